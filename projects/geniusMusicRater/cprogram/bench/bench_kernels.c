@@ -0,0 +1,489 @@
+// Microbenchmarks for the DSP kernels the analysis spends its time in.
+//
+//   bench_kernels [--reps N] [--warmup N] [--filter SUBSTR] [--cpu N]
+//                 [--save FILE] [--baseline FILE] [--threshold PCT]
+//
+// Every kernel runs on the same deterministic 30 s, 44.1 kHz test signal
+// (three sines plus noise), so results are comparable between machines and
+// builds. Each repetition is timed as a whole; the table shows the best and
+// median time per unit of work (one transform, one chroma frame, one onset
+// frame, ...) and reference cycles per input sample (x86 only, counted with
+// the TSC, which ticks at a fixed rate whatever the current clock).
+//
+// --cpu pins the process to one core. --save writes the medians to FILE;
+// --baseline reads such a file and marks every kernel that got slower by more
+// than --threshold percent (default 10), in which case the exit status is 1.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include "dsp.h"
+#include "audio_decoder.h"
+#include "harmony.h"
+#include "melody.h"
+#include "onset.h"
+#include "beats.h"
+#include "rhythm.h"
+#include "feature_extractor.h"
+#include "order_stats.h"
+#include "plan.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BENCH_HAVE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define BENCH_SR        44100
+#define BENCH_SECONDS   30
+#define BENCH_MAX_REPS  1000
+#define BENCH_MAX_KERNELS 32
+
+// Inputs shared by all kernels, built once.
+typedef struct {
+    float* mono;
+    size_t frames;
+    AudioBuffer stereo;         // 48 kHz stereo copy for the resampler
+    OnsetFunction onset;
+    BeatGrid beats;
+    double* odf;                // onset function as doubles for the median filter
+} BenchInput;
+
+// Work done by one repetition: units for ns/unit, input samples for cycles/sample.
+typedef struct {
+    size_t units;
+    size_t samples;
+} BenchWork;
+
+typedef struct {
+    const char* name;
+    const char* unit;
+    int (*run)(const BenchInput* in, BenchWork* work);
+} Kernel;
+
+typedef struct {
+    const char* name;
+    const char* unit;
+    size_t units;
+    double min_ns;              // per unit
+    double med_ns;
+    double cycles_per_sample;   // median repetition; < 0 without a TSC
+} KernelResult;
+
+static uint64_t read_cycles(void) {
+#ifdef BENCH_HAVE_TSC
+    return (uint64_t)__rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// ---------- Test signal ----------
+
+static int bench_input_init(BenchInput* in) {
+    memset(in, 0, sizeof(*in));
+    in->frames = (size_t)BENCH_SR * BENCH_SECONDS;
+    in->mono = (float*)malloc(sizeof(float) * in->frames);
+    if (!in->mono) return -1;
+
+    // A4, E5 and a 110 Hz bass with 120 BPM amplitude pulses, plus LCG noise
+    uint32_t seed = 12345u;
+    for (size_t i = 0; i < in->frames; i++) {
+        double t = (double)i / BENCH_SR;
+        double pulse = 0.5 + 0.5 * exp(-8.0 * fmod(t, 0.5));
+        seed = seed * 1664525u + 1013904223u;
+        double noise = ((double)(seed >> 8) / 16777216.0 - 0.5) * 0.05;
+        in->mono[i] = (float)(pulse * (0.3 * sin(2.0 * M_PI * 440.0 * t) +
+                                       0.2 * sin(2.0 * M_PI * 659.25 * t) +
+                                       0.3 * sin(2.0 * M_PI * 110.0 * t)) + noise);
+    }
+
+    // the same material as 48 kHz stereo, channels slightly apart
+    AudioBuffer* st = &in->stereo;
+    st->sample_rate = 48000;
+    st->channels = 2;
+    st->frames = (size_t)st->sample_rate * BENCH_SECONDS;
+    st->pcm = (float*)malloc(sizeof(float) * st->frames * 2);
+    if (!st->pcm) return -1;
+    for (size_t i = 0; i < st->frames; i++) {
+        size_t j = (size_t)((double)i * BENCH_SR / st->sample_rate);
+        if (j >= in->frames) j = in->frames - 1;
+        st->pcm[2 * i] = in->mono[j];
+        st->pcm[2 * i + 1] = 0.8f * in->mono[j];
+    }
+
+    if (compute_onset_function(in->mono, in->frames, BENCH_SR, &in->onset) != 0) return -1;
+    if (compute_beat_grid_onset(&in->onset, &in->beats) != 0) return -1;
+    in->odf = (double*)malloc(sizeof(double) * in->onset.odf_len);
+    if (!in->odf) return -1;
+    for (size_t i = 0; i < in->onset.odf_len; i++) in->odf[i] = in->onset.odf[i];
+    return 0;
+}
+
+static void bench_input_free(BenchInput* in) {
+    free(in->mono);
+    free(in->stereo.pcm);
+    free_onset_function(&in->onset);
+    free_beat_grid(&in->beats);
+    free(in->odf);
+}
+
+// ---------- Kernels ----------
+
+#define FFT_BATCH 256
+
+static int run_fft(int n, BenchWork* work) {
+    const FftPlan* plan = dsp_fft_plan(n);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * n);
+    if (!plan || !X) return -1;
+    for (int b = 0; b < FFT_BATCH; b++) {
+        for (int i = 0; i < n; i++) {
+            X[i].r = (double)((i * 7 + b) % 13) - 6.0;
+            X[i].i = 0.0;
+        }
+        dsp_fft(plan, X);
+    }
+    work->units = FFT_BATCH;
+    work->samples = (size_t)FFT_BATCH * n;
+    return 0;
+}
+
+static int run_fft1024(const BenchInput* in, BenchWork* work) {
+    (void)in;
+    return run_fft(1024, work);
+}
+static int run_fft2048(const BenchInput* in, BenchWork* work) {
+    (void)in;
+    return run_fft(2048, work);
+}
+static int run_fft4096(const BenchInput* in, BenchWork* work) {
+    (void)in;
+    return run_fft(4096, work);
+}
+
+// Parameters of the harmony stage at full resolution.
+static int run_chroma_goertzel(const BenchInput* in, BenchWork* work) {
+    double* chroma = NULL;
+    size_t n = 0;
+    int decim = BENCH_SR / 11025;
+    if (compute_chroma_goertzel(in->mono, in->frames, BENCH_SR, 2048, 1024, decim, &chroma, &n) != 0)
+        return -1;
+    free(chroma);
+    work->units = n;
+    work->samples = in->frames;
+    return 0;
+}
+
+#define YIN_BENCH_FRAMES 64
+
+static int run_yin(const BenchInput* in, BenchWork* work) {
+    volatile double sink = 0.0;
+    for (int f = 0; f < YIN_BENCH_FRAMES; f++) {
+        double conf;
+        sink += yin_get_pitch(in->mono + (size_t)f * 512, 2048, BENCH_SR, 80.0, 1200.0, &conf);
+    }
+    (void)sink;
+    work->units = YIN_BENCH_FRAMES;
+    work->samples = (size_t)YIN_BENCH_FRAMES * 2048;
+    return 0;
+}
+
+// Power spectrum -> 26 mel energies -> 13 cepstral coefficients through the
+// spectral features' mfcc_from_power() (the FFT is included).
+#define MEL_BENCH_FRAMES 512
+
+static int run_mel_dct(const BenchInput* in, BenchWork* work) {
+    const int n_fft = 1024, n_filters = 26, n_bins = n_fft / 2 + 1;
+    const double* window = dsp_window(DSP_HANN_PERIODIC, n_fft);
+    const FftPlan* plan = dsp_fft_plan(n_fft);
+    const double* mel_w = dsp_mel_filterbank(BENCH_SR, n_fft, n_filters, 0.0, BENCH_SR / 2.0);
+    const double* dct_basis = dsp_dct_basis(n_filters, FEATURE_MFCC_COUNT);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * n_fft);
+    if (!window || !plan || !mel_w || !dct_basis || !X) return -1;
+
+    double power[1024 / 2 + 1], melE[26], mfcc[FEATURE_MFCC_COUNT];
+    volatile double sink = 0.0;
+    for (int f = 0; f < MEL_BENCH_FRAMES; f++) {
+        const float* x = in->mono + (size_t)f * 512;
+        for (int i = 0; i < n_fft; i++) {
+            X[i].r = (double)x[i] * window[i];
+            X[i].i = 0.0;
+        }
+        dsp_fft(plan, X);
+        for (int k = 0; k < n_bins; k++) power[k] = X[k].r * X[k].r + X[k].i * X[k].i;
+        mfcc_from_power(power, n_bins, mel_w, n_filters, dct_basis, 0, melE, mfcc);
+        sink += mfcc[0];
+    }
+    (void)sink;
+    work->units = MEL_BENCH_FRAMES;
+    work->samples = (size_t)MEL_BENCH_FRAMES * 512;
+    return 0;
+}
+
+static int run_resample(const BenchInput* in, BenchWork* work) {
+    float* out = NULL;
+    size_t n = 0;
+    if (resample_and_mix_mono(&in->stereo, BENCH_SR, &out, &n) != 0) return -1;
+    free(out);
+    work->units = in->stereo.frames;
+    work->samples = in->stereo.frames * in->stereo.channels;
+    return 0;
+}
+
+// Window of the melody pitch smoothing.
+static int run_median(const BenchInput* in, BenchWork* work) {
+    int n = (int)in->onset.odf_len;
+    double* out = (double*)malloc(sizeof(double) * n);
+    if (!out) return -1;
+    int rc = median_filter_sliding(in->odf, out, n, 7);
+    free(out);
+    work->units = (size_t)n;
+    work->samples = in->frames;
+    return rc;
+}
+
+// Tempo from the onset autocorrelation.
+static int run_tempo_autocorr(const BenchInput* in, BenchWork* work) {
+    double bpm;
+    if (estimate_tempo_bpm_onset(&in->onset, &bpm) != 0) return -1;
+    work->units = in->onset.odf_len;
+    work->samples = in->frames;
+    return 0;
+}
+
+// Rhythm features over the beat grid (FFT tempogram autocorrelation).
+static int run_rhythm_autocorr(const BenchInput* in, BenchWork* work) {
+    RhythmFeatures rf;
+    if (compute_rhythm_features_beats(&in->beats, &rf) != 0) return -1;
+    free_rhythm_features(&rf);
+    work->units = in->beats.odf_len;
+    work->samples = in->frames;
+    return 0;
+}
+
+// Cost of one recorded --trace span (two clock reads and a buffer store).
+#define TRACE_BENCH_SPANS 65536
+
+static int run_trace_span(const BenchInput* in, BenchWork* work) {
+    (void)in;
+    if (trace_start() != 0) return -1;
+    for (int i = 0; i < TRACE_BENCH_SPANS; i++) {
+        uint64_t t0 = trace_now();
+        trace_span("bench", "span", t0, 0);
+    }
+    trace_stop();
+    work->units = TRACE_BENCH_SPANS;
+    work->samples = TRACE_BENCH_SPANS;
+    return 0;
+}
+
+static const Kernel KERNELS[] = {
+    { "fft1024",          "transform", run_fft1024 },
+    { "fft2048",          "transform", run_fft2048 },
+    { "fft4096",          "transform", run_fft4096 },
+    { "chroma_goertzel",  "frame",     run_chroma_goertzel },
+    { "yin_get_pitch",    "frame",     run_yin },
+    { "mel_dct",          "frame",     run_mel_dct },
+    { "resample_mix",     "frame",     run_resample },
+    { "median_filter",    "value",     run_median },
+    { "tempo_autocorr",   "odf frame", run_tempo_autocorr },
+    { "rhythm_autocorr",  "odf frame", run_rhythm_autocorr },
+    { "trace_span",       "span",      run_trace_span },
+};
+#define KERNEL_COUNT (sizeof(KERNELS) / sizeof(KERNELS[0]))
+
+// ---------- Timing ----------
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int time_kernel(const Kernel* k, const BenchInput* in, int warmup, int reps,
+                       KernelResult* out) {
+    double ns[BENCH_MAX_REPS];
+    double cyc[BENCH_MAX_REPS];
+    BenchWork work = {0, 0};
+    for (int r = 0; r < warmup; r++) {
+        if (k->run(in, &work) != 0) return -1;
+    }
+    for (int r = 0; r < reps; r++) {
+        double t0 = analysis_plan_now();
+        uint64_t c0 = read_cycles();
+        if (k->run(in, &work) != 0) return -1;
+        uint64_t c1 = read_cycles();
+        double t1 = analysis_plan_now();
+        if (work.units == 0 || work.samples == 0) return -1;
+        ns[r] = (t1 - t0) * 1e9 / (double)work.units;
+        cyc[r] = (double)(c1 - c0) / (double)work.samples;
+    }
+    qsort(ns, reps, sizeof(double), cmp_double);
+    qsort(cyc, reps, sizeof(double), cmp_double);
+    out->name = k->name;
+    out->unit = k->unit;
+    out->units = work.units;
+    out->min_ns = ns[0];
+    out->med_ns = ns[reps / 2];
+#ifdef BENCH_HAVE_TSC
+    out->cycles_per_sample = cyc[reps / 2];
+#else
+    out->cycles_per_sample = -1.0;
+#endif
+    return 0;
+}
+
+static int pin_to_cpu(int cpu) {
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) ? 0 : -1;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+// ---------- Baseline files ----------
+// One "name median_ns_per_unit" line per kernel; '#' starts a comment.
+
+static int save_baseline(const char* path, const KernelResult* res, int n) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "# bench_kernels baseline: kernel median_ns_per_unit\n");
+    for (int i = 0; i < n; i++) fprintf(f, "%s %.3f\n", res[i].name, res[i].med_ns);
+    return fclose(f);
+}
+
+// Median of `name` in the baseline file, or -1 if it is not listed.
+static double baseline_lookup(FILE* f, const char* name) {
+    char line[256], key[128];
+    double v;
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%127s %lf", key, &v) == 2 && strcmp(key, name) == 0) return v;
+    }
+    return -1.0;
+}
+
+int main(int argc, char** argv) {
+    int reps = 11, warmup = 2, cpu = -1;
+    double threshold = 10.0;
+    const char* filter = NULL;
+    const char* save_path = NULL;
+    const char* baseline_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc ? argv[i + 1] : NULL);
+        if (!v) {
+            fprintf(stderr, "Usage: %s [--reps N] [--warmup N] [--filter SUBSTR] [--cpu N]\n"
+                            "       [--save FILE] [--baseline FILE] [--threshold PCT]\n", argv[0]);
+            return 2;
+        }
+        if (strcmp(a, "--reps") == 0) reps = atoi(v);
+        else if (strcmp(a, "--warmup") == 0) warmup = atoi(v);
+        else if (strcmp(a, "--filter") == 0) filter = v;
+        else if (strcmp(a, "--cpu") == 0) cpu = atoi(v);
+        else if (strcmp(a, "--save") == 0) save_path = v;
+        else if (strcmp(a, "--baseline") == 0) baseline_path = v;
+        else if (strcmp(a, "--threshold") == 0) threshold = atof(v);
+        else {
+            fprintf(stderr, "Unknown option %s\n", a);
+            return 2;
+        }
+        i++;
+    }
+    if (reps < 1) reps = 1;
+    if (reps > BENCH_MAX_REPS) reps = BENCH_MAX_REPS;
+    if (warmup < 0) warmup = 0;
+    if (cpu >= 0 && pin_to_cpu(cpu) != 0) fprintf(stderr, "Could not pin to CPU %d\n", cpu);
+
+    FILE* baseline = NULL;
+    if (baseline_path && !(baseline = fopen(baseline_path, "r"))) {
+        fprintf(stderr, "Cannot read baseline %s\n", baseline_path);
+        return 2;
+    }
+
+    DspCache cache;
+    dsp_cache_init(&cache);
+    DspCache* prev = dsp_cache_bind(&cache);
+    BenchInput in;
+    if (bench_input_init(&in) != 0) {
+        fprintf(stderr, "Failed to build the test signal\n");
+        return 2;
+    }
+
+    printf("%d repetitions (+%d warmup), %d s at %d Hz%s\n", reps, warmup, BENCH_SECONDS, BENCH_SR,
+#ifdef BENCH_HAVE_TSC
+           ", cycles are TSC reference cycles"
+#else
+           ""
+#endif
+    );
+    printf("%-16s %-10s %8s %12s %12s %10s", "kernel", "unit", "units", "min ns/unit",
+           "med ns/unit", "cyc/sample");
+    if (baseline) printf(" %12s %8s", "baseline", "change");
+    printf("\n");
+
+    KernelResult res[BENCH_MAX_KERNELS];
+    int n_res = 0, regressions = 0, failed = 0;
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        if (filter && !strstr(KERNELS[k].name, filter)) continue;
+        KernelResult* r = &res[n_res];
+        if (time_kernel(&KERNELS[k], &in, warmup, reps, r) != 0) {
+            fprintf(stderr, "%s failed\n", KERNELS[k].name);
+            failed = 1;
+            continue;
+        }
+        n_res++;
+        printf("%-16s %-10s %8zu %12.1f %12.1f", r->name, r->unit, r->units, r->min_ns, r->med_ns);
+        if (r->cycles_per_sample >= 0.0) printf(" %10.2f", r->cycles_per_sample);
+        else printf(" %10s", "-");
+        if (baseline) {
+            double base = baseline_lookup(baseline, r->name);
+            if (base > 0.0) {
+                double change = 100.0 * (r->med_ns - base) / base;
+                int slower = change > threshold;
+                regressions += slower;
+                printf(" %12.1f %+7.1f%%%s", base, change, slower ? "  REGRESSION" : "");
+            } else {
+                printf(" %12s", "-");
+            }
+        }
+        printf("\n");
+    }
+
+    if (save_path && save_baseline(save_path, res, n_res) != 0) {
+        fprintf(stderr, "Cannot write %s\n", save_path);
+        failed = 1;
+    }
+    if (baseline) {
+        fclose(baseline);
+        if (regressions) printf("%d kernel(s) slower than the baseline by more than %.0f%%\n",
+                                regressions, threshold);
+    }
+
+    bench_input_free(&in);
+    dsp_cache_bind(prev);
+    dsp_cache_clear(&cache);
+    if (failed) return 2;
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+// Throughput of the 4x true-peak meter against the decode it rides along with.
+//
+//   bench_true_peak <file> [repetitions]
+//
+// Decodes the file once on one thread, then runs the streaming meter over the
+// decoded PCM in 8192-frame chunks (the size the decoder delivers) and reports
+// both rates and the meter's cost as a share of decode time.
+#include "audio_input.h"
+#include "truepeak.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CHUNK_FRAMES 8192
+
+static double seconds_since(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <file> [repetitions]\n", argv[0]);
+        return 1;
+    }
+    int reps = (argc > 2 ? atoi(argv[2]) : 5);
+    if (reps < 1) reps = 1;
+
+    AudioDecoder* dec = audio_decoder_create();
+    AudioInputOptions in;
+    audio_input_options_init(&in);
+    in.decode_threads = 1;
+    AudioBuffer buf;
+    clock_t t0 = clock();
+    int rc = audio_load(dec, argv[1], &in, &buf);
+    double decode_s = seconds_since(t0);
+    audio_decoder_destroy(dec);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to load %s: error %d\n", argv[1], rc);
+        return 2;
+    }
+
+    double best = 0.0;
+    TruePeakResult tp = {0};
+    for (int r = 0; r < reps; r++) {
+        TruePeakMeter m;
+        if (true_peak_init(&m, buf.sample_rate, buf.channels, buf.frames) != 0) return 2;
+        t0 = clock();
+        for (size_t f = 0; f < buf.frames; f += CHUNK_FRAMES) {
+            size_t n = (buf.frames - f < CHUNK_FRAMES ? buf.frames - f : CHUNK_FRAMES);
+            true_peak_push(&m, buf.pcm + f * buf.channels, n, f);
+        }
+        double s = seconds_since(t0);
+        if (r == 0 || s < best) best = s;
+        free_true_peak_result(&tp);
+        true_peak_finish(&m, &tp);
+        true_peak_free(&m);
+    }
+
+    double audio_s = (double)buf.frames / buf.sample_rate;
+    double samples = (double)buf.frames * buf.channels;
+    printf("audio:      %.1f s, %d Hz, %d ch\n", audio_s, buf.sample_rate, buf.channels);
+    printf("decode:     %.3f s  (%.0fx realtime)\n", decode_s, decode_s > 0 ? audio_s / decode_s : 0.0);
+    printf("true peak:  %.3f s  (%.0fx realtime, %.1f Msamples/s, best of %d)\n",
+           best, best > 0 ? audio_s / best : 0.0, best > 0 ? samples / best / 1e6 : 0.0, reps);
+    if (decode_s > 0) printf("cost:       %.1f%% of decode time\n", 100.0 * best / decode_s);
+    printf("result:     %.2f dBTP (sample peak %.2f dBFS)\n", tp.true_peak_dbtp, tp.sample_peak_dbfs);
+
+    free_true_peak_result(&tp);
+    free_audio_buffer(&buf);
+    return 0;
+}
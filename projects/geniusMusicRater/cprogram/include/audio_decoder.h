@@ -12,19 +12,73 @@ typedef struct {
     size_t frames;     // Number of frames (per channel)
     int sample_rate;   // Hz
     int channels;      // 1 or 2 (or more, but typically 2)
+
+    // Block pcm points into when it was loaded without a copy (WAV/raw input);
+    // NULL when pcm is its own malloc'd block.
+    void* storage;
+    size_t storage_size;
+    int storage_mapped; // storage is a read-only file mapping, not heap memory
 } AudioBuffer;
 
-// Decode an MP3 file to float32 PCM using libmpg123.
+// Reusable MP3 decoder (one libmpg123 handle, reopened per file).
+// Not thread-safe: use one decoder per thread.
+typedef struct AudioDecoder AudioDecoder;
+
+AudioDecoder* audio_decoder_create(void);
+void audio_decoder_destroy(AudioDecoder* dec);
+
+// Decode an MP3 file with an existing decoder. Returns 0 on success.
+int audio_decoder_decode(AudioDecoder* dec, const char* path, AudioBuffer* out);
+
+// Most segments a file is split into for parallel decode.
+#define AUDIO_MAX_SEGMENTS 16
+
+// Receiver for decoded float32 PCM, so callers can consume audio as it is
+// decoded instead of holding the whole interleaved signal.
+typedef struct {
+    // Called before any frames with the stream format, the exact length from
+    // a header scan (0 if unknown) and how many segments will deliver frames.
+    // May be called a second time (segments == 1) if a parallel attempt is
+    // abandoned; the sink must then start over. Non-zero aborts the decode.
+    int (*begin)(void* user, int sample_rate, int channels, size_t expected_frames, int segments);
+    // Interleaved frames [first_frame, first_frame + count). Each segment
+    // delivers its frames in order from its own thread; different segments
+    // run concurrently on disjoint ranges. Non-zero aborts the decode.
+    int (*frames)(void* user, int segment, size_t first_frame, const float* interleaved, size_t count);
+} AudioSink;
+
+// Decode an MP3 file into a sink on `threads` threads (<= 0: one per CPU,
+// 1: sequential). *total_frames receives the number of frames delivered.
+int audio_decoder_stream(AudioDecoder* dec, const char* path, int threads,
+                         const AudioSink* sink, void* user, size_t* total_frames);
+
+// Decode an MP3 file on `threads` threads (<= 0: one per CPU). The frame
+// index is used to split the stream into segments decoded on separate
+// handles into one presized buffer; output matches audio_decoder_decode().
+// Short files and streams without a usable index are decoded sequentially.
+int audio_decoder_decode_parallel(AudioDecoder* dec, const char* path, int threads, AudioBuffer* out);
+
+// Decode an MP3 held in memory (e.g. read from stdin). Returns 0 on success.
+int audio_decoder_decode_memory(AudioDecoder* dec, const unsigned char* data, size_t size,
+                                AudioBuffer* out);
+
+// Decode an MP3 file to float32 PCM using libmpg123 (one-shot decoder).
 // Returns 0 on success, non-zero on error.
 int decode_mp3_to_pcm(const char* path, AudioBuffer* out);
 
-// Free resources allocated in AudioBuffer.
+// Free resources allocated in AudioBuffer (heap block or file mapping).
 void free_audio_buffer(AudioBuffer* buf);
 
 // Mix an interleaved multi-channel buffer to mono and resample to target_sr (linear).
 // Returns 0 on success, non-zero on error. Caller owns *out_pcm.
 int resample_and_mix_mono(const AudioBuffer* in, int target_sr, float** out_pcm, size_t* out_frames);
 
+// Resample a malloc'd mono buffer from in_sr to out_sr (linear), taking
+// ownership of it: *out_pcm is either mono itself (downsampled in place) or a
+// new block, in which case mono is freed. Returns 0 on success.
+int resample_mono_linear(float* mono, size_t frames, int in_sr, int out_sr,
+                         float** out_pcm, size_t* out_frames);
+
 #ifdef __cplusplus
 }
 #endif
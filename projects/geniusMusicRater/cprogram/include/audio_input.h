@@ -0,0 +1,53 @@
+#ifndef AUDIO_INPUT_H
+#define AUDIO_INPUT_H
+
+#include <stddef.h>
+#include "audio_decoder.h"
+#include "genius_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Input containers accepted besides MP3. WAV and raw float32 files are
+// memory-mapped; float32 data is used in place instead of being copied.
+typedef enum {
+    AUDIO_INPUT_AUTO = 0,   // detect from file extension and header bytes
+    AUDIO_INPUT_MP3,
+    AUDIO_INPUT_WAV,        // PCM16/24/32 or IEEE float32
+    AUDIO_INPUT_RAW_F32     // headerless little-endian float32, interleaved
+} AudioInputFormat;
+
+typedef struct {
+    AudioInputFormat format;
+    int raw_sample_rate;    // raw f32 only (default 44100)
+    int raw_channels;       // raw f32 only (default 1)
+    int decode_threads;     // MP3 files: segments decoded in parallel (0 = one per CPU, 1 = sequential)
+} AudioInputOptions;
+
+GENIUS_API void audio_input_options_init(AudioInputOptions* opts);
+
+// Parse "auto", "mp3", "wav" or "f32"/"raw". Returns 0 on success.
+GENIUS_API int audio_input_format_from_name(const char* name, AudioInputFormat* out);
+
+// Guess the container from the first bytes and the path's extension (path may
+// be NULL). A headerless extension (.f32, .raw, .pcm) wins over the header
+// bytes; otherwise the extension only decides when the header is inconclusive.
+GENIUS_API AudioInputFormat audio_input_detect(const unsigned char* head, size_t n, const char* path);
+
+// Format of the file at path: requested, or detected from its first bytes
+// when requested is AUDIO_INPUT_AUTO. Not for stdin.
+GENIUS_API AudioInputFormat audio_input_resolve(const char* path, AudioInputFormat requested);
+
+// Load path ("-" = stdin) into out. MP3 goes through dec. Returns 0 on success.
+int audio_load(AudioDecoder* dec, const char* path, const AudioInputOptions* opts, AudioBuffer* out);
+
+// Read-only view of a whole file: mmap where available, a heap copy otherwise.
+void* audio_map_file(const char* path, size_t* size, int* mapped);
+void audio_release_storage(void* base, size_t size, int mapped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_INPUT_H
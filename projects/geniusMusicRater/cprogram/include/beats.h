@@ -0,0 +1,53 @@
+#ifndef BEATS_H
+#define BEATS_H
+
+#include <stddef.h>
+#include "onset.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Beat grid shared by the rhythm, harmony and structure analyses, so the
+// beat positions are computed once per track.
+typedef struct {
+    float* odf;                // copy of the onset function (see onset.h), one value per hop
+    size_t odf_len;
+    size_t hop_size;           // samples per onset envelope frame
+    int sample_rate;
+
+    double tempo_bpm;          // global tempo from the envelope autocorrelation
+    double tempo_confidence;   // [0-1]
+
+    size_t* beat_frames;       // onset envelope frame of each beat, increasing
+    double* beat_times;        // the same positions in seconds
+    size_t beat_count;
+} BeatGrid;
+
+/**
+ * Track beats in a mono PCM signal (Ellis 2007 dynamic programming over the
+ * onset envelope: each beat maximises onset strength plus a log-period
+ * penalty on the gap to the previous beat).
+ *
+ * @param mono        - pointer to mono float samples
+ * @param frames      - number of frames in PCM buffer
+ * @param sample_rate - sampling rate (e.g. 44100 Hz)
+ * @param out         - grid to fill; release with free_beat_grid()
+ * @return 0 on success (beat_count may be 0 when no tempo is found), nonzero on error
+ */
+int compute_beat_grid(const float* mono,
+                      size_t frames,
+                      int sample_rate,
+                      BeatGrid* out);
+
+// Same, from an onset function that is already computed (the grid keeps its
+// own copy of the ODF).
+int compute_beat_grid_onset(const OnsetFunction* onset, BeatGrid* out);
+
+void free_beat_grid(BeatGrid* grid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BEATS_H
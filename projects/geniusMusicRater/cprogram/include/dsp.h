@@ -0,0 +1,119 @@
+#ifndef DSP_H
+#define DSP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// SSE2 is part of every x86-64 target; kernels fall back to scalar code elsewhere.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DSP_HAVE_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#define DSP_THREAD_LOCAL __declspec(thread)
+#else
+#define DSP_THREAD_LOCAL _Thread_local
+#endif
+
+// ---------- FFT (radix-2, precomputed twiddles + bit-reversal) ----------
+
+typedef struct { double r, i; } DspComplex;
+
+typedef struct {
+    int n;               // transform size (power of two)
+    int* bitrev;         // n entries
+    DspComplex* twiddle; // n/2 entries: exp(-2*pi*i*k/n)
+} FftPlan;
+
+// In-place forward transform of n complex values.
+void dsp_fft(const FftPlan* plan, DspComplex* a);
+
+// ---------- Dense products ----------
+
+// out[r*cols + c] = sum_k a[r*inner + k] * b[k*cols + c] (all row-major).
+// Vectorized over c (SSE2 where available); cols is typically small, e.g.
+// chroma frames x 12 times 12 x 24 chord templates.
+void dsp_matmul(const double* a, size_t rows, int inner,
+                const double* b, int cols, double* out);
+
+// ---------- Window kinds ----------
+
+typedef enum {
+    DSP_HANN_PERIODIC = 0,  // 0.5*(1-cos(2*pi*i/n))
+    DSP_HANN_SYMMETRIC      // 0.5*(1-cos(2*pi*i/(n-1)))
+} DspWindowKind;
+
+// ---------- Cache of plans, tables and scratch memory ----------
+
+typedef enum {
+    DSP_SCRATCH_FFT = 0,    // complex frame buffer
+    DSP_SCRATCH_MAG,        // magnitude / power spectrum
+    DSP_SCRATCH_AUX,        // per-frame helper vectors (mel energies, ...)
+    DSP_SCRATCH_SLOTS
+} DspScratchSlot;
+
+typedef struct {
+    int n;
+    DspWindowKind kind;
+    double* w;
+} DspWindow;
+
+typedef struct {
+    int sr, n_fft, n_filters;
+    double fmin, fmax;
+    double* weights;     // n_filters * (n_fft/2+1)
+} DspMel;
+
+typedef struct {
+    int n_in, n_out;
+    double* basis;       // n_out * n_in DCT-II basis
+} DspDct;
+
+// Owned by a GeniusContext (one per thread); see dsp_cache_bind().
+typedef struct {
+    FftPlan** plans;     // entries never move, so returned pointers stay valid
+    int plan_count, plan_cap;
+    DspWindow* windows;
+    int window_count, window_cap;
+    DspMel* mels;
+    int mel_count, mel_cap;
+    DspDct* dcts;
+    int dct_count, dct_cap;
+    void* scratch[DSP_SCRATCH_SLOTS];
+    size_t scratch_size[DSP_SCRATCH_SLOTS];
+} DspCache;
+
+void dsp_cache_init(DspCache* cache);
+void dsp_cache_clear(DspCache* cache);
+
+// Make `cache` the one used by this thread's analysis calls.
+// Returns the previously bound cache (NULL if none) so callers can restore it.
+DspCache* dsp_cache_bind(DspCache* cache);
+
+// Bound cache, or a per-thread fallback when nothing is bound.
+DspCache* dsp_cache_current(void);
+
+// Lookups below use the current cache; results stay valid until it is cleared.
+// NULL on allocation failure or (for plans) a size that is not a power of two.
+const FftPlan* dsp_fft_plan(int n);
+const double* dsp_window(DspWindowKind kind, int n);
+const double* dsp_mel_filterbank(int sr, int n_fft, int n_filters, double fmin, double fmax);
+// DCT-II basis: basis[k*n_in + n] = cos(pi/n_in * (n+0.5) * k)
+const double* dsp_dct_basis(int n_in, int n_out);
+
+// Reusable scratch buffer for `slot`; contents are undefined and the pointer is
+// only valid until the next request for the same slot.
+void* dsp_scratch(DspScratchSlot slot, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DSP_H
@@ -0,0 +1,73 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opt-in fast math (--fast-math): inline replacements for the libm calls in
+// per-frame and per-bin loops. They are branch-free and built from +, *, /
+// and integer bit operations only, so loops that use them can vectorize.
+// Maximum errors over the documented domain:
+//
+//   fm_log(x)     x positive, normal      absolute error < 3e-8
+//   fm_log2(x)    same                    absolute error < 5e-8
+//   fm_log10(x)   same                    absolute error < 2e-8
+//   fm_exp(x)     -708 <= x <= 709        relative error < 1e-8
+//
+// Like the DSP cache, the mode is bound to the calling thread for the
+// duration of one analysis; stages test fast_math_enabled() once per call.
+
+// Bind the mode for this thread (0 = libm); returns the previous one.
+int fast_math_bind(int on);
+int fast_math_enabled(void);
+
+static inline double fm_bits_to_double(uint64_t u) { double d; memcpy(&d, &u, sizeof(d)); return d; }
+static inline uint64_t fm_double_to_bits(double d) { uint64_t u; memcpy(&u, &d, sizeof(u)); return u; }
+
+// x = 2^e * m with m folded into [sqrt(1/2), sqrt(2)); log(m) = 2*atanh(t),
+// t = (m-1)/(m+1), |t| < 0.1716, odd series through t^7.
+static inline double fm_log(double x) {
+    uint64_t u = fm_double_to_bits(x);
+    double e = (double)(int64_t)(u >> 52) - 1023.0;
+    double m = fm_bits_to_double((u & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL);
+    double big = (double)(m > 1.4142135623730951);
+    m *= 1.0 - 0.5 * big;
+    e += big;
+    double t = (m - 1.0) / (m + 1.0);
+    double t2 = t * t;
+    double p = ((2.0 / 7.0 * t2 + 2.0 / 5.0) * t2 + 2.0 / 3.0) * t2 + 2.0;
+    return e * 0.69314718055994531 + p * t;
+}
+
+static inline double fm_log2(double x) { return fm_log(x) * 1.4426950408889634; }
+static inline double fm_log10(double x) { return fm_log(x) * 0.43429448190325183; }
+
+// exp(x) = 2^n * exp(r), n = round(x / ln2) via the 1.5*2^52 rounding trick,
+// |r| <= ln2/2, degree-7 Taylor polynomial.
+static inline double fm_exp(double x) {
+    const double magic = 6755399441055744.0;     // 1.5 * 2^52
+    x = (x < -708.0 ? -708.0 : (x > 709.0 ? 709.0 : x));
+    double kn = x * 1.4426950408889634 + magic;
+    int64_t n = (int64_t)(fm_double_to_bits(kn) - fm_double_to_bits(magic));
+    kn -= magic;
+    double r = (x - kn * 0.693147180369123816490) - kn * 1.90821492927058770002e-10;
+    double p = 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+    return p * fm_bits_to_double((uint64_t)(n + 1023) << 52);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FASTMATH_H
@@ -2,6 +2,7 @@
 #define FEATURE_EXTRACTOR_H
 
 #include <stddef.h>
+#include "onset.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,6 +14,8 @@ typedef struct {
     double centroid;   // Hz
     double rolloff;    // Hz (85% energy)
     double brightness; // ratio [0,1] energy above ~1500 Hz
+    double bandwidth;  // Hz, power-weighted spread around the centroid
+    double flatness;   // geometric / arithmetic mean of power [0,1]
     double mfcc[FEATURE_MFCC_COUNT]; // averaged over frames
 } SpectralFeatures;
 
@@ -20,14 +23,35 @@ typedef struct {
 // Returns 0 on success.
 int compute_spectral_features(const float* mono, size_t frames, int sr, SpectralFeatures* out);
 
+// Same, averaging only every stride-th frame (stride 1 = all frames).
+int compute_spectral_features_stride(const float* mono, size_t frames, int sr, int stride,
+                                     SpectralFeatures* out);
+
+// MFCCs of one frame from its power spectrum (n_bins values): log mel
+// energies through the n_filters x n_bins filterbank mel_w into melE, then
+// the FEATURE_MFCC_COUNT x n_filters DCT basis into mfcc. fast selects the
+// fm_log approximation.
+void mfcc_from_power(const double* power, int n_bins, const double* mel_w, int n_filters,
+                     const double* dct_basis, int fast, double* melE, double* mfcc);
+
 // Estimate tempo in BPM using onset envelope + autocorrelation.
 // Returns 0 on success; out_bpm set to 0 if uncertain.
 int estimate_tempo_bpm(const float* mono, size_t frames, int sr, double* out_bpm);
 
+// Same, from an onset function that is already computed.
+int estimate_tempo_bpm_onset(const OnsetFunction* onset, double* out_bpm);
+
 // Estimate musical key (e.g., "C major", "A minor") using chroma + Krumhansl profiles.
 // out_key must have space for at least 8 chars. Returns 0 on success.
 int estimate_key(const float* mono, size_t frames, int sr, char out_key[8]);
 
+// Key of an accumulated 12-bin chroma vector (index 0 = C).
+void estimate_key_chroma(const double chroma[12], char out_key[8]);
+
+// Pitch class of every bin of an n_fft spectrum at rate sr (n_fft/2+1
+// entries, -1 outside 50-5000 Hz), as used by the key chroma.
+void chroma_bin_pitch_classes(int sr, int n_fft, int* bin_pc);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,57 @@
+#ifndef FEATURE_GRAPH_H
+#define FEATURE_GRAPH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Feature dependency graph. Every output (and every intermediate several
+// outputs share, like the onset function and the beat grid) is a node; a
+// selection is closed over the dependencies and evaluated in node order,
+// each node once, so shared products are computed a single time.
+//
+// Node order is a topological order: dependencies always come first.
+
+typedef enum {
+    FEATURE_STATS = 0,      // basic stats
+    FEATURE_SPECTRAL,       // centroid / rolloff / brightness / MFCC
+    FEATURE_ONSET,          // onset function (intermediate)
+    FEATURE_TEMPO,
+    FEATURE_KEY,
+    FEATURE_PRODUCTION,     // native-rate meters: loudness, true peak, stereo
+    FEATURE_PSY,            // roughness, dissonance, dynamic range
+    FEATURE_RATINGS,
+    FEATURE_BEATS,          // beat grid (intermediate, also reported)
+    FEATURE_RHYTHM,
+    FEATURE_HARMONY,
+    FEATURE_MELODY,
+    FEATURE_STRUCTURE,
+    FEATURE_GENIUS,
+    FEATURE_COUNT
+} FeatureNode;
+
+#define FEATURE_BIT(n) (1u << (n))
+#define FEATURE_ALL    (FEATURE_BIT(FEATURE_COUNT) - 1u)
+
+// Outputs computed when nothing is selected: all but the optional stages.
+#define FEATURE_DEFAULT (FEATURE_ALL & ~(FEATURE_BIT(FEATURE_MELODY) | \
+                                         FEATURE_BIT(FEATURE_STRUCTURE) | \
+                                         FEATURE_BIT(FEATURE_GENIUS)))
+
+// Direct dependencies of a node.
+unsigned feature_deps(FeatureNode node);
+
+// `selected` plus everything it needs, transitively.
+unsigned feature_closure(unsigned selected);
+
+// Parse a comma-separated list of names ("tempo,key,loudness") into a mask.
+// Returns 0 on success, -1 on an unknown name.
+int feature_parse_list(const char* list, unsigned* out);
+
+const char* feature_name(FeatureNode node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FEATURE_GRAPH_H
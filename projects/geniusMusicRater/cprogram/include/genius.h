@@ -0,0 +1,112 @@
+#ifndef GENIUS_H
+#define GENIUS_H
+
+/*
+ * libgenius: embeddable analysis API.
+ *
+ * A GeniusContext owns everything that can be reused between tracks: cached
+ * FFT plans, windows and filterbanks, scratch buffers and the MP3 decoder
+ * handle. Contexts are not thread-safe; use one context per thread.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include "audio_decoder.h"
+#include "audio_input.h"
+#include "output_writer.h"
+#include "feature_graph.h"
+#include "genius_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever GeniusOptions / GeniusLiveUpdate change layout or the API
+// changes incompatibly.
+#define GENIUS_API_VERSION 17
+
+typedef struct GeniusContext GeniusContext;
+
+// Result of one analysis; opaque, see the accessors below.
+typedef struct GeniusReport GeniusReport;
+
+// Pitch trackers for melody features (see genius_parse_melody_backend).
+#define GENIUS_MELODY_YIN      0    // time-domain YIN (default)
+#define GENIUS_MELODY_SALIENCE 1    // harmonic summation, much faster
+
+typedef struct {
+    const char* genre;       // "rap", "vgm", "pop", "experimental", "phonk"; NULL = default
+    int melody;              // enable melody extraction
+    int structure;           // enable structure extraction
+    int genius;              // enable genius rating
+    int analysis_sample_rate;// mono analysis rate (0 = 44100)
+    double budget_sec;       // wall-clock budget per track (0 = unlimited)
+    unsigned features;       // FEATURE_BIT() outputs to compute (0 = FEATURE_DEFAULT); see feature_graph.h
+    int fast_math;           // bounded-error approximations in hot loops
+    int melody_backend;      // GENIUS_MELODY_*
+    AudioInputOptions input; // container selection for genius_analyze_file
+} GeniusOptions;
+
+GENIUS_API int genius_api_version(void);
+GENIUS_API void genius_options_init(GeniusOptions* opts);
+
+// Create contexts from a single thread (libmpg123 initialization is not
+// guaranteed to be thread-safe); using them afterwards is per-thread.
+GENIUS_API GeniusContext* genius_context_create(void);
+GENIUS_API void genius_context_destroy(GeniusContext* ctx);
+
+// An empty report to analyze into; NULL on allocation failure. One report
+// can be reused for any number of analyses.
+GENIUS_API GeniusReport* genius_report_create(void);
+GENIUS_API void genius_report_destroy(GeniusReport* report);
+
+// Load and analyze an MP3, WAV or raw float32 file ("-" = stdin) into `out`,
+// replacing what it held. Returns 0 on success; on failure the report is
+// left empty.
+GENIUS_API int genius_analyze_file(GeniusContext* ctx, const char* path,
+                                   const GeniusOptions* opts, GeniusReport* out);
+
+// Analyze already-decoded interleaved float PCM. Mono input at the analysis
+// rate is read in place, without a copy.
+GENIUS_API int genius_analyze_pcm(GeniusContext* ctx, const AudioBuffer* pcm,
+                                  const GeniusOptions* opts, GeniusReport* out);
+
+// ---------- Report accessors ----------
+// The headline values; everything else is available by serializing the
+// report (genius_report_write).
+
+// 0 if `node` was computed successfully, 1 if it was not computed, another
+// value if it failed (negative: a stage it depends on failed).
+GENIUS_API int genius_report_status(const GeniusReport* report, FeatureNode node);
+GENIUS_API const char* genius_report_profile(const GeniusReport* report);
+GENIUS_API double genius_report_duration_sec(const GeniusReport* report);
+GENIUS_API double genius_report_tempo_bpm(const GeniusReport* report);
+GENIUS_API const char* genius_report_key(const GeniusReport* report);
+GENIUS_API double genius_report_integrated_lufs(const GeniusReport* report);
+// Overall genius score (0..100), -1 when the genius rating was not computed.
+GENIUS_API int genius_report_genius_score(const GeniusReport* report);
+
+// Serialize a report as one record. `source` is echoed as the "file" field.
+GENIUS_API int genius_report_write(const GeniusReport* report, const char* source,
+                                   OutputWriter* w);
+
+// Write the report as one object without closing the record, so it can be
+// nested (`key` inside an open object, NULL inside an array / at the root).
+GENIUS_API int genius_report_write_object(const GeniusReport* report, const char* source,
+                                          OutputWriter* w, const char* key);
+
+// Parse a comma-separated feature selection ("tempo,key,loudness") into a
+// GeniusOptions.features mask. Returns 0 on success, -1 on an unknown name.
+GENIUS_API int genius_parse_features(const char* list, unsigned* out);
+
+// Parse a melody backend name ("yin", "salience") into a GENIUS_MELODY_* value.
+GENIUS_API int genius_parse_melody_backend(const char* name, int* out);
+
+// Parse an output format name ("json", "jsonl", "cbor", "msgpack").
+GENIUS_API int genius_parse_format(const char* name, OutputFormat* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GENIUS_H
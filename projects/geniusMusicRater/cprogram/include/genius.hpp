@@ -0,0 +1,143 @@
+#ifndef GENIUS_HPP
+#define GENIUS_HPP
+
+// Header-only C++ wrapper around the libgenius C API (genius.h).
+//
+//   genius::Context ctx;
+//   genius::Report r = ctx.analyze_file("song.mp3", opts);
+//   std::string json = r.to_string(OUTPUT_JSON, "song.mp3");
+
+#include "genius.h"
+#include <stdexcept>
+#include <string>
+
+namespace genius {
+
+class Error : public std::runtime_error {
+public:
+    Error(const std::string& what, int code) : std::runtime_error(what), code_(code) {}
+    int code() const noexcept { return code_; }
+private:
+    int code_;
+};
+
+class Options {
+public:
+    Options() { genius_options_init(&opts_); }
+    Options& genre(const char* name) { opts_.genre = name; return *this; }
+    Options& melody(bool on = true) { opts_.melody = on ? 1 : 0; return *this; }
+    Options& structure(bool on = true) { opts_.structure = on ? 1 : 0; return *this; }
+    Options& genius(bool on = true) { opts_.genius = on ? 1 : 0; return *this; }
+    Options& analysis_sample_rate(int sr) { opts_.analysis_sample_rate = sr; return *this; }
+    Options& budget_sec(double sec) { opts_.budget_sec = sec; return *this; }
+    Options& features(unsigned mask) { opts_.features = mask; return *this; }
+    // Comma-separated selection, e.g. "tempo,key,loudness".
+    Options& features(const char* list) {
+        if (genius_parse_features(list, &opts_.features) != 0)
+            throw Error(std::string("genius: unknown feature in '") + list + "'", -1);
+        return *this;
+    }
+    Options& fast_math(bool on = true) { opts_.fast_math = on ? 1 : 0; return *this; }
+    Options& melody_backend(int backend) { opts_.melody_backend = backend; return *this; }
+    // "yin" or "salience"
+    Options& melody_backend(const char* name) {
+        if (genius_parse_melody_backend(name, &opts_.melody_backend) != 0)
+            throw Error(std::string("genius: unknown melody backend '") + name + "'", -1);
+        return *this;
+    }
+    Options& input(const AudioInputOptions& in) { opts_.input = in; return *this; }
+    const GeniusOptions* get() const noexcept { return &opts_; }
+private:
+    GeniusOptions opts_;
+};
+
+// Move-only owner of a GeniusReport.
+class Report {
+public:
+    Report() : report_(genius_report_create()) {
+        if (!report_) throw Error("genius: failed to create report", -1);
+    }
+    ~Report() { genius_report_destroy(report_); }
+    Report(Report&& o) noexcept : report_(o.report_) { o.report_ = nullptr; }
+    Report& operator=(Report&& o) noexcept {
+        if (this != &o) {
+            genius_report_destroy(report_);
+            report_ = o.report_;
+            o.report_ = nullptr;
+        }
+        return *this;
+    }
+    Report(const Report&) = delete;
+    Report& operator=(const Report&) = delete;
+
+    int status(FeatureNode node) const { return genius_report_status(report_, node); }
+    std::string profile() const { return genius_report_profile(report_); }
+    double duration_sec() const { return genius_report_duration_sec(report_); }
+    double tempo_bpm() const { return genius_report_tempo_bpm(report_); }
+    std::string key() const { return genius_report_key(report_); }
+    double integrated_lufs() const { return genius_report_integrated_lufs(report_); }
+    int genius_score() const { return genius_report_genius_score(report_); }
+
+    const GeniusReport* get() const noexcept { return report_; }
+    GeniusReport* raw() noexcept { return report_; }
+
+    // Serialize as one record in the given format.
+    std::string to_string(OutputFormat format, const char* source = "") const {
+        OutputWriter w;
+        writer_init(&w, format);
+        int rc = genius_report_write(report_, source, &w);
+        std::string out;
+        if (rc == 0) out.assign(reinterpret_cast<const char*>(w.data), w.len);
+        writer_free(&w);
+        if (rc != 0) throw Error("genius: failed to serialize report", rc);
+        return out;
+    }
+
+private:
+    GeniusReport* report_;
+};
+
+// Move-only owner of a GeniusContext. Not thread-safe; use one per thread.
+class Context {
+public:
+    Context() : ctx_(genius_context_create()) {
+        if (!ctx_) throw Error("genius: failed to create context", -1);
+    }
+    ~Context() { genius_context_destroy(ctx_); }
+    Context(Context&& o) noexcept : ctx_(o.ctx_) { o.ctx_ = nullptr; }
+    Context& operator=(Context&& o) noexcept {
+        if (this != &o) {
+            genius_context_destroy(ctx_);
+            ctx_ = o.ctx_;
+            o.ctx_ = nullptr;
+        }
+        return *this;
+    }
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    Report analyze_file(const std::string& path, const Options& opts = Options()) {
+        Report r;
+        int rc = genius_analyze_file(ctx_, path.c_str(), opts.get(), r.raw());
+        if (rc != 0) throw Error("genius: failed to analyze " + path, rc);
+        return r;
+    }
+
+    Report analyze_pcm(const AudioBuffer& pcm, const Options& opts = Options()) {
+        Report r;
+        int rc = genius_analyze_pcm(ctx_, &pcm, opts.get(), r.raw());
+        if (rc != 0) throw Error("genius: failed to analyze PCM buffer", rc);
+        return r;
+    }
+
+    GeniusContext* get() const noexcept { return ctx_; }
+
+private:
+    GeniusContext* ctx_;
+};
+
+inline int api_version() { return genius_api_version(); }
+
+} // namespace genius
+
+#endif // GENIUS_HPP
@@ -0,0 +1,18 @@
+#ifndef GENIUS_EXPORT_H
+#define GENIUS_EXPORT_H
+
+// Symbol visibility for the public libgenius API (genius.h, audio_input.h,
+// output_writer.h, live.h, trace.h).
+#if defined(_WIN32) && defined(GENIUS_SHARED)
+#  ifdef GENIUS_BUILDING
+#    define GENIUS_API __declspec(dllexport)
+#  else
+#    define GENIUS_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__) && defined(GENIUS_SHARED)
+#  define GENIUS_API __attribute__((visibility("default")))
+#else
+#  define GENIUS_API
+#endif
+
+#endif // GENIUS_EXPORT_H
@@ -0,0 +1,85 @@
+#ifndef GENIUS_REPORT_H
+#define GENIUS_REPORT_H
+
+/*
+ * Layout of GeniusReport, shared by the pipeline (genius.c) and the
+ * serializer (report.c). Not part of the public API: applications hold the
+ * report through the opaque handle in genius.h and read it with the
+ * accessors there or by serializing it.
+ */
+
+#include "genius.h"
+#include "feature_extractor.h"
+#include "psychoacoustics.h"
+#include "grading.h"
+#include "beats.h"
+#include "rhythm.h"
+#include "harmony.h"
+#include "melody.h"
+#include "structure.h"
+#include "production.h"
+#include "geniusgrading.h"
+#include "plan.h"
+#include "timeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    double duration_sec;
+    double rms;
+    double peak;
+    double dc_offset;
+    double zcr; // zero-crossing rate (per second)
+} GeniusBasicStats;
+
+// Result of one analysis. Status fields are 0 when the stage succeeded.
+struct GeniusReport {
+    int api_version;
+
+    // source format
+    int sample_rate;
+    int channels;
+    size_t frames;
+
+    // analysis basis
+    int analysis_sample_rate;
+    size_t mono_frames;
+
+    GeniusBasicStats stats;
+
+    SpectralFeatures spectral;      int rc_spectral;
+    double tempo_bpm;               int rc_tempo;
+    char key[8];                    int rc_key;
+    PsychoacousticFeatures psy;     int rc_psy;
+    Ratings ratings;                int rc_ratings;
+    char profile[16];               // rating/genre profile label
+    BeatGrid beats;                 int rc_beats;    // shared by rhythm/harmony/structure
+    RhythmFeatures rhythm;          int rc_rhythm;
+    HarmonyFeatures harmony;        int rc_harmony;
+    MelodyFeatures melody;          int rc_melody;
+    StructureFeatures structure;    int rc_structure;
+    ProductionFeatures production;  int rc_production;
+    GeniusResult genius;
+    GeniusTimelineScores genius_timeline;   // per-section and rolling genius scores
+    AnalysisPlan resolution;        // budget plan and the resolution each stage used
+
+    // options the report was produced with
+    unsigned features;              // FEATURE_BIT() nodes computed (selection + dependencies)
+    int features_only;              // an explicit selection: only computed sections are written
+    int fast_math;
+    MelodyBackend melody_backend;
+    int melody_enabled;
+    int structure_enabled;
+    int genius_enabled;
+};
+
+// Release the arrays the report owns and leave it empty.
+void genius_report_clear(GeniusReport* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GENIUS_REPORT_H
@@ -12,6 +12,10 @@
 #include "production.h"
 #include <math.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Already defined before...
 typedef struct {
     double duration_sec;
@@ -117,4 +121,8 @@ int compute_genius_rating(const GeniusInputs* in,
                           GeniusResult* out,
                           GeniusGenre genre);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include "feature_extractor.h"
 #include "psychoacoustics.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Ratings in 0–100 scale
 typedef struct {
     int harmonic_quality;
@@ -59,4 +63,8 @@ int compute_ratings(const SpectralFeatures* spec,
                     Ratings* out,
                     const RatingWeights* weights);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
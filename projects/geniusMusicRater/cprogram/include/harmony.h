@@ -2,6 +2,11 @@
 #define HARMONY_H
 
 #include <stddef.h>
+#include "beats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 // Basic chord label
 typedef struct {
@@ -9,15 +14,25 @@ typedef struct {
     double time_sec;   // estimated beat/time position
 } ChordLabel;
 
+// Stretch of the local key track
+typedef struct {
+    char key[16];      // e.g. "G", "Em"
+    double start_sec;
+    double end_sec;
+    double strength;   // mean profile correlation over the stretch
+} KeySegment;
+
 // Harmony features
 typedef struct {
     char global_key[16];       // global/most probable key ("C", "Am", etc.)
     double key_stability;      // 0..1 how consistent piece is in one key
-    double modulation_count;   // number of detected key changes
+    double modulation_count;   // number of changes in the local key track
     double harmonic_motion;    // average Tonnetz distance between chords
     double tension;            // avg harmonic tension (0..1 scale)
     int chord_count;
-    ChordLabel* chords;        // dynamic array of chords (beat-synchronous)
+    ChordLabel* chords;        // dynamic array of chords (one per beat)
+    int key_segment_count;
+    KeySegment* key_segments;  // local key timeline (10 s window, 1 s steps)
 } HarmonyFeatures;
 
 /**
@@ -34,7 +49,54 @@ int compute_harmony_features(const float* mono,
                              int sample_rate,
                              HarmonyFeatures* out);
 
+// Same, labelling one chord per beat of `beats` (chroma averaged over each
+// beat). NULL beats or a grid with fewer than two beats: one chord per second.
+int compute_harmony_features_beats(const float* mono,
+                                   size_t frames,
+                                   int sample_rate,
+                                   const BeatGrid* beats,
+                                   HarmonyFeatures* out);
+
+// Per-chord terms of harmonic_motion and tension: Jaccard distance between
+// two chords' pitch-class sets, and tension of a chord in `key` (the share of
+// its notes outside the scale, +0.2 for minor). Both -1 when undefined.
+double harmony_chord_distance(const char* a, const char* b);
+double harmony_chord_tension(const char* chord, const char* key);
+
+// The chroma front end: Goertzel filters on MIDI notes 40..88 over Hann frames
+// of the signal decimated by `decim`. *out_chroma is out_frames x 12,
+// row-major, each row normalized; the caller frees it. 0 on success.
+int compute_chroma_goertzel(const float* mono,
+                            size_t frames,
+                            int sample_rate,
+                            size_t win_size,
+                            size_t hop_size,
+                            int decim,
+                            double** out_chroma,
+                            size_t* out_frames);
+
+// Chord estimate for live input: the chord Viterbi run forward one chroma
+// frame at a time (no look-ahead, constant work per frame).
+#define CHORD_TRACKER_STATES 24
+
+typedef struct {
+    double templates[12 * CHORD_TRACKER_STATES];
+    char names[CHORD_TRACKER_STATES][16];
+    double delta[CHORD_TRACKER_STATES];   // log scores, best = 0
+    size_t frames;
+} ChordTracker;
+
+void chord_tracker_init(ChordTracker* t);
+
+// Feed one 12-bin chroma frame (index 0 = C, any scale); returns the name of
+// the current chord ("C", "Am", ...), valid until the next call.
+const char* chord_tracker_push(ChordTracker* t, const double chroma[12]);
+
 // Free chord array
 void free_harmony_features(HarmonyFeatures* hf);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // HARMONY_H
\ No newline at end of file
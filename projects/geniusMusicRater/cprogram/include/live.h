@@ -0,0 +1,64 @@
+#ifndef LIVE_H
+#define LIVE_H
+
+#include <stddef.h>
+#include "output_writer.h"
+#include "genius_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Live analysis (mp3_analyzer --live): interleaved float PCM is pushed as it
+ * arrives and a snapshot of loudness, tempo, key, spectral centroid and the
+ * current chord is taken after every push. All state is ring-buffered, so the
+ * work per update depends on the update size, not on how long the stream has
+ * been running:
+ *
+ *   loudness  momentary / short-term from a 3 s ring of 100 ms sub-blocks,
+ *             integrated from a gating histogram, range from two P-square
+ *             quantile sketches (see loudness.h)
+ *   tempo     onset function over the last LIVE_TEMPO_SEC
+ *   key       chroma of the last LIVE_KEY_SEC
+ *   chord     forward chord Viterbi, one step per chroma frame
+ *   centroid  mean over the frames completed during the update
+ */
+
+#define LIVE_UPDATE_SEC 0.25
+#define LIVE_TEMPO_SEC  8.0
+#define LIVE_KEY_SEC    15.0
+
+typedef struct GeniusLive GeniusLive;
+
+typedef struct {
+    double t_sec;               // stream time at the end of the update
+    double momentary_lufs;
+    double short_term_lufs;
+    double integrated_lufs;
+    double loudness_range_lu;   // streaming estimate, see loudness.h
+    double tempo_bpm;           // 0 until enough onsets have been seen
+    char key[8];
+    double centroid;            // Hz
+    char chord[16];
+    double latency_ms;          // processing time of this update
+    double rtf;                 // processing time / stream time so far
+} GeniusLiveUpdate;
+
+// NULL on bad arguments or allocation failure.
+GENIUS_API GeniusLive* genius_live_create(int sample_rate, int channels);
+GENIUS_API void genius_live_destroy(GeniusLive* live);
+
+// Add `frames` interleaved frames and fill `out` with the state after them.
+// Returns 0 on success.
+GENIUS_API int genius_live_process(GeniusLive* live, const float* interleaved, size_t frames,
+                                   GeniusLiveUpdate* out);
+
+// One record per update.
+GENIUS_API int genius_live_write(const GeniusLiveUpdate* u, OutputWriter* w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIVE_H
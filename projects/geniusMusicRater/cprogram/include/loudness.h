@@ -0,0 +1,119 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <stddef.h>
+#include "order_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ITU-R BS.1770-4 / EBU R128 loudness: K-weighting (high shelf + RLB
+// high-pass biquads) per channel, 100 ms sub-block energies, 400 ms gated
+// blocks for integrated loudness and 3 s blocks for loudness range.
+
+#define LOUDNESS_SILENCE (-120.0)   // reported instead of -inf (no audible block)
+
+typedef struct {
+    double integrated_lufs;     // gated (-70 LUFS absolute, -10 LU relative)
+    double loudness_range_lu;   // EBU Tech 3342: P95 - P10 of gated short-term values
+    double max_momentary_lufs;  // 400 ms
+    double max_short_term_lufs; // 3 s
+
+    // One value per second: loudest momentary block and short-term loudness
+    // at the end of each second. Only full windows are measured, so the
+    // opening seconds read LOUDNESS_SILENCE until 400 ms / 3 s have passed.
+    float* momentary;
+    float* short_term;
+    size_t track_len;
+
+    // Energy of every 400 ms block (block i starts at i * block_hop_sec);
+    // loudness_gated() over any run of them is that span's integrated loudness.
+    double* blocks;
+    size_t block_count;
+    double block_hop_sec;
+} LoudnessResult;
+
+typedef struct { double b0, b1, b2, a1, a2; } Biquad;
+
+// Streaming meter. Frames may arrive in any chunking; parallel producers
+// each use a fork and the results are merged before _finish(). A fork starts
+// from a silent filter state, so it keeps its first LOUDNESS_SETTLE_SEC of
+// input aside; _merge() re-filters those frames from the state the preceding
+// segment ended in, by which point the fork's own state has converged.
+#define LOUDNESS_SETTLE_SEC 0.5
+
+typedef struct {
+    int sample_rate;
+    int channels;
+    size_t sub_len;             // samples per 100 ms sub-block
+    Biquad shelf, highpass;
+    double weight[8];           // per-channel gain (1.41 for 5.1 surrounds, 0 for LFE)
+    double* state;              // 4 filter states per channel
+    double* energy;             // weighted K-filtered energy per sub-block
+    size_t energy_cap;
+    size_t frames;              // frames pushed
+    size_t end_frame;           // one past the highest frame seen
+    float* head;                // forks: first frames pushed, energy added at merge
+    size_t head_len, head_cap;  // in frames
+    size_t first;               // forks: absolute first frame pushed
+} LoudnessMeter;
+
+int loudness_meter_init(LoudnessMeter* m, int sample_rate, int channels, size_t expected_frames);
+// Add interleaved frames that start at absolute frame first_frame.
+int loudness_meter_push(LoudnessMeter* m, const float* interleaved, size_t count, size_t first_frame);
+// Meter for another producer of the same stream. Merge forks in stream order.
+int loudness_meter_fork(const LoudnessMeter* parent, LoudnessMeter* child, size_t expected_frames);
+int loudness_meter_merge(LoudnessMeter* dst, const LoudnessMeter* src);
+int loudness_meter_finish(const LoudnessMeter* m, LoudnessResult* out);
+void loudness_meter_free(LoudnessMeter* m);
+
+// Live meter: the same K-weighting with bounded state. The last 3 s of
+// sub-block energies live in a ring; integrated loudness gates a histogram
+// of the 400 ms block energies (0.1 LU bins from -70 to +5 LUFS, louder
+// blocks in the top bin) instead of keeping every block. Loudness range
+// tracks the 10th and 95th percentile of the short-term values with two
+// P-square sketches; the relative gate uses the mean as it stands when each
+// value arrives, so early values may pass a gate the final mean would reject.
+#define LOUDNESS_LIVE_RING   30
+#define LOUDNESS_LIVE_BIN_LU 0.1
+#define LOUDNESS_LIVE_BINS   750
+
+typedef struct {
+    LoudnessMeter meter;        // coefficients and filter state only
+    double ring[LOUDNESS_LIVE_RING];
+    size_t sub_blocks;          // complete sub-blocks so far
+    double partial;             // energy of the sub-block in progress
+    size_t partial_len;
+    unsigned hist_count[LOUDNESS_LIVE_BINS];
+    double hist_energy[LOUDNESS_LIVE_BINS];
+    double short_sum;           // short-term energies above the absolute gate
+    size_t short_count;
+    QuantileSketch range_lo;    // gated short-term loudness, p10 / p95
+    QuantileSketch range_hi;
+} LoudnessLive;
+
+int loudness_live_init(LoudnessLive* l, int sample_rate, int channels);
+int loudness_live_push(LoudnessLive* l, const float* interleaved, size_t count);
+// Current momentary (400 ms), short-term (3 s) and integrated loudness;
+// LOUDNESS_SILENCE until a full window has been seen. Any pointer may be NULL.
+void loudness_live_read(const LoudnessLive* l, double* momentary, double* short_term,
+                        double* integrated);
+// Loudness range (LU) so far; 0 until a short-term value has passed the gates.
+double loudness_live_range(const LoudnessLive* l);
+void loudness_live_free(LoudnessLive* l);
+
+// Integrated loudness of n 400 ms block energies: absolute gate at -70 LUFS,
+// then a relative gate 10 LU below the mean of the blocks that passed.
+double loudness_gated(const double* blocks, size_t n);
+
+// One-shot measurement of an interleaved buffer.
+int compute_loudness(const float* interleaved, size_t frames, int sample_rate, int channels,
+                     LoudnessResult* out);
+void free_loudness_result(LoudnessResult* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOUDNESS_H
@@ -23,6 +23,20 @@ typedef struct {
     double hook_strength;            /* 0..1 heuristic combining repetition + length + energy */
 } MelodyFeatures;
 
+/* Pitch tracker behind the features:
+ *   YIN       time-domain YIN per frame + median smoothing (default)
+ *   SALIENCE  harmonic summation over a log-frequency spectrogram, contour
+ *             picked by Viterbi; much faster, steadier on dense mixes
+ */
+typedef enum {
+    MELODY_BACKEND_YIN = 0,
+    MELODY_BACKEND_SALIENCE
+} MelodyBackend;
+
+/* "yin" or "salience"; returns 0 on success. */
+int melody_backend_from_name(const char* name, MelodyBackend* out);
+const char* melody_backend_name(MelodyBackend backend);
+
 /* Returns 0 on success (features filled). Non-zero only on invalid input.
  * The function is conservative: if no voiced material is found it still returns 0
  * and fills the features with 0/NaN-safe values. 
@@ -32,6 +46,19 @@ int compute_melody_features(const float* mono,
                             int sample_rate,
                             MelodyFeatures* out);
 
+/* Same, with the given pitch tracker. */
+int compute_melody_features_backend(const float* mono,
+                                    size_t frames,
+                                    int sample_rate,
+                                    MelodyBackend backend,
+                                    MelodyFeatures* out);
+
+/* YIN pitch of one frame of N samples: Hz, or 0 if unvoiced or outside
+ * [fmin, fmax]. out_confidence (may be NULL) gets 1 - the CMND minimum. */
+double yin_get_pitch(const float* frame, int N,
+                     int sr, double fmin, double fmax,
+                     double* out_confidence);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,77 @@
+#ifndef ONSET_H
+#define ONSET_H
+
+#include <stddef.h>
+#include "spectral_kernel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Onset detection function shared by the tempo estimate, the beat tracker,
+// the rhythm metrics and structure novelty, computed once per track from one
+// STFT. Magnitudes are log-compressed, the rectified flux is averaged within
+// log-spaced bands (so bass and hi-hat onsets weigh the same as the dense mid
+// range) and the bands are summed; a moving average is then subtracted.
+
+#define ONSET_BANDS    8
+#define ONSET_FFT_SIZE 1024
+#define ONSET_HOP_SIZE 512      // ~11.6 ms at 44.1kHz
+
+typedef struct {
+    float* odf;                 // onset strength per hop, >= 0
+    float* band_energy;         // odf_len x ONSET_BANDS mean log magnitude per band
+    size_t odf_len;
+    size_t hop_size;            // samples per ODF frame
+    int sample_rate;
+    double frame_rate;          // ODF frames per second
+} OnsetFunction;
+
+/**
+ * Compute the onset detection function of a mono signal.
+ *
+ * @param mono        - pointer to mono float samples
+ * @param frames      - number of frames in PCM buffer
+ * @param sample_rate - sampling rate (e.g. 44100 Hz)
+ * @param out         - function to fill; release with free_onset_function()
+ * @return 0 on success, nonzero on error (signal shorter than one FFT frame)
+ */
+int compute_onset_function(const float* mono, size_t frames, int sample_rate,
+                           OnsetFunction* out);
+
+void free_onset_function(OnsetFunction* of);
+
+// ---------- Streaming ----------
+// The same onset function for live input. Samples are pushed as they arrive;
+// every completed hop appends one band-flux value to a ring of the last
+// `history` frames, so memory and per-push work stay bounded.
+
+typedef struct {
+    int sample_rate;
+    double frame_rate;
+    SpectralKernel kernel;
+    float* input;               // pending samples, up to ONSET_FFT_SIZE
+    size_t input_len;
+    double* levels;             // two level spectra (owned) ...
+    double* level;              // ... current
+    double* prev;               // ... previous frame
+    float* flux;                // ring of `history` band-flux values
+    size_t history;
+    size_t frames;              // frames produced so far
+} OnsetStream;
+
+int onset_stream_init(OnsetStream* s, int sample_rate, size_t history);
+int onset_stream_push(OnsetStream* s, const float* mono, size_t n);
+
+// The most recent n frames (capped at what is held) with the local mean
+// subtracted, as an OnsetFunction without band energies. Release with
+// free_onset_function(). Nonzero when no frame is available yet.
+int onset_stream_function(const OnsetStream* s, size_t n, OnsetFunction* out);
+
+void onset_stream_free(OnsetStream* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ONSET_H
@@ -0,0 +1,71 @@
+#ifndef ORDER_STATS_H
+#define ORDER_STATS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------- Selection (quickselect, expected O(n)) ----------
+
+// Return the k-th smallest value (0-based) of arr. Reorders arr in place.
+double select_kth(double* arr, size_t n, size_t k);
+
+// Percentile using the floor(p * (n-1)) index convention (p in [0,1]).
+// Reorders arr in place. Returns 0.0 for n == 0.
+double percentile_select(double* arr, size_t n, double p);
+
+// Median (mean of the two middle values for even n). Reorders arr in place.
+double median_select(double* arr, size_t n);
+
+// ---------- Sliding median (two indexed heaps, O(log w) per update) ----------
+
+typedef struct {
+    double* values;     // ring buffer of window values
+    int* heap_of;       // per ring slot: 0 = low (max-heap), 1 = high (min-heap)
+    int* pos_of;        // per ring slot: index inside its heap
+    int* low;           // max-heap of ring slots (smaller half)
+    int* high;          // min-heap of ring slots (larger half)
+    int n_low, n_high;
+    int head;           // ring slot of the oldest value
+    int count;          // values currently in the window
+    int capacity;
+} SlidingMedian;
+
+// Returns 0 on success.
+int sliding_median_init(SlidingMedian* sm, int capacity);
+void sliding_median_free(SlidingMedian* sm);
+
+// Append a value as the newest element (window must not be full).
+void sliding_median_push(SlidingMedian* sm, double x);
+// Drop the oldest element.
+void sliding_median_pop(SlidingMedian* sm);
+// Element of rank count/2 in the current window (upper median for even counts).
+double sliding_median_get(const SlidingMedian* sm);
+
+// Centered median filter with edge windows truncated to the signal, matching
+// "sort window, take buf[m/2]" semantics. win <= 1 copies the input.
+int median_filter_sliding(const double* in, double* out, int n, int win);
+
+// ---------- Streaming quantile sketch (P-square, O(1) memory) ----------
+
+typedef struct {
+    double p;           // target quantile in (0,1)
+    double q[5];        // marker heights
+    double pos[5];      // actual marker positions
+    double want[5];     // desired marker positions
+    double inc[5];      // desired position increments
+    size_t count;
+} QuantileSketch;
+
+void quantile_sketch_init(QuantileSketch* qs, double p);
+void quantile_sketch_add(QuantileSketch* qs, double x);
+// Current estimate (exact while fewer than 5 values were seen).
+double quantile_sketch_get(const QuantileSketch* qs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ORDER_STATS_H
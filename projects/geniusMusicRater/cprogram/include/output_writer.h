@@ -0,0 +1,88 @@
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "genius_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OUTPUT_MAX_DEPTH 32
+
+typedef enum {
+    OUTPUT_JSON = 0,    // pretty-printed JSON (default, what the web viewer expects)
+    OUTPUT_JSONL,       // one compact JSON object per line
+    OUTPUT_CBOR,        // RFC 8949
+    OUTPUT_MSGPACK      // MessagePack
+} OutputFormat;
+
+// Structured writer: every value is appended to one growable buffer,
+// which is emitted with a single write once the record is complete.
+typedef struct {
+    OutputFormat format;
+    unsigned char* data;
+    size_t len;
+    size_t cap;
+    int depth;
+    int count[OUTPUT_MAX_DEPTH];       // values written in each open container
+    int is_map[OUTPUT_MAX_DEPTH];
+    int is_inline[OUTPUT_MAX_DEPTH];   // JSON: keep container on one line
+    size_t head_pos[OUTPUT_MAX_DEPTH]; // binary: where the container header goes
+    int error;                         // sticky: allocation failure / misuse
+} OutputWriter;
+
+// Parse "json", "jsonl", "cbor" or "msgpack". Returns 0 on success.
+GENIUS_API int output_format_from_name(const char* name, OutputFormat* out);
+
+GENIUS_API void writer_init(OutputWriter* w, OutputFormat format);
+GENIUS_API void writer_free(OutputWriter* w);
+// Drop buffered bytes but keep the allocation (for writing the next record).
+GENIUS_API void writer_reset(OutputWriter* w);
+
+// `key` names the member inside objects; pass NULL inside arrays / at the root.
+GENIUS_API void writer_begin_object(OutputWriter* w, const char* key);
+GENIUS_API void writer_end_object(OutputWriter* w);
+GENIUS_API void writer_begin_array(OutputWriter* w, const char* key);
+GENIUS_API void writer_end_array(OutputWriter* w);
+
+GENIUS_API void writer_string(OutputWriter* w, const char* key, const char* value);
+// `decimals` only affects JSON text; negative = shortest round-trip form.
+GENIUS_API void writer_double(OutputWriter* w, const char* key, double value, int decimals);
+GENIUS_API void writer_int(OutputWriter* w, const char* key, long long value);
+GENIUS_API void writer_bool(OutputWriter* w, const char* key, int value);
+GENIUS_API void writer_null(OutputWriter* w, const char* key);
+
+// Close the current record (JSON variants get their trailing newline).
+// Returns 0 if the buffer holds a complete, well-formed record.
+GENIUS_API int writer_end_record(OutputWriter* w);
+
+// Write the buffered bytes with one fwrite. Returns 0 on success.
+GENIUS_API int writer_flush(const OutputWriter* w, FILE* f);
+
+// ---------- Schema tables for flat structs ----------
+
+typedef enum {
+    FIELD_DOUBLE = 0,
+    FIELD_INT,
+    FIELD_SIZE,
+    FIELD_STRING,   // inline char array
+    FIELD_BOOL      // int treated as true/false
+} FieldType;
+
+typedef struct {
+    const char* key;
+    FieldType type;
+    size_t offset;  // offsetof() into the struct
+    int decimals;   // FIELD_DOUBLE only
+} FieldSpec;
+
+// Write every field described by spec[0..n) from the struct at base.
+GENIUS_API void writer_fields(OutputWriter* w, const void* base, const FieldSpec* spec, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OUTPUT_WRITER_H
@@ -0,0 +1,76 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Time-budgeted analysis. A plan picks the analysis sample rate and per-stage
+// frame hops so the predicted cost (a per-stage model scaled by a measured
+// machine speed) fits the budget; stages that refine coarse-to-fine stop once
+// their deadline approaches. Stages record the resolution they actually used.
+//
+// Like the DSP cache, a plan is bound to the calling thread for the duration
+// of one analysis; stages look up their entry with analysis_plan_stage().
+
+typedef enum {
+    PLAN_CHROMA = 0,    // harmony chroma frames
+    PLAN_MELODY,        // YIN pitch frames
+    PLAN_STRUCTURE,     // per-section MFCC frames
+    PLAN_DISSONANCE,    // psychoacoustic peak-analysis frames
+    PLAN_STAGES
+} PlanStage;
+
+typedef struct {
+    int hop_scale;          // frame hop multiplier over the stage default (1 = full resolution)
+    double deadline;        // analysis_plan_now() value to finish by (0 = none)
+
+    // filled in by the stage
+    int ran;
+    int truncated;          // stopped refining before reaching hop_scale
+    double hop_sec;         // frame hop actually used
+    double coverage;        // share of the full-resolution frames analysed [0-1]
+} StagePlan;
+
+typedef struct {
+    double budget_sec;      // 0 = unlimited
+    double start;           // analysis_plan_now() when the analysis began
+    double deadline;        // start + budget_sec (0 = none)
+    double speed;           // measured seconds per modelled second (1 = reference machine)
+    int decimation;         // analysis sample rate divisor
+    StagePlan stage[PLAN_STAGES];
+} AnalysisPlan;
+
+// Wall clock in seconds (C11 timespec_get).
+double analysis_plan_now(void);
+
+void analysis_plan_init(AnalysisPlan* plan, double budget_sec, double start);
+
+// Choose decimation (at most max_decimation) and stage hops for a track of
+// duration_sec, after a short calibration run. No-op without a budget.
+void analysis_plan_choose(AnalysisPlan* plan, double duration_sec, int max_decimation,
+                          int melody, int structure);
+
+// Re-plan melody and structure from the time the earlier mono stages really
+// took (elapsed_sec) and set their deadlines. No-op without a budget.
+void analysis_plan_refine(AnalysisPlan* plan, double duration_sec, double elapsed_sec,
+                          int melody, int structure);
+
+// Bind `plan` to this thread (NULL unbinds); returns the previous one.
+AnalysisPlan* analysis_plan_bind(AnalysisPlan* plan);
+
+// Entry for `stage` in the bound plan, NULL when none is bound.
+StagePlan* analysis_plan_stage(PlanStage stage);
+
+// True once a stage with this plan entry should stop refining.
+int analysis_plan_expired(const StagePlan* sp);
+
+const char* analysis_plan_stage_name(PlanStage stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PLAN_H
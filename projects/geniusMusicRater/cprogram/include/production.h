@@ -2,19 +2,120 @@
 #define PRODUCTION_H
 
 #include <stddef.h>
+#include "loudness.h"
+#include "truepeak.h"
+#include "dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Stereo image over the whole track: L and R share one complex FFT per hop
+// (x = L + iR, the two spectra separated by conjugate symmetry), from which
+// mid/side energy and L/R correlation are summed per band and the phase
+// coherence per second.
+#define PRODUCTION_STEREO_FFT   2048
+#define PRODUCTION_STEREO_HOP   1024
+#define PRODUCTION_STEREO_BANDS 5       // edges 150, 500, 2000, 6000 Hz
+
+typedef struct {
+    double low_hz;
+    double high_hz;
+    double energy_share;         // share of the track's energy in this band
+    double side_ratio;           // side / (mid + side) energy (0 = mono, 0.5 = unrelated L/R)
+    double correlation;          // L/R spectral correlation (1 = mono, 0 = unrelated, -1 = inverted)
+} StereoBand;
+
+typedef struct {
+    int valid;                   // 0 for mono input or tracks shorter than one frame
+    StereoBand bands[PRODUCTION_STEREO_BANDS];
+    double side_ratio;           // all bands
+    double phase_coherence;      // magnitude-weighted mean cos(phase L - phase R), -1..1
+    float* coherence;            // phase coherence per second (owned)
+    size_t coherence_len;
+} StereoImage;
 
 // Features describing production/timbre aspects
 typedef struct {
-    double loudness_db;          // Integrated loudness (dB LUFS or RMS converted)
-    double dynamic_range_db;     // Peak-to-quiet difference
+    double loudness_db;          // Integrated loudness (LUFS, BS.1770)
+    double dynamic_range_db;     // True-peak-to-RMS difference
     double stereo_width;         // Correlation between channels (1.0 = mono, 0.0 = wide)
     double spectral_balance;     // Ratio of low vs high frequencies
     double masking_index;        // Estimate of spectral masking/clutter
+    LoudnessResult loudness;     // integrated/range/max + per-second tracks (owned)
+    TruePeakResult true_peak;    // 4x oversampled peak + per-second track (owned)
+    StereoImage stereo;          // per-band mid/side and coherence track (owned)
 } ProductionFeatures;
 
 // Skeleton for computation (to implement step by step)
 int compute_production_features(const float* stereo, size_t frames, int sample_rate, int channels, ProductionFeatures* out);
 
-void free_production_features(ProductionFeatures* pf); // in case we add malloc'd arrays later
+// Incremental form of compute_production_features() for audio that arrives
+// in chunks while it is decoded. The spectral windows are placed from the
+// expected length, so feeding exactly that many frames gives the same result
+// as the one-shot call.
+#define PRODUCTION_WINDOWS 10
+
+// Stereo transform state of one accumulator. Frames sit at multiples of
+// PRODUCTION_STEREO_HOP; a frame that straddles two forked segments is
+// completed at merge time from the first segment's pending samples and the
+// second one's head.
+typedef struct {
+    const FftPlan* plan;         // from the DSP cache of the creating thread
+    const double* window;
+    int band_first[PRODUCTION_STEREO_BANDS + 1];
+    DspComplex* fft;             // PRODUCTION_STEREO_FFT values (owned)
+    float* buf;                  // pending L,R pairs, at most one frame (owned)
+    size_t buf_start;            // absolute frame of buf[0]
+    size_t buf_len;
+    float* head;                 // first FFT-1 pairs pushed (owned)
+    size_t head_len;
+    size_t first;                // absolute first frame pushed
+    int started;
+    size_t frames;               // transforms summed
+    double ll[PRODUCTION_STEREO_BANDS], rr[PRODUCTION_STEREO_BANDS], lr[PRODUCTION_STEREO_BANDS];
+    double* sec_lr;              // per second: sum Re(L conj R) ...
+    double* sec_mag;             // ... and sum |L||R|
+    size_t sec_cap;
+} StereoAccumulator;
+
+typedef struct {
+    int sample_rate;
+    int channels;
+    size_t expected_frames;
+    size_t frames;               // frames pushed so far
+    double sumsq, peak;
+    double sumL, sumR, sumL2, sumR2, sumLR;
+
+    int fft_size;
+    int window_count;
+    size_t window_start[PRODUCTION_WINDOWS];
+    double* windows;             // window_count * fft_size mono samples
+    int owns_windows;
+
+    LoudnessMeter loudness;
+    int has_loudness;
+    TruePeakMeter true_peak;
+    int has_true_peak;
+    StereoAccumulator stereo;
+    int has_stereo;
+} ProductionAccumulator;
+
+int production_acc_init(ProductionAccumulator* acc, int sample_rate, int channels, size_t expected_frames);
+// Add interleaved frames starting at absolute frame first_frame. Frames must
+// arrive in order per accumulator. Returns -1 if a meter could not grow.
+int production_acc_push(ProductionAccumulator* acc, const float* interleaved, size_t count, size_t first_frame);
+// Accumulator for another thread feeding a disjoint frame range of the same
+// stream; it shares the parent's window buffer. Combine with _merge().
+int production_acc_fork(const ProductionAccumulator* parent, ProductionAccumulator* child);
+void production_acc_merge(ProductionAccumulator* dst, const ProductionAccumulator* src);
+int production_acc_finish(ProductionAccumulator* acc, ProductionFeatures* out);
+void production_acc_free(ProductionAccumulator* acc);
+
+void free_production_features(ProductionFeatures* pf); // releases the loudness, peak and coherence tracks
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
\ No newline at end of file
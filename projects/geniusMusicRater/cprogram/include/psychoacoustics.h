@@ -2,15 +2,16 @@
 #define PSYCHOACOUSTICS_H
 
 #include <stddef.h>
+#include "loudness.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct {
-    double roughness;      // [0..1] relative
-    double dissonance;     // [0..1] relative
-    double loudness_lu;    // LUFS-like loudness estimate
+    double roughness;      // [0..1] Plomp-Levelt pair curve over spectral peaks, energy weighted
+    double dissonance;     // [0..1] Sethares sensory dissonance (min-amplitude weighted)
+    double loudness_lu;    // integrated loudness, LUFS (BS.1770)
     double dynamic_range;  // dB difference between loud & quiet percentiles
 } PsychoacousticFeatures;
 
@@ -18,6 +19,22 @@ typedef struct {
 // Returns 0 on success.
 int compute_psychoacoustics(const float* mono, size_t frames, int sr, PsychoacousticFeatures* out);
 
+// Same, taking loudness_lu from an existing measurement (e.g. the stereo
+// signal at its native rate); NULL measures the mono buffer itself.
+int compute_psychoacoustics_loudness(const float* mono, size_t frames, int sr,
+                                     const LoudnessResult* loudness, PsychoacousticFeatures* out);
+
+// Level frames behind dynamic_range: PSY_LEVEL_WIN samples, PSY_LEVEL_HOP apart.
+#define PSY_LEVEL_WIN 4096
+#define PSY_LEVEL_HOP 2048
+
+// RMS level in dB of every level frame (*out_db owned by the caller).
+// Returns 0 on success.
+int psy_frame_levels_db(const float* mono, size_t frames, double** out_db, size_t* out_n);
+
+// P95 - P05 of n frame levels, as dynamic_range is for the whole track.
+double psy_dynamic_range(const double* db, size_t n);
+
 #ifdef __cplusplus
 }
 #endif
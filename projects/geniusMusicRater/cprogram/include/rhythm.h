@@ -2,6 +2,11 @@
 #define RHYTHM_H
 
 #include <stddef.h>
+#include "beats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef struct {
     double tempo_bpm;          // Detected main tempo (beats per minute)
@@ -10,6 +15,10 @@ typedef struct {
     double pulse_clarity;      // How steady/clear the beat pulse is [0-1]
     double syncopation;        // Level of off-beat complexity
     double swing_ratio;        // If swing is detected, ratio (e.g. 2:1 for triplet feel)
+    int beat_count;            // Beats found by the tracker
+    double tempo_stability;    // Share of seconds whose local tempi agree within +-4% [0-1]
+    float* local_tempo;        // Local tempo (BPM) per second from the tempogram, 0 = no peak (owned)
+    size_t local_tempo_len;
 } RhythmFeatures;
 
 /**
@@ -18,7 +27,8 @@ typedef struct {
  * @param mono        - pointer to mono float samples
  * @param frames      - number of frames in PCM buffer
  * @param sample_rate - sampling rate (e.g. 44100 Hz)
- * @param out         - pointer to struct to fill with rhythm features
+ * @param out         - pointer to struct to fill with rhythm features;
+ *                      release with free_rhythm_features()
  * @return 0 on success, nonzero on error
  */
 int compute_rhythm_features(const float* mono,
@@ -26,4 +36,21 @@ int compute_rhythm_features(const float* mono,
                             int sample_rate,
                             RhythmFeatures* out);
 
+/**
+ * Same, from an existing beat grid (see compute_beat_grid()): pulse clarity,
+ * syncopation and swing are measured at the tracked beat positions.
+ */
+int compute_rhythm_features_beats(const BeatGrid* grid, RhythmFeatures* out);
+
+// Onset peak on each beat (on[b]) and halfway to the next one (off[b], -1
+// where there is none): the per-beat terms of pulse clarity and syncopation.
+void rhythm_beat_peaks(const BeatGrid* grid, double* on, double* off);
+
+// Release the local tempo track.
+void free_rhythm_features(RhythmFeatures* rf);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // RHYTHM_H
\ No newline at end of file
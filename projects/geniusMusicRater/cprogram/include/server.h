@@ -0,0 +1,36 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Resident analysis daemon (mp3_analyzer --serve /path/to.sock).
+ *
+ * Clients connect to a Unix domain socket and send one JSON request per line:
+ *   {"id": 1, "path": "song.mp3", "genre": "rap", "flags": ["m", "s", "g"]}
+ * ("melody"/"structure"/"genius" booleans work as well). Each request gets
+ * one JSON line back on the same connection, in completion order:
+ *   {"id": 1, "status": "ok", "elapsed_ms": 812.4, "result": {...}}
+ *   {"id": 2, "status": "busy", "retry_after_ms": 1500, "queued": 16}
+ *   {"id": 3, "status": "error", "error": "decode failed", "code": -2}
+ */
+
+typedef struct {
+    int workers;          // analysis threads (0 = online CPUs)
+    int queue_capacity;   // requests waiting for a worker (0 = 4 per worker)
+    int max_connections;  // concurrent clients (0 = 64)
+} ServerOptions;
+
+void server_options_init(ServerOptions* opts);
+
+// Serve until SIGINT/SIGTERM, then finish queued requests and return.
+// Returns 0 on clean shutdown, non-zero if the socket could not be set up.
+int run_server(const char* socket_path, const ServerOptions* opts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERVER_H
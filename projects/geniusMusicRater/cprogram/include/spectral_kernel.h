@@ -0,0 +1,68 @@
+#ifndef SPECTRAL_KERNEL_H
+#define SPECTRAL_KERNEL_H
+
+#include "dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fused spectral post-processing: one pass over an FFT frame produces the
+// power spectrum, an optional (log-compressed) level spectrum, the energy
+// moments behind centroid / bandwidth / brightness / flatness and, per band,
+// the rectified level rise against the previous frame and the mean level.
+//
+// The inner loop is dispatched at run time between AVX2 (GCC/Clang on x86),
+// SSE2 and a scalar reference; GENIUS_SIMD=scalar|sse2|avx2 in the
+// environment caps the choice (for comparisons and benchmarks). The SIMD
+// paths use a polynomial log, |error| < 1e-9, so results match the scalar
+// reference to well below the precision that is reported.
+
+#define SPECTRAL_MAX_BANDS 16
+
+typedef struct {
+    int n_fft;
+    int n_bins;                     // n_fft/2 + 1
+    double bin_hz;
+    int bright_bin;                 // first bin at or above 1500 Hz
+    int n_bands;                    // 0 = no band flux / levels
+    int band_first[SPECTRAL_MAX_BANDS + 1];   // first bin per band + end sentinel
+    double level_scale;             // level = scale*|X| ...
+    double compression;             // ... or log(1 + compression*scale*|X|) when > 0
+    int flatness;                   // compute spectral flatness (one log per bin)
+
+    // contiguous runs of bins that share a band and brightness side
+    int n_segments;
+    int seg_start[SPECTRAL_MAX_BANDS + 4];
+    int seg_band[SPECTRAL_MAX_BANDS + 3];     // -1 = in no band
+} SpectralKernel;
+
+typedef struct {
+    double energy;                  // sum of power
+    double centroid;                // Hz, power weighted
+    double bandwidth;               // Hz, power-weighted spread around the centroid
+    double rolloff;                 // Hz below which 85% of the power lies
+    double flatness;                // geometric / arithmetic mean of power [0,1]
+    double brightness;              // share of power at or above 1500 Hz
+    double flux;                    // sum over bands of the mean rectified level rise
+} SpectralFrame;
+
+// band_first: n_bands+1 ascending bin indices (NULL / 0 bands = none).
+// Returns 0 on success, -1 on bad arguments.
+int spectral_kernel_init(SpectralKernel* k, int n_fft, int sample_rate,
+                         const int* band_first, int n_bands);
+
+// power: n_bins out. level: n_bins out or NULL. prev_level: the previous
+// frame's level (NULL = first frame, flux 0). band_level: n_bands out or NULL.
+void spectral_kernel_run(const SpectralKernel* k, const DspComplex* X,
+                         double* power, double* level, const double* prev_level,
+                         double* band_level, SpectralFrame* out);
+
+// "avx2", "sse2" or "scalar": the implementation spectral_kernel_run uses.
+const char* spectral_kernel_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPECTRAL_KERNEL_H
@@ -2,6 +2,12 @@
 #define STRUCTURE_H
 
 #include <stddef.h>
+#include "beats.h"
+#include "onset.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef struct {
     double start_sec;         // section start time
@@ -14,7 +20,8 @@ typedef struct {
     size_t section_count;
 
     double arc_complexity;     // later: measure of narrative/arc similarity
-    double repetition_ratio;   // ratio of repeated material vs novel
+    double repetition_ratio;   // ratio of repeated material vs novel, over the analysed sections
+    int repetition_valid;      // 0 when no section timbre was analysed (deadline passed)
 } StructureFeatures;
 
 // Allocate + compute structure features
@@ -23,7 +30,28 @@ int compute_structure_features(const float* mono,
                                int sample_rate,
                                StructureFeatures* out);
 
+// Same, with the novelty curve computed per beat of `beats` so section
+// boundaries fall on beats. Fewer than three beats: 0.5 s frames.
+int compute_structure_features_beats(const float* mono,
+                                     size_t frames,
+                                     int sample_rate,
+                                     const BeatGrid* beats,
+                                     StructureFeatures* out);
+
+// Same, with the novelty taken from an onset function that is already
+// computed (band level and onset strength changes between blocks).
+int compute_structure_features_onset(const float* mono,
+                                     size_t frames,
+                                     int sample_rate,
+                                     const OnsetFunction* onset,
+                                     const BeatGrid* beats,
+                                     StructureFeatures* out);
+
 // Free allocated memory inside StructureFeatures
 void free_structure_features(StructureFeatures* sf);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // STRUCTURE_H
\ No newline at end of file
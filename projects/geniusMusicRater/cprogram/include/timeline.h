@@ -0,0 +1,109 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stddef.h>
+#include "geniusgrading.h"
+#include "beats.h"
+#include "loudness.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Genius score over time. The per-frame tracks behind the time-varying
+// rating inputs (onset function, beat peaks, chords, local tempo) are turned
+// into prefix sums once, so those inputs for any time range are assembled in
+// O(1) and scored with compute_genius_rating(). Loudness and dynamic range
+// are measured over the range exactly as for the whole track: the gated
+// integrated loudness of the range's 400 ms blocks and the P95 - P05 spread
+// of its level frames, in time linear in the range.
+//
+// Range inputs replace the track values for tempo, tempo confidence, beat
+// strength, pulse clarity, syncopation, harmonic motion, tension, loudness
+// and dynamic range; everything else (melody, structure, timbre extras) keeps
+// the whole-track value. A range without enough material for a term (e.g.
+// fewer than two beats) keeps the track value for that term too.
+
+#define TIMELINE_WINDOW_SEC 15.0
+#define TIMELINE_HOP_SEC     1.0
+
+typedef struct {
+    double frame_rate;          // index frames per second (onset hop)
+    size_t n_frames;
+    double* odf;                // n_frames+1 prefix sums of the onset function
+    size_t* beat_before;        // n_frames+1: beats on frames < f
+    size_t* chord_before;       // n_frames+1: chords starting before frame f
+
+    size_t beat_count;
+    double* beat_on;            // beat_count+1 prefix sums: onset peak on the beat
+    double* beat_off;           // ... halfway to the next beat (where measured)
+    size_t* off_count;          // ... beats with an off-beat measurement
+
+    size_t chord_count;
+    double* tension;            // chord_count+1 prefix sums of chord tension
+    size_t* tension_count;
+    double* motion;             // chord_count+1: distance to the previous chord
+    size_t* motion_count;
+
+    size_t seconds;
+    double* tempo;              // seconds+1 prefix sums of local tempo (voiced seconds)
+    size_t* tempo_count;
+    size_t* tempo_agree;        // seconds within +-4% of the track tempo
+
+    const double* blocks;       // 400 ms loudness block energies (borrowed)
+    size_t block_count;
+    double block_hop_sec;
+    double* level_db;           // psychoacoustic level frames (owned)
+    size_t level_count;
+    double level_hop_sec;
+} GeniusTimeline;
+
+typedef struct {
+    double start_sec;
+    double end_sec;
+    int overall;
+    int harmony;
+    int progression;
+    int rhythm;
+    int timbre;
+    int emotion;
+} GeniusSpan;
+
+// Scores for the structure sections and a rolling TIMELINE_WINDOW_SEC window
+// centred on every TIMELINE_HOP_SEC step.
+typedef struct {
+    GeniusSpan* sections;       // one per structure section (owned)
+    size_t section_count;
+    double window_sec;
+    double hop_sec;
+    int* rolling;               // overall score per hop (owned)
+    size_t rolling_len;
+} GeniusTimelineScores;
+
+// beats: the shared beat grid (its onset function is the frame index).
+// Any of rhythm, harmony, loudness and mono (the analysis-rate signal the
+// psychoacoustic features were measured on) may be NULL; loudness must
+// outlive the timeline. 0 on success.
+int genius_timeline_build(GeniusTimeline* tl, const BeatGrid* beats, const RhythmFeatures* rhythm,
+                          const HarmonyFeatures* harmony, const LoudnessResult* loudness,
+                          const float* mono, size_t frames, int sr);
+
+// Rating inputs for [start_sec, end_sec): `track` with the range values
+// substituted.
+void genius_timeline_inputs(const GeniusTimeline* tl, const GeniusInputs* track,
+                            double start_sec, double end_sec, GeniusInputs* out);
+
+void genius_timeline_free(GeniusTimeline* tl);
+
+// Section and rolling scores of a track of duration_sec. 0 on success.
+int genius_timeline_score(const GeniusTimeline* tl, const GeniusInputs* track, GeniusGenre genre,
+                          const StructureFeatures* structure, double duration_sec,
+                          GeniusTimelineScores* out);
+
+void genius_timeline_scores_free(GeniusTimelineScores* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMELINE_H
@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "genius_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Timeline of a run in the Chrome trace-event format (mp3_analyzer --trace
+ * out.json; open it in Perfetto or chrome://tracing). While a trace is on,
+ * the pipeline records a span for decoding and every decode chunk, resampling,
+ * the production meters and each feature stage, plus counters such as the
+ * server queue depth.
+ *
+ * Every thread appends to its own buffer, so recording takes no lock: a span
+ * is two clock reads and one store. Buffers outlive their threads (a later
+ * thread takes over the buffer, and the row, of one that has exited) and are
+ * only read by trace_write(), which must not overlap recording.
+ *
+ *   uint64_t t0 = trace_now();
+ *   ...
+ *   trace_span("stage", "onset", t0, bytes);
+ */
+
+#define TRACE_CHUNK_EVENTS 4096
+#define TRACE_MAX_CHUNKS   256      // per thread; later events are dropped and counted
+
+// Start a new trace: discards earlier events and restarts the clock. Call it
+// while no other thread is recording. Returns 0 on success.
+GENIUS_API int trace_start(void);
+GENIUS_API void trace_stop(void);
+GENIUS_API int trace_enabled(void);
+
+// Write everything recorded since trace_start() as one JSON object
+// ({"traceEvents": [...]}). Returns 0 on success.
+GENIUS_API int trace_write(const char* path);
+
+// Nanoseconds since trace_start(); 0 while tracing is off.
+GENIUS_API uint64_t trace_now(void);
+
+// A span on the calling thread from t0 (a trace_now() value) to now. `cat`
+// and `name` must be string literals (only the pointers are stored); bytes > 0
+// is attached as args.bytes.
+GENIUS_API void trace_span(const char* cat, const char* name, uint64_t t0, uint64_t bytes);
+
+// Value of the counter `name` (a string literal) from now on.
+GENIUS_API void trace_counter(const char* name, double value);
+
+// Label for the calling thread's row (copied).
+GENIUS_API void trace_thread_name(const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,62 @@
+#ifndef TRUEPEAK_H
+#define TRUEPEAK_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ITU-R BS.1770-4 Annex 2 true-peak: 4x oversampling with the 48-tap
+// polyphase interpolation filter from the standard, maximum absolute value
+// over all phases and channels. Catches the intersample overs that a plain
+// sample peak misses on clipped or heavily limited masters.
+
+#define TRUEPEAK_PHASES 4
+#define TRUEPEAK_TAPS   12          // per phase
+#define TRUEPEAK_SILENCE (-120.0)   // reported instead of -inf (digital silence)
+
+typedef struct {
+    double true_peak_dbtp;      // max over the whole stream
+    double sample_peak_dbfs;    // same stream without oversampling
+    float* track;               // dBTP per second
+    size_t track_len;
+} TruePeakResult;
+
+// Streaming meter. Frames may arrive in any chunking; parallel producers
+// each use a fork and the results are merged before _finish(). A fork has no
+// filter history for its first TRUEPEAK_TAPS-1 frames, so it only stores them;
+// _merge() measures them behind the preceding segment's history.
+typedef struct {
+    int sample_rate;
+    int channels;
+    float* history;             // last TRUEPEAK_TAPS-1 input samples per channel
+    float* peak;                // linear true peak per second
+    size_t peak_cap;
+    double sample_peak;
+    size_t frames;              // frames pushed
+    size_t end_frame;           // one past the highest frame seen
+    float* head;                // forks: first TRUEPEAK_TAPS-1 frames, measured at merge
+    size_t head_len;
+    size_t first;               // forks: absolute first frame pushed
+} TruePeakMeter;
+
+int true_peak_init(TruePeakMeter* m, int sample_rate, int channels, size_t expected_frames);
+// Add interleaved frames that start at absolute frame first_frame.
+int true_peak_push(TruePeakMeter* m, const float* interleaved, size_t count, size_t first_frame);
+// Meter for another producer of the same stream. Merge forks in stream order.
+int true_peak_fork(const TruePeakMeter* parent, TruePeakMeter* child, size_t expected_frames);
+int true_peak_merge(TruePeakMeter* dst, const TruePeakMeter* src);
+int true_peak_finish(const TruePeakMeter* m, TruePeakResult* out);
+void true_peak_free(TruePeakMeter* m);
+
+// One-shot measurement of an interleaved buffer.
+int compute_true_peak(const float* interleaved, size_t frames, int sample_rate, int channels,
+                      TruePeakResult* out);
+void free_true_peak_result(TruePeakResult* r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRUEPEAK_H
@@ -0,0 +1,86 @@
+"""Regression check for `mp3_analyzer --fast-math`.
+
+Usage:
+    python3 fastmath_check.py ./mp3_analyzer song1.mp3 song2.wav --flags "--m --s --g"
+    python3 fastmath_check.py ./mp3_analyzer song.mp3 --abs-tol 0.02 --rel-tol 1e-3
+
+Analyzes each file with and without --fast-math and compares every value in
+the two JSON records. A number passes when |a - b| <= abs_tol + rel_tol * max(|a|, |b|);
+strings, booleans and array lengths must match exactly. Prints the largest
+deviations and exits with status 1 if any value is out of tolerance.
+"""
+import argparse
+import json
+import shlex
+import subprocess
+import sys
+
+# Differs by design between the two runs.
+IGNORED = {"analysis_basis.fast_math"}
+
+
+def analyze(analyzer, path, flags, fast):
+    cmd = [analyzer, path] + flags + (["--fast-math"] if fast else [])
+    out = subprocess.run(cmd, check=True, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    return json.loads(out.stdout)
+
+
+def compare(a, b, path, abs_tol, rel_tol, deviations, mismatches):
+    if path in IGNORED:
+        return
+    if isinstance(a, dict) and isinstance(b, dict):
+        for key in sorted(set(a) | set(b)):
+            sub = f"{path}.{key}" if path else key
+            if key not in a or key not in b:
+                mismatches.append(f"{sub}: present in one run only")
+            else:
+                compare(a[key], b[key], sub, abs_tol, rel_tol, deviations, mismatches)
+    elif isinstance(a, list) and isinstance(b, list):
+        if len(a) != len(b):
+            mismatches.append(f"{path}: length {len(a)} vs {len(b)}")
+            return
+        for i, (x, y) in enumerate(zip(a, b)):
+            compare(x, y, f"{path}[{i}]", abs_tol, rel_tol, deviations, mismatches)
+    elif isinstance(a, (int, float)) and isinstance(b, (int, float)) and \
+            not isinstance(a, bool) and not isinstance(b, bool):
+        diff = abs(a - b)
+        allowed = abs_tol + rel_tol * max(abs(a), abs(b))
+        deviations.append((diff / allowed if allowed > 0 else float(diff > 0), diff, path, a, b))
+    elif a != b:
+        mismatches.append(f"{path}: {a!r} vs {b!r}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Compare mp3_analyzer output with and without --fast-math")
+    ap.add_argument("analyzer")
+    ap.add_argument("files", nargs="+")
+    ap.add_argument("--flags", default="--m --s --g", help="extra analyzer arguments")
+    ap.add_argument("--abs-tol", type=float, default=0.011,
+                    help="absolute tolerance (default: one unit in the last printed place of 2-decimal fields)")
+    ap.add_argument("--rel-tol", type=float, default=1e-4)
+    ap.add_argument("--show", type=int, default=5, help="largest deviations to print per file")
+    args = ap.parse_args()
+
+    flags = shlex.split(args.flags)
+    failed = 0
+    for path in args.files:
+        ref = analyze(args.analyzer, path, flags, False)
+        fast = analyze(args.analyzer, path, flags, True)
+        deviations, mismatches = [], []
+        compare(ref, fast, "", args.abs_tol, args.rel_tol, deviations, mismatches)
+        deviations.sort(reverse=True)
+        over = [d for d in deviations if d[0] > 1.0]
+        ok = not over and not mismatches
+        print(f"{path}: {'ok' if ok else 'FAIL'} ({len(deviations)} numbers, "
+              f"{len(over)} out of tolerance, {len(mismatches)} mismatches)")
+        for ratio, diff, key, a, b in deviations[:args.show]:
+            if diff > 0:
+                print(f"    {key}: {a} vs {b} (|d| = {diff:.3g}, {ratio:.2f} of tolerance)")
+        for m in mismatches:
+            print(f"    {m}")
+        failed += not ok
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
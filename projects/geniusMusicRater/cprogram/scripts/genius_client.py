@@ -0,0 +1,84 @@
+"""Local client for `mp3_analyzer --serve /path/to.sock`.
+
+Usage:
+    python3 genius_client.py /tmp/genius.sock song1.mp3 song2.mp3 --genre rap --m --s --g
+
+Sends one request per file on a single connection, prints each JSON response
+line as it arrives, and resends requests the server rejected as busy after the
+retry_after_ms hint.
+"""
+import argparse
+import json
+import socket
+import sys
+import time
+
+
+def send_requests(sock, requests):
+    data = "".join(json.dumps(r) + "\n" for r in requests)
+    sock.sendall(data.encode("utf-8"))
+
+
+def read_lines(sock):
+    buf = b""
+    while True:
+        chunk = sock.recv(65536)
+        if not chunk:
+            return
+        buf += chunk
+        while b"\n" in buf:
+            line, buf = buf.split(b"\n", 1)
+            if line:
+                yield json.loads(line)
+
+
+def run(socket_path, files, genre, flags, max_retries):
+    pending = {i: {"id": i, "path": f, "genre": genre, "flags": flags} for i, f in enumerate(files)}
+    retries = 0
+    failed = 0
+    while pending and retries <= max_retries:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(socket_path)
+        send_requests(sock, list(pending.values()))
+        sock.shutdown(socket.SHUT_WR)  # server answers everything, then closes
+
+        wait_ms = 0
+        for resp in read_lines(sock):
+            status = resp.get("status")
+            rid = resp.get("id")
+            if status == "busy":
+                wait_ms = max(wait_ms, resp.get("retry_after_ms", 1000))
+                print(f"[busy] id={rid} retry in {resp.get('retry_after_ms')} ms", file=sys.stderr)
+                continue
+            print(json.dumps(resp))
+            if status != "ok":
+                failed += 1
+            pending.pop(rid, None)
+        sock.close()
+
+        if pending:
+            retries += 1
+            time.sleep(max(wait_ms, 100) / 1000.0)
+
+    if pending:
+        print(f"gave up on {len(pending)} request(s) after {max_retries} retries", file=sys.stderr)
+    return 1 if (pending or failed) else 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Send analysis requests to a running mp3_analyzer --serve daemon")
+    ap.add_argument("socket")
+    ap.add_argument("files", nargs="+")
+    ap.add_argument("--genre", default="default")
+    ap.add_argument("--m", "--melody", dest="melody", action="store_true")
+    ap.add_argument("--s", "--structure", dest="structure", action="store_true")
+    ap.add_argument("--g", "--genius", dest="genius", action="store_true")
+    ap.add_argument("--retries", type=int, default=20)
+    args = ap.parse_args()
+
+    flags = [name for name, on in (("m", args.melody), ("s", args.structure), ("g", args.genius)) if on]
+    sys.exit(run(args.socket, args.files, args.genre, flags, args.retries))
+
+
+if __name__ == "__main__":
+    main()
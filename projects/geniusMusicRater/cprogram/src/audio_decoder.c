@@ -1,9 +1,17 @@
 #include "audio_decoder.h"
+#include "audio_input.h"
+#include "trace.h"
 #include <mpg123.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 static float* mix_to_mono(const float* interleaved, size_t frames, int channels) {
     if (channels <= 0) return NULL;
@@ -21,44 +29,81 @@ static float* mix_to_mono(const float* interleaved, size_t frames, int channels)
     return mono;
 }
 
-int decode_mp3_to_pcm(const char* path, AudioBuffer* out) {
-    if (!path || !out) return -1;
+// Parallel decode: segments of at least this many frames
+// (~10 s at 44.1 kHz), each started this many frames early so the layer III
+// bit reservoir, IMDCT overlap and synthesis filterbank state are rebuilt.
+#define DECODE_MIN_SEG_FRAMES 400
+#define DECODE_WARMUP_FRAMES  8
 
-    memset(out, 0, sizeof(*out));
+struct AudioDecoder {
+    mpg123_handle* mh;
+    mpg123_handle* seg[AUDIO_MAX_SEGMENTS]; // extra handles for parallel decode, created on demand
+};
 
-    int ret = 0;
+static mpg123_handle* new_float_handle(void) {
     int err = MPG123_OK;
-    mpg123_handle* mh = NULL;
+    mpg123_handle* mh = mpg123_new(NULL, &err);
+    if (!mh) {
+        fprintf(stderr, "mpg123_new failed: %s\n", mpg123_plain_strerror(err));
+        return NULL;
+    }
+    mpg123_param(mh, MPG123_FLAGS, MPG123_FORCE_FLOAT, 0.0);
+    return mh;
+}
+
+AudioDecoder* audio_decoder_create(void) {
 
+    // process-wide init; repeated calls are harmless
     if (mpg123_init() != MPG123_OK) {
         fprintf(stderr, "mpg123_init failed\n");
-        return -2;
+        return NULL;
     }
 
-    mh = mpg123_new(NULL, &err);
-    if (!mh) {
-        fprintf(stderr, "mpg123_new failed: %s\n", mpg123_plain_strerror(err));
-        mpg123_exit();
-        return -3;
-    }
+    AudioDecoder* dec = (AudioDecoder*)calloc(1, sizeof(AudioDecoder));
+    if (!dec) return NULL;
 
     // Request float32 output in any sample rate, mono or stereo etc.
     // Request float32 output (do not clear formats on Windows)
-    mpg123_param(mh, MPG123_FLAGS, MPG123_FORCE_FLOAT, 0.0);
+    dec->mh = new_float_handle();
+    if (!dec->mh) {
+        free(dec);
+        return NULL;
+    }
+    return dec;
+}
 
-    if ((err = mpg123_open(mh, path)) != MPG123_OK) {
-        fprintf(stderr, "mpg123_open failed for %s: %s\n", path, mpg123_plain_strerror(err));
-        mpg123_delete(mh);
-        mpg123_exit();
-        return -5;
+void audio_decoder_destroy(AudioDecoder* dec) {
+    if (!dec) return;
+    if (dec->mh) mpg123_delete(dec->mh);
+    for (int i = 0; i < AUDIO_MAX_SEGMENTS; ++i) {
+        if (dec->seg[i]) mpg123_delete(dec->seg[i]);
     }
+    free(dec);
+}
 
+// Make sure an opened handle produces float32 output.
+static int force_float_output(mpg123_handle* mh, long* rate, int* channels) {
+    int encoding = 0;
+    mpg123_getformat(mh, rate, channels, &encoding);
+    if (encoding != MPG123_ENC_FLOAT_32) {
+        // Try to enforce again
+        mpg123_format_none(mh);
+        int err = mpg123_format(mh, *rate, *channels == 1 ? MPG123_MONO : MPG123_STEREO, MPG123_ENC_FLOAT_32);
+        if (err != MPG123_OK) {
+            fprintf(stderr, "Failed to set float32 output: %s\n", mpg123_plain_strerror(err));
+            return -6;
+        }
+    }
+    return 0;
+}
+
+// Decode everything from an opened handle (file or feed) into out.
+static int decode_open_stream(mpg123_handle* mh, int feed, AudioBuffer* out) {
     // Decode loop
     size_t cap = 0;
     size_t sz = 0; // bytes
     float* data = NULL;
 
-    unsigned char* io_buf = NULL;
     size_t done = 0;
 
     long rate = 0;
@@ -66,21 +111,10 @@ int decode_mp3_to_pcm(const char* path, AudioBuffer* out) {
     int encoding = 0;
 
     // Ensure we know the format
-    mpg123_getformat(mh, &rate, &channels, &encoding);
-    if (encoding != MPG123_ENC_FLOAT_32) {
-        // Try to enforce again
-        mpg123_format_none(mh);
-        err = mpg123_format(mh, rate, channels == 1 ? MPG123_MONO : MPG123_STEREO, MPG123_ENC_FLOAT_32);
-        if (err != MPG123_OK) {
-            fprintf(stderr, "Failed to set float32 output: %s\n", mpg123_plain_strerror(err));
-            mpg123_close(mh);
-            mpg123_delete(mh);
-            mpg123_exit();
-            return -6;
-        }
-    }
+    int rc = force_float_output(mh, &rate, &channels);
+    if (rc != 0) return rc;
 
-    // Read until EOF
+    // Read until EOF (a feed reader runs out of input instead)
     for (;;) {
         // Grow buffer if needed
         if (sz + 4096 * sizeof(float) > cap) {
@@ -89,9 +123,6 @@ int decode_mp3_to_pcm(const char* path, AudioBuffer* out) {
             if (!nd) {
                 fprintf(stderr, "Out of memory while decoding\n");
                 free(data);
-                mpg123_close(mh);
-                mpg123_delete(mh);
-                mpg123_exit();
                 return -7;
             }
             data = nd;
@@ -102,14 +133,13 @@ int decode_mp3_to_pcm(const char* path, AudioBuffer* out) {
         int read_res = mpg123_read(mh, (unsigned char*)data + sz, bytes_avail, &done);
         sz += done;
 
-        if (read_res == MPG123_DONE) {
+        if (read_res == MPG123_DONE || (feed && read_res == MPG123_NEED_MORE)) {
             break;
+        } else if (read_res == MPG123_NEW_FORMAT) {
+            continue;
         } else if (read_res != MPG123_OK) {
             fprintf(stderr, "mpg123_read error: %s\n", mpg123_plain_strerror(read_res));
             free(data);
-            mpg123_close(mh);
-            mpg123_delete(mh);
-            mpg123_exit();
             return -8;
         }
     }
@@ -117,10 +147,6 @@ int decode_mp3_to_pcm(const char* path, AudioBuffer* out) {
     // Final format after decode (in case stream changed)
     mpg123_getformat(mh, &rate, &channels, &encoding);
 
-    mpg123_close(mh);
-    mpg123_delete(mh);
-    mpg123_exit();
-
     size_t total_samples = sz / sizeof(float);
     if (channels <= 0) {
         free(data);
@@ -130,46 +156,377 @@ int decode_mp3_to_pcm(const char* path, AudioBuffer* out) {
 
     out->pcm = data;
     out->frames = frames;
-    out->sample_rate = (int)rate;   
+    out->sample_rate = (int)rate;
     out->channels = channels;
-    return ret;
+    return 0;
+}
+
+int audio_decoder_decode(AudioDecoder* dec, const char* path, AudioBuffer* out) {
+    if (!dec || !path || !out) return -1;
+
+    memset(out, 0, sizeof(*out));
+
+    int err = MPG123_OK;
+    mpg123_handle* mh = dec->mh;
+
+    if ((err = mpg123_open(mh, path)) != MPG123_OK) {
+        fprintf(stderr, "mpg123_open failed for %s: %s\n", path, mpg123_plain_strerror(err));
+        return -5;
+    }
+    int rc = decode_open_stream(mh, 0, out);
+    mpg123_close(mh);
+    return rc;
+}
+
+// ---------- Streaming decode (sequential or parallel segments) ----------
+
+#define DECODE_CHUNK_FRAMES 8192
+
+typedef struct {
+    mpg123_handle* mh;
+    const char* path;
+    const AudioSink* sink;
+    void* user;
+    int segment;
+    off_t* index;           // frame index of the main handle (shared, read-only)
+    off_t index_step;
+    size_t index_fill;
+    long rate;
+    int channels;
+    int spf;                // samples per frame
+    off_t start, end;       // output frames [start, end)
+    off_t produced;
+    int rc;
+} DecodeSegment;
+
+static int online_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// Read up to `limit` frames (< 0: until EOF) from the current position and
+// hand them to the sink in chunks. Returns 0 on success.
+static int read_to_sink(DecodeSegment* sg, off_t limit) {
+    size_t frame_bytes = sizeof(float) * (size_t)sg->channels;
+    float chunk[DECODE_CHUNK_FRAMES * 2];
+    size_t chunk_frames = sizeof(chunk) / frame_bytes;
+    if (chunk_frames == 0) return -9;
+
+    for (;;) {
+        size_t want = chunk_frames;
+        if (limit >= 0) {
+            if (sg->produced >= limit) return 0;
+            if ((off_t)want > limit - sg->produced) want = (size_t)(limit - sg->produced);
+        }
+        size_t done = 0;
+        uint64_t t0 = trace_now();
+        int r = mpg123_read(sg->mh, (unsigned char*)chunk, want * frame_bytes, &done);
+        size_t n = done / frame_bytes;
+        if (n > 0) {
+            if (sg->sink->frames(sg->user, sg->segment, (size_t)(sg->start + sg->produced), chunk, n) != 0) {
+                return -7;
+            }
+            sg->produced += (off_t)n;
+        }
+        trace_span("decode", "decode_chunk", t0, (uint64_t)done);
+        if (r == MPG123_DONE) return 0;
+        if (r == MPG123_NEW_FORMAT) continue;
+        if (r != MPG123_OK) {
+            fprintf(stderr, "mpg123_read error: %s\n", mpg123_plain_strerror(r));
+            return -8;
+        }
+    }
+}
+
+static void* decode_segment(void* arg) {
+    DecodeSegment* sg = (DecodeSegment*)arg;
+    mpg123_handle* mh = sg->mh;
+    uint64_t t0 = trace_now();
+    trace_thread_name("decode");
+    sg->rc = 0;
+    sg->produced = 0;
+
+    if (mpg123_open(mh, sg->path) != MPG123_OK) { sg->rc = -5; return NULL; }
+    mpg123_set_index(mh, sg->index, sg->index_step, sg->index_fill);
+
+    long rate = 0;
+    int channels = 0;
+    if (force_float_output(mh, &rate, &channels) != 0 || rate != sg->rate || channels != sg->channels) {
+        sg->rc = -6;
+        mpg123_close(mh);
+        return NULL;
+    }
+
+    // Start a few frames early and throw that output away.
+    off_t from = sg->start - (off_t)DECODE_WARMUP_FRAMES * sg->spf;
+    if (from < 0) from = 0;
+    if (mpg123_seek(mh, from, SEEK_SET) < 0) {
+        sg->rc = -11;
+        mpg123_close(mh);
+        return NULL;
+    }
+
+    size_t frame_bytes = sizeof(float) * (size_t)channels;
+    size_t skip = (size_t)(sg->start - from) * frame_bytes;
+    unsigned char scratch[16384];
+    while (skip > 0) {
+        size_t done = 0;
+        int r = mpg123_read(mh, scratch, skip < sizeof(scratch) ? skip : sizeof(scratch), &done);
+        skip -= done;
+        if (r == MPG123_NEW_FORMAT) continue;
+        if (r != MPG123_OK) { sg->rc = (r == MPG123_DONE) ? -12 : -8; break; }
+    }
+
+    // Then stream this segment's frames to the sink.
+    if (sg->rc == 0) sg->rc = read_to_sink(sg, sg->end - sg->start);
+    mpg123_close(mh);
+    trace_span("decode", "decode_segment", t0,
+               (uint64_t)sg->produced * (uint64_t)channels * sizeof(float));
+    return NULL;
+}
+
+int audio_decoder_stream(AudioDecoder* dec, const char* path, int threads,
+                         const AudioSink* sink, void* user, size_t* total_frames) {
+    if (!dec || !path || !sink || !sink->begin || !sink->frames) return -1;
+    if (total_frames) *total_frames = 0;
+    if (threads <= 0) threads = online_cpus();
+    if (threads > AUDIO_MAX_SEGMENTS) threads = AUDIO_MAX_SEGMENTS;
+
+    int err = MPG123_OK;
+    mpg123_handle* mh = dec->mh;
+    if ((err = mpg123_open(mh, path)) != MPG123_OK) {
+        fprintf(stderr, "mpg123_open failed for %s: %s\n", path, mpg123_plain_strerror(err));
+        return -5;
+    }
+
+    long rate = 0;
+    int channels = 0;
+    int rc = force_float_output(mh, &rate, &channels);
+    if (rc != 0 || channels <= 0) {
+        mpg123_close(mh);
+        return rc != 0 ? rc : -9;
+    }
+
+    // A full scan gives the exact length (to presize the sink) and the
+    // frame index (to split the stream). It only parses frame headers.
+    off_t* index = NULL;
+    off_t index_step = 0;
+    size_t index_fill = 0;
+    off_t total = -1;
+    int spf = 0;
+    int have_index = 0;
+    if (mpg123_scan(mh) == MPG123_OK) {
+        total = mpg123_length(mh);
+        spf = mpg123_spf(mh);
+        have_index = (mpg123_index(mh, &index, &index_step, &index_fill) == MPG123_OK);
+    }
+
+    int segments = threads;
+    if (have_index && spf > 0 && total > 0) {
+        off_t frames = (total + spf - 1) / spf;
+        while (segments > 1 && frames / segments < DECODE_MIN_SEG_FRAMES) segments--;
+    } else {
+        segments = 1;
+    }
+
+    if (segments > 1) {
+        rc = sink->begin(user, (int)rate, channels, (size_t)total, segments);
+        if (rc != 0) {
+            mpg123_close(mh);
+            return -7;
+        }
+
+        // Segment boundaries fall on frame boundaries of the output timeline.
+        DecodeSegment sg[AUDIO_MAX_SEGMENTS];
+        pthread_t tid[AUDIO_MAX_SEGMENTS];
+        int started[AUDIO_MAX_SEGMENTS] = {0};
+        off_t frames = (total + spf - 1) / spf;
+        off_t per_seg = (frames + segments - 1) / segments;
+        for (int i = 0; i < segments; ++i) {
+            memset(&sg[i], 0, sizeof(sg[i]));
+            sg[i].path = path;
+            sg[i].sink = sink;
+            sg[i].user = user;
+            sg[i].segment = i;
+            sg[i].index = index;
+            sg[i].index_step = index_step;
+            sg[i].index_fill = index_fill;
+            sg[i].rate = rate;
+            sg[i].channels = channels;
+            sg[i].spf = spf;
+            sg[i].start = (off_t)i * per_seg * spf;
+            sg[i].end = (i == segments - 1) ? total : (off_t)(i + 1) * per_seg * spf;
+            if (sg[i].start > total) sg[i].start = total;
+            if (sg[i].end > total) sg[i].end = total;
+            sg[i].rc = -3;
+
+            if (!dec->seg[i]) dec->seg[i] = new_float_handle();
+            sg[i].mh = dec->seg[i];
+            if (!sg[i].mh) continue;
+            started[i] = (pthread_create(&tid[i], NULL, decode_segment, &sg[i]) == 0);
+        }
+
+        int ok = 1;
+        for (int i = 0; i < segments; ++i) {
+            if (started[i]) pthread_join(tid[i], NULL);
+            if (!started[i] || sg[i].rc != 0) ok = 0;
+            // only the last segment may come up short (length estimate past EOF)
+            if (i < segments - 1 && sg[i].produced != sg[i].end - sg[i].start) ok = 0;
+        }
+        if (ok) {
+            mpg123_close(mh);
+            if (total_frames) *total_frames = (size_t)(sg[segments - 1].start + sg[segments - 1].produced);
+            return 0;
+        }
+        // fall back to one sequential pass rather than return a gapped signal
+    }
+
+    rc = sink->begin(user, (int)rate, channels, total > 0 ? (size_t)total : 0, 1);
+    if (rc != 0) {
+        mpg123_close(mh);
+        return -7;
+    }
+    DecodeSegment seq;
+    memset(&seq, 0, sizeof(seq));
+    seq.mh = mh;
+    seq.sink = sink;
+    seq.user = user;
+    seq.channels = channels;
+    rc = read_to_sink(&seq, -1);
+    mpg123_close(mh);
+    if (rc == 0 && total_frames) *total_frames = (size_t)seq.produced;
+    return rc;
+}
+
+// ---------- Interleaved buffer sink ----------
+
+typedef struct {
+    float* pcm;
+    size_t cap;             // frames
+    int sample_rate;
+    int channels;
+    int segments;
+} BufferSink;
+
+static int buffer_sink_begin(void* user, int sample_rate, int channels, size_t expected_frames, int segments) {
+    BufferSink* b = (BufferSink*)user;
+    size_t cap = expected_frames > 0 ? expected_frames : ((size_t)1 << 18);
+    if (!b->pcm || b->cap < cap || b->channels != channels) {
+        float* nd = (float*)realloc(b->pcm, sizeof(float) * cap * (size_t)channels);
+        if (!nd) return -1;
+        b->pcm = nd;
+        b->cap = cap;
+    }
+    b->sample_rate = sample_rate;
+    b->channels = channels;
+    b->segments = segments;
+    return 0;
+}
+
+static int buffer_sink_frames(void* user, int segment, size_t first_frame, const float* interleaved, size_t count) {
+    BufferSink* b = (BufferSink*)user;
+    (void)segment;
+    size_t need = first_frame + count;
+    if (need > b->cap) {
+        // only a single sequential stream can run past the announced length
+        if (b->segments > 1) return -1;
+        size_t newcap = b->cap * 2 > need ? b->cap * 2 : need;
+        float* nd = (float*)realloc(b->pcm, sizeof(float) * newcap * (size_t)b->channels);
+        if (!nd) return -1;
+        b->pcm = nd;
+        b->cap = newcap;
+    }
+    memcpy(b->pcm + first_frame * (size_t)b->channels, interleaved,
+           sizeof(float) * count * (size_t)b->channels);
+    return 0;
+}
+
+int audio_decoder_decode_parallel(AudioDecoder* dec, const char* path, int threads, AudioBuffer* out) {
+    if (!dec || !path || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    BufferSink b;
+    memset(&b, 0, sizeof(b));
+    AudioSink sink = {buffer_sink_begin, buffer_sink_frames};
+    size_t frames = 0;
+    int rc = audio_decoder_stream(dec, path, threads, &sink, &b, &frames);
+    if (rc != 0) {
+        free(b.pcm);
+        return rc;
+    }
+    out->pcm = b.pcm;
+    out->frames = frames;
+    out->sample_rate = b.sample_rate;
+    out->channels = b.channels;
+    return 0;
+}
+
+int audio_decoder_decode_memory(AudioDecoder* dec, const unsigned char* data, size_t size,
+                                AudioBuffer* out) {
+    if (!dec || !data || !out) return -1;
+
+    memset(out, 0, sizeof(*out));
+
+    int err = MPG123_OK;
+    mpg123_handle* mh = dec->mh;
+
+    if ((err = mpg123_open_feed(mh)) != MPG123_OK ||
+        (err = mpg123_feed(mh, data, size)) != MPG123_OK) {
+        fprintf(stderr, "mpg123 feed failed: %s\n", mpg123_plain_strerror(err));
+        mpg123_close(mh);
+        return -5;
+    }
+    int rc = decode_open_stream(mh, 1, out);
+    mpg123_close(mh);
+    return rc;
+}
+
+int decode_mp3_to_pcm(const char* path, AudioBuffer* out) {
+    if (!path || !out) return -1;
+    AudioDecoder* dec = audio_decoder_create();
+    if (!dec) return -3;
+    int rc = audio_decoder_decode(dec, path, out);
+    audio_decoder_destroy(dec);
+    return rc;
 }
 
 void free_audio_buffer(AudioBuffer* buf) {
     if (!buf) return;
-    free(buf->pcm);
-    buf->pcm = NULL;
-    buf->frames = 0;
-    buf->sample_rate = 0;
-    buf->channels = 0;
+    if (buf->storage) audio_release_storage(buf->storage, buf->storage_size, buf->storage_mapped);
+    else free(buf->pcm);
+    memset(buf, 0, sizeof(*buf));
 }
 
-int resample_and_mix_mono(const AudioBuffer* in, int target_sr, float** out_pcm, size_t* out_frames) {
-    if (!in || !out_pcm || !out_frames || !in->pcm || in->frames == 0 || target_sr <= 0) {
+int resample_mono_linear(float* mono, size_t frames, int in_sr, int out_sr,
+                        float** out_pcm, size_t* out_frames) {
+    if (!mono || frames == 0 || in_sr <= 0 || out_sr <= 0 || !out_pcm || !out_frames) {
+        free(mono);
         return -1;
     }
-
-    // Mix to mono first
-    float* mono = mix_to_mono(in->pcm, in->frames, in->channels);
-    if (!mono) return -2;
-
-    if (in->sample_rate == target_sr) {
-        // No resampling needed
+    if (in_sr == out_sr) {
         *out_pcm = mono;
-        *out_frames = in->frames;
+        *out_frames = frames;
         return 0;
     }
 
-    double in_sr = (double)in->sample_rate;
-    double out_sr = (double)target_sr;
-    double ratio = in_sr / out_sr;
-    size_t n_out = (size_t)floor((double)in->frames * (out_sr / in_sr));
+    double ratio = (double)in_sr / (double)out_sr;
+    size_t n_out = (size_t)floor((double)frames * ((double)out_sr / (double)in_sr));
     if (n_out == 0) n_out = 1;
 
-    float* out = (float*)malloc(sizeof(float) * n_out);
-    if (!out) {
-        free(mono);
-        return -3;
+    // Downsampling reads at or ahead of where it writes, so it can run in place.
+    float* out = mono;
+    if (ratio < 1.0) {
+        out = (float*)malloc(sizeof(float) * n_out);
+        if (!out) {
+            free(mono);
+            return -3;
+        }
     }
 
     for (size_t n = 0; n < n_out; ++n) {
@@ -177,8 +534,8 @@ int resample_and_mix_mono(const AudioBuffer* in, int target_sr, float** out_pcm,
         size_t i0 = (size_t)floor(src_pos);
         double frac = src_pos - (double)i0;
 
-        if (i0 >= in->frames - 1) {
-            out[n] = mono[in->frames - 1];
+        if (i0 >= frames - 1) {
+            out[n] = mono[frames - 1];
         } else {
             float s0 = mono[i0];
             float s1 = mono[i0 + 1];
@@ -186,8 +543,25 @@ int resample_and_mix_mono(const AudioBuffer* in, int target_sr, float** out_pcm,
         }
     }
 
-    free(mono);
+    if (out == mono) {
+        float* shrunk = (float*)realloc(mono, sizeof(float) * n_out);
+        if (shrunk) out = shrunk;
+    } else {
+        free(mono);
+    }
     *out_pcm = out;
     *out_frames = n_out;
     return 0;
-}
\ No newline at end of file
+}
+
+int resample_and_mix_mono(const AudioBuffer* in, int target_sr, float** out_pcm, size_t* out_frames) {
+    if (!in || !out_pcm || !out_frames || !in->pcm || in->frames == 0 || target_sr <= 0) {
+        return -1;
+    }
+
+    // Mix to mono first
+    float* mono = mix_to_mono(in->pcm, in->frames, in->channels);
+    if (!mono) return -2;
+
+    return resample_mono_linear(mono, in->frames, in->sample_rate, target_sr, out_pcm, out_frames);
+}
@@ -0,0 +1,354 @@
+#include "audio_input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+void audio_input_options_init(AudioInputOptions* opts) {
+    if (!opts) return;
+    opts->format = AUDIO_INPUT_AUTO;
+    opts->raw_sample_rate = 44100;
+    opts->raw_channels = 1;
+    opts->decode_threads = 0;
+}
+
+int audio_input_format_from_name(const char* name, AudioInputFormat* out) {
+    if (!name || !out) return -1;
+    if (strcmp(name, "auto") == 0)                            *out = AUDIO_INPUT_AUTO;
+    else if (strcmp(name, "mp3") == 0)                        *out = AUDIO_INPUT_MP3;
+    else if (strcmp(name, "wav") == 0)                        *out = AUDIO_INPUT_WAV;
+    else if (strcmp(name, "f32") == 0 || strcmp(name, "raw") == 0) *out = AUDIO_INPUT_RAW_F32;
+    else return -1;
+    return 0;
+}
+
+static int has_extension(const char* path, const char* ext) {
+    if (!path) return 0;
+    const char* dot = strrchr(path, '.');
+    if (!dot) return 0;
+    dot++;
+    for (; *dot && *ext; ++dot, ++ext) {
+        char c = *dot;
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != *ext) return 0;
+    }
+    return *dot == '\0' && *ext == '\0';
+}
+
+AudioInputFormat audio_input_detect(const unsigned char* head, size_t n, const char* path) {
+    // headerless samples can start with anything, including an MP3 sync word
+    if (has_extension(path, "f32") || has_extension(path, "raw") || has_extension(path, "pcm")) {
+        return AUDIO_INPUT_RAW_F32;
+    }
+    if (head && n >= 12 && memcmp(head, "RIFF", 4) == 0 && memcmp(head + 8, "WAVE", 4) == 0) {
+        return AUDIO_INPUT_WAV;
+    }
+    if (head && n >= 3 && memcmp(head, "ID3", 3) == 0) return AUDIO_INPUT_MP3;
+    if (head && n >= 2 && head[0] == 0xFF && (head[1] & 0xE0) == 0xE0) return AUDIO_INPUT_MP3;
+
+    if (has_extension(path, "wav")) return AUDIO_INPUT_WAV;
+    return AUDIO_INPUT_MP3;
+}
+
+// ---------- Whole-file views ----------
+
+void* audio_map_file(const char* path, size_t* size, int* mapped) {
+    *size = 0;
+    *mapped = 0;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+#ifdef MADV_SEQUENTIAL
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    *size = (size_t)st.st_size;
+    *mapped = 1;
+    return base;
+#else
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len <= 0) { fclose(f); return NULL; }
+    void* data = malloc((size_t)len);
+    if (data && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data) *size = (size_t)len;
+    return data;
+#endif
+}
+
+void audio_release_storage(void* base, size_t size, int mapped) {
+    if (!base) return;
+#ifndef _WIN32
+    if (mapped) {
+        munmap(base, size);
+        return;
+    }
+#else
+    (void)size; (void)mapped;
+#endif
+    free(base);
+}
+
+// Slurp stdin (a pipe cannot be mapped). Returns a malloc'd block.
+static unsigned char* read_stdin(size_t* size) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    size_t cap = (size_t)1 << 20, len = 0;
+    unsigned char* data = (unsigned char*)malloc(cap);
+    if (!data) return NULL;
+    for (;;) {
+        if (len == cap) {
+            unsigned char* nd = (unsigned char*)realloc(data, cap * 2);
+            if (!nd) { free(data); return NULL; }
+            data = nd;
+            cap *= 2;
+        }
+        size_t n = fread(data + len, 1, cap - len, stdin);
+        if (n == 0) break;
+        len += n;
+    }
+    *size = len;
+    return data;
+}
+
+// ---------- Sample conversion ----------
+
+static int host_little_endian(void) {
+    const uint16_t one = 1;
+    return *(const unsigned char*)&one == 1;
+}
+
+static uint32_t rd_le16(const unsigned char* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8); }
+static uint32_t rd_le32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+typedef enum { SAMPLE_I16, SAMPLE_I24, SAMPLE_I32, SAMPLE_F32 } SampleKind;
+
+// Convert n interleaved little-endian samples to float32.
+static void convert_samples(const unsigned char* src, size_t n, SampleKind kind, float* dst) {
+    switch (kind) {
+        case SAMPLE_I16:
+            for (size_t i = 0; i < n; ++i, src += 2) {
+                dst[i] = (float)((int16_t)rd_le16(src) / 32768.0);
+            }
+            break;
+        case SAMPLE_I24:
+            for (size_t i = 0; i < n; ++i, src += 3) {
+                int32_t v = (int32_t)(((uint32_t)src[0] << 8) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 24)) >> 8;
+                dst[i] = (float)(v / 8388608.0);
+            }
+            break;
+        case SAMPLE_I32:
+            for (size_t i = 0; i < n; ++i, src += 4) {
+                dst[i] = (float)((int32_t)rd_le32(src) / 2147483648.0);
+            }
+            break;
+        case SAMPLE_F32:
+            for (size_t i = 0; i < n; ++i, src += 4) {
+                uint32_t bits = rd_le32(src);
+                memcpy(&dst[i], &bits, sizeof(float));
+            }
+            break;
+    }
+}
+
+// Fill out from samples inside `block`. Float32 data that is aligned and in
+// host order is referenced in place and the block is handed to out;
+// otherwise the samples are converted and the block is released.
+static int adopt_samples(void* block, size_t block_size, int mapped,
+                         size_t offset, size_t frames, int channels, int sample_rate,
+                         SampleKind kind, AudioBuffer* out) {
+    const unsigned char* src = (const unsigned char*)block + offset;
+    size_t n = frames * (size_t)channels;
+
+    out->frames = frames;
+    out->channels = channels;
+    out->sample_rate = sample_rate;
+
+    if (kind == SAMPLE_F32 && host_little_endian() && ((uintptr_t)src % sizeof(float)) == 0) {
+        out->pcm = (float*)src;
+        out->storage = block;
+        out->storage_size = block_size;
+        out->storage_mapped = mapped;
+        return 0;
+    }
+
+    float* pcm = (float*)malloc(sizeof(float) * (n ? n : 1));
+    if (!pcm) {
+        audio_release_storage(block, block_size, mapped);
+        return -7;
+    }
+    convert_samples(src, n, kind, pcm);
+    audio_release_storage(block, block_size, mapped);
+    out->pcm = pcm;
+    return 0;
+}
+
+// ---------- Containers ----------
+
+#define WAVE_FORMAT_PCM        1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+static int load_wav(void* block, size_t size, int mapped, AudioBuffer* out) {
+    const unsigned char* p = (const unsigned char*)block;
+    if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "Not a RIFF/WAVE file\n");
+        audio_release_storage(block, size, mapped);
+        return -10;
+    }
+
+    int format = 0, channels = 0, bits = 0, block_align = 0;
+    long sample_rate = 0;
+    size_t data_off = 0, data_len = 0;
+    int have_fmt = 0, have_data = 0;
+
+    size_t pos = 12;
+    while (pos + 8 <= size && !have_data) {
+        const unsigned char* ck = p + pos;
+        size_t ck_len = rd_le32(ck + 4);
+        size_t body = pos + 8;
+        if (memcmp(ck, "fmt ", 4) == 0 && ck_len >= 16 && body + 16 <= size) {
+            format = (int)rd_le16(p + body);
+            channels = (int)rd_le16(p + body + 2);
+            sample_rate = (long)rd_le32(p + body + 4);
+            block_align = (int)rd_le16(p + body + 12);
+            bits = (int)rd_le16(p + body + 14);
+            if (format == WAVE_FORMAT_EXTENSIBLE && ck_len >= 26 && body + 26 <= size) {
+                format = (int)rd_le16(p + body + 24); // first two bytes of the SubFormat GUID
+            }
+            have_fmt = 1;
+        } else if (memcmp(ck, "data", 4) == 0) {
+            data_off = body;
+            // streamed WAVs may leave the length at 0 / 0xFFFFFFFF
+            data_len = (ck_len == 0 || body + ck_len > size) ? size - body : ck_len;
+            have_data = 1;
+        }
+        pos = body + ck_len + (ck_len & 1);
+    }
+
+    int kind = -1;
+    if (format == WAVE_FORMAT_PCM && bits == 16)             kind = SAMPLE_I16;
+    else if (format == WAVE_FORMAT_PCM && bits == 24)        kind = SAMPLE_I24;
+    else if (format == WAVE_FORMAT_PCM && bits == 32)        kind = SAMPLE_I32;
+    else if (format == WAVE_FORMAT_IEEE_FLOAT && bits == 32) kind = SAMPLE_F32;
+
+    if (!have_fmt || !have_data || channels <= 0 || sample_rate <= 0 ||
+        kind < 0 || block_align != channels * (bits / 8)) {
+        fprintf(stderr, "Unsupported WAV layout (format %d, %d bits, %d channels)\n",
+                format, bits, channels);
+        audio_release_storage(block, size, mapped);
+        return -11;
+    }
+
+    size_t frames = data_len / (size_t)block_align;
+    return adopt_samples(block, size, mapped, data_off, frames, channels, (int)sample_rate, (SampleKind)kind, out);
+}
+
+static int load_raw_f32(void* block, size_t size, int mapped,
+                        const AudioInputOptions* opts, AudioBuffer* out) {
+    int channels = opts->raw_channels > 0 ? opts->raw_channels : 1;
+    int sample_rate = opts->raw_sample_rate > 0 ? opts->raw_sample_rate : 44100;
+    size_t frames = size / (sizeof(float) * (size_t)channels);
+    return adopt_samples(block, size, mapped, 0, frames, channels, sample_rate, SAMPLE_F32, out);
+}
+
+// Dispatch a whole input held in memory; takes ownership of block.
+static int load_block(AudioDecoder* dec, void* block, size_t size, int mapped,
+                      AudioInputFormat fmt, const AudioInputOptions* opts, AudioBuffer* out) {
+    switch (fmt) {
+        case AUDIO_INPUT_WAV:
+            return load_wav(block, size, mapped, out);
+        case AUDIO_INPUT_RAW_F32:
+            return load_raw_f32(block, size, mapped, opts, out);
+        default: {
+            int rc = dec ? audio_decoder_decode_memory(dec, (const unsigned char*)block, size, out) : -3;
+            audio_release_storage(block, size, mapped);
+            return rc;
+        }
+    }
+}
+
+AudioInputFormat audio_input_resolve(const char* path, AudioInputFormat requested) {
+    if (requested != AUDIO_INPUT_AUTO || !path) return requested;
+    unsigned char head[12];
+    size_t n = 0;
+    FILE* f = fopen(path, "rb");
+    if (f) {
+        n = fread(head, 1, sizeof(head), f);
+        fclose(f);
+    }
+    return audio_input_detect(head, n, path);
+}
+
+int audio_load(AudioDecoder* dec, const char* path, const AudioInputOptions* opts, AudioBuffer* out) {
+    if (!path || !out) return -1;
+    memset(out, 0, sizeof(*out));
+
+    AudioInputOptions defaults;
+    if (!opts) {
+        audio_input_options_init(&defaults);
+        opts = &defaults;
+    }
+    AudioInputFormat fmt = opts->format;
+
+    if (strcmp(path, "-") == 0) {
+        size_t size = 0;
+        unsigned char* data = read_stdin(&size);
+        if (!data || size == 0) {
+            free(data);
+            fprintf(stderr, "No audio on stdin\n");
+            return -5;
+        }
+        if (fmt == AUDIO_INPUT_AUTO) {
+            fmt = audio_input_detect(data, size, NULL);
+            // a headerless pipe is far more likely raw f32 (ffmpeg -f f32le -) than MP3
+            int sync = (size >= 3 && memcmp(data, "ID3", 3) == 0) ||
+                       (size >= 2 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0);
+            if (fmt == AUDIO_INPUT_MP3 && !sync) fmt = AUDIO_INPUT_RAW_F32;
+        }
+        return load_block(dec, data, size, 0, fmt, opts, out);
+    }
+
+    fmt = audio_input_resolve(path, fmt);
+
+    // libmpg123 reads MP3 files itself; only PCM containers are mapped
+    if (fmt == AUDIO_INPUT_MP3) {
+        return dec ? audio_decoder_decode_parallel(dec, path, opts->decode_threads, out) : -3;
+    }
+
+    size_t size = 0;
+    int mapped = 0;
+    void* block = audio_map_file(path, &size, &mapped);
+    if (!block) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return -5;
+    }
+    return load_block(dec, block, size, mapped, fmt, opts, out);
+}
@@ -0,0 +1,261 @@
+#include "beats.h"
+#include "order_stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define BEAT_TIGHTNESS  100.0   // weight of the tempo-deviation penalty
+
+// ---------- Global tempo ----------
+
+/**
+ * Estimate Tempo (BPM) using autocorrelation of onset envelope.
+ * Confidence is defined as best_peak / second_best_peak ratio,
+ * normalized into [0,1].
+ */
+static void estimate_tempo_from_odf(const float* odf,
+                                    size_t odf_len,
+                                    int sample_rate,
+                                    size_t hop_size,
+                                    double* tempo_bpm,
+                                    double* confidence) {
+    if (!odf || odf_len == 0) {
+        *tempo_bpm = 0.0;
+        *confidence = 0.0;
+        return;
+    }
+
+    // Simple autocorrelation, over the lags of the 40-200 BPM range only
+    double frame_rate = (double)sample_rate / (double)hop_size;
+    size_t min_lag = (size_t)floor((60.0 / 200.0) * frame_rate);
+    size_t max_lag = (size_t)ceil ((60.0 /  40.0) * frame_rate) + 1;
+    if (max_lag > odf_len / 2) max_lag = odf_len / 2;
+    if (min_lag < 1) min_lag = 1;
+    double best_val = -1.0, second_val = -1.0;
+    size_t best_lag = 0;
+
+    for (size_t lag = min_lag; lag < max_lag; lag++) {
+        double sum = 0.0;
+        for (size_t i = 0; i + lag < odf_len; i++) {
+            sum += odf[i] * odf[i+lag];
+        }
+
+        // Only consider BPMs in reasonable range
+        double sec = (lag * hop_size) / (double)sample_rate;
+        double bpm = (sec > 0.0 ? 60.0 / sec : 0.0);
+        if (bpm < 40.0 || bpm > 200.0) continue;
+
+        // Track top 2 peaks
+        if (sum > best_val) {
+            second_val = best_val;
+            best_val = sum;
+            best_lag = lag;
+        } else if (sum > second_val) {
+            second_val = sum;
+        }
+    }
+
+    if (best_lag > 0) {
+        double sec = (best_lag * hop_size) / (double)sample_rate;
+        *tempo_bpm = 60.0 / sec;
+
+        // ----- Confidence improvement -----
+        if (second_val > 0.0) {
+            double ratio = best_val / second_val;  // >1 = dominant
+            // map into [0,1] with a soft clamp
+            *confidence = (ratio > 2.0 ? 1.0 : (ratio - 1.0));
+            if (*confidence < 0.0) *confidence = 0.0;
+            if (*confidence > 1.0) *confidence = 1.0;
+        } else {
+            *confidence = 1.0; // only one strong peak
+        }
+    } else {
+        *tempo_bpm = 0.0;
+        *confidence = 0.0;
+    }
+}
+
+// ---------- Dynamic programming beat tracker ----------
+
+/**
+ * Local score: the onset envelope (unit variance) smoothed with a Gaussian
+ * of width period/32, so onsets close to a beat position still count.
+ */
+static double* beat_local_score(const float* odf, size_t n, double period) {
+    double mean = 0.0, var = 0.0;
+    for (size_t i = 0; i < n; i++) mean += odf[i];
+    mean /= (double)n;
+    for (size_t i = 0; i < n; i++) var += (odf[i] - mean) * (odf[i] - mean);
+    double sd = sqrt(var / (double)n);
+    double scale = (sd > 1e-12 ? 1.0 / sd : 0.0);
+
+    int half = (int)lround(period);
+    double sigma = period / 32.0;
+    double* kernel = (double*)malloc(sizeof(double) * (2 * (size_t)half + 1));
+    double* score = (double*)calloc(n, sizeof(double));
+    if (!kernel || !score) {
+        free(kernel); free(score);
+        return NULL;
+    }
+    for (int k = -half; k <= half; k++) {
+        kernel[k + half] = exp(-0.5 * (k / sigma) * (k / sigma));
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        double v = odf[i] * scale;
+        if (v == 0.0) continue;
+        size_t lo = (i > (size_t)half ? i - half : 0);
+        size_t hi = (i + half < n ? i + half : n - 1);
+        for (size_t j = lo; j <= hi; j++) {
+            score[j] += v * kernel[(long)j - (long)i + half];
+        }
+    }
+    free(kernel);
+    return score;
+}
+
+/**
+ * Ellis DP: cumscore[t] = local[t] + max over t-2P..t-P/2 of
+ * cumscore[prev] - tightness * log((t-prev)/P)^2; beats are then read back
+ * from the best final position.
+ */
+static size_t track_beats_dp(const double* local, size_t n, double period,
+                             double tightness, size_t* beats) {
+    int max_off = (int)lround(2.0 * period);
+    int min_off = (int)lround(0.5 * period);
+    if (min_off < 1) min_off = 1;
+    if (max_off <= min_off) return 0;
+
+    double* cum = (double*)malloc(sizeof(double) * n);
+    long* back = (long*)malloc(sizeof(long) * n);
+    double* txcost = (double*)malloc(sizeof(double) * (size_t)(max_off + 1));
+    if (!cum || !back || !txcost) {
+        free(cum); free(back); free(txcost);
+        return 0;
+    }
+    for (int off = min_off; off <= max_off; off++) {
+        double l = log((double)off / period);
+        txcost[off] = -tightness * l * l;
+    }
+
+    for (size_t t = 0; t < n; t++) {
+        double best = -INFINITY;
+        long arg = -1;
+        for (int off = min_off; off <= max_off && (size_t)off <= t; off++) {
+            double s = cum[t - off] + txcost[off];
+            if (s > best) { best = s; arg = (long)(t - off); }
+        }
+        cum[t] = local[t] + (arg >= 0 ? best : 0.0);
+        back[t] = arg;
+    }
+
+    // Last beat: the final local maximum of cumscore that reaches half the
+    // median local-maximum score.
+    size_t max_count = 0;
+    double* maxima = (double*)malloc(sizeof(double) * n);
+    if (maxima) {
+        for (size_t t = 1; t + 1 < n; t++) {
+            if (cum[t] > cum[t-1] && cum[t] >= cum[t+1]) maxima[max_count++] = cum[t];
+        }
+    }
+    double threshold = (max_count > 0 ? 0.5 * median_select(maxima, max_count) : 0.0);
+    free(maxima);
+
+    long last = -1;
+    for (size_t t = n - 1; t > 0 && last < 0; t--) {
+        if (t + 1 < n && cum[t] > cum[t-1] && cum[t] >= cum[t+1] && cum[t] >= threshold) last = (long)t;
+    }
+
+    size_t count = 0;
+    for (long t = last; t >= 0; t = back[t]) beats[count++] = (size_t)t;
+    for (size_t i = 0; i < count / 2; i++) {
+        size_t tmp = beats[i];
+        beats[i] = beats[count - 1 - i];
+        beats[count - 1 - i] = tmp;
+    }
+
+    free(cum);
+    free(back);
+    free(txcost);
+    return count;
+}
+
+// Drop weak beats at either end (silence before/after the music).
+static size_t trim_beats(const double* local, size_t* beats, size_t count) {
+    if (count == 0) return 0;
+    double sumsq = 0.0;
+    for (size_t i = 0; i < count; i++) sumsq += local[beats[i]] * local[beats[i]];
+    double threshold = 0.5 * sqrt(sumsq / (double)count);
+
+    size_t first = 0, end = count;
+    while (first < end && local[beats[first]] <= threshold) first++;
+    while (end > first && local[beats[end - 1]] <= threshold) end--;
+    if (first > 0) memmove(beats, beats + first, sizeof(size_t) * (end - first));
+    return end - first;
+}
+
+// ---------- Public API ----------
+
+int compute_beat_grid(const float* mono,
+                      size_t frames,
+                      int sample_rate,
+                      BeatGrid* out) {
+    if (!mono || frames == 0 || sample_rate <= 0 || !out) return -1;
+    OnsetFunction onset;
+    if (compute_onset_function(mono, frames, sample_rate, &onset) != 0) {
+        memset(out, 0, sizeof(*out));
+        return -2; // onset detection failed
+    }
+    int rc = compute_beat_grid_onset(&onset, out);
+    free_onset_function(&onset);
+    return rc;
+}
+
+int compute_beat_grid_onset(const OnsetFunction* onset, BeatGrid* out) {
+    if (!onset || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    out->hop_size = onset->hop_size;
+    out->sample_rate = onset->sample_rate;
+    if (!onset->odf || onset->odf_len == 0) return -2; // onset detection failed
+
+    out->odf = (float*)malloc(sizeof(float) * onset->odf_len);
+    if (!out->odf) return -3;
+    memcpy(out->odf, onset->odf, sizeof(float) * onset->odf_len);
+    out->odf_len = onset->odf_len;
+
+    estimate_tempo_from_odf(out->odf, out->odf_len, out->sample_rate, out->hop_size,
+                            &out->tempo_bpm, &out->tempo_confidence);
+    if (out->tempo_bpm <= 0.0) return 0;
+
+    double period = onset->frame_rate * 60.0 / out->tempo_bpm; // frames per beat
+    double* local = beat_local_score(out->odf, out->odf_len, period);
+    size_t* beats = (size_t*)malloc(sizeof(size_t) * out->odf_len);
+    if (!local || !beats) {
+        free(local); free(beats);
+        return -3;
+    }
+
+    size_t count = track_beats_dp(local, out->odf_len, period, BEAT_TIGHTNESS, beats);
+    count = trim_beats(local, beats, count);
+    free(local);
+
+    double* times = (double*)malloc(sizeof(double) * (count > 0 ? count : 1));
+    if (!times) {
+        free(beats);
+        return -3;
+    }
+    for (size_t i = 0; i < count; i++) times[i] = beats[i] / onset->frame_rate;
+
+    out->beat_frames = beats;
+    out->beat_times = times;
+    out->beat_count = count;
+    return 0;
+}
+
+void free_beat_grid(BeatGrid* grid) {
+    if (!grid) return;
+    free(grid->odf);
+    free(grid->beat_frames);
+    free(grid->beat_times);
+    memset(grid, 0, sizeof(*grid));
+}
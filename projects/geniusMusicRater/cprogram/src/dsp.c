@@ -0,0 +1,312 @@
+#include "dsp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#ifdef DSP_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+// ---------- FFT ----------
+
+static int is_pow2(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+static FftPlan* fft_plan_create(int n) {
+    if (!is_pow2(n)) return NULL;
+    FftPlan* p = (FftPlan*)calloc(1, sizeof(FftPlan));
+    if (!p) return NULL;
+    p->n = n;
+    p->bitrev = (int*)malloc(sizeof(int) * n);
+    p->twiddle = (DspComplex*)malloc(sizeof(DspComplex) * (n / 2 > 0 ? n / 2 : 1));
+    if (!p->bitrev || !p->twiddle) {
+        free(p->bitrev); free(p->twiddle); free(p);
+        return NULL;
+    }
+
+    int bits = 0;
+    while ((1 << bits) < n) bits++;
+    for (int i = 0; i < n; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+        }
+        p->bitrev[i] = r;
+    }
+    for (int k = 0; k < n / 2; ++k) {
+        double theta = -2.0 * M_PI * (double)k / (double)n;
+        p->twiddle[k].r = cos(theta);
+        p->twiddle[k].i = sin(theta);
+    }
+    return p;
+}
+
+static void fft_plan_destroy(FftPlan* p) {
+    if (!p) return;
+    free(p->bitrev);
+    free(p->twiddle);
+    free(p);
+}
+
+void dsp_fft(const FftPlan* plan, DspComplex* a) {
+    if (!plan || !a) return;
+    int n = plan->n;
+
+    for (int i = 0; i < n; ++i) {
+        int j = plan->bitrev[i];
+        if (i < j) { DspComplex t = a[i]; a[i] = a[j]; a[j] = t; }
+    }
+
+    for (int m = 2; m <= n; m <<= 1) {
+        int half = m / 2;
+        int stride = n / m;
+        for (int k = 0; k < n; k += m) {
+            for (int j = 0; j < half; ++j) {
+                DspComplex w = plan->twiddle[j * stride];
+                DspComplex* lo = &a[k + j];
+                DspComplex* hi = &a[k + j + half];
+                double tr = w.r * hi->r - w.i * hi->i;
+                double ti = w.r * hi->i + w.i * hi->r;
+                hi->r = lo->r - tr;
+                hi->i = lo->i - ti;
+                lo->r += tr;
+                lo->i += ti;
+            }
+        }
+    }
+}
+
+// ---------- Dense products ----------
+
+void dsp_matmul(const double* a, size_t rows, int inner,
+                const double* b, int cols, double* out) {
+    if (!a || !b || !out || inner <= 0 || cols <= 0) return;
+    for (size_t r = 0; r < rows; ++r) {
+        const double* ar = a + r * (size_t)inner;
+        double* o = out + r * (size_t)cols;
+        int c = 0;
+#ifdef DSP_HAVE_SSE2
+        // two output columns per register, the row of `a` broadcast
+        for (; c + 4 <= cols; c += 4) {
+            __m128d s0 = _mm_setzero_pd();
+            __m128d s1 = _mm_setzero_pd();
+            for (int k = 0; k < inner; ++k) {
+                __m128d x = _mm_set1_pd(ar[k]);
+                const double* bk = b + (size_t)k * cols + c;
+                s0 = _mm_add_pd(s0, _mm_mul_pd(x, _mm_loadu_pd(bk)));
+                s1 = _mm_add_pd(s1, _mm_mul_pd(x, _mm_loadu_pd(bk + 2)));
+            }
+            _mm_storeu_pd(o + c, s0);
+            _mm_storeu_pd(o + c + 2, s1);
+        }
+#endif
+        for (; c < cols; ++c) {
+            double s = 0.0;
+            for (int k = 0; k < inner; ++k) s += ar[k] * b[(size_t)k * cols + c];
+            o[c] = s;
+        }
+    }
+}
+
+// ---------- Cache ----------
+
+static DSP_THREAD_LOCAL DspCache* g_bound_cache = NULL;
+
+// Threads that never bind a cache get one on first use; a thread-exit
+// destructor releases it (threads such as server workers come and go).
+// Only if that allocation fails is a static per-thread cache used instead.
+static DSP_THREAD_LOCAL DspCache* g_fallback_cache = NULL;
+static DSP_THREAD_LOCAL DspCache g_fallback_static;  // zero-initialized == dsp_cache_init()
+static pthread_once_t g_fallback_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_fallback_key;
+static int g_fallback_key_ok = 0;
+
+static void fallback_release(void* p) {
+    dsp_cache_clear((DspCache*)p);
+    free(p);
+}
+
+static void fallback_make_key(void) {
+    g_fallback_key_ok = (pthread_key_create(&g_fallback_key, fallback_release) == 0);
+}
+
+static DspCache* fallback_cache(void) {
+    if (g_fallback_cache) return g_fallback_cache;
+    pthread_once(&g_fallback_once, fallback_make_key);
+    DspCache* c = (g_fallback_key_ok ? (DspCache*)calloc(1, sizeof(DspCache)) : NULL);
+    if (c && pthread_setspecific(g_fallback_key, c) != 0) {
+        free(c);
+        c = NULL;
+    }
+    g_fallback_cache = (c ? c : &g_fallback_static);
+    return g_fallback_cache;
+}
+
+void dsp_cache_init(DspCache* cache) {
+    if (cache) memset(cache, 0, sizeof(*cache));
+}
+
+void dsp_cache_clear(DspCache* cache) {
+    if (!cache) return;
+    for (int i = 0; i < cache->plan_count; ++i) fft_plan_destroy(cache->plans[i]);
+    free(cache->plans);
+    for (int i = 0; i < cache->window_count; ++i) free(cache->windows[i].w);
+    free(cache->windows);
+    for (int i = 0; i < cache->mel_count; ++i) free(cache->mels[i].weights);
+    free(cache->mels);
+    for (int i = 0; i < cache->dct_count; ++i) free(cache->dcts[i].basis);
+    free(cache->dcts);
+    for (int s = 0; s < DSP_SCRATCH_SLOTS; ++s) free(cache->scratch[s]);
+    memset(cache, 0, sizeof(*cache));
+}
+
+DspCache* dsp_cache_bind(DspCache* cache) {
+    DspCache* prev = g_bound_cache;
+    g_bound_cache = cache;
+    return prev;
+}
+
+DspCache* dsp_cache_current(void) {
+    return g_bound_cache ? g_bound_cache : fallback_cache();
+}
+
+// grow a cache array by one slot; returns 0 on success
+static int grow(void** arr, int* cap, int count, size_t elem) {
+    if (count < *cap) return 0;
+    int newcap = *cap ? *cap * 2 : 4;
+    void* na = realloc(*arr, elem * (size_t)newcap);
+    if (!na) return -1;
+    *arr = na;
+    *cap = newcap;
+    return 0;
+}
+
+const FftPlan* dsp_fft_plan(int n) {
+    DspCache* c = dsp_cache_current();
+    for (int i = 0; i < c->plan_count; ++i) {
+        if (c->plans[i]->n == n) return c->plans[i];
+    }
+    if (grow((void**)&c->plans, &c->plan_cap, c->plan_count, sizeof(FftPlan*)) != 0) return NULL;
+    FftPlan* p = fft_plan_create(n);
+    if (!p) return NULL;
+    c->plans[c->plan_count++] = p;
+    return p;
+}
+
+const double* dsp_window(DspWindowKind kind, int n) {
+    if (n <= 0) return NULL;
+    DspCache* c = dsp_cache_current();
+    for (int i = 0; i < c->window_count; ++i) {
+        if (c->windows[i].n == n && c->windows[i].kind == kind) return c->windows[i].w;
+    }
+    if (grow((void**)&c->windows, &c->window_cap, c->window_count, sizeof(DspWindow)) != 0) return NULL;
+    double* w = (double*)malloc(sizeof(double) * n);
+    if (!w) return NULL;
+    double denom = (kind == DSP_HANN_SYMMETRIC) ? (double)(n > 1 ? n - 1 : 1) : (double)n;
+    for (int i = 0; i < n; ++i) {
+        w[i] = 0.5 * (1.0 - cos(2.0 * M_PI * (double)i / denom));
+    }
+    c->windows[c->window_count].n = n;
+    c->windows[c->window_count].kind = kind;
+    c->windows[c->window_count].w = w;
+    c->window_count++;
+    return w;
+}
+
+// ---------- Mel filterbank ----------
+
+static double hz_to_mel(double f) {
+    return 2595.0 * log10(1.0 + f / 700.0);
+}
+static double mel_to_hz(double m) {
+    return 700.0 * (pow(10.0, m / 2595.0) - 1.0);
+}
+
+static double* mel_weights_create(int sr, int n_fft, int n_filters, double fmin, double fmax) {
+    double* weights = (double*)calloc((size_t)n_filters * (n_fft/2+1), sizeof(double));
+    double* mel_points = (double*)malloc((n_filters+2) * sizeof(double));
+    int* bins = (int*)malloc((n_filters+2) * sizeof(int));
+    if (!weights || !mel_points || !bins) {
+        free(weights); free(mel_points); free(bins);
+        return NULL;
+    }
+
+    double mel_min = hz_to_mel(fmin);
+    double mel_max = hz_to_mel(fmax);
+    double mel_step = (mel_max - mel_min) / (n_filters + 1);
+
+    for (int i=0; i<n_filters+2; ++i) {
+        mel_points[i] = mel_to_hz(mel_min + mel_step * i);
+        bins[i] = (int)floor((n_fft+1) * mel_points[i] / sr);
+    }
+
+    for (int m=1; m <= n_filters; ++m) {
+        int f_m_minus = bins[m-1];
+        int f_m = bins[m];
+        int f_m_plus = bins[m+1];
+        for (int k=f_m_minus; k<f_m; ++k) {
+            if (k>=0 && k<=n_fft/2)
+                weights[(m-1)*(n_fft/2+1) + k] = (double)(k - f_m_minus) / (f_m - f_m_minus);
+        }
+        for (int k=f_m; k<f_m_plus; ++k) {
+            if (k>=0 && k<=n_fft/2)
+                weights[(m-1)*(n_fft/2+1) + k] = (double)(f_m_plus - k) / (f_m_plus - f_m);
+        }
+    }
+
+    free(mel_points); free(bins);
+    return weights;
+}
+
+const double* dsp_mel_filterbank(int sr, int n_fft, int n_filters, double fmin, double fmax) {
+    if (sr <= 0 || n_fft <= 0 || n_filters <= 0) return NULL;
+    DspCache* c = dsp_cache_current();
+    for (int i = 0; i < c->mel_count; ++i) {
+        const DspMel* m = &c->mels[i];
+        if (m->sr == sr && m->n_fft == n_fft && m->n_filters == n_filters &&
+            m->fmin == fmin && m->fmax == fmax) return m->weights;
+    }
+    if (grow((void**)&c->mels, &c->mel_cap, c->mel_count, sizeof(DspMel)) != 0) return NULL;
+    double* weights = mel_weights_create(sr, n_fft, n_filters, fmin, fmax);
+    if (!weights) return NULL;
+    DspMel* m = &c->mels[c->mel_count++];
+    m->sr = sr; m->n_fft = n_fft; m->n_filters = n_filters;
+    m->fmin = fmin; m->fmax = fmax;
+    m->weights = weights;
+    return weights;
+}
+
+const double* dsp_dct_basis(int n_in, int n_out) {
+    if (n_in <= 0 || n_out <= 0) return NULL;
+    DspCache* c = dsp_cache_current();
+    for (int i = 0; i < c->dct_count; ++i) {
+        const DspDct* d = &c->dcts[i];
+        if (d->n_in == n_in && d->n_out == n_out) return d->basis;
+    }
+    if (grow((void**)&c->dcts, &c->dct_cap, c->dct_count, sizeof(DspDct)) != 0) return NULL;
+
+    double* basis = (double*)malloc(sizeof(double) * (size_t)n_in * n_out);
+    if (!basis) return NULL;
+    for (int k = 0; k < n_out; ++k) {
+        for (int n = 0; n < n_in; ++n) {
+            basis[k * n_in + n] = cos(M_PI / n_in * (n + 0.5) * k);
+        }
+    }
+    DspDct* d = &c->dcts[c->dct_count++];
+    d->n_in = n_in; d->n_out = n_out;
+    d->basis = basis;
+    return basis;
+}
+
+void* dsp_scratch(DspScratchSlot slot, size_t bytes) {
+    if (slot < 0 || slot >= DSP_SCRATCH_SLOTS) return NULL;
+    DspCache* c = dsp_cache_current();
+    if (c->scratch_size[slot] < bytes) {
+        void* p = realloc(c->scratch[slot], bytes);
+        if (!p) return NULL;
+        c->scratch[slot] = p;
+        c->scratch_size[slot] = bytes;
+    }
+    return c->scratch[slot];
+}
@@ -0,0 +1,14 @@
+#include "fastmath.h"
+#include "dsp.h"
+
+static DSP_THREAD_LOCAL int g_fast_math = 0;
+
+int fast_math_bind(int on) {
+    int prev = g_fast_math;
+    g_fast_math = (on != 0);
+    return prev;
+}
+
+int fast_math_enabled(void) {
+    return g_fast_math;
+}
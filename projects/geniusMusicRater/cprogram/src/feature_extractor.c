@@ -1,62 +1,13 @@
 #include "feature_extractor.h"
+#include "dsp.h"
+#include "spectral_kernel.h"
+#include "fastmath.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-// ---------- Utility: simple complex type and radix-2 iterative FFT ----------
-
-typedef struct { double r, i; } cpx;
-
-static void bit_reverse(cpx* a, size_t n) {
-    size_t j = 0;
-    for (size_t i = 0; i < n; ++i) {
-        if (i < j) {
-            cpx t = a[i]; a[i] = a[j]; a[j] = t;
-        }
-        size_t m = n >> 1;
-        while (m && j >= m) {
-            j -= m;
-            m >>= 1;
-        }
-        j += m;
-    }
-}
-
-static void fft(cpx* a, size_t n) {
-    bit_reverse(a, n);
-    for (size_t s = 1; (size_t)1 << s <= n; ++s) {
-        size_t m = (size_t)1 << s;
-        double theta = -2.0 * M_PI / (double)m;
-        cpx wm = { cos(theta), sin(theta) };
-        for (size_t k = 0; k < n; k += m) {
-            cpx w = {1.0, 0.0};
-            for (size_t j = 0; j < m/2; ++j) {
-                cpx t = { w.r * a[k + j + m/2].r - w.i * a[k + j + m/2].i,
-                          w.r * a[k + j + m/2].i + w.i * a[k + j + m/2].r };
-                cpx u = a[k + j];
-                a[k + j].r       = u.r + t.r;
-                a[k + j].i       = u.i + t.i;
-                a[k + j + m/2].r = u.r - t.r;
-                a[k + j + m/2].i = u.i - t.i;
-                cpx wnext = { w.r * wm.r - w.i * wm.i, w.r * wm.i + w.i * wm.r };
-                w = wnext;
-            }
-        }
-    }
-}
-
-// ---------- Windowing and framing helpers ----------
-
-static void hann(double* w, size_t n) {
-    for (size_t i = 0; i < n; ++i) {
-        w[i] = 0.5 * (1.0 - cos(2.0 * M_PI * (double)i / (double)(n)));
-    }
-}
+// ---------- Framing helper ----------
 
 static size_t compute_num_frames(size_t total, size_t frame, size_t hop) {
     if (total == 0) return 0;
@@ -64,300 +15,147 @@ static size_t compute_num_frames(size_t total, size_t frame, size_t hop) {
     return 1 + (total - frame) / hop;
 }
 
-// ---------- Mel filterbank and DCT for MFCC ----------
-
-static double hz_to_mel(double f) {
-    return 2595.0 * log10(1.0 + f / 700.0);
-}
-static double mel_to_hz(double m) {
-    return 700.0 * (pow(10.0, m / 2595.0) - 1.0);
+// Window + transform one frame of mono into X (n_fft bins).
+static void windowed_fft(const FftPlan* plan, const float* x, const double* window, DspComplex* X) {
+    for (int i = 0; i < plan->n; ++i) {
+        X[i].r = (double)x[i] * window[i];
+        X[i].i = 0.0;
+    }
+    dsp_fft(plan, X);
 }
 
-typedef struct {
-    int n_filters;
-    int n_fft;
-    int sr;
-    double* weights; // size n_filters * (n_fft/2+1)
-} MelFB;
-
-// ---------- Mel Filterbank + MFCC ----------
-
-static MelFB* mel_filterbank(int sr, int n_fft, int n_filters, double fmin, double fmax) {
-    MelFB* fb = (MelFB*)calloc(1, sizeof(MelFB));
-    if (!fb) return NULL;
-    fb->n_filters = n_filters;
-    fb->n_fft = n_fft;
-    fb->sr = sr;
-    fb->weights = (double*)calloc((size_t)n_filters * (n_fft/2+1), sizeof(double));
-    if (!fb->weights) { free(fb); return NULL; }
-
-    double mel_min = hz_to_mel(fmin);
-    double mel_max = hz_to_mel(fmax);
-    double mel_step = (mel_max - mel_min) / (n_filters + 1);
-
-    double* mel_points = (double*)malloc((n_filters+2) * sizeof(double));
-    int* bins = (int*)malloc((n_filters+2) * sizeof(int));
-
-    for (int i=0; i<n_filters+2; ++i) {
-        mel_points[i] = mel_to_hz(mel_min + mel_step * i);
-        bins[i] = (int)floor((n_fft+1) * mel_points[i] / sr);
-    }
+// ----------------- Public API Implementations --------------------
 
-    for (int m=1; m <= n_filters; ++m) {
-        int f_m_minus = bins[m-1];
-        int f_m = bins[m];
-        int f_m_plus = bins[m+1];
-        for (int k=f_m_minus; k<f_m; ++k) {
-            if (k>=0 && k<=n_fft/2)
-                fb->weights[(m-1)*(n_fft/2+1) + k] = (double)(k - f_m_minus) / (f_m - f_m_minus);
-        }
-        for (int k=f_m; k<f_m_plus; ++k) {
-            if (k>=0 && k<=n_fft/2)
-                fb->weights[(m-1)*(n_fft/2+1) + k] = (double)(f_m_plus - k) / (f_m_plus - f_m);
-        }
+void mfcc_from_power(const double* power, int n_bins, const double* mel_w, int n_filters,
+                     const double* dct_basis, int fast, double* melE, double* mfcc) {
+    // mel energies
+    for (int m=0; m<n_filters; ++m) {
+        double e=0.0;
+        for (int k=0; k<n_bins; ++k)
+            e += power[k] * mel_w[m*n_bins + k];
+        melE[m] = (fast ? fm_log(e+1e-9) : log(e+1e-9));
     }
 
-    free(mel_points); free(bins);
-    return fb;
-}
-
-static void free_melfb(MelFB* fb) {
-    if (!fb) return;
-    free(fb->weights);
-    free(fb);
-}
-
-// Discrete Cosine Transform (DCT-II) for MFCC
-static void dct(double* in, int n_in, double* out, int n_out) {
-    for (int k=0; k<n_out; ++k) {
+    // DCT
+    for (int i=0; i<FEATURE_MFCC_COUNT; ++i) {
         double sum = 0.0;
-        for (int n=0; n<n_in; ++n) {
-            sum += in[n] * cos(M_PI / n_in * (n + 0.5) * k);
-        }
-        out[k] = sum;
+        for (int m=0; m<n_filters; ++m) sum += melE[m] * dct_basis[i*n_filters + m];
+        mfcc[i] = sum;
     }
 }
 
-// ---------------- Spectral Feature Computations -----------------
-
-static void spectral_features_from_frame(
-    const double* mag, int nfft, int sr,
-    double* centroid, double* rolloff, double* brightness)
-{
-    int n = nfft/2 + 1;
-
-    // Use power spectrum for all three to keep them consistent
-    double energy_tot = 0.0;
-    double weighted_sum = 0.0;
-
-    for (int k = 0; k < n; ++k) {
-        double f = (double)k * sr / (double)nfft;
-        double p = mag[k] * mag[k]; // power
-        energy_tot += p;
-        weighted_sum += f * p;
-    }
-
-    *centroid = (energy_tot > 1e-12) ? (weighted_sum / energy_tot) : 0.0;
-
-    // 85% rolloff
-    double target = 0.85 * energy_tot;
-    double acc = 0.0;
-    *rolloff = 0.0;
-    for (int k = 0; k < n; ++k) {
-        double p = mag[k] * mag[k];
-        acc += p;
-        if (acc >= target) {
-            *rolloff = (double)k * sr / (double)nfft;
-            break;
-        }
-    }
-
-    // Brightness: fraction of energy above 1500 Hz
-    double bright_energy = 0.0;
-    for (int k = 0; k < n; ++k) {
-        double f = (double)k * sr / (double)nfft;
-        double p = mag[k] * mag[k];
-        if (f >= 1500.0) bright_energy += p;
-    }
-    *brightness = (energy_tot > 1e-12) ? (bright_energy / energy_tot) : 0.0;
+int compute_spectral_features(const float* mono, size_t frames, int sr, SpectralFeatures* out) {
+    return compute_spectral_features_stride(mono, frames, sr, 1, out);
 }
 
-// ----------------- Public API Implementations --------------------
-
-int compute_spectral_features(const float* mono, size_t frames, int sr, SpectralFeatures* out) {
+int compute_spectral_features_stride(const float* mono, size_t frames, int sr, int stride,
+                                     SpectralFeatures* out) {
     if (!mono || frames == 0 || sr <= 0 || !out) return -1;
+    if (stride < 1) stride = 1;
 
     // Analysis parameters
     int n_fft = 1024;
     int hop = n_fft/2;
     int n_filters = 26;
 
-    // Window
-    double* window = (double*)malloc(n_fft * sizeof(double));
-    hann(window, n_fft);
+    // Cached window, FFT plan, mel filterbank and DCT basis (see dsp.h)
+    const double* window = dsp_window(DSP_HANN_PERIODIC, n_fft);
+    const FftPlan* plan = dsp_fft_plan(n_fft);
+    const double* mel_w = dsp_mel_filterbank(sr, n_fft, n_filters, 0.0, sr/2.0);
+    const double* dct_basis = dsp_dct_basis(n_filters, FEATURE_MFCC_COUNT);
+    if (!window || !plan || !mel_w || !dct_basis) return -2;
+
+    int n_bins = n_fft/2+1;
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * n_fft);
+    double* power = (double*)dsp_scratch(DSP_SCRATCH_MAG, sizeof(double) * n_bins);
+    double* melE = (double*)dsp_scratch(DSP_SCRATCH_AUX, sizeof(double) * n_filters);
+    if (!X || !power || !melE) return -2;
 
-    // Mel filterbank
-    MelFB* fb = mel_filterbank(sr, n_fft, n_filters, 0.0, sr/2.0);
-    if (!fb) { free(window); return -2; }
+    // Power and per-frame descriptors in one pass (see spectral_kernel.h)
+    SpectralKernel kernel;
+    if (spectral_kernel_init(&kernel, n_fft, sr, NULL, 0) != 0) return -1;
+    kernel.flatness = 1;
 
     // Accumulators
     double centroid_sum = 0.0, rolloff_sum = 0.0, bright_sum = 0.0;
+    double bandwidth_sum = 0.0, flatness_sum = 0.0;
+    const int fast = fast_math_enabled();
     double mfcc_acc[FEATURE_MFCC_COUNT];
     for(int i=0;i<FEATURE_MFCC_COUNT;i++) mfcc_acc[i]=0.0;
     int n_frames = 0;
 
     // Frame loop
     size_t num_frames = compute_num_frames(frames, n_fft, hop);
-    for (size_t fi=0; fi<num_frames; ++fi) {
+    for (size_t fi=0; fi<num_frames; fi += (size_t)stride) {
         size_t offset = fi * hop;
         if (offset + n_fft > frames) break;
 
-        // Copy + window
-        cpx* X = (cpx*)calloc(n_fft, sizeof(cpx));
-        for (int i=0; i<n_fft; ++i) {
-            double s = (double)mono[offset+i] * window[i];
-            X[i].r = s; X[i].i=0.0;
-        }
-        fft(X, n_fft);
-
-        // magnitude spectrum
-        int n_bins = n_fft/2+1;
-        double* mag = (double*)malloc(n_bins*sizeof(double));
-        for (int k=0; k<n_bins; ++k) {
-            mag[k] = sqrt(X[k].r*X[k].r + X[k].i*X[k].i);
-        }
-
-        // spectral feats
-        double c, r, b; 
-        spectral_features_from_frame(mag, n_fft, sr, &c, &r, &b);
-        centroid_sum += c; rolloff_sum += r; bright_sum += b;
-
-        // mel energies
-        double* melE = (double*)calloc(n_filters, sizeof(double));
-        for (int m=0; m<n_filters; ++m) {
-            double e=0.0;
-            for (int k=0; k<n_bins; ++k)
-                e += mag[k]*mag[k] * fb->weights[m*n_bins + k];
-            melE[m] = log(e+1e-9);
-        }
+        windowed_fft(plan, mono + offset, window, X);
 
-        // DCT
-        double mfcc_frame[FEATURE_MFCC_COUNT];
-        dct(melE, n_filters, mfcc_frame, FEATURE_MFCC_COUNT);
-        for (int i=0; i<FEATURE_MFCC_COUNT; ++i)
-            mfcc_acc[i] += mfcc_frame[i];
+        // power spectrum + spectral feats
+        SpectralFrame sf;
+        spectral_kernel_run(&kernel, X, power, NULL, NULL, NULL, &sf);
+        centroid_sum += sf.centroid; rolloff_sum += sf.rolloff; bright_sum += sf.brightness;
+        bandwidth_sum += sf.bandwidth; flatness_sum += sf.flatness;
 
-        free(melE);
-        free(mag);
-        free(X);
+        double mfcc[FEATURE_MFCC_COUNT];
+        mfcc_from_power(power, n_bins, mel_w, n_filters, dct_basis, fast, melE, mfcc);
+        for (int i=0; i<FEATURE_MFCC_COUNT; ++i) mfcc_acc[i] += mfcc[i];
         n_frames++;
     }
 
-    if (n_frames==0) { 
-        free(window); free_melfb(fb); 
-        return -3; 
-    }
+    if (n_frames==0) return -3;
 
     // Average
     out->centroid   = centroid_sum / n_frames;
     out->rolloff    = rolloff_sum / n_frames;
     out->brightness = bright_sum / n_frames;
+    out->bandwidth  = bandwidth_sum / n_frames;
+    out->flatness   = flatness_sum / n_frames;
     for (int i=0; i<FEATURE_MFCC_COUNT; ++i)
         out->mfcc[i] = mfcc_acc[i] / n_frames;
 
-    free(window);
-    free_melfb(fb);
     return 0;
 }
 
 // ---------------- Tempo Estimation -----------------
 
-static void compute_onset_envelope(const float* mono, size_t frames, int sr,
-                                   double** out_env, int* out_len, int hop, int n_fft) {
-    int n_bins = n_fft/2 + 1;
-    int num_frames = (int)compute_num_frames(frames, n_fft, hop);
-    double* window = (double*)malloc(n_fft * sizeof(double));
-    hann(window, n_fft);
-
-    double* env = (double*)calloc(num_frames, sizeof(double));
-    double* prev_mag = (double*)calloc(n_bins, sizeof(double));
-
-    for (int fi=0; fi<num_frames; ++fi) {
-        size_t offset = (size_t)fi * hop;
-        if (offset + n_fft > frames) break;
-
-        // FFT
-        cpx* X = (cpx*)calloc(n_fft, sizeof(cpx));
-        for (int i=0;i<n_fft;i++) {
-            double s = (double)mono[offset+i] * window[i];
-            X[i].r = s; X[i].i = 0.0;
-        }
-        fft(X, n_fft);
-
-        // spectral flux
-        double flux = 0.0;
-        for (int k=0; k<n_bins; ++k) {
-            double mag = sqrt(X[k].r*X[k].r + X[k].i*X[k].i);
-            double diff = mag - prev_mag[k];
-            if (diff > 0) flux += diff;
-            prev_mag[k] = mag;
-        }
-        env[fi] = flux;
-
-        free(X);
-    }
-
-    free(window); free(prev_mag);
-    *out_env = env;
-    *out_len = num_frames;
-}
-
-static void autocorrelate(const double* x, int n, double* ac) {
-    for (int lag=0; lag<n; ++lag) {
-        double sum=0.0;
-        for (int i=0;i<n-lag;i++) sum += x[i]*x[i+lag];
-        ac[lag]=sum;
-    }
-}
-
 int estimate_tempo_bpm(const float* mono, size_t frames, int sr, double* out_bpm) {
     if (!mono || frames==0 || sr<=0 || !out_bpm) return -1;
 
-    int n_fft = 1024;
-    int hop = n_fft/2;
-    double* env = NULL; int env_len=0;
-    compute_onset_envelope(mono, frames, sr, &env, &env_len, hop, n_fft);
-    if (!env || env_len<4) { free(env); *out_bpm=0.0; return -2; }
+    OnsetFunction onset;
+    if (compute_onset_function(mono, frames, sr, &onset) != 0) { *out_bpm=0.0; return -2; }
+    int rc = estimate_tempo_bpm_onset(&onset, out_bpm);
+    free_onset_function(&onset);
+    return rc;
+}
 
-    // Autocorrelation
-    double* ac = (double*)calloc(env_len, sizeof(double));
-    autocorrelate(env, env_len, ac);
+int estimate_tempo_bpm_onset(const OnsetFunction* onset, double* out_bpm) {
+    if (!onset || !out_bpm) return -1;
+    const float* env = onset->odf;
+    int env_len = (int)onset->odf_len;
+    if (!env || env_len<4) { *out_bpm=0.0; return -2; }
 
-    // Search best peak in lag range corresponding to 40–200 BPM
+    // Search best autocorrelation peak in lag range corresponding to 40–200 BPM
     double best_val=0.0; int best_lag=0;
     double min_period_sec = 60.0/200.0;
     double max_period_sec = 60.0/40.0;
-    double hop_time = (double)hop / sr;
 
-    int min_lag = (int)floor(min_period_sec / hop_time);
-    int max_lag = (int)ceil (max_period_sec / hop_time);
+    int min_lag = (int)floor(min_period_sec * onset->frame_rate);
+    int max_lag = (int)ceil (max_period_sec * onset->frame_rate);
     if (max_lag >= env_len) max_lag = env_len-1;
+    if (min_lag < 1) min_lag = 1;
 
     for (int lag=min_lag; lag<=max_lag; ++lag) {
-        if (ac[lag] > best_val) {
-            best_val = ac[lag];
+        double sum=0.0;
+        for (int i=0; i<env_len-lag; i++) sum += (double)env[i]*env[i+lag];
+        if (sum > best_val) {
+            best_val = sum;
             best_lag = lag;
         }
     }
 
-    if (best_lag>0) {
-        double period_sec = best_lag * hop_time;
-        *out_bpm = 60.0 / period_sec;
-    } else {
-        *out_bpm = 0.0;
-    }
-
-    free(env); free(ac);
+    *out_bpm = (best_lag>0 ? 60.0 * onset->frame_rate / best_lag : 0.0);
     return 0;
 }
 
@@ -367,45 +165,50 @@ int estimate_tempo_bpm(const float* mono, size_t frames, int sr, double* out_bpm
 static const double KK_major[12] = {6.35,2.23,3.48,2.33,4.38,4.09,2.52,5.19,2.39,3.66,2.29,2.88};
 static const double KK_minor[12] = {6.33,2.68,3.52,5.38,2.60,3.53,2.54,4.75,3.98,2.69,3.34,3.17};
 
+void chroma_bin_pitch_classes(int sr, int n_fft, int* bin_pc) {
+    int n_bins = n_fft/2+1;
+    for (int k=0;k<n_bins;k++) {
+        double freq = (double)k*sr/n_fft;
+        bin_pc[k] = -1;
+        if (k == 0 || freq < 50.0 || freq > 5000.0) continue;
+        double midi = 69.0 + 12.0*log2(freq/440.0);
+        int pc = ((int)round(midi)) % 12;
+        if (pc<0) pc+=12;
+        bin_pc[k] = pc;
+    }
+}
+
 static void compute_chroma(const float* mono, size_t frames, int sr,
                            double* out_chroma) {
     int n_fft = 4096;
     int hop = n_fft/2;
     int n_bins = n_fft/2+1;
 
-    double* window = (double*)malloc(n_fft * sizeof(double));
-    hann(window, n_fft);
-
-    size_t num_frames = compute_num_frames(frames, n_fft, hop);
     double chroma_acc[12]; memset(chroma_acc, 0, sizeof(chroma_acc));
+    const double* window = dsp_window(DSP_HANN_PERIODIC, n_fft);
+    const FftPlan* plan = dsp_fft_plan(n_fft);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * n_fft);
+    int* bin_pc = (int*)dsp_scratch(DSP_SCRATCH_MAG, sizeof(int) * n_bins);
+    if (!window || !plan || !X || !bin_pc) {
+        for (int i=0;i<12;i++) out_chroma[i]=0.0;
+        return;
+    }
+
+    chroma_bin_pitch_classes(sr, n_fft, bin_pc);
 
+    size_t num_frames = compute_num_frames(frames, n_fft, hop);
     for (size_t fi=0; fi<num_frames; ++fi) {
         size_t offset = fi*hop;
         if (offset + n_fft > frames) break;
 
-        // FFT
-        cpx* X = (cpx*)calloc(n_fft, sizeof(cpx));
-        for (int i=0;i<n_fft;i++) {
-            double s = (double)mono[offset+i]*window[i];
-            X[i].r = s; X[i].i=0.0;
-        }
-        fft(X,n_fft);
+        windowed_fft(plan, mono + offset, window, X);
 
         // Energy per pitch class
         for (int k=1;k<n_bins;k++) {
-            double freq = (double)k*sr/n_fft;
-            if (freq < 50.0 || freq > 5000.0) continue;
-            double mag2 = X[k].r*X[k].r + X[k].i*X[k].i;
-            // MIDI pitch
-            double midi = 69.0 + 12.0*log2(freq/440.0);
-            int pc = ((int)round(midi)) % 12;
-            if (pc<0) pc+=12;
-            chroma_acc[pc] += mag2;
+            if (bin_pc[k] < 0) continue;
+            chroma_acc[bin_pc[k]] += X[k].r*X[k].r + X[k].i*X[k].i;
         }
-
-        free(X);
     }
-    free(window);
 
     // Normalize
     double sum=0; for(int i=0;i<12;i++) sum+=chroma_acc[i];
@@ -413,12 +216,7 @@ static void compute_chroma(const float* mono, size_t frames, int sr,
     else { for(int i=0;i<12;i++) out_chroma[i]=0.0; }
 }
 
-int estimate_key(const float* mono, size_t frames, int sr, char out_key[8]) {
-    if (!mono || frames==0 || sr<=0 || !out_key) return -1;
-
-    double chroma[12];
-    compute_chroma(mono,frames,sr,chroma);
-
+void estimate_key_chroma(const double chroma[12], char out_key[8]) {
     // Try all 12 rotations
     const char* names[12]={"C","C#","D","D#","E","F","F#","G","G#","A","A#","B"};
     double best_corr=-1e9;
@@ -447,5 +245,13 @@ int estimate_key(const float* mono, size_t frames, int sr, char out_key[8]) {
     }
 
     snprintf(out_key,8,"%s %s",names[best_index], best_is_major?"maj":"min");
+}
+
+int estimate_key(const float* mono, size_t frames, int sr, char out_key[8]) {
+    if (!mono || frames==0 || sr<=0 || !out_key) return -1;
+
+    double chroma[12];
+    compute_chroma(mono,frames,sr,chroma);
+    estimate_key_chroma(chroma,out_key);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,101 @@
+#include "feature_graph.h"
+#include <string.h>
+
+#define B(n) FEATURE_BIT(n)
+
+// ---------- Graph ----------
+
+static const unsigned FEATURE_DEPS[FEATURE_COUNT] = {
+    [FEATURE_STATS]      = 0,
+    [FEATURE_SPECTRAL]   = 0,
+    [FEATURE_ONSET]      = 0,
+    [FEATURE_TEMPO]      = B(FEATURE_ONSET),
+    [FEATURE_KEY]        = 0,
+    [FEATURE_PRODUCTION] = 0,
+    // loudness_lu comes from the native-rate meter
+    [FEATURE_PSY]        = B(FEATURE_PRODUCTION),
+    [FEATURE_RATINGS]    = B(FEATURE_SPECTRAL) | B(FEATURE_TEMPO) | B(FEATURE_KEY) | B(FEATURE_PSY),
+    [FEATURE_BEATS]      = B(FEATURE_ONSET),
+    [FEATURE_RHYTHM]     = B(FEATURE_BEATS),
+    [FEATURE_HARMONY]    = B(FEATURE_BEATS),
+    [FEATURE_MELODY]     = 0,
+    [FEATURE_STRUCTURE]  = B(FEATURE_ONSET) | B(FEATURE_BEATS),
+    [FEATURE_GENIUS]     = B(FEATURE_STATS) | B(FEATURE_SPECTRAL) | B(FEATURE_PSY) | B(FEATURE_RHYTHM) |
+                           B(FEATURE_HARMONY) | B(FEATURE_MELODY) | B(FEATURE_STRUCTURE) |
+                           B(FEATURE_PRODUCTION),
+};
+
+typedef struct {
+    const char* name;
+    FeatureNode node;
+} FeatureName;
+
+// first entry per node is its canonical name; the rest are aliases
+static const FeatureName FEATURE_NAMES[] = {
+    {"stats",           FEATURE_STATS},
+    {"spectral",        FEATURE_SPECTRAL},
+    {"onset",           FEATURE_ONSET},
+    {"tempo",           FEATURE_TEMPO},
+    {"key",             FEATURE_KEY},
+    {"production",      FEATURE_PRODUCTION},
+    {"psy",             FEATURE_PSY},
+    {"ratings",         FEATURE_RATINGS},
+    {"beats",           FEATURE_BEATS},
+    {"rhythm",          FEATURE_RHYTHM},
+    {"harmony",         FEATURE_HARMONY},
+    {"melody",          FEATURE_MELODY},
+    {"structure",       FEATURE_STRUCTURE},
+    {"genius",          FEATURE_GENIUS},
+    {"basic_stats",     FEATURE_STATS},
+    {"mfcc",            FEATURE_SPECTRAL},
+    {"loudness",        FEATURE_PRODUCTION},
+    {"true_peak",       FEATURE_PRODUCTION},
+    {"psychoacoustics", FEATURE_PSY},
+    {"chords",          FEATURE_HARMONY},
+};
+
+unsigned feature_deps(FeatureNode node) {
+    if (node < 0 || node >= FEATURE_COUNT) return 0;
+    return FEATURE_DEPS[node];
+}
+
+unsigned feature_closure(unsigned selected) {
+    selected &= FEATURE_ALL;
+    // dependencies precede their users, so one backwards pass closes the set
+    for (int n = FEATURE_COUNT - 1; n >= 0; --n) {
+        if (selected & B(n)) selected |= FEATURE_DEPS[n];
+    }
+    return selected;
+}
+
+int feature_parse_list(const char* list, unsigned* out) {
+    if (!list || !out) return -1;
+    unsigned mask = 0;
+    const char* p = list;
+    while (*p) {
+        const char* end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        while (len > 0 && *p == ' ') { p++; len--; }
+        while (len > 0 && p[len - 1] == ' ') len--;
+        if (len > 0) {
+            size_t i = 0;
+            for (; i < sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0]); ++i) {
+                if (strlen(FEATURE_NAMES[i].name) == len && strncmp(FEATURE_NAMES[i].name, p, len) == 0) break;
+            }
+            if (i == sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0])) return -1;
+            mask |= B(FEATURE_NAMES[i].node);
+        }
+        if (!end) break;
+        p = end + 1;
+    }
+    if (mask == 0) return -1;
+    *out = mask;
+    return 0;
+}
+
+const char* feature_name(FeatureNode node) {
+    for (size_t i = 0; i < sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0]); ++i) {
+        if (FEATURE_NAMES[i].node == node) return FEATURE_NAMES[i].name;
+    }
+    return "unknown";
+}
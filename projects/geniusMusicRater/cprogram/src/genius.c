@@ -0,0 +1,647 @@
+#include "genius_report.h"
+#include "dsp.h"
+#include "fastmath.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+_Static_assert(GENIUS_MELODY_YIN == MELODY_BACKEND_YIN &&
+               GENIUS_MELODY_SALIENCE == MELODY_BACKEND_SALIENCE,
+               "GENIUS_MELODY_* must match MelodyBackend");
+
+struct GeniusContext {
+    DspCache dsp;           // FFT plans, windows, filterbanks, scratch
+    AudioDecoder* decoder;
+};
+
+// ---------- Genre profiles ----------
+
+typedef struct {
+    const char* name;
+    const RatingWeights* weights;
+    GeniusGenre genius_genre;
+} GenreProfile;
+
+static const GenreProfile GENRE_PROFILES[] = {
+    {"default",      &DEFAULT_WEIGHTS,      GENIUS_GENRE_DEFAULT},
+    {"rap",          &RAP_WEIGHTS,          GENIUS_GENRE_RAP},
+    {"vgm",          &VGM_WEIGHTS,          GENIUS_GENRE_VGM},
+    {"pop",          &POP_WEIGHTS,          GENIUS_GENRE_POP},
+    {"experimental", &EXPERIMENTAL_WEIGHTS, GENIUS_GENRE_EXPERIMENTAL},
+    {"phonk",        &PHONK_WEIGHTS,        GENIUS_GENRE_PHONK},
+};
+
+static const GenreProfile* find_genre(const char* name) {
+    if (name) {
+        for (size_t i = 0; i < sizeof(GENRE_PROFILES) / sizeof(GENRE_PROFILES[0]); ++i) {
+            if (strcmp(GENRE_PROFILES[i].name, name) == 0) return &GENRE_PROFILES[i];
+        }
+    }
+    return &GENRE_PROFILES[0];
+}
+
+// ---------- Basic stats ----------
+
+static GeniusBasicStats compute_basic_stats(const float* mono, size_t frames, int sample_rate) {
+    GeniusBasicStats s = {0};
+    if (!mono || frames == 0 || sample_rate <= 0) return s;
+
+    double sum = 0.0;
+    double sumsq = 0.0;
+    double peak = 0.0;
+    size_t zero_crossings = 0;
+
+    float prev = mono[0];
+    for (size_t i = 0; i < frames; ++i) {
+        float x = mono[i];
+        sum += x;
+        sumsq += (double)x * (double)x;
+        double a = fabs((double)x);
+        if (a > peak) peak = a;
+
+        if ((x >= 0.0f && prev < 0.0f) || (x < 0.0f && prev >= 0.0f)) {
+            zero_crossings++;
+        }
+        prev = x;
+    }
+
+    double mean = sum / (double)frames;
+    double rms = sqrt(sumsq / (double)frames);
+
+    s.duration_sec = (double)frames / (double)sample_rate;
+    s.rms = rms;
+    s.peak = peak;
+    s.dc_offset = mean;
+    s.zcr = ((double)zero_crossings / s.duration_sec);
+    return s;
+}
+
+// ---------- Context ----------
+
+int genius_api_version(void) {
+    return GENIUS_API_VERSION;
+}
+
+void genius_options_init(GeniusOptions* opts) {
+    if (!opts) return;
+    memset(opts, 0, sizeof(*opts));
+    opts->analysis_sample_rate = 44100;
+    audio_input_options_init(&opts->input);
+}
+
+GeniusContext* genius_context_create(void) {
+    GeniusContext* ctx = (GeniusContext*)calloc(1, sizeof(GeniusContext));
+    if (!ctx) return NULL;
+    dsp_cache_init(&ctx->dsp);
+    // created up front: older libmpg123 wants mpg123_init() outside worker threads
+    ctx->decoder = audio_decoder_create();
+    if (!ctx->decoder) {
+        free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void genius_context_destroy(GeniusContext* ctx) {
+    if (!ctx) return;
+    if (dsp_cache_current() == &ctx->dsp) dsp_cache_bind(NULL);
+    dsp_cache_clear(&ctx->dsp);
+    audio_decoder_destroy(ctx->decoder);
+    free(ctx);
+}
+
+// ---------- Shared pipeline ----------
+
+// Requested outputs (the legacy melody/structure/genius switches add to the
+// selection) closed over their dependencies.
+static unsigned selected_features(const GeniusOptions* opts) {
+    unsigned sel = opts->features ? opts->features : FEATURE_DEFAULT;
+    if (opts->melody) sel |= FEATURE_BIT(FEATURE_MELODY);
+    if (opts->structure) sel |= FEATURE_BIT(FEATURE_STRUCTURE);
+    if (opts->genius) sel |= FEATURE_BIT(FEATURE_GENIUS);
+    unsigned need = feature_closure(sel);
+    if (!opts->features) {
+        // switch mode: genius rates melody/structure only when they are on
+        if (!opts->melody) need &= ~FEATURE_BIT(FEATURE_MELODY);
+        if (!opts->structure) need &= ~FEATURE_BIT(FEATURE_STRUCTURE);
+    }
+    return need;
+}
+
+static void report_begin(GeniusReport* out, const GeniusOptions* opts, const GenreProfile* genre,
+                         int sample_rate, int channels, size_t frames, int target_sr) {
+    out->api_version = GENIUS_API_VERSION;
+    out->sample_rate = sample_rate;
+    out->channels = channels;
+    out->frames = frames;
+    out->analysis_sample_rate = target_sr;
+    out->features = selected_features(opts);
+    out->features_only = (opts->features != 0);
+    out->fast_math = (opts->fast_math != 0);
+    out->melody_backend = (MelodyBackend)opts->melody_backend;
+    out->melody_enabled = (out->features & FEATURE_BIT(FEATURE_MELODY)) != 0;
+    out->structure_enabled = (out->features & FEATURE_BIT(FEATURE_STRUCTURE)) != 0;
+    out->genius_enabled = (out->features & FEATURE_BIT(FEATURE_GENIUS)) != 0;
+    strncpy(out->profile, genre->name, sizeof(out->profile) - 1);
+}
+
+// Plan the track against opts->budget_sec, counted from `start`, and return
+// the analysis rate the plan settled on. Needs the DSP cache bound.
+static int plan_analysis(const GeniusOptions* opts, double start, double duration_sec,
+                         GeniusReport* out) {
+    int target_sr = opts->analysis_sample_rate > 0 ? opts->analysis_sample_rate : 44100;
+    analysis_plan_init(&out->resolution, opts->budget_sec, start);
+    // decimate at most 4x, and never below the rate chroma analysis runs at
+    int max_decimation = 1;
+    while (max_decimation < 4 && target_sr / (max_decimation * 2) >= 11025) max_decimation *= 2;
+    unsigned features = selected_features(opts);
+    analysis_plan_choose(&out->resolution, duration_sec, max_decimation,
+                         (features & FEATURE_BIT(FEATURE_MELODY)) != 0,
+                         (features & FEATURE_BIT(FEATURE_STRUCTURE)) != 0);
+    return target_sr / out->resolution.decimation;
+}
+
+// ---------- Feature graph evaluation ----------
+//
+// Each node of feature_graph.h runs at most once per track, in node order, and
+// only when the selection needs it; products shared by several nodes (the
+// onset function, the beat grid) live here or in the report.
+
+typedef struct {
+    const float* mono;
+    size_t frames;
+    int sr;
+    const GeniusOptions* opts;
+    const GenreProfile* genre;
+    GeniusReport* out;
+
+    OnsetFunction onset;
+    int rc_onset;
+    double t_mono;          // analysis_plan_now() when the mono stages began
+    int refined;            // budget plan re-estimated before the optional stages
+} FeatureJob;
+
+static void eval_node(FeatureJob* job, FeatureNode node) {
+    GeniusReport* out = job->out;
+    const float* mono = job->mono;
+    size_t frames = job->frames;
+    int sr = job->sr;
+    const BeatGrid* beats = (out->rc_beats == 0 ? &out->beats : NULL);
+
+    // the stages so far calibrate the plan for the expensive optional ones
+    if ((node == FEATURE_MELODY || node == FEATURE_STRUCTURE) && !job->refined) {
+        analysis_plan_refine(&out->resolution, (double)frames / (double)sr,
+                             analysis_plan_now() - job->t_mono,
+                             (out->features & FEATURE_BIT(FEATURE_MELODY)) != 0,
+                             (out->features & FEATURE_BIT(FEATURE_STRUCTURE)) != 0);
+        job->refined = 1;
+    }
+
+    switch (node) {
+    case FEATURE_STATS:
+        out->stats = compute_basic_stats(mono, frames, sr);
+        break;
+    case FEATURE_SPECTRAL:
+        out->rc_spectral = compute_spectral_features(mono, frames, sr, &out->spectral);
+        break;
+    case FEATURE_ONSET:
+        // one onset function for both tempo estimates, rhythm and structure novelty
+        job->rc_onset = compute_onset_function(mono, frames, sr, &job->onset);
+        break;
+    case FEATURE_TEMPO:
+        out->rc_tempo = (job->rc_onset == 0 ? estimate_tempo_bpm_onset(&job->onset, &out->tempo_bpm) : -2);
+        break;
+    case FEATURE_KEY:
+        out->rc_key = estimate_key(mono, frames, sr, out->key);
+        break;
+    case FEATURE_PRODUCTION:
+        break;  // native rate: measured before the mono stages
+    case FEATURE_PSY: {
+        // loudness comes from the K-weighted meter run over the native signal
+        const LoudnessResult* loudness = (out->rc_production == 0 ? &out->production.loudness : NULL);
+        out->rc_psy = compute_psychoacoustics_loudness(mono, frames, sr, loudness, &out->psy);
+        break;
+    }
+    case FEATURE_RATINGS:
+        out->rc_ratings = compute_ratings(&out->spectral,
+                                          out->tempo_bpm,
+                                          (out->rc_key==0? out->key:"unknown"),
+                                          &out->psy,
+                                          &out->ratings,
+                                          job->genre->weights);
+        break;
+    case FEATURE_BEATS:
+        // one beat grid for rhythm metrics, per-beat chords and per-beat novelty
+        out->rc_beats = (job->rc_onset == 0 ? compute_beat_grid_onset(&job->onset, &out->beats) : -2);
+        break;
+    case FEATURE_RHYTHM:
+        out->rc_rhythm = (beats ? compute_rhythm_features_beats(beats, &out->rhythm) : -2);
+        break;
+    case FEATURE_HARMONY:
+        out->rc_harmony = compute_harmony_features_beats(mono, frames, sr, beats, &out->harmony);
+        break;
+    case FEATURE_MELODY:
+        out->rc_melody = compute_melody_features_backend(mono, frames, sr,
+                                                         (MelodyBackend)job->opts->melody_backend,
+                                                         &out->melody);
+        break;
+    case FEATURE_STRUCTURE:
+        out->rc_structure = (job->rc_onset == 0 ? compute_structure_features_onset(mono, frames, sr,
+                                                                                    &job->onset, beats,
+                                                                                    &out->structure)
+                                                : -2);
+        break;
+    case FEATURE_GENIUS: {
+        GeniusInputs g_in = {0};
+        g_in.duration_sec = out->stats.duration_sec;
+        g_in.rms = out->stats.rms;
+        g_in.peak = out->stats.peak;
+        g_in.dc_offset = out->stats.dc_offset;
+        g_in.zcr = out->stats.zcr;
+
+        g_in.spectral = out->spectral;
+        g_in.psy = out->psy;
+        g_in.rhythm = out->rhythm;
+        g_in.harmony = out->harmony;
+        g_in.melody = out->melody;
+        g_in.melody_valid = (out->rc_melody == 0);
+        g_in.structure = out->structure;
+        g_in.structure_valid = (out->structure_enabled && out->rc_structure == 0);
+        g_in.prod = out->production;
+        g_in.prod_valid = (out->rc_production == 0);
+
+        compute_genius_rating(&g_in, &out->genius, job->genre->genius_genre);
+
+        // the same rating over sections and a rolling window
+        GeniusTimeline tl;
+        if (out->rc_beats == 0 &&
+            genius_timeline_build(&tl, &out->beats,
+                                  (out->rc_rhythm == 0 ? &out->rhythm : NULL),
+                                  (out->rc_harmony == 0 ? &out->harmony : NULL),
+                                  (out->rc_production == 0 ? &out->production.loudness : NULL),
+                                  (out->rc_psy == 0 ? mono : NULL), frames, sr) == 0) {
+            genius_timeline_score(&tl, &g_in, job->genre->genius_genre,
+                                  (g_in.structure_valid ? &out->structure : NULL),
+                                  out->stats.duration_sec, &out->genius_timeline);
+            genius_timeline_free(&tl);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Everything computed from the analysis-rate mono signal. Production
+// features (native rate, interleaved) must already be in out.
+static void analyze_mono(const float* mono, size_t mono_frames, int target_sr,
+                         const GeniusOptions* opts, const GenreProfile* genre, GeniusReport* out) {
+    out->mono_frames = mono_frames;
+    out->rc_melody = 1;     // "not run" unless the melody node succeeds
+
+    FeatureJob job;
+    memset(&job, 0, sizeof(job));
+    job.mono = mono;
+    job.frames = mono_frames;
+    job.sr = target_sr;
+    job.opts = opts;
+    job.genre = genre;
+    job.out = out;
+    job.rc_onset = -1;
+
+    AnalysisPlan* prev_plan = analysis_plan_bind(&out->resolution);
+    job.t_mono = analysis_plan_now();
+    for (int n = 0; n < FEATURE_COUNT; ++n) {
+        if (!(out->features & FEATURE_BIT(n))) continue;
+        uint64_t t0 = trace_now();
+        eval_node(&job, (FeatureNode)n);
+        // production is measured (and traced) before the mono stages
+        if (n != FEATURE_PRODUCTION) trace_span("stage", feature_name((FeatureNode)n), t0, 0);
+    }
+    if (job.rc_onset == 0) free_onset_function(&job.onset);
+    analysis_plan_bind(prev_plan);
+}
+
+// ---------- Fused MP3 decode ----------
+//
+// Decoded chunks are mixed straight into a presized native-rate mono buffer
+// and fed to the production accumulators (one per decode segment), so the
+// interleaved full-rate signal is never stored. The mono buffer is then
+// resampled to the analysis rate, in place when downsampling.
+
+typedef struct {
+    float* mono;
+    size_t cap;                 // frames
+    int sample_rate;
+    int channels;
+    int segments;
+    size_t expected;
+    int production;             // feed the native-rate production meters
+
+    // length unknown up front: production windows cannot be placed while
+    // decoding, so the interleaved signal is kept for the one-shot call
+    float* interleaved;
+
+    ProductionAccumulator prod[AUDIO_MAX_SEGMENTS];
+    int prod_count;
+} FusedSink;
+
+static void fused_sink_reset(FusedSink* fs) {
+    for (int i = fs->prod_count - 1; i >= 0; --i) production_acc_free(&fs->prod[i]);
+    fs->prod_count = 0;
+    free(fs->interleaved);
+    fs->interleaved = NULL;
+}
+
+static int fused_sink_reserve(FusedSink* fs, size_t cap) {
+    float* nm = (float*)realloc(fs->mono, sizeof(float) * cap);
+    if (!nm) return -1;
+    fs->mono = nm;
+    if (fs->expected == 0 && fs->production) {
+        float* ni = (float*)realloc(fs->interleaved, sizeof(float) * cap * (size_t)fs->channels);
+        if (!ni) return -1;
+        fs->interleaved = ni;
+    }
+    fs->cap = cap;
+    return 0;
+}
+
+static int fused_sink_begin(void* user, int sample_rate, int channels, size_t expected_frames, int segments) {
+    FusedSink* fs = (FusedSink*)user;
+    fused_sink_reset(fs); // a parallel attempt may have been abandoned
+    fs->sample_rate = sample_rate;
+    fs->channels = channels;
+    fs->segments = segments;
+    fs->expected = expected_frames;
+    fs->cap = 0;
+    if (fused_sink_reserve(fs, expected_frames > 0 ? expected_frames : ((size_t)1 << 18)) != 0) return -1;
+
+    if (expected_frames > 0 && fs->production) {
+        if (production_acc_init(&fs->prod[0], sample_rate, channels, expected_frames) != 0) return -1;
+        fs->prod_count = 1;
+        for (int i = 1; i < segments; ++i) {
+            if (production_acc_fork(&fs->prod[0], &fs->prod[i]) != 0) return -1;
+            fs->prod_count++;
+        }
+    }
+    return 0;
+}
+
+static int fused_sink_frames(void* user, int segment, size_t first_frame, const float* interleaved, size_t count) {
+    FusedSink* fs = (FusedSink*)user;
+    int channels = fs->channels;
+    size_t need = first_frame + count;
+    if (need > fs->cap) {
+        // only a single sequential stream can run past the announced length
+        if (fs->segments > 1) return -1;
+        if (fused_sink_reserve(fs, fs->cap * 2 > need ? fs->cap * 2 : need) != 0) return -1;
+    }
+
+    float* dst = fs->mono + first_frame;
+    for (size_t i = 0; i < count; ++i) {
+        double acc = 0.0;
+        const float* frame = interleaved + i * channels;
+        for (int c = 0; c < channels; ++c) {
+            acc += frame[c];
+        }
+        dst[i] = (float)(acc / (double)channels);
+    }
+
+    if (fs->production && fs->expected > 0) {
+        if (production_acc_push(&fs->prod[segment], interleaved, count, first_frame) != 0) return -1;
+    } else if (fs->production) {
+        memcpy(fs->interleaved + first_frame * (size_t)channels, interleaved,
+               sizeof(float) * count * (size_t)channels);
+    }
+    return 0;
+}
+
+static int analyze_mp3_fused(GeniusContext* ctx, const char* path, const GeniusOptions* opts,
+                             const GenreProfile* genre, double start, GeniusReport* out) {
+    FusedSink fs;
+    memset(&fs, 0, sizeof(fs));
+    fs.production = (selected_features(opts) & FEATURE_BIT(FEATURE_PRODUCTION)) != 0;
+    AudioSink sink = {fused_sink_begin, fused_sink_frames};
+    size_t frames = 0;
+    uint64_t t0 = trace_now();
+    int rc = audio_decoder_stream(ctx->decoder, path, opts->input.decode_threads, &sink, &fs, &frames);
+    trace_span("decode", "decode", t0, (uint64_t)frames * (uint64_t)fs.channels * sizeof(float));
+    if (rc == 0 && frames == 0) rc = -9;
+    if (rc != 0) {
+        fused_sink_reset(&fs);
+        free(fs.mono);
+        return rc;
+    }
+
+    int target_sr = plan_analysis(opts, start, (double)frames / (double)fs.sample_rate, out);
+    report_begin(out, opts, genre, fs.sample_rate, fs.channels, frames, target_sr);
+
+    out->rc_production = 1;    // not selected
+    t0 = trace_now();
+    if (fs.production && fs.expected > 0) {
+        for (int i = 1; i < fs.prod_count; ++i) production_acc_merge(&fs.prod[0], &fs.prod[i]);
+        out->rc_production = production_acc_finish(&fs.prod[0], &out->production);
+    } else if (fs.production) {
+        out->rc_production = compute_production_features(fs.interleaved, frames, fs.sample_rate,
+                                                         fs.channels, &out->production);
+    }
+    if (fs.production) trace_span("stage", "production", t0, 0);
+    fused_sink_reset(&fs);
+
+    float* mono = NULL;
+    size_t mono_frames = 0;
+    t0 = trace_now();
+    if (resample_mono_linear(fs.mono, frames, fs.sample_rate, target_sr, &mono, &mono_frames) != 0) {
+        return -4;
+    }
+    trace_span("resample", "resample", t0, (uint64_t)frames * sizeof(float));
+
+    analyze_mono(mono, mono_frames, target_sr, opts, genre, out);
+    free(mono);
+    return 0;
+}
+
+static int analyze_pcm(GeniusContext* ctx, const AudioBuffer* pcm, const GeniusOptions* opts,
+                       double start, GeniusReport* out) {
+    const GenreProfile* genre = find_genre(opts->genre);
+    DspCache* prev_cache = dsp_cache_bind(&ctx->dsp);
+    double duration_sec = pcm->sample_rate > 0 ? (double)pcm->frames / (double)pcm->sample_rate : 0.0;
+    int target_sr = plan_analysis(opts, start, duration_sec, out);
+
+    report_begin(out, opts, genre, pcm->sample_rate, pcm->channels, pcm->frames, target_sr);
+
+    // Convert to mono and resample for consistent analysis; input that is
+    // already mono at the analysis rate (e.g. a mapped f32 file) is used as is
+    const float* mono = NULL;
+    float* mono_owned = NULL;
+    size_t mono_frames = 0;
+    if (pcm->channels == 1 && pcm->sample_rate == target_sr && pcm->pcm && pcm->frames > 0) {
+        mono = pcm->pcm;
+        mono_frames = pcm->frames;
+    } else {
+        uint64_t t0 = trace_now();
+        int rc = resample_and_mix_mono(pcm, target_sr, &mono_owned, &mono_frames);
+        if (rc != 0) {
+            dsp_cache_bind(prev_cache);
+            return -4;
+        }
+        trace_span("resample", "resample", t0,
+                   (uint64_t)pcm->frames * (uint64_t)pcm->channels * sizeof(float));
+        mono = mono_owned;
+    }
+
+    // --- Production / Timbre Features (native rate, interleaved) ---
+    out->rc_production = 1;    // not selected
+    if (out->features & FEATURE_BIT(FEATURE_PRODUCTION)) {
+        uint64_t t0 = trace_now();
+        out->rc_production = compute_production_features(pcm->pcm, pcm->frames,
+                                                         pcm->sample_rate, pcm->channels,
+                                                         &out->production);
+        trace_span("stage", "production", t0, 0);
+    }
+
+    analyze_mono(mono, mono_frames, target_sr, opts, genre, out);
+
+    free(mono_owned);
+    dsp_cache_bind(prev_cache);
+    return 0;
+}
+
+// ---------- Public API ----------
+
+int genius_analyze_file(GeniusContext* ctx, const char* path,
+                        const GeniusOptions* opts, GeniusReport* out) {
+    if (!ctx || !path || !out) return -1;
+    genius_report_clear(out);
+    double start = analysis_plan_now();   // a budget covers decoding too
+
+    GeniusOptions defaults;
+    if (!opts) {
+        genius_options_init(&defaults);
+        opts = &defaults;
+    }
+
+    int prev_fast = fast_math_bind(opts->fast_math);
+    uint64_t t0 = trace_now();
+    int rc;
+    // MP3 files are decoded straight into the analysis signal
+    if (strcmp(path, "-") != 0 &&
+        audio_input_resolve(path, opts->input.format) == AUDIO_INPUT_MP3) {
+        const GenreProfile* genre = find_genre(opts->genre);
+        DspCache* prev_cache = dsp_cache_bind(&ctx->dsp);
+        rc = analyze_mp3_fused(ctx, path, opts, genre, start, out);
+        dsp_cache_bind(prev_cache);
+    } else {
+        AudioBuffer buf = {0};
+        uint64_t t_load = trace_now();
+        rc = audio_load(ctx->decoder, path, &opts->input, &buf);
+        trace_span("decode", "load", t_load,
+                   (uint64_t)buf.frames * (uint64_t)buf.channels * sizeof(float));
+        if (rc == 0) {
+            rc = analyze_pcm(ctx, &buf, opts, start, out);
+            free_audio_buffer(&buf);
+        }
+    }
+    trace_span("track", "analyze_file", t0, 0);
+    fast_math_bind(prev_fast);
+    return rc;
+}
+
+int genius_analyze_pcm(GeniusContext* ctx, const AudioBuffer* pcm,
+                       const GeniusOptions* opts, GeniusReport* out) {
+    if (!ctx || !pcm || !out) return -1;
+    genius_report_clear(out);
+
+    GeniusOptions defaults;
+    if (!opts) {
+        genius_options_init(&defaults);
+        opts = &defaults;
+    }
+    int prev_fast = fast_math_bind(opts->fast_math);
+    uint64_t t0 = trace_now();
+    int rc = analyze_pcm(ctx, pcm, opts, analysis_plan_now(), out);
+    trace_span("track", "analyze_pcm", t0, 0);
+    fast_math_bind(prev_fast);
+    return rc;
+}
+
+GeniusReport* genius_report_create(void) {
+    return (GeniusReport*)calloc(1, sizeof(GeniusReport));
+}
+
+void genius_report_clear(GeniusReport* report) {
+    if (!report) return;
+    free_beat_grid(&report->beats);
+    free_rhythm_features(&report->rhythm);
+    free_production_features(&report->production);
+    free_harmony_features(&report->harmony);
+    free_structure_features(&report->structure);
+    genius_timeline_scores_free(&report->genius_timeline);
+    memset(report, 0, sizeof(*report));
+}
+
+void genius_report_destroy(GeniusReport* report) {
+    genius_report_clear(report);
+    free(report);
+}
+
+// ---------- Report accessors ----------
+
+int genius_report_status(const GeniusReport* r, FeatureNode node) {
+    if (!r || node < 0 || node >= FEATURE_COUNT) return -1;
+    if (!(r->features & FEATURE_BIT(node))) return 1;
+    switch (node) {
+    case FEATURE_SPECTRAL:   return r->rc_spectral;
+    case FEATURE_TEMPO:      return r->rc_tempo;
+    case FEATURE_KEY:        return r->rc_key;
+    case FEATURE_PRODUCTION: return r->rc_production;
+    case FEATURE_PSY:        return r->rc_psy;
+    case FEATURE_RATINGS:    return r->rc_ratings;
+    case FEATURE_BEATS:      return r->rc_beats;
+    case FEATURE_RHYTHM:     return r->rc_rhythm;
+    case FEATURE_HARMONY:    return r->rc_harmony;
+    case FEATURE_MELODY:     return r->rc_melody;
+    case FEATURE_STRUCTURE:  return r->rc_structure;
+    default:                 return 0;   // no failure mode of its own
+    }
+}
+
+const char* genius_report_profile(const GeniusReport* r) {
+    return r ? r->profile : "";
+}
+
+double genius_report_duration_sec(const GeniusReport* r) {
+    return r ? r->stats.duration_sec : 0.0;
+}
+
+double genius_report_tempo_bpm(const GeniusReport* r) {
+    return (r && r->rc_tempo == 0) ? r->tempo_bpm : 0.0;
+}
+
+const char* genius_report_key(const GeniusReport* r) {
+    return (r && r->rc_key == 0) ? r->key : "unknown";
+}
+
+double genius_report_integrated_lufs(const GeniusReport* r) {
+    return (r && r->rc_production == 0) ? r->production.loudness.integrated_lufs : LOUDNESS_SILENCE;
+}
+
+int genius_report_genius_score(const GeniusReport* r) {
+    return (r && r->genius_enabled) ? r->genius.overall_score : -1;
+}
+
+int genius_parse_features(const char* list, unsigned* out) {
+    return feature_parse_list(list, out);
+}
+
+int genius_parse_melody_backend(const char* name, int* out) {
+    MelodyBackend b;
+    if (!out || melody_backend_from_name(name, &b) != 0) return -1;
+    *out = (int)b;
+    return 0;
+}
+
+int genius_parse_format(const char* name, OutputFormat* out) {
+    return output_format_from_name(name, out);
+}
@@ -61,12 +61,18 @@ static int compute_structure_score(const GeniusInputs* in) {
     if (!in->structure_valid || in->structure.section_count == 0) return 50;
     int sec_bonus = gaussian_score((double)in->structure.section_count, 5.0, 2.0, 100);
     int arc       = scale_to_100(in->structure.arc_complexity, 0.0, 1.0);
-    int rep       = gaussian_score(in->structure.repetition_ratio, 0.5, 0.2, 100);
     int chorus    = 0;
     for (size_t i=0; i<in->structure.section_count; i++) {
         if (strcmp(in->structure.sections[i].label, "chorus")==0) { chorus=15; break; }
     }
-    int base = (sec_bonus + arc + rep) / 3 + chorus;
+    // repetition only counts when section timbre was analysed
+    int base;
+    if (in->structure.repetition_valid) {
+        int rep = gaussian_score(in->structure.repetition_ratio, 0.5, 0.2, 100);
+        base = (sec_bonus + arc + rep) / 3 + chorus;
+    } else {
+        base = (sec_bonus + arc) / 2 + chorus;
+    }
     return clampd(base, 0, 100);
 }
 
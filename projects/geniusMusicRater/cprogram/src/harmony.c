@@ -1,4 +1,6 @@
 #include "harmony.h"
+#include "dsp.h"
+#include "plan.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -36,14 +38,14 @@ static void hann_windowf(float* w, size_t N) {
  * out_chroma is [num_frames x 12], row-major.
  * Caller must free(*out_chroma).
  */
-static int compute_chroma_goertzel(const float* mono,
-                                   size_t frames,
-                                   int sample_rate,
-                                   size_t win_size,
-                                   size_t hop_size,
-                                   int decim,
-                                   double** out_chroma,
-                                   size_t* out_frames) {
+int compute_chroma_goertzel(const float* mono,
+                            size_t frames,
+                            int sample_rate,
+                            size_t win_size,
+                            size_t hop_size,
+                            int decim,
+                            double** out_chroma,
+                            size_t* out_frames) {
     if (!mono || frames < win_size || !out_chroma || !out_frames) return -1;
     if (decim < 1) decim = 1;
 
@@ -64,32 +66,38 @@ static int compute_chroma_goertzel(const float* mono,
 
     // Window
     float* window = (float*)malloc(sizeof(float) * win_size);
+    float* xw = (float*)malloc(sizeof(float) * win_size);
+    if (!window || !xw) { free(window); free(xw); free(chroma); free(ds); return -3; }
     hann_windowf(window, win_size);
 
-    // Pitch range: MIDI note 40 (E2, ~82Hz) to 88 (C8, ~4186Hz)
-    int min_note = 40, max_note = 88;
+    // Pitch range: MIDI note 40 (E2, ~82Hz) to 88 (C8, ~4186Hz). Goertzel
+    // coefficients depend only on the note, so they are computed once.
+    enum { MIN_NOTE = 40, MAX_NOTE = 88 };
+    double coeffs[MAX_NOTE - MIN_NOTE + 1];
+    int pcs[MAX_NOTE - MIN_NOTE + 1];
+    int n_notes = 0;
+    for (int midi = MIN_NOTE; midi <= MAX_NOTE; midi++) {
+        double freq = 440.0 * pow(2.0, (midi - 69) / 12.0);
+        if (freq >= ds_rate/2.0) break; // beyond Nyquist
+        double k = 0.5 + ((double)win_size * freq / (double)ds_rate);
+        int K = (int)k;
+        double w = 2.0 * M_PI * (double)K / (double)win_size;
+        coeffs[n_notes] = 2.0 * cos(w);
+        pcs[n_notes] = midi % 12;
+        n_notes++;
+    }
 
     for (size_t fi=0; fi<num_frames; fi++) {
         const float* frame = ds + fi*hop_size;
 
         // apply window
-        float* xw = (float*)malloc(sizeof(float)*win_size);
         for (size_t n=0; n<win_size; n++) {
             xw[n] = frame[n] * window[n];
         }
 
-        // Analyze selected pitches
-        for (int midi = min_note; midi <= max_note; midi++) {
-            double freq = 440.0 * pow(2.0, (midi - 69) / 12.0);
-            if (freq >= ds_rate/2.0) break; // beyond Nyquist
-
-            // Goertzel
-            double k = 0.5 + ((double)win_size * freq / (double)ds_rate);
-            int K = (int)k;
-            double w = 2.0 * M_PI * (double)K / (double)win_size;
-            double c = cos(w);
-            double coeff = 2.0 * c;
-
+        // Analyze selected pitches (Goertzel)
+        for (int note = 0; note < n_notes; note++) {
+            double coeff = coeffs[note];
             double s_prev = 0.0, s_prev2 = 0.0;
             for (size_t n=0; n<win_size; n++) {
                 double s = xw[n] + coeff * s_prev - s_prev2;
@@ -97,11 +105,8 @@ static int compute_chroma_goertzel(const float* mono,
                 s_prev = s;
             }
             double power = s_prev2*s_prev2 + s_prev*s_prev - coeff*s_prev*s_prev2;
-
-            int pc = midi % 12;
-            chroma[fi*12 + pc] += power;
+            chroma[fi*12 + pcs[note]] += power;
         }
-        free(xw);
 
         // normalize
         double norm = 0.0;
@@ -112,6 +117,7 @@ static int compute_chroma_goertzel(const float* mono,
         }
     }
 
+    free(xw);
     free(window);
     free(ds);
     *out_chroma = chroma;
@@ -123,40 +129,116 @@ static const char* PC_NAMES[12] = {
     "C","C#","D","D#","E","F","F#","G","G#","A","A#","B"
 };
 
-// Major and minor triad templates (idealized, 12 bins)
-static void fill_chord_templates(double templates[24][12], char names[24][16], int* count) {
-    *count = 0;
+// ---------- Chord templates + Viterbi ----------
+
+#define CHORD_STATES     CHORD_TRACKER_STATES
+#define CHORD_SELF_PROB  0.9    // chance a chord lasts into the next chroma frame (~93 ms)
+#define CHORD_SHARPNESS  10.0   // log-emission per unit of cosine similarity
+
+// Major and minor triads as a unit-norm [12 x 24] matrix (column t = chord t),
+// so a dot product with a normalized chroma frame is the cosine similarity.
+static void fill_chord_templates(double templates[12*CHORD_STATES], char names[CHORD_STATES][16]) {
+    const double v = 1.0 / sqrt(3.0);
+    memset(templates, 0, sizeof(double) * 12 * CHORD_STATES);
     for (int root=0; root<12; root++) {
+        int maj = 2*root, min = 2*root + 1;
         // Major: root, +4, +7
-        memset(templates[*count], 0, 12*sizeof(double));
-        templates[*count][root] = 1.0;
-        templates[*count][(root+4)%12] = 1.0;
-        templates[*count][(root+7)%12] = 1.0;
-        snprintf(names[*count], 16, "%s", PC_NAMES[root]);
-        (*count)++;
+        templates[root*CHORD_STATES + maj] = v;
+        templates[((root+4)%12)*CHORD_STATES + maj] = v;
+        templates[((root+7)%12)*CHORD_STATES + maj] = v;
+        snprintf(names[maj], 16, "%s", PC_NAMES[root]);
 
         // Minor: root, +3, +7
-        memset(templates[*count], 0, 12*sizeof(double));
-        templates[*count][root] = 1.0;
-        templates[*count][(root+3)%12] = 1.0;
-        templates[*count][(root+7)%12] = 1.0;
-        snprintf(names[*count], 16, "%sm", PC_NAMES[root]);
-        (*count)++;
+        templates[root*CHORD_STATES + min] = v;
+        templates[((root+3)%12)*CHORD_STATES + min] = v;
+        templates[((root+7)%12)*CHORD_STATES + min] = v;
+        snprintf(names[min], 16, "%sm", PC_NAMES[root]);
     }
 }
 
-// Cosine similarity between two 12-dim vectors
-static double cosine_similarity(const double* a, const double* b) {
-    double dot=0, na=0, nb=0;
-    for (int i=0; i<12; i++) {
-        dot += a[i]*b[i];
-        na  += a[i]*a[i];
-        nb  += b[i]*b[i];
+/**
+ * Most likely chord per chroma frame. Emissions are log-linear in the
+ * template similarity; transitions keep the chord with CHORD_SELF_PROB and
+ * switch to any other chord uniformly, which makes each step O(states).
+ * sim is [frames x 24] scratch; path receives one state per frame.
+ */
+static int viterbi_chords(const double* chroma, size_t frames, const double* templates,
+                          double* sim, int* path) {
+    if (frames == 0) return -1;
+    dsp_matmul(chroma, frames, 12, templates, CHORD_STATES, sim);
+
+    unsigned char* back = (unsigned char*)malloc(frames * CHORD_STATES);
+    if (!back) return -1;
+    const double log_stay = log(CHORD_SELF_PROB);
+    const double log_switch = log((1.0 - CHORD_SELF_PROB) / (CHORD_STATES - 1));
+
+    double delta[CHORD_STATES], next[CHORD_STATES];
+    for (int s = 0; s < CHORD_STATES; s++) delta[s] = CHORD_SHARPNESS * sim[s];
+
+    for (size_t f = 1; f < frames; f++) {
+        int best = 0;
+        for (int s = 1; s < CHORD_STATES; s++) if (delta[s] > delta[best]) best = s;
+        const double* e = sim + f * CHORD_STATES;
+        for (int s = 0; s < CHORD_STATES; s++) {
+            double stay = delta[s] + log_stay;
+            double move = delta[best] + log_switch;
+            int from = s;
+            if (best != s && move > stay) { stay = move; from = best; }
+            next[s] = stay + CHORD_SHARPNESS * e[s];
+            back[f * CHORD_STATES + s] = (unsigned char)from;
+        }
+        memcpy(delta, next, sizeof(delta));
+    }
+
+    int s = 0;
+    for (int t = 1; t < CHORD_STATES; t++) if (delta[t] > delta[s]) s = t;
+    for (size_t f = frames; f-- > 0; ) {
+        path[f] = s;
+        if (f > 0) s = back[f * CHORD_STATES + s];
     }
-    if (na==0||nb==0) return 0.0;
-    return dot / (sqrt(na)*sqrt(nb));
+    free(back);
+    return 0;
 }
 
+// Live chord: the forward half of viterbi_chords. The best state of delta
+// after each frame is the filtered estimate; there is no backtrace, so a
+// change is reported once its evidence outweighs the switch penalty.
+void chord_tracker_init(ChordTracker* t) {
+    memset(t, 0, sizeof(*t));
+    fill_chord_templates(t->templates, t->names);
+}
+
+const char* chord_tracker_push(ChordTracker* t, const double chroma[12]) {
+    double norm = 0.0;
+    for (int i = 0; i < 12; i++) norm += chroma[i] * chroma[i];
+    norm = (norm > 1e-18 ? 1.0 / sqrt(norm) : 0.0);
+    double x[12];
+    for (int i = 0; i < 12; i++) x[i] = chroma[i] * norm;
+    double e[CHORD_STATES];
+    dsp_matmul(x, 1, 12, t->templates, CHORD_STATES, e);
+
+    if (t->frames == 0) {
+        for (int s = 0; s < CHORD_STATES; s++) t->delta[s] = CHORD_SHARPNESS * e[s];
+    } else {
+        const double log_stay = log(CHORD_SELF_PROB);
+        const double log_switch = log((1.0 - CHORD_SELF_PROB) / (CHORD_STATES - 1));
+        int best = 0;
+        for (int s = 1; s < CHORD_STATES; s++) if (t->delta[s] > t->delta[best]) best = s;
+        double move = t->delta[best] + log_switch;
+        for (int s = 0; s < CHORD_STATES; s++) {
+            double stay = t->delta[s] + log_stay;
+            t->delta[s] = (move > stay ? move : stay) + CHORD_SHARPNESS * e[s];
+        }
+    }
+    t->frames++;
+
+    // keep the scores near zero on long streams
+    int best = 0;
+    for (int s = 1; s < CHORD_STATES; s++) if (t->delta[s] > t->delta[best]) best = s;
+    double top = t->delta[best];
+    for (int s = 0; s < CHORD_STATES; s++) t->delta[s] -= top;
+    return t->names[best];
+}
 
 // Krumhansl-Schmuckler key profiles (major/minor).
 // Normalized values for 12 pitch classes.
@@ -171,40 +253,149 @@ static const double KEY_PROFILE_MINOR[12] = {
     3.34, 3.17
 };
 
-// Rotate profile to match tonic offset
-static void rotate_profile(const double* base, int offset, double* out) {
-    for (int i=0; i<12; i++) {
-        out[(i+offset)%12] = base[i];
-    }
-}
+// ---------- Key profiles + local key track ----------
 
-static void detect_key_from_chroma(const double* chroma, char* out_key, size_t out_sz, double* best_score) {
-    double best_sim = -1.0;
-    char best_name[16] = "C";
+#define KEY_COUNT         24
+#define KEY_WINDOW_SEC    10.0  // chroma window per key estimate
+#define KEY_HOP_SEC       1.0   // key track resolution
+#define KEY_MIN_HOLD      4     // steps a new key must win before the track switches
 
-    double profile[12];
-    static const char* maj_min[2] = {"", "m"};
+// Same order as the search always used: majors by tonic, then minors.
+static const char* KEY_NAMES[KEY_COUNT] = {
+    "C","C#","D","D#","E","F","F#","G","G#","A","A#","B",
+    "Cm","C#m","Dm","D#m","Em","Fm","F#m","Gm","G#m","Am","A#m","Bm"
+};
+
+// Profiles rotated to every tonic and scaled to unit length, built once per
+// analysis so matching a chroma vector is 24 dot products.
+typedef struct {
+    double p[KEY_COUNT][12];
+} KeyProfiles;
 
+static void build_key_profiles(KeyProfiles* kp) {
     for (int mode=0; mode<2; mode++) { // 0=maj, 1=min
         const double* base = (mode==0? KEY_PROFILE_MAJOR : KEY_PROFILE_MINOR);
+        double nb = 0.0;
+        for (int i=0; i<12; i++) nb += base[i]*base[i];
+        nb = sqrt(nb);
         for (int tonic=0; tonic<12; tonic++) {
-            rotate_profile(base, tonic, profile);
-            // cosine similarity
-            double dot=0, na=0, nb=0;
-            for (int i=0; i<12; i++) {
-                dot += chroma[i]*profile[i];
-                na  += chroma[i]*chroma[i];
-                nb  += profile[i]*profile[i];
-            }
-            double sim = (na>0 && nb>0)? dot/(sqrt(na)*sqrt(nb)) : 0;
-            if (sim > best_sim) {
-                best_sim = sim;
-                snprintf(best_name, sizeof(best_name), "%s%s", PC_NAMES[tonic], maj_min[mode]);
+            for (int i=0; i<12; i++) kp->p[mode*12 + tonic][(i+tonic)%12] = base[i] / nb;
+        }
+    }
+}
+
+// Best key for a (not necessarily normalized) chroma vector; *score is its
+// cosine similarity.
+static int best_key(const KeyProfiles* kp, const double* chroma, double* score) {
+    double na = 0.0;
+    for (int i=0; i<12; i++) na += chroma[i]*chroma[i];
+    double inv = (na > 0 ? 1.0 / sqrt(na) : 0.0);
+
+    int best = 0;
+    double best_sim = -1.0;
+    for (int k=0; k<KEY_COUNT; k++) {
+        double dot = 0.0;
+        for (int i=0; i<12; i++) dot += chroma[i]*kp->p[k][i];
+        double sim = dot * inv;
+        if (sim > best_sim) { best_sim = sim; best = k; }
+    }
+    *score = best_sim;
+    return best;
+}
+
+// Close the last segment of the track and open one for `key` at start_sec.
+static void key_track_switch(HarmonyFeatures* out, int key, double start_sec,
+                             double score_sum, int scored) {
+    if (out->key_segment_count > 0) {
+        KeySegment* prev = &out->key_segments[out->key_segment_count - 1];
+        prev->end_sec = start_sec;
+        prev->strength = (scored > 0 ? score_sum / scored : 0.0);
+    }
+    KeySegment* seg = &out->key_segments[out->key_segment_count++];
+    snprintf(seg->key, sizeof(seg->key), "%s", KEY_NAMES[key]);
+    seg->start_sec = start_sec;
+}
+
+/**
+ * Local key timeline: a KEY_WINDOW_SEC window slides over the chroma in
+ * KEY_HOP_SEC steps, each window sum taken from a prefix table in O(12).
+ * A different key has to win KEY_MIN_HOLD steps in a row before a new
+ * segment starts (at the first of those steps).
+ */
+static int track_local_keys(const double* chroma, size_t frames, double hop_time,
+                            const KeyProfiles* kp, HarmonyFeatures* out) {
+    double* prefix = (double*)calloc((frames + 1) * 12, sizeof(double));
+    if (!prefix) return -1;
+    for (size_t f=0; f<frames; f++) {
+        for (int p=0; p<12; p++) prefix[(f+1)*12+p] = prefix[f*12+p] + chroma[f*12+p];
+    }
+
+    double duration = frames * hop_time;
+    size_t steps = (size_t)ceil(duration / KEY_HOP_SEC);
+    if (steps == 0) steps = 1;
+    out->key_segments = (KeySegment*)calloc(steps, sizeof(KeySegment));
+    if (!out->key_segments) { free(prefix); return -1; }
+    out->key_segment_count = 0;
+
+    size_t half = (size_t)(0.5 * KEY_WINDOW_SEC / hop_time);
+    int current = -1, candidate = -1, hold = 0;
+    size_t candidate_step = 0;
+    double score_sum = 0.0, candidate_sum = 0.0;
+    int scored = 0;
+
+    for (size_t k=0; k<steps; k++) {
+        size_t center = (size_t)(k * KEY_HOP_SEC / hop_time);
+        size_t lo = (center > half ? center - half : 0);
+        size_t hi = (center + half < frames ? center + half : frames);
+        if (hi <= lo) hi = (lo + 1 < frames ? lo + 1 : frames);
+
+        double window[12];
+        for (int p=0; p<12; p++) window[p] = prefix[hi*12+p] - prefix[lo*12+p];
+        double score;
+        int key = best_key(kp, window, &score);
+
+        if (current < 0) {
+            current = key;
+            key_track_switch(out, key, 0.0, 0.0, 0);
+        }
+        if (key == current) {
+            // a pending candidate lost; its steps stay with the current key
+            score_sum += candidate_sum + score;
+            scored += hold + 1;
+            candidate = -1; hold = 0; candidate_sum = 0.0;
+            continue;
+        }
+        if (key != candidate) {
+            score_sum += candidate_sum;
+            scored += hold;
+            candidate = key; hold = 0; candidate_sum = 0.0;
+            candidate_step = k;
+        }
+        hold++;
+        candidate_sum += score;
+
+        if (hold >= KEY_MIN_HOLD) {
+            if (out->key_segment_count == 1 && candidate_step < KEY_MIN_HOLD) {
+                // the opening windows are half empty: relabel instead of splitting
+                snprintf(out->key_segments[0].key, sizeof(out->key_segments[0].key), "%s", KEY_NAMES[candidate]);
+                score_sum += candidate_sum; scored += hold;
+            } else {
+                key_track_switch(out, candidate, candidate_step * KEY_HOP_SEC, score_sum, scored);
+                score_sum = candidate_sum; scored = hold;
             }
+            current = candidate;
+            candidate = -1; hold = 0; candidate_sum = 0.0;
         }
     }
-    *best_score = best_sim;
-    snprintf(out_key, out_sz, "%s", best_name);
+    score_sum += candidate_sum;
+    scored += hold;
+
+    KeySegment* last = &out->key_segments[out->key_segment_count - 1];
+    last->end_sec = duration;
+    last->strength = (scored > 0 ? score_sum / scored : 0.0);
+
+    free(prefix);
+    return 0;
 }
 
 // Map chord (triads) into pitch class set
@@ -239,29 +430,32 @@ static void chord_to_pcset(const char* name, int* pcs, int* count) {
     pcs[(*count)++] = (root+7)%12;     // perfect fifth
 }
 
+double harmony_chord_distance(const char* a, const char* b) {
+    int pcs1[3], pcs2[3];
+    int n1=0,n2=0;
+    chord_to_pcset(a, pcs1,&n1);
+    chord_to_pcset(b, pcs2,&n2);
+    if (n1==0||n2==0) return -1.0;
+
+    // Jaccard distance
+    int common=0;
+    for (int i=0;i<n1;i++){
+        for (int j=0;j<n2;j++){
+            if (pcs1[i]==pcs2[j]) common++;
+        }
+    }
+    int total_notes = n1+n2-common;
+    return (total_notes>0)? 1.0 - ((double)common/(double)total_notes):0.0;
+}
+
 static double compute_harmonic_motion(const ChordLabel* chords, int n) {
     if (!chords || n<2) return 0.0;
     double total=0.0;
     int steps=0;
 
     for (int i=1; i<n; i++) {
-        int pcs1[3], pcs2[3];
-        int n1=0,n2=0;
-        chord_to_pcset(chords[i-1].name, pcs1,&n1);
-        chord_to_pcset(chords[i].name,   pcs2,&n2);
-
-        if (n1==0||n2==0) continue;
-
-        // Jaccard distance
-        int common=0;
-        for (int a=0;a<n1;a++){
-            for (int b=0;b<n2;b++){
-                if (pcs1[a]==pcs2[b]) common++;
-            }
-        }
-        int total_notes = n1+n2-common;
-        double dist = (total_notes>0)? 1.0 - ((double)common/(double)total_notes):0.0;
-
+        double dist = harmony_chord_distance(chords[i-1].name, chords[i].name);
+        if (dist < 0.0) continue;
         total += dist;
         steps++;
     }
@@ -306,6 +500,36 @@ static int pc_in_scale(int pc, const int* scale, int size) {
     return 0;
 }
 
+// Tension of one chord against a diatonic scale: share of its notes outside
+// the scale, plus 0.2 for minor chords. -1 when the chord has no notes.
+static double chord_tension(const char* chord, const int* scale, int scale_size) {
+    int pcs[3], pc_count=0;
+    chord_to_pcset(chord, pcs, &pc_count);
+    if (pc_count==0) return -1.0;
+
+    int out_notes=0;
+    for (int j=0;j<pc_count;j++) {
+        if (!pc_in_scale(pcs[j], scale, scale_size)) out_notes++;
+    }
+
+    double instability = (double)out_notes / (double)pc_count; // fraction outside scale
+
+    // add minor chord penalty
+    double is_minor = (chord[strlen(chord)-1]=='m');
+    double local_tension = instability + (is_minor?0.2:0.0);
+
+    if (local_tension>1.0) local_tension=1.0;
+    return local_tension;
+}
+
+double harmony_chord_tension(const char* chord, const char* key) {
+    if (!chord || !key) return -1.0;
+    int scale[7]; int scale_size=0;
+    build_diatonic_scale(key, scale, &scale_size);
+    if (scale_size==0) return -1.0;
+    return chord_tension(chord, scale, scale_size);
+}
+
 static double compute_harmonic_tension(const ChordLabel* chords, int n, const char* global_key) {
     if (!chords || n==0 || !global_key) return 0.0;
 
@@ -317,22 +541,8 @@ static double compute_harmonic_tension(const ChordLabel* chords, int n, const ch
     int count=0;
 
     for (int i=0;i<n;i++) {
-        int pcs[3], pc_count=0;
-        chord_to_pcset(chords[i].name, pcs, &pc_count);
-        if (pc_count==0) continue;
-
-        int out_notes=0;
-        for (int j=0;j<pc_count;j++) {
-            if (!pc_in_scale(pcs[j], scale, scale_size)) out_notes++;
-        }
-
-        double instability = (double)out_notes / (double)pc_count; // fraction outside scale
-
-        // add minor chord penalty
-        double is_minor = (chords[i].name[strlen(chords[i].name)-1]=='m');
-        double local_tension = instability + (is_minor?0.2:0.0);
-
-        if (local_tension>1.0) local_tension=1.0;
+        double local_tension = chord_tension(chords[i].name, scale, scale_size);
+        if (local_tension < 0.0) continue;
         total += local_tension;
         count++;
     }
@@ -340,17 +550,36 @@ static double compute_harmonic_tension(const ChordLabel* chords, int n, const ch
     return (count>0? total/count:0.0);
 }
 
+static void add_chord(HarmonyFeatures* out, const char* name, double time_sec) {
+    ChordLabel* c = &out->chords[out->chord_count];
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    c->time_sec = time_sec;
+    out->chord_count++;
+}
+
 int compute_harmony_features(const float* mono,
                              size_t frames,
                              int sample_rate,
                              HarmonyFeatures* out) {
+    return compute_harmony_features_beats(mono, frames, sample_rate, NULL, out);
+}
+
+int compute_harmony_features_beats(const float* mono,
+                                   size_t frames,
+                                   int sample_rate,
+                                   const BeatGrid* beats,
+                                   HarmonyFeatures* out) {
     if (!out) return -1;
     memset(out, 0, sizeof(*out));
 
     // --- Step 2.1: Compute chroma features ---
+    // A budget plan may space frames further apart; decimation keeps the
+    // Goertzel rate near 11 kHz whatever the analysis rate.
+    StagePlan* plan = analysis_plan_stage(PLAN_CHROMA);
     size_t win_size   = 2048;  // at ds_rate, ~186ms window
-    size_t hop_size   = 1024;  // 50% overlap
-    int decim         = 4;     // downsample factor
+    size_t hop_size   = 1024 * (size_t)(plan ? plan->hop_scale : 1);  // 50% overlap at full resolution
+    int decim         = sample_rate / 11025;  // downsample factor, 4 at 44.1/48 kHz
+    if (decim < 1) decim = 1;
 
     double* chroma = NULL;
     size_t chroma_frames = 0;
@@ -369,6 +598,12 @@ int compute_harmony_features(const float* mono,
         return rc;
     }
 
+    if (plan) {
+        plan->ran = 1;
+        plan->hop_sec = (double)hop_size * (double)decim / (double)sample_rate;
+        plan->coverage = 1.0 / (double)plan->hop_scale;
+    }
+
     // Aggregate chroma across entire song for rough key guess
     double avg_chroma[12] = {0};
     for (size_t f=0; f<chroma_frames; f++) {
@@ -395,71 +630,70 @@ int compute_harmony_features(const float* mono,
     
 
         // --- Step 2.2: Chord recognition ---
-    double templates[24][12];
-    char chord_names[24][16];
-    int num_templates=0;
-    fill_chord_templates(templates, chord_names, &num_templates);
+    // Every chroma frame is scored against all templates in one product,
+    // then Viterbi picks the most likely chord sequence.
+    double templates[12*CHORD_STATES];
+    char chord_names[CHORD_STATES][16];
+    fill_chord_templates(templates, chord_names);
+
+    double* sim = (double*)malloc(sizeof(double) * chroma_frames * CHORD_STATES);
+    int* path = (int*)malloc(sizeof(int) * chroma_frames);
+    if (!sim || !path || viterbi_chords(chroma, chroma_frames, templates, sim, path) != 0) {
+        free(sim); free(path); free(chroma);
+        return -4;
+    }
+    free(sim);
 
-    // Allocate chord labels, one every N frames (e.g. ~beat-synchronous)
-    // For now we’ll rate chords every 1 sec (choose downsampled interval)
+    // Chord labels: one per tracked beat (most frequent smoothed chord in the
+    // beat), or one per second when no beat grid is available
     double hop_time = (double)hop_size * (double)decim / (double)sample_rate;
-    int step = (int)(1.0 / hop_time); // number of frames ~1 sec hop
-    if (step < 1) step=1;
-    int chord_capacity = (int)(chroma_frames/step + 1);
-    out->chords = (ChordLabel*)calloc(chord_capacity, sizeof(ChordLabel));
-    out->chord_count = 0;
-    
-    for (size_t f=0; f<chroma_frames; f += step) {
-        const double* vec = &chroma[f*12];
-        // find best template
-        double best_sim = -1.0;
-        int best_idx = -1;
-        for (int t=0; t<num_templates; t++) {
-            double sim = cosine_similarity(vec, templates[t]);
-            if (sim > best_sim) { best_sim = sim; best_idx = t; }
+    if (beats && beats->beat_count >= 2) {
+        out->chords = (ChordLabel*)calloc(beats->beat_count, sizeof(ChordLabel));
+        out->chord_count = 0;
+        for (size_t b = 0; out->chords && b < beats->beat_count; b++) {
+            double t0 = beats->beat_times[b];
+            double t1 = (b + 1 < beats->beat_count ? beats->beat_times[b+1]
+                                                   : t0 + (t0 - beats->beat_times[b-1]));
+            size_t f0 = (size_t)ceil(t0 / hop_time);
+            size_t f1 = (size_t)ceil(t1 / hop_time);
+            if (f1 <= f0) f1 = f0 + 1; // beat shorter than a chroma hop
+            if (f0 >= chroma_frames) break;
+            if (f1 > chroma_frames) f1 = chroma_frames;
+
+            int votes[CHORD_STATES] = {0};
+            int best = path[f0];
+            for (size_t f=f0; f<f1; f++) {
+                if (++votes[path[f]] > votes[best]) best = path[f];
+            }
+            add_chord(out, chord_names[best], t0);
         }
-        if (best_idx>=0) {
-            strncpy(out->chords[out->chord_count].name,
-                    chord_names[best_idx],
-                    sizeof(out->chords[out->chord_count].name));
-            out->chords[out->chord_count].time_sec = f * hop_time;
-            out->chord_count++;
+    } else {
+        int step = (int)(1.0 / hop_time); // number of frames ~1 sec hop
+        if (step < 1) step=1;
+        int chord_capacity = (int)(chroma_frames/step + 1);
+        out->chords = (ChordLabel*)calloc(chord_capacity, sizeof(ChordLabel));
+        out->chord_count = 0;
+        for (size_t f=0; out->chords && f<chroma_frames; f += step) {
+            add_chord(out, chord_names[path[f]], f * hop_time);
         }
     }
+    free(path);
 
         // --- Step 2.3: Key stability and modulation ---
     // Compute average chroma to get global key
 
+    KeyProfiles key_profiles;
+    build_key_profiles(&key_profiles);
+
     double best_score=0.0;
-    detect_key_from_chroma(avg_chroma, out->global_key, sizeof(out->global_key), &best_score);
+    int global = best_key(&key_profiles, avg_chroma, &best_score);
+    snprintf(out->global_key, sizeof(out->global_key), "%s", KEY_NAMES[global]);
     out->key_stability = best_score; // 0..1
 
-    // Now detect local keys in blocks (~10s each) and count modulations
-    int window = (int)(10.0 / hop_time); // 10s worth of frames
-    if (window < 1) window = 1;
-    char last_key[16]="";
-    int mods=0;
-
-    for (size_t f=0; f<chroma_frames; f+=window) {
-        double block_chroma[12]={0};
-        int block_frames=0;
-        for (size_t i=f; i<f+window && i<chroma_frames; i++) {
-            for (int p=0; p<12; p++) block_chroma[p]+=chroma[i*12+p];
-            block_frames++;
-        }
-        if (block_frames>0) {
-            double dummy;
-            char block_key[16];
-            detect_key_from_chroma(block_chroma, block_key, sizeof(block_key), &dummy);
-            if (last_key[0]==0) {
-                strncpy(last_key, block_key, sizeof(last_key));
-            } else if (strcmp(block_key,last_key)!=0) {
-                mods++;
-                strncpy(last_key, block_key, sizeof(last_key));
-            }
-        }
+    // Local keys on a sliding window; modulations are changes in that track
+    if (track_local_keys(chroma, chroma_frames, hop_time, &key_profiles, out) == 0) {
+        out->modulation_count = (double)(out->key_segment_count - 1);
     }
-    out->modulation_count = (double)mods;
 
     // --- Step 2.4: Harmonic motion ---
     out->harmonic_motion = compute_harmonic_motion(out->chords, out->chord_count);
@@ -476,4 +710,7 @@ void free_harmony_features(HarmonyFeatures* hf) {
     if (hf->chords) free(hf->chords);
     hf->chords = NULL;
     hf->chord_count = 0;
+    free(hf->key_segments);
+    hf->key_segments = NULL;
+    hf->key_segment_count = 0;
 }
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "live.h"
+#include "dsp.h"
+#include "spectral_kernel.h"
+#include "onset.h"
+#include "loudness.h"
+#include "harmony.h"
+#include "feature_extractor.h"
+#include "plan.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define LIVE_FFT_SIZE 4096      // same frames as the key chroma
+#define LIVE_HOP_SIZE 2048
+
+struct GeniusLive {
+    int sample_rate;
+    int channels;
+    DspCache dsp;               // bound while processing
+
+    float* mono;                // mono mix of the current push
+    size_t mono_cap;
+
+    LoudnessLive loudness;
+    OnsetStream onset;
+    size_t tempo_frames;        // onset frames used for the tempo
+
+    // chroma / centroid frames
+    SpectralKernel kernel;
+    int* bin_pc;
+    float* input;               // pending samples, up to LIVE_FFT_SIZE
+    size_t input_len;
+    double* chroma;             // ring: key_frames x 12 raw pitch-class energies
+    size_t key_frames;
+    size_t chroma_frames;       // chroma frames produced so far
+    ChordTracker chords;
+    const char* chord;
+    double centroid_sum;        // over the frames of the current update
+    size_t centroid_count;
+    double centroid;
+
+    size_t frames;              // stream frames pushed
+    double busy_sec;            // total processing time
+};
+
+GeniusLive* genius_live_create(int sample_rate, int channels) {
+    if (sample_rate <= 0 || channels <= 0) return NULL;
+    GeniusLive* live = (GeniusLive*)calloc(1, sizeof(GeniusLive));
+    if (!live) return NULL;
+    live->sample_rate = sample_rate;
+    live->channels = channels;
+    dsp_cache_init(&live->dsp);
+
+    double frame_rate = (double)sample_rate / LIVE_HOP_SIZE;
+    live->tempo_frames = (size_t)ceil(LIVE_TEMPO_SEC * sample_rate / ONSET_HOP_SIZE);
+    live->key_frames = (size_t)ceil(LIVE_KEY_SEC * frame_rate);
+    live->bin_pc = (int*)malloc(sizeof(int) * (LIVE_FFT_SIZE / 2 + 1));
+    live->input = (float*)malloc(sizeof(float) * LIVE_FFT_SIZE);
+    live->chroma = (double*)calloc(live->key_frames * 12, sizeof(double));
+    int ok = (live->bin_pc && live->input && live->chroma &&
+              loudness_live_init(&live->loudness, sample_rate, channels) == 0 &&
+              onset_stream_init(&live->onset, sample_rate, live->tempo_frames) == 0 &&
+              spectral_kernel_init(&live->kernel, LIVE_FFT_SIZE, sample_rate, NULL, 0) == 0);
+    if (!ok) {
+        genius_live_destroy(live);
+        return NULL;
+    }
+    chroma_bin_pitch_classes(sample_rate, LIVE_FFT_SIZE, live->bin_pc);
+    chord_tracker_init(&live->chords);
+    live->chord = "";
+    return live;
+}
+
+void genius_live_destroy(GeniusLive* live) {
+    if (!live) return;
+    loudness_live_free(&live->loudness);
+    onset_stream_free(&live->onset);
+    dsp_cache_clear(&live->dsp);
+    free(live->mono);
+    free(live->bin_pc);
+    free(live->input);
+    free(live->chroma);
+    free(live);
+}
+
+// One LIVE_FFT_SIZE frame: centroid, a chroma frame for the key ring and a
+// chord tracker step.
+static int live_frame(GeniusLive* live) {
+    const FftPlan* plan = dsp_fft_plan(LIVE_FFT_SIZE);
+    const double* window = dsp_window(DSP_HANN_PERIODIC, LIVE_FFT_SIZE);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * LIVE_FFT_SIZE);
+    double* power = (double*)dsp_scratch(DSP_SCRATCH_MAG, sizeof(double) * live->kernel.n_bins);
+    if (!plan || !window || !X || !power) return -1;
+
+    for (int i = 0; i < LIVE_FFT_SIZE; i++) {
+        X[i].r = (double)live->input[i] * window[i];
+        X[i].i = 0.0;
+    }
+    dsp_fft(plan, X);
+    SpectralFrame sf;
+    spectral_kernel_run(&live->kernel, X, power, NULL, NULL, NULL, &sf);
+    live->centroid_sum += sf.centroid;
+    live->centroid_count++;
+
+    double* c = live->chroma + (live->chroma_frames % live->key_frames) * 12;
+    memset(c, 0, sizeof(double) * 12);
+    for (int k = 1; k < live->kernel.n_bins; k++) {
+        if (live->bin_pc[k] >= 0) c[live->bin_pc[k]] += power[k];
+    }
+    live->chroma_frames++;
+    live->chord = chord_tracker_push(&live->chords, c);
+    return 0;
+}
+
+static int live_push_mono(GeniusLive* live, const float* mono, size_t n) {
+    if (onset_stream_push(&live->onset, mono, n) != 0) return -1;
+    while (n > 0) {
+        size_t take = LIVE_FFT_SIZE - live->input_len;
+        if (take > n) take = n;
+        memcpy(live->input + live->input_len, mono, sizeof(float) * take);
+        live->input_len += take;
+        mono += take;
+        n -= take;
+        if (live->input_len < LIVE_FFT_SIZE) break;
+
+        if (live_frame(live) != 0) return -1;
+        memmove(live->input, live->input + LIVE_HOP_SIZE, sizeof(float) * (LIVE_FFT_SIZE - LIVE_HOP_SIZE));
+        live->input_len = LIVE_FFT_SIZE - LIVE_HOP_SIZE;
+    }
+    return 0;
+}
+
+static void live_snapshot(GeniusLive* live, GeniusLiveUpdate* out) {
+    out->t_sec = (double)live->frames / live->sample_rate;
+    loudness_live_read(&live->loudness, &out->momentary_lufs, &out->short_term_lufs,
+                       &out->integrated_lufs);
+    out->loudness_range_lu = loudness_live_range(&live->loudness);
+
+    OnsetFunction of;
+    out->tempo_bpm = 0.0;
+    if (onset_stream_function(&live->onset, live->tempo_frames, &of) == 0) {
+        if (estimate_tempo_bpm_onset(&of, &out->tempo_bpm) != 0) out->tempo_bpm = 0.0;
+        free_onset_function(&of);
+    }
+
+    double acc[12] = {0};
+    size_t held = (live->chroma_frames < live->key_frames ? live->chroma_frames : live->key_frames);
+    for (size_t f = 0; f < held; f++) {
+        for (int i = 0; i < 12; i++) acc[i] += live->chroma[f * 12 + i];
+    }
+    double sum = 0.0;
+    for (int i = 0; i < 12; i++) sum += acc[i];
+    if (sum > 1e-9) {
+        for (int i = 0; i < 12; i++) acc[i] /= sum;
+        estimate_key_chroma(acc, out->key);
+    } else {
+        out->key[0] = '\0';
+    }
+
+    // keep the last value through updates shorter than one hop
+    if (live->centroid_count > 0) live->centroid = live->centroid_sum / live->centroid_count;
+    live->centroid_sum = 0.0;
+    live->centroid_count = 0;
+    out->centroid = live->centroid;
+    snprintf(out->chord, sizeof(out->chord), "%s", live->chord);
+}
+
+int genius_live_process(GeniusLive* live, const float* interleaved, size_t frames,
+                        GeniusLiveUpdate* out) {
+    if (!live || !out || (!interleaved && frames > 0)) return -1;
+    double t0 = analysis_plan_now();
+    uint64_t t_trace = trace_now();
+    memset(out, 0, sizeof(*out));
+
+    if (frames > live->mono_cap) {
+        float* m = (float*)realloc(live->mono, sizeof(float) * frames);
+        if (!m) return -2;
+        live->mono = m;
+        live->mono_cap = frames;
+    }
+    int ch = live->channels;
+    for (size_t i = 0; i < frames; i++) {
+        double s = 0.0;
+        for (int c = 0; c < ch; c++) s += interleaved[i * ch + c];
+        live->mono[i] = (float)(s / ch);
+    }
+
+    DspCache* prev_cache = dsp_cache_bind(&live->dsp);
+    int rc = loudness_live_push(&live->loudness, interleaved, frames);
+    if (rc == 0) rc = live_push_mono(live, live->mono, frames);
+    live->frames += frames;
+    if (rc == 0) live_snapshot(live, out);
+    dsp_cache_bind(prev_cache);
+    if (rc != 0) return -3;
+
+    trace_span("live", "live_update", t_trace,
+               (uint64_t)frames * (uint64_t)live->channels * sizeof(float));
+    double busy = analysis_plan_now() - t0;
+    live->busy_sec += busy;
+    out->latency_ms = 1000.0 * busy;
+    out->rtf = (out->t_sec > 0.0 ? live->busy_sec / out->t_sec : 0.0);
+    return 0;
+}
+
+int genius_live_write(const GeniusLiveUpdate* u, OutputWriter* w) {
+    if (!u || !w) return -1;
+    writer_begin_object(w, NULL);
+    writer_double(w, "t_sec", u->t_sec, 3);
+    writer_begin_object(w, "loudness");
+    writer_double(w, "momentary", u->momentary_lufs, 2);
+    writer_double(w, "short_term", u->short_term_lufs, 2);
+    writer_double(w, "integrated", u->integrated_lufs, 2);
+    writer_double(w, "range", u->loudness_range_lu, 2);
+    writer_end_object(w);
+    writer_double(w, "tempo_bpm", u->tempo_bpm, 2);
+    writer_string(w, "key", u->key);
+    writer_double(w, "centroid", u->centroid, 2);
+    writer_string(w, "chord", u->chord);
+    writer_double(w, "latency_ms", u->latency_ms, 3);
+    writer_double(w, "rtf", u->rtf, 5);
+    writer_end_object(w);
+    return writer_end_record(w);
+}
@@ -1,7 +1,8 @@
 /* src/melody.c
  *
  * Compact, self-contained melody extraction module.
- * - YIN-based pitch tracking (time-domain)
+ * - YIN-based pitch tracking (time-domain), or
+ * - harmonic-summation salience on a log-frequency spectrogram + Viterbi
  * - Median smoothing
  * - Contour segmentation
  * - Simple motif counting (n-gram of rounded MIDI pitches)
@@ -10,6 +11,10 @@
  */
 
 #include "melody.h"
+#include "order_stats.h"
+#include "plan.h"
+#include "fastmath.h"
+#include "dsp.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -28,18 +33,26 @@
 #define YIN_FMAX             1200.0    /* Hz */
 #define MEDIAN_WINDOW         7        /* was 5, increased */
 #define MOTIF_N               4        /* motif length in notes */
+#define COARSE_STRIDE         8        /* first pass under a deadline: every 8th frame */
+
+/* Salience backend: pitch candidates YIN_FMIN.. 4 octaves up on a 20-cent
+ * grid, the log-frequency spectrum extending SAL_HARMONICS harmonics above. */
+#define SAL_BINS_PER_OCT     60
+#define SAL_STATES          240        /* 80 Hz - 1280 Hz */
+#define SAL_HARMONICS         8
+#define SAL_LOG_BINS        (SAL_STATES + 180)  /* + 60*log2(8) */
+#define SAL_HARMONIC_DECAY   0.8
+#define SAL_SHARPNESS       10.0       /* log-emission per unit of normalized salience */
+#define SAL_STEP_COST        0.4       /* per 20-cent step between frames */
+#define SAL_JUMP_COST        4.0       /* cap: any jump costs at most this */
+#define SAL_VOICING_COST     4.0       /* voiced <-> unvoiced */
+#define SAL_VOICING_GAIN     3.0       /* weight of log(frame salience / reference) */
+#define SAL_VOICING_REF      0.5       /* reference = this x median frame salience */
+#define SAL_BLOCK           256        /* frames decided at least this many at a time */
+#define SAL_WINDOW          (2 * SAL_BLOCK)  /* Viterbi survivors kept */
 
 /* small helpers */
-static double safe_log2(double x) { return log(x) / log(2.0); }
-
-/* qsort comparator */
-static int cmp_double(const void* a, const void* b) {
-    double aa = *(const double*)a;
-    double bb = *(const double*)b;
-    if (aa < bb) return -1;
-    if (aa > bb) return 1;
-    return 0;
-}
+static double safe_log2(double x) { return fast_math_enabled() ? fm_log2(x) : log(x) / log(2.0); }
 
 /* compute a Hann window (in-place) */
 static void fill_hann(float* w, int N) {
@@ -48,31 +61,17 @@ static void fill_hann(float* w, int N) {
     }
 }
 
-/* median filter on double array (simple, small window) */
+/* median filter on double array: sliding two-heap median, O(n log win) */
 static void median_filter(const double* in, double* out, int n, int win) {
-    if (win <= 1) {
+    if (median_filter_sliding(in, out, n, win) != 0) {
         memcpy(out, in, sizeof(double) * n);
-        return;
-    }
-    int half = win / 2;
-    double* buf = (double*)malloc(sizeof(double) * win);
-    for (int i = 0; i < n; ++i) {
-        int a = i - half;
-        int b = i + half;
-        if (a < 0) a = 0;
-        if (b >= n) b = n - 1;
-        int m = 0;
-        for (int j = a; j <= b; ++j) buf[m++] = in[j];
-        qsort(buf, m, sizeof(double), cmp_double);
-        out[i] = buf[m/2];
-    }
-    free(buf);
+    }
 }
 
 /* YIN core: returns frequency in Hz (0 if unvoiced). also returns confidence via out_conf (0..1) */
-static double yin_get_pitch(const float* frame, int N,
-                            int sr, double fmin, double fmax,
-                            double* out_confidence) {
+double yin_get_pitch(const float* frame, int N,
+                     int sr, double fmin, double fmax,
+                     double* out_confidence) {
     if (!frame || N < 32) {
         if (out_confidence) *out_confidence = 0.0;
         return 0.0;
@@ -156,56 +155,396 @@ static double yin_get_pitch(const float* frame, int N,
     return freq;
 }
 
-int compute_melody_features(const float* mono,
-                            size_t frames,
-                            int sample_rate,
-                            MelodyFeatures* out) {
-    if (!mono || frames == 0 || sample_rate <= 0 || !out) return 1;
-
-    /* zero-out out initially */
-    memset(out, 0, sizeof(MelodyFeatures));
-
+/* YIN backend: pitch, confidence and RMS energy per frame. Returns 0 with
+ * *n_out = 0 when the signal is shorter than one frame. */
+static int track_pitch_yin(const float* mono, size_t frames, int sample_rate,
+                           double** f0_out, double** conf_out, double** energy_out,
+                           int* n_out, int* hop_out) {
     const int frame_size = MELODY_FRAME_SIZE;
-    const int hop = MELODY_HOP;
+    StagePlan* plan = analysis_plan_stage(PLAN_MELODY);
+    int hop = MELODY_HOP * (plan ? plan->hop_scale : 1);
 
+    *n_out = 0;
     if (frames < (size_t)frame_size) {
         /* too short -> nothing to do, return success but features zero */
         return 0;
     }
 
     int n_frames = (int)((frames - frame_size) / hop) + 1;
+    int full_frames = (int)((frames - frame_size) / MELODY_HOP) + 1;
     double* f0 = (double*)calloc(n_frames, sizeof(double));
     double* conf = (double*)calloc(n_frames, sizeof(double));
     double* frame_energy = (double*)calloc(n_frames, sizeof(double));
-    double* f0_smoothed = (double*)calloc(n_frames, sizeof(double));
-    if (!f0 || !conf || !frame_energy || !f0_smoothed) {
-        free(f0); free(conf); free(frame_energy); free(f0_smoothed);
+    if (!f0 || !conf || !frame_energy) {
+        free(f0); free(conf); free(frame_energy);
         return 1;
     }
 
     float* window = (float*)malloc(sizeof(float) * frame_size);
     float* frame_buf = (float*)malloc(sizeof(float) * frame_size);
-    if (!window || !frame_buf) { free(window); free(frame_buf); free(f0); free(conf); free(frame_energy); free(f0_smoothed); return 1; }
+    if (!window || !frame_buf) { free(window); free(frame_buf); free(f0); free(conf); free(frame_energy); return 1; }
     fill_hann(window, frame_size);
 
-    /* compute frame-wise pitch and energy */
+    /* compute frame-wise pitch and energy. Under a deadline this runs
+     * coarse-to-fine: every COARSE_STRIDE-th frame first, then the frames
+     * halfway between, as long as the next pass is predicted to fit. */
+    int stride = 1;
+    if (plan && plan->deadline > 0.0) {
+        while (stride < COARSE_STRIDE && (n_frames - 1) / (stride * 2) >= 16) stride *= 2;
+    }
+    int done_stride = 0;     /* finest complete pass */
+    int computed = 0;
+    double t_start = analysis_plan_now();
+    for (int s = stride; s >= 1; s /= 2) {
+        int first = (done_stride == 0) ? 0 : s;
+        int step = (done_stride == 0) ? s : 2 * s;
+        int pass_frames = (n_frames - 1 - first) / step + 1;
+        if (done_stride != 0 && computed > 0) {
+            double per_frame = (analysis_plan_now() - t_start) / (double)computed;
+            if (analysis_plan_now() + per_frame * pass_frames > plan->deadline) {
+                plan->truncated = 1;
+                break;
+            }
+        }
+        for (int i = first; i < n_frames; i += step) {
+            size_t start = (size_t)i * hop;
+            double esum = 0.0;
+            for (int j = 0; j < frame_size; ++j) {
+                float x = mono[start + j] * window[j];
+                frame_buf[j] = x;
+                esum += (double)x * (double)x;
+            }
+            frame_energy[i] = sqrt(esum / (double)frame_size);
+            double c;
+            double pitch = yin_get_pitch(frame_buf, frame_size, sample_rate, YIN_FMIN, YIN_FMAX, &c);
+            f0[i] = pitch;
+            conf[i] = c;
+        }
+        computed += pass_frames;
+        done_stride = s;
+    }
+
+    /* keep the finest complete pass as a uniformly spaced sequence */
+    if (done_stride > 1) {
+        int kept = (n_frames - 1) / done_stride + 1;
+        for (int k = 0; k < kept; ++k) {
+            f0[k] = f0[k * done_stride];
+            conf[k] = conf[k * done_stride];
+            frame_energy[k] = frame_energy[k * done_stride];
+        }
+        n_frames = kept;
+        hop *= done_stride;
+    }
+    if (plan) {
+        plan->ran = 1;
+        plan->hop_sec = (double)hop / (double)sample_rate;
+        plan->coverage = (double)n_frames / (double)full_frames;
+    }
+
+    free(window);
+    free(frame_buf);
+    *f0_out = f0;
+    *conf_out = conf;
+    *energy_out = frame_energy;
+    *n_out = n_frames;
+    *hop_out = hop;
+    return 0;
+}
+
+/* ---------- Salience backend ---------- */
+
+int melody_backend_from_name(const char* name, MelodyBackend* out) {
+    if (!name || !out) return -1;
+    if (strcmp(name, "yin") == 0) *out = MELODY_BACKEND_YIN;
+    else if (strcmp(name, "salience") == 0) *out = MELODY_BACKEND_SALIENCE;
+    else return -1;
+    return 0;
+}
+
+const char* melody_backend_name(MelodyBackend backend) {
+    return backend == MELODY_BACKEND_SALIENCE ? "salience" : "yin";
+}
+
+/* Log-frequency axis and harmonic layout shared by every frame. */
+typedef struct {
+    int lo_bin[SAL_LOG_BINS];
+    double frac[SAL_LOG_BINS];
+    int offset[SAL_HARMONICS];
+    double weight[SAL_HARMONICS];
+} SalienceAxis;
+
+static void salience_axis_init(SalienceAxis* ax, int sample_rate) {
+    const int N = MELODY_FRAME_SIZE;
+    const int n_bins = N / 2 + 1;
+    /* log-frequency axis: linear interpolation between FFT bins */
+    for (int b = 0; b < SAL_LOG_BINS; ++b) {
+        double k = YIN_FMIN * pow(2.0, (double)b / SAL_BINS_PER_OCT) * N / sample_rate;
+        ax->lo_bin[b] = (int)k;
+        ax->frac[b] = k - ax->lo_bin[b];
+        if (ax->lo_bin[b] >= n_bins - 1) { ax->lo_bin[b] = n_bins - 2; ax->frac[b] = -1.0; }  /* above Nyquist */
+    }
+    for (int h = 0; h < SAL_HARMONICS; ++h) {
+        ax->offset[h] = (int)lround(SAL_BINS_PER_OCT * log2((double)(h + 1)));
+        ax->weight[h] = pow(SAL_HARMONIC_DECAY, h);
+    }
+}
+
+/* Salience of every candidate for the frame at x; returns the frame's RMS. */
+static double salience_frame(const SalienceAxis* ax, const FftPlan* fft, const double* window,
+                             DspComplex* X, const float* x, double* s) {
+    const int N = MELODY_FRAME_SIZE;
+    const int n_bins = N / 2 + 1;
+    double mag[MELODY_FRAME_SIZE / 2 + 1];
+    double logspec[SAL_LOG_BINS];
+    double esum = 0.0;
+    for (int j = 0; j < N; ++j) {
+        double v = (double)x[j] * window[j];
+        X[j].r = v;
+        X[j].i = 0.0;
+        esum += v * v;
+    }
+    dsp_fft(fft, X);
+    for (int k = 0; k < n_bins; ++k) mag[k] = sqrt(X[k].r * X[k].r + X[k].i * X[k].i);
+    for (int b = 0; b < SAL_LOG_BINS; ++b) {
+        int k = ax->lo_bin[b];
+        logspec[b] = (ax->frac[b] < 0.0 ? 0.0 : mag[k] + ax->frac[b] * (mag[k + 1] - mag[k]));
+    }
+
+    for (int c = 0; c < SAL_STATES; ++c) s[c] = 0.0;
+    for (int h = 0; h < SAL_HARMONICS; ++h) {
+        const double* src = logspec + ax->offset[h];
+        double w = ax->weight[h];
+        for (int c = 0; c < SAL_STATES; ++c) s[c] += w * src[c];
+    }
+    return sqrt(esum / (double)N);
+}
+
+/* Viterbi survivors of the last SAL_WINDOW frames, in rings indexed by
+ * frame % SAL_WINDOW, and the per-frame outputs they are decided into. */
+typedef struct {
+    const unsigned char* sal;       /* salience relative to the frame peak, 0-255 */
+    const unsigned short* back;     /* best predecessor of each state */
+    const double* peak;
+    double ref;
+    double* f0;
+    double* conf;
+} SalienceTrack;
+
+/* Write frames stop..last along the path that is in state st at frame last. */
+static void salience_emit(const SalienceTrack* t, int last, int st, int stop) {
+    const int U = SAL_STATES;
+    for (int i = last; i >= stop; --i) {
+        if (st < U) {
+            const unsigned char* q = t->sal + (size_t)(i % SAL_WINDOW) * SAL_STATES;
+            /* parabolic refinement between neighbouring candidates */
+            double pos = (double)st;
+            if (st > 0 && st < SAL_STATES - 1) {
+                double a = q[st - 1], b = q[st], c = q[st + 1];
+                double den = a - 2.0 * b + c;
+                if (den < 0.0) pos += 0.5 * (a - c) / den;
+            }
+            t->f0[i] = YIN_FMIN * pow(2.0, pos / SAL_BINS_PER_OCT);
+            double strength = (t->ref > 1e-12 ? t->peak[i] / (t->peak[i] + t->ref) : 0.0);
+            t->conf[i] = strength * q[st] / 255.0;
+        }
+        if (i > stop) st = t->back[(size_t)(i % SAL_WINDOW) * (SAL_STATES + 1) + st];
+    }
+}
+
+/* The rings are full at frame i: decide frames from `done` on and return the
+ * first undecided frame. Where the survivors of all states have merged, the
+ * path before the merge is final; if they have not merged within the window,
+ * the oldest block follows the currently best state. */
+static int salience_decide(const SalienceTrack* t, const double* delta, int i, int done) {
+    const int U = SAL_STATES;
+    int cur[SAL_STATES + 1];
+    for (int c = 0; c <= U; ++c) cur[c] = c;
+    for (int j = i; j > done; --j) {
+        const unsigned short* bp = t->back + (size_t)(j % SAL_WINDOW) * (SAL_STATES + 1);
+        int merged = 1;
+        for (int c = 0; c <= U; ++c) {
+            cur[c] = bp[cur[c]];
+            if (cur[c] != cur[0]) merged = 0;
+        }
+        if (merged) {
+            if (j - 1 < done + SAL_BLOCK - 1) break;
+            salience_emit(t, j - 1, cur[0], done);
+            return j;
+        }
+    }
+
+    int st = U;
+    for (int c = 0; c <= U; ++c) if (delta[c] > delta[st]) st = c;
+    int last = done + SAL_BLOCK - 1;
+    for (int j = i; j > last; --j) st = t->back[(size_t)(j % SAL_WINDOW) * (SAL_STATES + 1) + st];
+    salience_emit(t, last, st, done);
+    return last + 1;
+}
+
+/* Log-frequency spectrogram + harmonic summation per frame, then Viterbi
+ * over the SAL_STATES pitch candidates and one unvoiced state. Harmonics sit
+ * at fixed offsets on the log axis, so the salience of every candidate is
+ * SAL_HARMONICS shifted multiply-adds over one array.
+ *
+ * The voicing reference needs the whole track, so a first pass only keeps
+ * each frame's peak salience and the Viterbi pass recomputes the spectrum.
+ * Survivors live in rings of SAL_WINDOW frames and are decided as they merge,
+ * which bounds memory regardless of track length. */
+static int track_pitch_salience(const float* mono, size_t frames, int sample_rate,
+                                double** f0_out, double** conf_out, double** energy_out,
+                                int* n_out, int* hop_out) {
+    const int N = MELODY_FRAME_SIZE;
+    StagePlan* plan = analysis_plan_stage(PLAN_MELODY);
+    int hop = MELODY_HOP * (plan ? plan->hop_scale : 1);
+    *n_out = 0;
+    if (frames < (size_t)N) return 0;
+
+    int n_frames = (int)((frames - N) / hop) + 1;
+    int full_frames = (int)((frames - N) / MELODY_HOP) + 1;
+    const FftPlan* fft = dsp_fft_plan(N);
+    const double* window = dsp_window(DSP_HANN_SYMMETRIC, N);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * N);
+    double* f0 = (double*)calloc(n_frames, sizeof(double));
+    double* conf = (double*)calloc(n_frames, sizeof(double));
+    double* energy = (double*)calloc(n_frames, sizeof(double));
+    double* peak = (double*)calloc(n_frames, sizeof(double));
+    unsigned char* sal = (unsigned char*)malloc((size_t)SAL_WINDOW * SAL_STATES);
+    unsigned short* back = (unsigned short*)malloc(sizeof(unsigned short) * SAL_WINDOW * (SAL_STATES + 1));
+    if (!fft || !window || !X || !f0 || !conf || !energy || !peak || !sal || !back) {
+        free(f0); free(conf); free(energy); free(peak); free(sal); free(back);
+        return 1;
+    }
+    SalienceAxis ax;
+    salience_axis_init(&ax, sample_rate);
+
+    /* Under a deadline the first pass gets half of the remaining time, as
+     * the second one costs about the same; either pass stops where the time
+     * runs out and the track ends there. */
+    StagePlan first_half;
+    const StagePlan* pass1_plan = NULL;
+    double t_start = analysis_plan_now();
+    if (plan && plan->deadline > 0.0) {
+        first_half = *plan;
+        first_half.deadline = t_start + 0.5 * (plan->deadline - t_start);
+        pass1_plan = &first_half;
+    }
+
+    /* pass 1: energy and peak salience per frame */
+    double s[SAL_STATES];
+    for (int i = 0; i < n_frames; ++i) {
+        if (i > 0 && i % SAL_BLOCK == 0 && analysis_plan_expired(pass1_plan)) {
+            plan->truncated = 1;
+            n_frames = i;
+            break;
+        }
+        energy[i] = salience_frame(&ax, fft, window, X, mono + (size_t)i * hop, s);
+        double top = 0.0;
+        for (int c = 0; c < SAL_STATES; ++c) if (s[c] > top) top = s[c];
+        peak[i] = top;
+    }
+
+    /* voicing reference: median frame salience */
+    double ref = 0.0;
+    double* tmp = (double*)malloc(sizeof(double) * n_frames);
+    if (tmp) {
+        memcpy(tmp, peak, sizeof(double) * n_frames);
+        ref = SAL_VOICING_REF * median_select(tmp, (size_t)n_frames);
+        free(tmp);
+    }
+
+    /* pass 2: Viterbi. Moving between candidates costs SAL_STEP_COST per
+     * step, capped at SAL_JUMP_COST; the best predecessor under the linear
+     * cost comes from a forward and a backward sweep (a 1-D distance
+     * transform), so a frame costs O(states). */
+    const int U = SAL_STATES;              /* unvoiced state */
+    SalienceTrack track = {sal, back, peak, ref, f0, conf};
+    double delta[SAL_STATES + 1], next[SAL_STATES + 1], g[SAL_STATES];
+    int from[SAL_STATES];
+    int done = 0;                          /* frames before this one are decided */
     for (int i = 0; i < n_frames; ++i) {
-        size_t start = (size_t)i * hop;
-        double esum = 0.0;
-        for (int j = 0; j < frame_size; ++j) {
-            float s = mono[start + j] * window[j];
-            frame_buf[j] = s;
-            esum += (double)s * (double)s;
+        if (i > 0 && i % SAL_BLOCK == 0 && analysis_plan_expired(plan)) {
+            plan->truncated = 1;
+            n_frames = i;
+            break;
         }
-        frame_energy[i] = sqrt(esum / (double)frame_size);
-        double c;
-        double pitch = yin_get_pitch(frame_buf, frame_size, sample_rate, YIN_FMIN, YIN_FMAX, &c);
-        f0[i] = pitch;
-        conf[i] = c;
+        salience_frame(&ax, fft, window, X, mono + (size_t)i * hop, s);
+        unsigned char* q = sal + (size_t)(i % SAL_WINDOW) * SAL_STATES;
+        double scale = (peak[i] > 0.0 ? 255.0 / peak[i] : 0.0);
+        for (int c = 0; c < SAL_STATES; ++c) q[c] = (unsigned char)(s[c] * scale + 0.5);
+
+        double v = (peak[i] > 1e-12 && ref > 1e-12) ? log(peak[i] / ref) : -4.0;
+        if (v < -4.0) v = -4.0;
+        if (v > 4.0) v = 4.0;
+        double voiced = SAL_VOICING_GAIN * v;
+        unsigned short* bp = back + (size_t)(i % SAL_WINDOW) * (SAL_STATES + 1);
+
+        if (i == 0) {
+            for (int c = 0; c < SAL_STATES; ++c) delta[c] = SAL_SHARPNESS * q[c] / 255.0 + voiced;
+            delta[U] = SAL_SHARPNESS;
+            continue;
+        }
+        for (int c = 0; c < SAL_STATES; ++c) { g[c] = delta[c]; from[c] = c; }
+        for (int c = 1; c < SAL_STATES; ++c) {
+            if (g[c - 1] - SAL_STEP_COST > g[c]) { g[c] = g[c - 1] - SAL_STEP_COST; from[c] = from[c - 1]; }
+        }
+        for (int c = SAL_STATES - 2; c >= 0; --c) {
+            if (g[c + 1] - SAL_STEP_COST > g[c]) { g[c] = g[c + 1] - SAL_STEP_COST; from[c] = from[c + 1]; }
+        }
+        int best = 0;
+        for (int c = 1; c < SAL_STATES; ++c) if (delta[c] > delta[best]) best = c;
+        double jump = delta[best] - SAL_JUMP_COST;
+        double wake = delta[U] - SAL_VOICING_COST;
+
+        double top = -1e300;
+        for (int c = 0; c < SAL_STATES; ++c) {
+            double m = g[c];
+            int f = from[c];
+            if (jump > m) { m = jump; f = best; }
+            if (wake > m) { m = wake; f = U; }
+            next[c] = m + SAL_SHARPNESS * q[c] / 255.0 + voiced;
+            bp[c] = (unsigned short)f;
+            if (next[c] > top) top = next[c];
+        }
+        double sleep = delta[best] - SAL_VOICING_COST;
+        next[U] = (sleep > delta[U] ? sleep : delta[U]) + SAL_SHARPNESS;
+        bp[U] = (unsigned short)(sleep > delta[U] ? best : U);
+        if (next[U] > top) top = next[U];
+        for (int c = 0; c <= U; ++c) delta[c] = next[c] - top;
+
+        if (i - done + 1 == SAL_WINDOW) done = salience_decide(&track, delta, i, done);
+    }
+
+    if (n_frames > 0) {
+        int st = U;
+        for (int c = 0; c <= U; ++c) if (delta[c] > delta[st]) st = c;
+        salience_emit(&track, n_frames - 1, st, done);
+    }
+
+    if (plan) {
+        plan->ran = 1;
+        plan->hop_sec = (double)hop / (double)sample_rate;
+        plan->coverage = (double)n_frames / (double)full_frames;
     }
+    free(peak); free(sal); free(back);
+    *f0_out = f0;
+    *conf_out = conf;
+    *energy_out = energy;
+    *n_out = n_frames;
+    *hop_out = hop;
+    return 0;
+}
+
+/* Shared by both backends: smoothing, voicing, contours, motifs and the
+ * derived statistics from per-frame pitch, confidence and energy. */
+static int summarize_melody(const double* f0, const double* conf, const double* frame_energy,
+                            int n_frames, int hop, int sample_rate, MelodyFeatures* out) {
+    double* f0_smoothed = (double*)calloc(n_frames, sizeof(double));
+    if (!f0_smoothed) return 1;
 
     /* median smoothing of f0 */
-    median_filter(f0, f0_smoothed, n_frames, MEDIAN_WINDOW);
+    /* same smoothing span in seconds when frames are further apart */
+    int median_win = (MEDIAN_WINDOW * MELODY_HOP / hop) | 1;
+    median_filter(f0, f0_smoothed, n_frames, median_win);
 
     /* decide voiced frames using conf and smoothed f0 */
     int voiced_count = 0;
@@ -229,16 +568,13 @@ int compute_melody_features(const float* mono,
     out->f0_confidence = (double)voiced_count / (double)n_frames;
     if (voiced_count == 0) {
         /* no voiced material; leave others as 0 and return success */
-        free(f0); free(conf); free(frame_energy); free(f0_smoothed);
-        free(window); free(frame_buf); free(voiced_f0_list);
+        free(f0_smoothed); free(voiced_f0_list);
         return 0;
     }
 
     /* median and mean f0 */
-    qsort(voiced_f0_list, median_list_size, sizeof(double), cmp_double);
     if (median_list_size > 0) {
-        if (median_list_size % 2 == 1) out->median_f0 = voiced_f0_list[median_list_size/2];
-        else out->median_f0 = 0.5 * (voiced_f0_list[median_list_size/2 - 1] + voiced_f0_list[median_list_size/2]);
+        out->median_f0 = median_select(voiced_f0_list, (size_t)median_list_size);
     }
     out->mean_f0 = sum_f0 / (double)voiced_count;
 
@@ -366,8 +702,7 @@ int compute_melody_features(const float* mono,
     double *eng_copy = (double*)malloc(sizeof(double) * n_frames);
     int ec = 0;
     for (int i = 0; i < n_frames; ++i) eng_copy[ec++] = frame_energy[i];
-    qsort(eng_copy, ec, sizeof(double), cmp_double);
-    double median_eng = eng_copy[ec/2];
+    double median_eng = select_kth(eng_copy, (size_t)ec, (size_t)(ec/2));
     free(eng_copy);
 
     double voiced_eng_sum = 0.0;
@@ -446,12 +781,7 @@ int compute_melody_features(const float* mono,
     out->hook_strength = hook_strength;
 
     /* cleanup */
-    free(f0);
-    free(conf);
-    free(frame_energy);
     free(f0_smoothed);
-    free(window);
-    free(frame_buf);
     free(voiced_f0_list);
     free(midi_seq);
     free(all_midi);
@@ -460,3 +790,33 @@ int compute_melody_features(const float* mono,
 
     return 0;
 }
+
+int compute_melody_features_backend(const float* mono,
+                                    size_t frames,
+                                    int sample_rate,
+                                    MelodyBackend backend,
+                                    MelodyFeatures* out) {
+    if (!mono || frames == 0 || sample_rate <= 0 || !out) return 1;
+
+    /* zero-out out initially */
+    memset(out, 0, sizeof(MelodyFeatures));
+
+    double *f0 = NULL, *conf = NULL, *energy = NULL;
+    int n_frames = 0, hop = MELODY_HOP;
+    int rc = (backend == MELODY_BACKEND_SALIENCE)
+           ? track_pitch_salience(mono, frames, sample_rate, &f0, &conf, &energy, &n_frames, &hop)
+           : track_pitch_yin(mono, frames, sample_rate, &f0, &conf, &energy, &n_frames, &hop);
+    if (rc != 0) return rc;
+    if (n_frames > 0) rc = summarize_melody(f0, conf, energy, n_frames, hop, sample_rate, out);
+    free(f0);
+    free(conf);
+    free(energy);
+    return rc;
+}
+
+int compute_melody_features(const float* mono,
+                            size_t frames,
+                            int sample_rate,
+                            MelodyFeatures* out) {
+    return compute_melody_features_backend(mono, frames, sample_rate, MELODY_BACKEND_YIN, out);
+}
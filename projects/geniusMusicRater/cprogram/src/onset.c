@@ -0,0 +1,203 @@
+#include "onset.h"
+#include "dsp.h"
+#include "spectral_kernel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define ONSET_COMPRESSION 1000.0  // gamma in log(1 + gamma * |X|), |X| = 1 at full scale
+#define ONSET_MEAN_RADIUS 8       // frames each side of the subtracted moving average
+
+// Upper band edges in Hz; the last band runs to Nyquist.
+static const double BAND_EDGES[ONSET_BANDS - 1] = {150, 300, 600, 1200, 2400, 4800, 9600};
+
+// First bin of each band plus the end sentinel.
+static void band_bins(int sr, int n_fft, int* first) {
+    int n_bins = n_fft / 2 + 1;
+    first[0] = 1;   // skip DC
+    for (int b = 1; b < ONSET_BANDS; b++) {
+        int k = (int)ceil(BAND_EDGES[b-1] * n_fft / sr);
+        if (k < first[b-1] + 1) k = first[b-1] + 1;  // at least one bin per band
+        if (k > n_bins) k = n_bins;
+        first[b] = k;
+    }
+    first[ONSET_BANDS] = n_bins;
+}
+
+static int onset_kernel(int sample_rate, SpectralKernel* kernel) {
+    int first[ONSET_BANDS + 1];
+    band_bins(sample_rate, ONSET_FFT_SIZE, first);
+    if (spectral_kernel_init(kernel, ONSET_FFT_SIZE, sample_rate, first, ONSET_BANDS) != 0) return -1;
+    kernel->level_scale = 4.0 / ONSET_FFT_SIZE;   // Hann window sum is n/2
+    kernel->compression = ONSET_COMPRESSION;
+    return 0;
+}
+
+// Log-compressed levels of one frame, per-band mean level and the rectified
+// band flux against prev (NULL on the first frame: flux 0).
+static double onset_frame(const SpectralKernel* kernel, const float* x, double* level,
+                          const double* prev, double* band_level) {
+    const int n_fft = ONSET_FFT_SIZE;
+    const FftPlan* plan = dsp_fft_plan(n_fft);
+    const double* window = dsp_window(DSP_HANN_PERIODIC, n_fft);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * n_fft);
+    double* power = (double*)dsp_scratch(DSP_SCRATCH_MAG, sizeof(double) * kernel->n_bins);
+    if (!plan || !window || !X || !power) return -1.0;
+
+    for (int i = 0; i < n_fft; i++) {
+        X[i].r = (double)x[i] * window[i];
+        X[i].i = 0.0;
+    }
+    dsp_fft(plan, X);
+    SpectralFrame sf;
+    spectral_kernel_run(kernel, X, power, level, prev, band_level, &sf);
+    return sf.flux;
+}
+
+// Subtract the local mean so sustained texture does not count as onsets.
+static void subtract_local_mean(const float* flux, size_t n, float* odf) {
+    double run = 0.0;
+    size_t lo = 0, hi = 0;    // window [lo, hi)
+    for (size_t f = 0; f < n; f++) {
+        size_t want_hi = (f + ONSET_MEAN_RADIUS + 1 < n ? f + ONSET_MEAN_RADIUS + 1 : n);
+        size_t want_lo = (f > ONSET_MEAN_RADIUS ? f - ONSET_MEAN_RADIUS : 0);
+        while (hi < want_hi) run += flux[hi++];
+        while (lo < want_lo) run -= flux[lo++];
+        double d = flux[f] - run / (double)(hi - lo);
+        odf[f] = (d > 0.0 ? (float)d : 0.0f);
+    }
+}
+
+int compute_onset_function(const float* mono, size_t frames, int sample_rate,
+                           OnsetFunction* out) {
+    if (!mono || sample_rate <= 0 || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    out->hop_size = ONSET_HOP_SIZE;
+    out->sample_rate = sample_rate;
+    out->frame_rate = (double)sample_rate / ONSET_HOP_SIZE;
+    if (frames < ONSET_FFT_SIZE) return -2;
+
+    const int n_bins = ONSET_FFT_SIZE / 2 + 1;
+    size_t n = 1 + (frames - ONSET_FFT_SIZE) / ONSET_HOP_SIZE;
+
+    SpectralKernel kernel;
+    if (onset_kernel(sample_rate, &kernel) != 0) return -1;
+    double* levels = (double*)malloc(sizeof(double) * 2 * n_bins);
+    float* flux = (float*)calloc(n, sizeof(float));
+    float* bands = (float*)calloc(n * ONSET_BANDS, sizeof(float));
+    float* odf = (float*)malloc(sizeof(float) * n);
+    if (!levels || !flux || !bands || !odf) {
+        free(levels); free(flux); free(bands); free(odf);
+        return -3;
+    }
+    double* level = levels;
+    double* prev = levels + n_bins;
+
+    for (size_t f = 0; f < n; f++) {
+        double band_level[ONSET_BANDS];
+        double v = onset_frame(&kernel, mono + f * ONSET_HOP_SIZE, level, (f > 0 ? prev : NULL), band_level);
+        if (v < 0.0) {
+            free(levels); free(flux); free(bands); free(odf);
+            return -3;
+        }
+        for (int b = 0; b < ONSET_BANDS; b++) bands[f * ONSET_BANDS + b] = (float)band_level[b];
+        flux[f] = (float)v;         // 0 on the first frame: nothing to compare with
+        double* t = prev; prev = level; level = t;
+    }
+    free(levels);
+
+    subtract_local_mean(flux, n, odf);
+    free(flux);
+
+    out->odf = odf;
+    out->band_energy = bands;
+    out->odf_len = n;
+    return 0;
+}
+
+void free_onset_function(OnsetFunction* of) {
+    if (!of) return;
+    free(of->odf);
+    free(of->band_energy);
+    of->odf = NULL;
+    of->band_energy = NULL;
+    of->odf_len = 0;
+}
+
+// ---------- Streaming ----------
+
+int onset_stream_init(OnsetStream* s, int sample_rate, size_t history) {
+    if (!s || sample_rate <= 0 || history == 0) return -1;
+    memset(s, 0, sizeof(*s));
+    s->sample_rate = sample_rate;
+    s->frame_rate = (double)sample_rate / ONSET_HOP_SIZE;
+    s->history = history;
+    if (onset_kernel(sample_rate, &s->kernel) != 0) return -1;
+    s->input = (float*)malloc(sizeof(float) * ONSET_FFT_SIZE);
+    s->levels = (double*)malloc(sizeof(double) * 2 * s->kernel.n_bins);
+    s->flux = (float*)calloc(history, sizeof(float));
+    if (!s->input || !s->levels || !s->flux) {
+        onset_stream_free(s);
+        return -2;
+    }
+    s->level = s->levels;
+    s->prev = s->levels + s->kernel.n_bins;
+    return 0;
+}
+
+int onset_stream_push(OnsetStream* s, const float* mono, size_t n) {
+    if (!s || !s->input || (!mono && n > 0)) return -1;
+    while (n > 0) {
+        size_t take = ONSET_FFT_SIZE - s->input_len;
+        if (take > n) take = n;
+        memcpy(s->input + s->input_len, mono, sizeof(float) * take);
+        s->input_len += take;
+        mono += take;
+        n -= take;
+        if (s->input_len < ONSET_FFT_SIZE) break;
+
+        double band_level[ONSET_BANDS];
+        double v = onset_frame(&s->kernel, s->input, s->level, (s->frames > 0 ? s->prev : NULL), band_level);
+        if (v < 0.0) return -2;
+        s->flux[s->frames % s->history] = (float)v;
+        s->frames++;
+        double* t = s->prev; s->prev = s->level; s->level = t;
+
+        memmove(s->input, s->input + ONSET_HOP_SIZE, sizeof(float) * (ONSET_FFT_SIZE - ONSET_HOP_SIZE));
+        s->input_len = ONSET_FFT_SIZE - ONSET_HOP_SIZE;
+    }
+    return 0;
+}
+
+int onset_stream_function(const OnsetStream* s, size_t n, OnsetFunction* out) {
+    if (!s || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    out->hop_size = ONSET_HOP_SIZE;
+    out->sample_rate = s->sample_rate;
+    out->frame_rate = s->frame_rate;
+    if (n > s->history) n = s->history;
+    if (n > s->frames) n = s->frames;
+    if (n == 0) return -2;
+
+    float* flux = (float*)malloc(sizeof(float) * n);
+    float* odf = (float*)malloc(sizeof(float) * n);
+    if (!flux || !odf) {
+        free(flux); free(odf);
+        return -3;
+    }
+    size_t first = s->frames - n;
+    for (size_t i = 0; i < n; i++) flux[i] = s->flux[(first + i) % s->history];
+    subtract_local_mean(flux, n, odf);
+    free(flux);
+    out->odf = odf;
+    out->odf_len = n;
+    return 0;
+}
+
+void onset_stream_free(OnsetStream* s) {
+    if (!s) return;
+    free(s->input);
+    free(s->levels);
+    free(s->flux);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,295 @@
+#include "order_stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// ---------- Quickselect ----------
+
+static void swap_d(double* a, double* b) {
+    double t = *a; *a = *b; *b = t;
+}
+
+double select_kth(double* arr, size_t n, size_t k) {
+    if (!arr || n == 0) return 0.0;
+    if (k >= n) k = n - 1;
+
+    ptrdiff_t lo = 0, hi = (ptrdiff_t)n - 1;
+    ptrdiff_t kk = (ptrdiff_t)k;
+    while (hi > lo) {
+        // median-of-three pivot keeps sorted / constant runs linear
+        ptrdiff_t mid = lo + (hi - lo) / 2;
+        if (arr[mid] < arr[lo]) swap_d(&arr[mid], &arr[lo]);
+        if (arr[hi]  < arr[lo]) swap_d(&arr[hi],  &arr[lo]);
+        if (arr[hi]  < arr[mid]) swap_d(&arr[hi], &arr[mid]);
+        double pivot = arr[mid];
+
+        // Hoare partition: [lo..j] <= pivot, [i..hi] >= pivot
+        ptrdiff_t i = lo, j = hi;
+        while (i <= j) {
+            while (arr[i] < pivot) i++;
+            while (arr[j] > pivot) j--;
+            if (i <= j) {
+                swap_d(&arr[i], &arr[j]);
+                i++; j--;
+            }
+        }
+
+        if (kk <= j) hi = j;
+        else if (kk >= i) lo = i;
+        else break; // j < k < i: arr[k] == pivot
+    }
+    return arr[kk];
+}
+
+double percentile_select(double* arr, size_t n, double p) {
+    if (!arr || n == 0) return 0.0;
+    if (p < 0.0) p = 0.0;
+    if (p > 1.0) p = 1.0;
+    size_t idx = (size_t)floor(p * (double)(n - 1));
+    if (idx >= n) idx = n - 1;
+    return select_kth(arr, n, idx);
+}
+
+double median_select(double* arr, size_t n) {
+    if (!arr || n == 0) return 0.0;
+    double upper = select_kth(arr, n, n / 2);
+    if (n % 2 == 1) return upper;
+
+    // everything left of n/2 is <= upper; the lower middle is their max
+    double lower = arr[0];
+    for (size_t i = 1; i < n / 2; ++i) {
+        if (arr[i] > lower) lower = arr[i];
+    }
+    return 0.5 * (lower + upper);
+}
+
+// ---------- Sliding median ----------
+
+static int sm_above(const SlidingMedian* sm, int heap, int slot_a, int slot_b) {
+    double va = sm->values[slot_a];
+    double vb = sm->values[slot_b];
+    return heap == 0 ? (va > vb) : (va < vb);
+}
+
+static int* sm_heap(SlidingMedian* sm, int heap) {
+    return heap == 0 ? sm->low : sm->high;
+}
+
+static int* sm_size(SlidingMedian* sm, int heap) {
+    return heap == 0 ? &sm->n_low : &sm->n_high;
+}
+
+static void sm_place(SlidingMedian* sm, int heap, int idx, int slot) {
+    sm_heap(sm, heap)[idx] = slot;
+    sm->heap_of[slot] = heap;
+    sm->pos_of[slot] = idx;
+}
+
+static void sm_sift_up(SlidingMedian* sm, int heap, int idx) {
+    int* h = sm_heap(sm, heap);
+    int slot = h[idx];
+    while (idx > 0) {
+        int parent = (idx - 1) / 2;
+        if (!sm_above(sm, heap, slot, h[parent])) break;
+        sm_place(sm, heap, idx, h[parent]);
+        idx = parent;
+    }
+    sm_place(sm, heap, idx, slot);
+}
+
+static void sm_sift_down(SlidingMedian* sm, int heap, int idx) {
+    int* h = sm_heap(sm, heap);
+    int n = *sm_size(sm, heap);
+    int slot = h[idx];
+    for (;;) {
+        int child = 2 * idx + 1;
+        if (child >= n) break;
+        if (child + 1 < n && sm_above(sm, heap, h[child + 1], h[child])) child++;
+        if (!sm_above(sm, heap, h[child], slot)) break;
+        sm_place(sm, heap, idx, h[child]);
+        idx = child;
+    }
+    sm_place(sm, heap, idx, slot);
+}
+
+static void sm_insert(SlidingMedian* sm, int heap, int slot) {
+    int idx = (*sm_size(sm, heap))++;
+    sm_place(sm, heap, idx, slot);
+    sm_sift_up(sm, heap, idx);
+}
+
+static void sm_remove_at(SlidingMedian* sm, int heap, int idx) {
+    int* h = sm_heap(sm, heap);
+    int last = --(*sm_size(sm, heap));
+    if (idx == last) return;
+    int moved = h[last];
+    sm_place(sm, heap, idx, moved);
+    sm_sift_up(sm, heap, idx);
+    sm_sift_down(sm, heap, sm->pos_of[moved]);
+}
+
+// keep |low| == count/2 so that min(high) is the element of rank count/2
+static void sm_rebalance(SlidingMedian* sm) {
+    int want_low = sm->count / 2;
+    while (sm->n_low > want_low) {
+        int top = sm->low[0];
+        sm_remove_at(sm, 0, 0);
+        sm_insert(sm, 1, top);
+    }
+    while (sm->n_low < want_low) {
+        int top = sm->high[0];
+        sm_remove_at(sm, 1, 0);
+        sm_insert(sm, 0, top);
+    }
+}
+
+int sliding_median_init(SlidingMedian* sm, int capacity) {
+    if (!sm || capacity <= 0) return -1;
+    memset(sm, 0, sizeof(*sm));
+    sm->values  = (double*)malloc(sizeof(double) * capacity);
+    sm->heap_of = (int*)malloc(sizeof(int) * capacity);
+    sm->pos_of  = (int*)malloc(sizeof(int) * capacity);
+    sm->low     = (int*)malloc(sizeof(int) * capacity);
+    sm->high    = (int*)malloc(sizeof(int) * capacity);
+    if (!sm->values || !sm->heap_of || !sm->pos_of || !sm->low || !sm->high) {
+        sliding_median_free(sm);
+        return -2;
+    }
+    sm->capacity = capacity;
+    return 0;
+}
+
+void sliding_median_free(SlidingMedian* sm) {
+    if (!sm) return;
+    free(sm->values);
+    free(sm->heap_of);
+    free(sm->pos_of);
+    free(sm->low);
+    free(sm->high);
+    memset(sm, 0, sizeof(*sm));
+}
+
+void sliding_median_push(SlidingMedian* sm, double x) {
+    if (!sm || sm->count >= sm->capacity) return;
+    int slot = (sm->head + sm->count) % sm->capacity;
+    sm->values[slot] = x;
+    sm->count++;
+    if (sm->n_low > 0 && x <= sm->values[sm->low[0]]) sm_insert(sm, 0, slot);
+    else sm_insert(sm, 1, slot);
+    sm_rebalance(sm);
+}
+
+void sliding_median_pop(SlidingMedian* sm) {
+    if (!sm || sm->count == 0) return;
+    int slot = sm->head;
+    sm_remove_at(sm, sm->heap_of[slot], sm->pos_of[slot]);
+    sm->head = (sm->head + 1) % sm->capacity;
+    sm->count--;
+    sm_rebalance(sm);
+}
+
+double sliding_median_get(const SlidingMedian* sm) {
+    if (!sm || sm->count == 0) return 0.0;
+    return sm->values[sm->high[0]];
+}
+
+int median_filter_sliding(const double* in, double* out, int n, int win) {
+    if (!in || !out || n <= 0) return -1;
+    if (win <= 1) {
+        memcpy(out, in, sizeof(double) * n);
+        return 0;
+    }
+    int half = win / 2;
+
+    SlidingMedian sm;
+    if (sliding_median_init(&sm, 2 * half + 1) != 0) return -2;
+
+    // window for output i is [i-half, i+half] clipped to [0, n-1]
+    for (int j = 0; j < half && j < n; ++j) sliding_median_push(&sm, in[j]);
+    for (int i = 0; i < n; ++i) {
+        if (i - half - 1 >= 0) sliding_median_pop(&sm);
+        if (i + half < n) sliding_median_push(&sm, in[i + half]);
+        out[i] = sliding_median_get(&sm);
+    }
+
+    sliding_median_free(&sm);
+    return 0;
+}
+
+// ---------- P-square quantile sketch (Jain & Chlamtac, 1985) ----------
+
+void quantile_sketch_init(QuantileSketch* qs, double p) {
+    if (!qs) return;
+    memset(qs, 0, sizeof(*qs));
+    if (p < 0.0) p = 0.0;
+    if (p > 1.0) p = 1.0;
+    qs->p = p;
+    for (int i = 0; i < 5; ++i) qs->pos[i] = (double)(i + 1);
+    qs->want[0] = 1.0;
+    qs->want[1] = 1.0 + 2.0 * p;
+    qs->want[2] = 1.0 + 4.0 * p;
+    qs->want[3] = 3.0 + 2.0 * p;
+    qs->want[4] = 5.0;
+    qs->inc[0] = 0.0;
+    qs->inc[1] = p / 2.0;
+    qs->inc[2] = p;
+    qs->inc[3] = (1.0 + p) / 2.0;
+    qs->inc[4] = 1.0;
+}
+
+static double p2_parabolic(const QuantileSketch* qs, int i, double d) {
+    const double* q = qs->q;
+    const double* n = qs->pos;
+    return q[i] + d / (n[i+1] - n[i-1]) *
+           ((n[i] - n[i-1] + d) * (q[i+1] - q[i]) / (n[i+1] - n[i]) +
+            (n[i+1] - n[i] - d) * (q[i] - q[i-1]) / (n[i] - n[i-1]));
+}
+
+void quantile_sketch_add(QuantileSketch* qs, double x) {
+    if (!qs) return;
+
+    // first five observations are kept exactly
+    if (qs->count < 5) {
+        size_t i = qs->count++;
+        while (i > 0 && qs->q[i-1] > x) { qs->q[i] = qs->q[i-1]; i--; }
+        qs->q[i] = x;
+        return;
+    }
+
+    int k;
+    if (x < qs->q[0])       { qs->q[0] = x; k = 0; }
+    else if (x >= qs->q[4]) { qs->q[4] = x; k = 3; }
+    else {
+        k = 0;
+        while (k < 3 && x >= qs->q[k+1]) k++;
+    }
+    for (int i = k + 1; i < 5; ++i) qs->pos[i] += 1.0;
+    for (int i = 0; i < 5; ++i) qs->want[i] += qs->inc[i];
+    qs->count++;
+
+    // nudge the three middle markers toward their desired positions
+    for (int i = 1; i <= 3; ++i) {
+        double d = qs->want[i] - qs->pos[i];
+        if ((d >= 1.0 && qs->pos[i+1] - qs->pos[i] > 1.0) ||
+            (d <= -1.0 && qs->pos[i-1] - qs->pos[i] < -1.0)) {
+            double ds = (d > 0.0) ? 1.0 : -1.0;
+            double qp = p2_parabolic(qs, i, ds);
+            if (qs->q[i-1] < qp && qp < qs->q[i+1]) {
+                qs->q[i] = qp;
+            } else {
+                int j = i + (int)ds;
+                qs->q[i] += ds * (qs->q[j] - qs->q[i]) / (qs->pos[j] - qs->pos[i]);
+            }
+            qs->pos[i] += ds;
+        }
+    }
+}
+
+double quantile_sketch_get(const QuantileSketch* qs) {
+    if (!qs || qs->count == 0) return 0.0;
+    if (qs->count < 5) {
+        size_t idx = (size_t)floor(qs->p * (double)(qs->count - 1));
+        return qs->q[idx]; // q[] is kept sorted during warm-up
+    }
+    return qs->q[2];
+}
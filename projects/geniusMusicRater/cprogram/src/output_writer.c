@@ -0,0 +1,336 @@
+#include "output_writer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+// ---------- Buffer helpers ----------
+
+static int ensure(OutputWriter* w, size_t extra) {
+    if (w->error) return -1;
+    if (w->len + extra <= w->cap) return 0;
+    size_t newcap = w->cap ? w->cap : 4096;
+    while (newcap < w->len + extra) newcap *= 2;
+    unsigned char* nd = (unsigned char*)realloc(w->data, newcap);
+    if (!nd) { w->error = 1; return -1; }
+    w->data = nd;
+    w->cap = newcap;
+    return 0;
+}
+
+static void put(OutputWriter* w, const void* bytes, size_t n) {
+    if (ensure(w, n) != 0) return;
+    memcpy(w->data + w->len, bytes, n);
+    w->len += n;
+}
+
+static void put_byte(OutputWriter* w, unsigned char b) {
+    put(w, &b, 1);
+}
+
+static void put_str(OutputWriter* w, const char* s) {
+    put(w, s, strlen(s));
+}
+
+static void put_be(OutputWriter* w, uint64_t v, int bytes) {
+    unsigned char b[8];
+    for (int i = 0; i < bytes; ++i) b[i] = (unsigned char)(v >> (8 * (bytes - 1 - i)));
+    put(w, b, (size_t)bytes);
+}
+
+static void put_be_double(OutputWriter* w, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put_be(w, bits, 8);
+}
+
+// Insert bytes at pos (used to prepend container headers once counts are known).
+static void insert_at(OutputWriter* w, size_t pos, const unsigned char* bytes, size_t n) {
+    if (ensure(w, n) != 0) return;
+    memmove(w->data + pos + n, w->data + pos, w->len - pos);
+    memcpy(w->data + pos, bytes, n);
+    w->len += n;
+}
+
+// ---------- JSON ----------
+
+static int json_pretty(const OutputWriter* w) {
+    return w->format == OUTPUT_JSON && !w->is_inline[w->depth];
+}
+
+static void json_indent(OutputWriter* w, int depth) {
+    put_byte(w, '\n');
+    for (int i = 0; i < depth; ++i) put(w, "  ", 2);
+}
+
+static void json_escaped(OutputWriter* w, const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    put_byte(w, '"');
+    for (const unsigned char* p = (const unsigned char*)(s ? s : ""); *p; ++p) {
+        unsigned char c = *p;
+        switch (c) {
+            case '"':  put(w, "\\\"", 2); break;
+            case '\\': put(w, "\\\\", 2); break;
+            case '\n': put(w, "\\n", 2);  break;
+            case '\r': put(w, "\\r", 2);  break;
+            case '\t': put(w, "\\t", 2);  break;
+            case '\b': put(w, "\\b", 2);  break;
+            case '\f': put(w, "\\f", 2);  break;
+            default:
+                if (c < 0x20) {
+                    char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+                    put(w, esc, 6);
+                } else {
+                    put_byte(w, c); // UTF-8 passes through unchanged
+                }
+        }
+    }
+    put_byte(w, '"');
+}
+
+// separator + key for the next value at the current depth
+static void json_prefix(OutputWriter* w, const char* key) {
+    int d = w->depth;
+    if (d > 0) {
+        if (w->count[d] > 0) put_byte(w, ',');
+        if (json_pretty(w)) json_indent(w, d);
+        else if (w->count[d] > 0 && w->format == OUTPUT_JSON) put_byte(w, ' ');
+    }
+    if (d > 0 && w->is_map[d]) {
+        json_escaped(w, key);
+        put_str(w, w->format == OUTPUT_JSON ? ": " : ":");
+    }
+}
+
+// ---------- CBOR / MessagePack ----------
+
+static void cbor_head(OutputWriter* w, int major, uint64_t v) {
+    unsigned char m = (unsigned char)(major << 5);
+    if (v < 24)               put_byte(w, m | (unsigned char)v);
+    else if (v <= 0xFF)       { put_byte(w, m | 24); put_be(w, v, 1); }
+    else if (v <= 0xFFFF)     { put_byte(w, m | 25); put_be(w, v, 2); }
+    else if (v <= 0xFFFFFFFF) { put_byte(w, m | 26); put_be(w, v, 4); }
+    else                      { put_byte(w, m | 27); put_be(w, v, 8); }
+}
+
+static void bin_string(OutputWriter* w, const char* s) {
+    size_t n = s ? strlen(s) : 0;
+    if (w->format == OUTPUT_CBOR) {
+        cbor_head(w, 3, n);
+    } else {
+        if (n < 32)          put_byte(w, (unsigned char)(0xa0 | n));
+        else if (n <= 0xFF)  { put_byte(w, 0xd9); put_be(w, n, 1); }
+        else if (n <= 0xFFFF){ put_byte(w, 0xda); put_be(w, n, 2); }
+        else                 { put_byte(w, 0xdb); put_be(w, n, 4); }
+    }
+    if (n) put(w, s, n);
+}
+
+static void bin_prefix(OutputWriter* w, const char* key) {
+    if (w->depth > 0 && w->is_map[w->depth]) bin_string(w, key ? key : "");
+}
+
+// Container header with the final element count (shortest encoding).
+static size_t bin_container_head(const OutputWriter* w, int is_map, uint64_t n, unsigned char* out) {
+    size_t len = 0;
+    if (w->format == OUTPUT_CBOR) {
+        unsigned char m = (unsigned char)((is_map ? 5 : 4) << 5);
+        if (n < 24)          { out[len++] = m | (unsigned char)n; }
+        else if (n <= 0xFF)  { out[len++] = m | 24; out[len++] = (unsigned char)n; }
+        else if (n <= 0xFFFF){ out[len++] = m | 25; out[len++] = (unsigned char)(n >> 8); out[len++] = (unsigned char)n; }
+        else {
+            out[len++] = m | 26;
+            for (int i = 3; i >= 0; --i) out[len++] = (unsigned char)(n >> (8 * i));
+        }
+    } else {
+        if (n < 16) {
+            out[len++] = (unsigned char)((is_map ? 0x80 : 0x90) | n);
+        } else if (n <= 0xFFFF) {
+            out[len++] = is_map ? 0xde : 0xdc;
+            out[len++] = (unsigned char)(n >> 8);
+            out[len++] = (unsigned char)n;
+        } else {
+            out[len++] = is_map ? 0xdf : 0xdd;
+            for (int i = 3; i >= 0; --i) out[len++] = (unsigned char)(n >> (8 * i));
+        }
+    }
+    return len;
+}
+
+static int is_binary(const OutputWriter* w) {
+    return w->format == OUTPUT_CBOR || w->format == OUTPUT_MSGPACK;
+}
+
+// ---------- Public API ----------
+
+int output_format_from_name(const char* name, OutputFormat* out) {
+    if (!name || !out) return -1;
+    if      (strcmp(name, "json") == 0)    *out = OUTPUT_JSON;
+    else if (strcmp(name, "jsonl") == 0)   *out = OUTPUT_JSONL;
+    else if (strcmp(name, "cbor") == 0)    *out = OUTPUT_CBOR;
+    else if (strcmp(name, "msgpack") == 0) *out = OUTPUT_MSGPACK;
+    else return -2;
+    return 0;
+}
+
+void writer_init(OutputWriter* w, OutputFormat format) {
+    if (!w) return;
+    memset(w, 0, sizeof(*w));
+    w->format = format;
+}
+
+void writer_free(OutputWriter* w) {
+    if (!w) return;
+    free(w->data);
+    memset(w, 0, sizeof(*w));
+}
+
+void writer_reset(OutputWriter* w) {
+    if (!w) return;
+    w->len = 0;
+    w->depth = 0;
+    w->error = 0;
+    memset(w->count, 0, sizeof(w->count));
+}
+
+static void begin_container(OutputWriter* w, const char* key, int is_map) {
+    if (!w || w->error) return;
+    if (w->depth + 1 >= OUTPUT_MAX_DEPTH) { w->error = 1; return; }
+
+    int parent_inline = w->is_inline[w->depth];
+    if (is_binary(w)) {
+        bin_prefix(w, key);
+    } else {
+        json_prefix(w, key);
+        put_byte(w, is_map ? '{' : '[');
+    }
+    w->count[w->depth]++;
+    w->depth++;
+    w->count[w->depth] = 0;
+    w->is_map[w->depth] = is_map;
+    // pretty JSON keeps arrays (and anything inside them) on one line
+    w->is_inline[w->depth] = (w->format != OUTPUT_JSON) || parent_inline || !is_map;
+    w->head_pos[w->depth] = w->len;
+}
+
+static void end_container(OutputWriter* w, int is_map) {
+    if (!w || w->error) return;
+    if (w->depth <= 0 || w->is_map[w->depth] != is_map) { w->error = 1; return; }
+
+    int d = w->depth;
+    if (is_binary(w)) {
+        unsigned char head[8];
+        size_t n = bin_container_head(w, is_map, (uint64_t)w->count[d], head);
+        insert_at(w, w->head_pos[d], head, n);
+    } else {
+        if (w->count[d] > 0 && json_pretty(w)) json_indent(w, d - 1);
+        put_byte(w, is_map ? '}' : ']');
+    }
+    w->depth--;
+}
+
+void writer_begin_object(OutputWriter* w, const char* key) { begin_container(w, key, 1); }
+void writer_end_object(OutputWriter* w)                    { end_container(w, 1); }
+void writer_begin_array(OutputWriter* w, const char* key)  { begin_container(w, key, 0); }
+void writer_end_array(OutputWriter* w)                     { end_container(w, 0); }
+
+void writer_string(OutputWriter* w, const char* key, const char* value) {
+    if (!w || w->error) return;
+    if (is_binary(w)) { bin_prefix(w, key); bin_string(w, value); }
+    else              { json_prefix(w, key); json_escaped(w, value); }
+    w->count[w->depth]++;
+}
+
+void writer_double(OutputWriter* w, const char* key, double value, int decimals) {
+    if (!w || w->error) return;
+    if (is_binary(w)) {
+        bin_prefix(w, key);
+        put_byte(w, w->format == OUTPUT_CBOR ? 0xfb : 0xcb);
+        put_be_double(w, value);
+    } else {
+        json_prefix(w, key);
+        if (!isfinite(value)) {
+            put_str(w, "null"); // JSON has no NaN/Inf
+        } else {
+            char num[64];
+            if (decimals >= 0) snprintf(num, sizeof(num), "%.*f", decimals, value);
+            else               snprintf(num, sizeof(num), "%.17g", value);
+            put_str(w, num);
+        }
+    }
+    w->count[w->depth]++;
+}
+
+void writer_int(OutputWriter* w, const char* key, long long value) {
+    if (!w || w->error) return;
+    if (w->format == OUTPUT_CBOR) {
+        bin_prefix(w, key);
+        if (value >= 0) cbor_head(w, 0, (uint64_t)value);
+        else            cbor_head(w, 1, (uint64_t)(-1 - value));
+    } else if (w->format == OUTPUT_MSGPACK) {
+        bin_prefix(w, key);
+        if (value >= 0 && value < 128)      put_byte(w, (unsigned char)value);
+        else if (value < 0 && value >= -32) put_byte(w, (unsigned char)(0xe0 | (value + 32)));
+        else if (value >= 0) {
+            if (value <= 0xFF)            { put_byte(w, 0xcc); put_be(w, (uint64_t)value, 1); }
+            else if (value <= 0xFFFF)     { put_byte(w, 0xcd); put_be(w, (uint64_t)value, 2); }
+            else if (value <= 0xFFFFFFFFLL){ put_byte(w, 0xce); put_be(w, (uint64_t)value, 4); }
+            else                          { put_byte(w, 0xcf); put_be(w, (uint64_t)value, 8); }
+        } else {
+            if (value >= -128)            { put_byte(w, 0xd0); put_be(w, (uint64_t)value, 1); }
+            else if (value >= -32768)     { put_byte(w, 0xd1); put_be(w, (uint64_t)value, 2); }
+            else if (value >= -2147483648LL){ put_byte(w, 0xd2); put_be(w, (uint64_t)value, 4); }
+            else                          { put_byte(w, 0xd3); put_be(w, (uint64_t)value, 8); }
+        }
+    } else {
+        char num[32];
+        json_prefix(w, key);
+        snprintf(num, sizeof(num), "%lld", value);
+        put_str(w, num);
+    }
+    w->count[w->depth]++;
+}
+
+void writer_bool(OutputWriter* w, const char* key, int value) {
+    if (!w || w->error) return;
+    if (w->format == OUTPUT_CBOR)         { bin_prefix(w, key); put_byte(w, value ? 0xf5 : 0xf4); }
+    else if (w->format == OUTPUT_MSGPACK) { bin_prefix(w, key); put_byte(w, value ? 0xc3 : 0xc2); }
+    else                                  { json_prefix(w, key); put_str(w, value ? "true" : "false"); }
+    w->count[w->depth]++;
+}
+
+void writer_null(OutputWriter* w, const char* key) {
+    if (!w || w->error) return;
+    if (w->format == OUTPUT_CBOR)         { bin_prefix(w, key); put_byte(w, 0xf6); }
+    else if (w->format == OUTPUT_MSGPACK) { bin_prefix(w, key); put_byte(w, 0xc0); }
+    else                                  { json_prefix(w, key); put_str(w, "null"); }
+    w->count[w->depth]++;
+}
+
+int writer_end_record(OutputWriter* w) {
+    if (!w) return -1;
+    if (w->depth != 0) w->error = 1;
+    if (!w->error && !is_binary(w)) put_byte(w, '\n');
+    return w->error ? -1 : 0;
+}
+
+int writer_flush(const OutputWriter* w, FILE* f) {
+    if (!w || !f || w->error) return -1;
+    if (w->len && fwrite(w->data, 1, w->len, f) != w->len) return -2;
+    return fflush(f) == 0 ? 0 : -3;
+}
+
+void writer_fields(OutputWriter* w, const void* base, const FieldSpec* spec, size_t n) {
+    if (!w || !base || !spec) return;
+    const unsigned char* p = (const unsigned char*)base;
+    for (size_t i = 0; i < n; ++i) {
+        const void* field = p + spec[i].offset;
+        switch (spec[i].type) {
+            case FIELD_DOUBLE: writer_double(w, spec[i].key, *(const double*)field, spec[i].decimals); break;
+            case FIELD_INT:    writer_int(w, spec[i].key, *(const int*)field); break;
+            case FIELD_SIZE:   writer_int(w, spec[i].key, (long long)*(const size_t*)field); break;
+            case FIELD_STRING: writer_string(w, spec[i].key, (const char*)field); break;
+            case FIELD_BOOL:   writer_bool(w, spec[i].key, *(const int*)field); break;
+        }
+    }
+}
@@ -0,0 +1,190 @@
+#include "plan.h"
+#include "dsp.h"
+#include <string.h>
+#include <time.h>
+
+// ---------- Cost model ----------
+//
+// Seconds of work per second of audio at 44.1 kHz on the reference machine
+// (the one PLAN_PROBE_REF_SEC was measured on), all stages at full
+// resolution. Decimating the analysis rate by d divides the frame count by d;
+// YIN also shrinks its lag range, so melody goes with 1/d^2. Chroma decimates
+// internally to the same ~11 kHz rate, so it does not get cheaper.
+
+#define PLAN_COST_FIXED      0.0060   // stats, spectral, onset, key, loudness, beats, rhythm
+#define PLAN_COST_CHROMA     0.0040
+#define PLAN_COST_MELODY     0.1000
+#define PLAN_COST_STRUCTURE  0.0030
+#define PLAN_COST_DISSONANCE 0.0004
+
+#define PLAN_PROBE_FFT       1024
+#define PLAN_PROBE_RUNS      64
+#define PLAN_PROBE_REF_SEC   1.1e-3   // PLAN_PROBE_RUNS transforms, reference machine
+#define PLAN_MARGIN          0.05     // share of the budget kept in reserve
+#define PLAN_MAX_HOP_SCALE   16
+
+static const double STAGE_COST[PLAN_STAGES] = {
+    PLAN_COST_CHROMA, PLAN_COST_MELODY, PLAN_COST_STRUCTURE, PLAN_COST_DISSONANCE
+};
+
+// Degradation order: the most expensive, least audible losses first.
+// PLAN_STAGES stands for halving the analysis sample rate.
+static const int PLAN_LADDER[] = {
+    PLAN_MELODY, PLAN_STRUCTURE, PLAN_CHROMA, PLAN_MELODY, PLAN_DISSONANCE,
+    PLAN_STAGES,
+    PLAN_STRUCTURE, PLAN_MELODY, PLAN_CHROMA, PLAN_DISSONANCE,
+    PLAN_STAGES,
+    PLAN_STRUCTURE, PLAN_MELODY,
+};
+
+static DSP_THREAD_LOCAL AnalysisPlan* g_bound_plan = NULL;
+
+double analysis_plan_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void analysis_plan_init(AnalysisPlan* plan, double budget_sec, double start) {
+    if (!plan) return;
+    memset(plan, 0, sizeof(*plan));
+    plan->budget_sec = budget_sec > 0.0 ? budget_sec : 0.0;
+    plan->start = start;
+    plan->deadline = plan->budget_sec > 0.0 ? start + plan->budget_sec : 0.0;
+    plan->speed = 1.0;
+    plan->decimation = 1;
+    for (int s = 0; s < PLAN_STAGES; ++s) plan->stage[s].hop_scale = 1;
+}
+
+// Seconds per PLAN_PROBE_RUNS transforms relative to the reference machine;
+// best of three so a preempted run does not make the machine look slow.
+static double measure_speed(void) {
+    const FftPlan* fft = dsp_fft_plan(PLAN_PROBE_FFT);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * PLAN_PROBE_FFT);
+    if (!fft || !X) return 1.0;
+
+    double best = 1e30;
+    for (int rep = 0; rep < 3; ++rep) {
+        double t0 = analysis_plan_now();
+        for (int r = 0; r < PLAN_PROBE_RUNS; ++r) {
+            for (int i = 0; i < PLAN_PROBE_FFT; ++i) {
+                X[i].r = (double)((i * 7 + r) % 13) - 6.0;
+                X[i].i = 0.0;
+            }
+            dsp_fft(fft, X);
+        }
+        double t = analysis_plan_now() - t0;
+        if (t < best) best = t;
+    }
+    double speed = best / PLAN_PROBE_REF_SEC;
+    if (speed < 0.1) speed = 0.1;
+    if (speed > 50.0) speed = 50.0;
+    return speed;
+}
+
+static double stage_cost(const AnalysisPlan* plan, int stage, double duration_sec) {
+    double d = (double)plan->decimation;
+    double c = STAGE_COST[stage] / (double)plan->stage[stage].hop_scale;
+    if (stage == PLAN_MELODY) c /= d * d;
+    else if (stage != PLAN_CHROMA) c /= d;
+    return c * duration_sec * plan->speed;
+}
+
+static double fixed_cost(const AnalysisPlan* plan, double duration_sec) {
+    return PLAN_COST_FIXED / (double)plan->decimation * duration_sec * plan->speed;
+}
+
+// Predicted seconds for the mono stages; fixed = 0 leaves out the stages
+// that run before melody.
+static double predicted_cost(const AnalysisPlan* plan, double duration_sec,
+                             int fixed, int melody, int structure) {
+    double t = 0.0;
+    if (fixed) {
+        t += fixed_cost(plan, duration_sec);
+        t += stage_cost(plan, PLAN_CHROMA, duration_sec);
+        t += stage_cost(plan, PLAN_DISSONANCE, duration_sec);
+    }
+    if (melody) t += stage_cost(plan, PLAN_MELODY, duration_sec);
+    if (structure) t += stage_cost(plan, PLAN_STRUCTURE, duration_sec);
+    return t;
+}
+
+// Walk down the ladder until the prediction fits `available`; fixed = 0
+// restricts it to melody and structure.
+static void degrade(AnalysisPlan* plan, double duration_sec, double available, int max_decimation,
+                    int fixed, int melody, int structure) {
+    const size_t n = sizeof(PLAN_LADDER) / sizeof(PLAN_LADDER[0]);
+    for (size_t step = 0; step < n; ++step) {
+        if (predicted_cost(plan, duration_sec, fixed, melody, structure) <= available) break;
+        int s = PLAN_LADDER[step];
+        if (s == PLAN_STAGES) {
+            if (fixed && plan->decimation * 2 <= max_decimation) plan->decimation *= 2;
+            continue;
+        }
+        if (!fixed && s != PLAN_MELODY && s != PLAN_STRUCTURE) continue;
+        if ((s == PLAN_MELODY && !melody) || (s == PLAN_STRUCTURE && !structure)) continue;
+        if (plan->stage[s].hop_scale < PLAN_MAX_HOP_SCALE) plan->stage[s].hop_scale *= 2;
+    }
+}
+
+void analysis_plan_choose(AnalysisPlan* plan, double duration_sec, int max_decimation,
+                          int melody, int structure) {
+    if (!plan || plan->budget_sec <= 0.0 || duration_sec <= 0.0) return;
+    if (max_decimation < 1) max_decimation = 1;
+
+    plan->speed = measure_speed();
+    double available = plan->deadline - analysis_plan_now() - PLAN_MARGIN * plan->budget_sec;
+    degrade(plan, duration_sec, available, max_decimation, 1, melody, structure);
+}
+
+void analysis_plan_refine(AnalysisPlan* plan, double duration_sec, double elapsed_sec,
+                          int melody, int structure) {
+    if (!plan || plan->budget_sec <= 0.0 || duration_sec <= 0.0) return;
+
+    // the stages so far are the best calibration there is
+    double model = predicted_cost(plan, duration_sec, 1, 0, 0) / plan->speed;
+    if (model > 0.0 && elapsed_sec > 0.0) {
+        double speed = elapsed_sec / model;
+        if (speed < 0.1) speed = 0.1;
+        if (speed > 50.0) speed = 50.0;
+        plan->speed = speed;
+    }
+
+    plan->stage[PLAN_MELODY].hop_scale = 1;
+    plan->stage[PLAN_STRUCTURE].hop_scale = 1;
+    double now = analysis_plan_now();
+    double finish = plan->deadline - PLAN_MARGIN * plan->budget_sec;
+    degrade(plan, duration_sec, finish - now, plan->decimation, 0, melody, structure);
+
+    // melody runs first and leaves structure its predicted share
+    double structure_cost = structure ? stage_cost(plan, PLAN_STRUCTURE, duration_sec) : 0.0;
+    plan->stage[PLAN_MELODY].deadline = finish - structure_cost;
+    plan->stage[PLAN_STRUCTURE].deadline = finish;
+}
+
+AnalysisPlan* analysis_plan_bind(AnalysisPlan* plan) {
+    AnalysisPlan* prev = g_bound_plan;
+    g_bound_plan = plan;
+    return prev;
+}
+
+StagePlan* analysis_plan_stage(PlanStage stage) {
+    if (!g_bound_plan || stage < 0 || stage >= PLAN_STAGES) return NULL;
+    StagePlan* sp = &g_bound_plan->stage[stage];
+    if (sp->hop_scale < 1) sp->hop_scale = 1;
+    return sp;
+}
+
+int analysis_plan_expired(const StagePlan* sp) {
+    return sp && sp->deadline > 0.0 && analysis_plan_now() >= sp->deadline;
+}
+
+const char* analysis_plan_stage_name(PlanStage stage) {
+    switch (stage) {
+        case PLAN_CHROMA:     return "chroma";
+        case PLAN_MELODY:     return "melody";
+        case PLAN_STRUCTURE:  return "structure";
+        case PLAN_DISSONANCE: return "dissonance";
+        default:              return "unknown";
+    }
+}
@@ -1,107 +1,420 @@
 #include "production.h"
+#include "dsp.h"
+#include "fastmath.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
-// --- small FFT wrapper (Cooley-Tukey radix-2) ---
-typedef struct { double r, i; } Complex;
-static void fft(Complex* buf, int n) {
-    // Bit reversal
-    int j = 0;
-    for (int i = 0; i < n; ++i) {
-        if (i < j) { Complex tmp = buf[i]; buf[i] = buf[j]; buf[j] = tmp; }
-        int m = n >> 1;
-        while (j >= m && m >= 2) { j -= m; m >>= 1; }
-        j += m;
-    }
-    // Danielson-Lanczos
-    for (int m = 2; m <= n; m <<= 1) {
-        double theta = -2.0 * M_PI / m;
-        Complex wm = { cos(theta), sin(theta) };
-        for (int k = 0; k < n; k += m) {
-            Complex w = {1.0, 0.0};
-            for (int j = 0; j < m/2; ++j) {
-                Complex t = {
-                    w.r * buf[k+j+m/2].r - w.i * buf[k+j+m/2].i,
-                    w.r * buf[k+j+m/2].i + w.i * buf[k+j+m/2].r
-                };
-                Complex u = buf[k+j];
-                buf[k+j].r        = u.r + t.r;
-                buf[k+j].i        = u.i + t.i;
-                buf[k+j+m/2].r    = u.r - t.r;
-                buf[k+j+m/2].i    = u.i - t.i;
-                // update twiddle
-                double wr = w.r * wm.r - w.i * wm.i;
-                double wi = w.r * wm.i + w.i * wm.r;
-                w.r = wr; w.i = wi;
+int compute_production_features(const float* stereo, size_t frames, int sample_rate, int channels, ProductionFeatures* out) {
+    if (!stereo || frames == 0 || sample_rate <= 0 || !out) return -1;
+
+    ProductionAccumulator acc;
+    if (production_acc_init(&acc, sample_rate, channels, frames) != 0) return -1;
+    int rc = production_acc_push(&acc, stereo, frames, 0);
+    if (rc == 0) rc = production_acc_finish(&acc, out);
+    production_acc_free(&acc);
+    return rc;
+}
+
+void free_production_features(ProductionFeatures* pf) {
+    if (!pf) return;
+    free_loudness_result(&pf->loudness);
+    free_true_peak_result(&pf->true_peak);
+    free(pf->stereo.coherence);
+    pf->stereo.coherence = NULL;
+    pf->stereo.coherence_len = 0;
+}
+
+// ---------- Stereo image ----------
+
+static const double STEREO_BAND_EDGES[PRODUCTION_STEREO_BANDS - 1] = {150.0, 500.0, 2000.0, 6000.0};
+
+static int stereo_alloc(StereoAccumulator* st) {
+    const int N = PRODUCTION_STEREO_FFT;
+    st->fft = (DspComplex*)malloc(sizeof(DspComplex) * N);
+    st->buf = (float*)malloc(sizeof(float) * 2 * N);
+    st->head = (float*)malloc(sizeof(float) * 2 * (N - 1));
+    return (st->fft && st->buf && st->head) ? 0 : -1;
+}
+
+static int stereo_init(StereoAccumulator* st, int sample_rate) {
+    const int N = PRODUCTION_STEREO_FFT;
+    memset(st, 0, sizeof(*st));
+    st->plan = dsp_fft_plan(N);
+    st->window = dsp_window(DSP_HANN_PERIODIC, N);
+    if (!st->plan || !st->window) return -1;
+    st->band_first[0] = 1;
+    for (int b = 1; b < PRODUCTION_STEREO_BANDS; b++) {
+        int k = (int)ceil(STEREO_BAND_EDGES[b-1] * N / sample_rate);
+        if (k < st->band_first[b-1]) k = st->band_first[b-1];
+        if (k > N / 2) k = N / 2;
+        st->band_first[b] = k;
+    }
+    st->band_first[PRODUCTION_STEREO_BANDS] = N / 2;  // DC and Nyquist excluded
+    return stereo_alloc(st);
+}
+
+static void stereo_free(StereoAccumulator* st) {
+    free(st->fft);
+    free(st->buf);
+    free(st->head);
+    free(st->sec_lr);
+    free(st->sec_mag);
+    st->fft = NULL;
+    st->buf = st->head = NULL;
+    st->sec_lr = st->sec_mag = NULL;
+    st->sec_cap = 0;
+}
+
+static int stereo_reserve(StereoAccumulator* st, size_t seconds) {
+    if (seconds <= st->sec_cap) return 0;
+    size_t cap = st->sec_cap ? st->sec_cap : 64;
+    while (cap < seconds) cap *= 2;
+    double* a = (double*)realloc(st->sec_lr, sizeof(double) * cap);
+    if (a) st->sec_lr = a;
+    double* b = (double*)realloc(st->sec_mag, sizeof(double) * cap);
+    if (b) st->sec_mag = b;
+    if (!a || !b) return -1;
+    memset(st->sec_lr + st->sec_cap, 0, sizeof(double) * (cap - st->sec_cap));
+    memset(st->sec_mag + st->sec_cap, 0, sizeof(double) * (cap - st->sec_cap));
+    st->sec_cap = cap;
+    return 0;
+}
+
+// One frame of L,R pairs starting at absolute frame pos. With x = L + iR and
+// X = FFT(x): L[k] = (X[k] + conj X[N-k]) / 2, R[k] = (X[k] - conj X[N-k]) / 2i.
+static void stereo_frame(StereoAccumulator* st, const float* pairs, size_t pos, int sample_rate) {
+    const int N = PRODUCTION_STEREO_FFT;
+    DspComplex* X = st->fft;
+    for (int i = 0; i < N; i++) {
+        X[i].r = (double)pairs[2*i] * st->window[i];
+        X[i].i = (double)pairs[2*i+1] * st->window[i];
+    }
+    dsp_fft(st->plan, X);
+
+    double frame_lr = 0.0, frame_mag = 0.0;
+    for (int b = 0; b < PRODUCTION_STEREO_BANDS; b++) {
+        double ll = 0.0, rr = 0.0, lr = 0.0;
+        for (int k = st->band_first[b]; k < st->band_first[b+1]; k++) {
+            double ar = X[k].r, ai = X[k].i;
+            double br = X[N-k].r, bi = -X[N-k].i;        // conj X[N-k]
+            double Lr = 0.5 * (ar + br), Li = 0.5 * (ai + bi);
+            double Rr = 0.5 * (ai - bi), Ri = -0.5 * (ar - br);
+            double pl = Lr*Lr + Li*Li, pr = Rr*Rr + Ri*Ri;
+            ll += pl;
+            rr += pr;
+            lr += Lr*Rr + Li*Ri;                          // Re(L conj R)
+            frame_mag += sqrt(pl * pr);
+        }
+        st->ll[b] += ll;
+        st->rr[b] += rr;
+        st->lr[b] += lr;
+        frame_lr += lr;
+    }
+
+    size_t sec = (pos + N / 2) / (size_t)sample_rate;
+    if (stereo_reserve(st, sec + 1) == 0) {
+        st->sec_lr[sec] += frame_lr;
+        st->sec_mag[sec] += frame_mag;
+    }
+    st->frames++;
+}
+
+// Feed count frames (channels 0 and 1 of an interleaved block with `stride`
+// values per frame) starting at absolute frame first_frame.
+static void stereo_push(StereoAccumulator* st, const float* x, size_t count, int stride,
+                        size_t first_frame, int sample_rate) {
+    const size_t N = PRODUCTION_STEREO_FFT;
+    if (!st->started || first_frame != st->buf_start + st->buf_len) {
+        // first block of this accumulator (or a gap): restart the frame buffer
+        if (!st->started) {
+            st->first = first_frame;
+            st->started = 1;
+        }
+        st->buf_start = first_frame;
+        st->buf_len = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const float* f = x + i * stride;
+        size_t abs_frame = first_frame + i;
+        if (abs_frame - st->first == st->head_len && st->head_len < N - 1) {
+            st->head[2*st->head_len] = f[0];
+            st->head[2*st->head_len+1] = f[1];
+            st->head_len++;
+        }
+        st->buf[2*st->buf_len] = f[0];
+        st->buf[2*st->buf_len+1] = f[1];
+        st->buf_len++;
+        if (st->buf_len < N) continue;
+
+        // full: transform if the buffer starts on the hop grid, then advance
+        // to the next grid position
+        size_t off = st->buf_start % PRODUCTION_STEREO_HOP;
+        if (off == 0) stereo_frame(st, st->buf, st->buf_start, sample_rate);
+        size_t drop = PRODUCTION_STEREO_HOP - off;
+        memmove(st->buf, st->buf + 2 * drop, sizeof(float) * 2 * (N - drop));
+        st->buf_start += drop;
+        st->buf_len -= drop;
+    }
+}
+
+// dst covers the frames just before src: complete the frames that straddle
+// the boundary, then continue from src's pending samples.
+static void stereo_merge(StereoAccumulator* dst, const StereoAccumulator* src, int sample_rate) {
+    if (!src->started) return;
+    int stitched = (dst->started && dst->buf_start + dst->buf_len == src->first);
+    if (stitched) stereo_push(dst, src->head, src->head_len, 2, src->first, sample_rate);
+    if (!stitched || src->buf_start + src->buf_len > src->first + src->head_len) {
+        memcpy(dst->buf, src->buf, sizeof(float) * 2 * src->buf_len);
+        dst->buf_start = src->buf_start;
+        dst->buf_len = src->buf_len;
+        if (!dst->started) {
+            dst->first = src->first;
+            dst->started = 1;
+        }
+    }
+    for (int b = 0; b < PRODUCTION_STEREO_BANDS; b++) {
+        dst->ll[b] += src->ll[b];
+        dst->rr[b] += src->rr[b];
+        dst->lr[b] += src->lr[b];
+    }
+    if (stereo_reserve(dst, src->sec_cap) == 0) {
+        for (size_t i = 0; i < src->sec_cap; i++) {
+            dst->sec_lr[i] += src->sec_lr[i];
+            dst->sec_mag[i] += src->sec_mag[i];
+        }
+    }
+    dst->frames += src->frames;
+}
+
+static void stereo_finish(const StereoAccumulator* st, size_t frames, int sample_rate, StereoImage* out) {
+    memset(out, 0, sizeof(*out));
+    if (st->frames == 0) return;
+    const double bin_hz = (double)sample_rate / PRODUCTION_STEREO_FFT;
+
+    double total = 0.0, side = 0.0;
+    for (int b = 0; b < PRODUCTION_STEREO_BANDS; b++) total += st->ll[b] + st->rr[b];
+    for (int b = 0; b < PRODUCTION_STEREO_BANDS; b++) {
+        StereoBand* band = &out->bands[b];
+        double sum = st->ll[b] + st->rr[b];
+        // |M|^2 + |S|^2 = (|L|^2 + |R|^2) / 2, |S|^2 = (|L|^2 + |R|^2 - 2 Re(L conj R)) / 4
+        double s = 0.25 * (sum - 2.0 * st->lr[b]);
+        band->low_hz = st->band_first[b] * bin_hz;
+        band->high_hz = st->band_first[b+1] * bin_hz;
+        band->energy_share = (total > 1e-20 ? sum / total : 0.0);
+        band->side_ratio = (sum > 1e-20 ? s / (0.5 * sum) : 0.0);
+        band->correlation = (st->ll[b] > 1e-20 && st->rr[b] > 1e-20
+                             ? st->lr[b] / sqrt(st->ll[b] * st->rr[b]) : 0.0);
+        side += s;
+    }
+    out->side_ratio = (total > 1e-20 ? side / (0.5 * total) : 0.0);
+
+    size_t seconds = (frames + (size_t)sample_rate - 1) / (size_t)sample_rate;
+    if (seconds > st->sec_cap) seconds = st->sec_cap;
+    double lr = 0.0, mag = 0.0;
+    out->coherence = (float*)malloc(sizeof(float) * (seconds ? seconds : 1));
+    for (size_t i = 0; i < seconds; i++) {
+        lr += st->sec_lr[i];
+        mag += st->sec_mag[i];
+        if (out->coherence) {
+            out->coherence[i] = (float)(st->sec_mag[i] > 1e-20 ? st->sec_lr[i] / st->sec_mag[i] : 0.0);
+        }
+    }
+    if (out->coherence) out->coherence_len = seconds;
+    out->phase_coherence = (mag > 1e-20 ? lr / mag : 0.0);
+    out->valid = 1;
+}
+
+// ---------- Incremental accumulation ----------
+
+int production_acc_init(ProductionAccumulator* acc, int sample_rate, int channels, size_t expected_frames) {
+    if (!acc || sample_rate <= 0 || channels <= 0) return -1;
+    memset(acc, 0, sizeof(*acc));
+    acc->sample_rate = sample_rate;
+    acc->channels = channels;
+    acc->expected_frames = expected_frames;
+
+    // --- Spectral Balance + Masking Index windows (evenly spread) ---
+    int N = 4096; // FFT size
+    while (N > 2 && (size_t)N > expected_frames) N >>= 1; // fallback for very short files
+    acc->fft_size = N;
+    acc->has_loudness = (loudness_meter_init(&acc->loudness, sample_rate, channels, expected_frames) == 0);
+    acc->has_true_peak = (true_peak_init(&acc->true_peak, sample_rate, channels, expected_frames) == 0);
+    if (channels >= 2) {
+        acc->has_stereo = (stereo_init(&acc->stereo, sample_rate) == 0);
+        if (!acc->has_stereo) stereo_free(&acc->stereo);
+    }
+    if (expected_frames < (size_t)N) return 0;
+
+    for (int w = 0; w < PRODUCTION_WINDOWS; w++) {
+        size_t start = (size_t)((expected_frames - N) * (w / (double)(PRODUCTION_WINDOWS - 1)));
+        if (start + N > expected_frames) break;
+        acc->window_start[acc->window_count++] = start;
+    }
+    acc->windows = (double*)calloc((size_t)acc->window_count * N, sizeof(double));
+    if (!acc->windows) acc->window_count = 0;
+    acc->owns_windows = 1;
+    return 0;
+}
+
+int production_acc_push(ProductionAccumulator* acc, const float* interleaved, size_t count, size_t first_frame) {
+    if (!acc || !interleaved) return -1;
+    if (count == 0) return 0;
+    int channels = acc->channels;
+
+    // --- RMS + Peak ---
+    size_t total_samples = count * channels;
+    for (size_t i=0; i<total_samples; i++) {
+        double x = (double)interleaved[i];
+        acc->sumsq += x*x;
+        if (fabs(x) > acc->peak) acc->peak = fabs(x);
+    }
+
+    // --- Stereo Width sums ---
+    if (channels >= 2) {
+        for (size_t i=0; i<count; i++) {
+            double L=(double)interleaved[i*channels+0];
+            double R=(double)interleaved[i*channels+1];
+            acc->sumL+=L; acc->sumR+=R; acc->sumL2+=L*L; acc->sumR2+=R*R; acc->sumLR+=L*R;
+        }
+    }
+
+    // --- Stereo transform over the whole track ---
+    if (acc->has_stereo) stereo_push(&acc->stereo, interleaved, count, channels, first_frame, acc->sample_rate);
+
+    // --- Mono mix of the frames that fall inside an analysis window ---
+    size_t end = first_frame + count;
+    int N = acc->fft_size;
+    for (int w = 0; w < acc->window_count; w++) {
+        size_t ws = acc->window_start[w];
+        size_t lo = ws > first_frame ? ws : first_frame;
+        size_t hi = ws + N < end ? ws + N : end;
+        double* dst = acc->windows + (size_t)w * N;
+        for (size_t f = lo; f < hi; f++) {
+            double sample = 0.0;
+            for (int c = 0; c < channels; c++) {
+                sample += interleaved[(f - first_frame) * channels + c];
             }
+            dst[f - ws] = sample / channels;
+        }
+    }
+
+    // --- K-weighted loudness ---
+    if (acc->has_loudness && loudness_meter_push(&acc->loudness, interleaved, count, first_frame) != 0) return -1;
+
+    // --- 4x oversampled true peak ---
+    if (acc->has_true_peak && true_peak_push(&acc->true_peak, interleaved, count, first_frame) != 0) return -1;
+
+    acc->frames += count;
+    return 0;
+}
+
+int production_acc_fork(const ProductionAccumulator* parent, ProductionAccumulator* child) {
+    *child = *parent;
+    child->frames = 0;
+    child->sumsq = child->peak = 0.0;
+    child->sumL = child->sumR = child->sumL2 = child->sumR2 = child->sumLR = 0.0;
+    child->owns_windows = 0;
+    child->has_loudness = 0;
+    child->has_true_peak = 0;
+    if (parent->has_loudness) {
+        if (loudness_meter_fork(&parent->loudness, &child->loudness, parent->expected_frames) != 0) return -1;
+        child->has_loudness = 1;
+    }
+    if (parent->has_true_peak) {
+        if (true_peak_fork(&parent->true_peak, &child->true_peak, parent->expected_frames) != 0) return -1;
+        child->has_true_peak = 1;
+    }
+    child->has_stereo = 0;
+    if (parent->has_stereo) {
+        StereoAccumulator* st = &child->stereo;
+        memset(st, 0, sizeof(*st));
+        st->plan = parent->stereo.plan;
+        st->window = parent->stereo.window;
+        memcpy(st->band_first, parent->stereo.band_first, sizeof(st->band_first));
+        if (stereo_alloc(st) != 0) {
+            stereo_free(st);
+            return -1;
         }
+        child->has_stereo = 1;
     }
+    return 0;
 }
 
-int compute_production_features(const float* stereo, size_t frames, int sample_rate, int channels, ProductionFeatures* out) {
-    if (!stereo || frames == 0 || sample_rate <= 0 || !out) return -1;
+void production_acc_merge(ProductionAccumulator* dst, const ProductionAccumulator* src) {
+    dst->frames += src->frames;
+    dst->sumsq += src->sumsq;
+    if (src->peak > dst->peak) dst->peak = src->peak;
+    dst->sumL += src->sumL;
+    dst->sumR += src->sumR;
+    dst->sumL2 += src->sumL2;
+    dst->sumR2 += src->sumR2;
+    dst->sumLR += src->sumLR;
+    if (dst->has_loudness && src->has_loudness) loudness_meter_merge(&dst->loudness, &src->loudness);
+    if (dst->has_true_peak && src->has_true_peak) true_peak_merge(&dst->true_peak, &src->true_peak);
+    if (dst->has_stereo && src->has_stereo) stereo_merge(&dst->stereo, &src->stereo, dst->sample_rate);
+}
+
+int production_acc_finish(ProductionAccumulator* acc, ProductionFeatures* out) {
+    if (!acc || !out || acc->frames == 0) return -1;
     memset(out, 0, sizeof(*out));
+    size_t frames = acc->frames;
+    int channels = acc->channels;
+    int sample_rate = acc->sample_rate;
 
     // --- RMS + Peak ---
-    double sumsq = 0.0, peak = 0.0;
     size_t total_samples = frames * channels;
-    for (size_t i=0; i<total_samples; i++) {
-        double x = (double)stereo[i];
-        sumsq += x*x;
-        if (fabs(x) > peak) peak = fabs(x);
+    double rms = (total_samples? sqrt(acc->sumsq/total_samples) : 0.0);
+    double peak = acc->peak;
+    if (acc->has_loudness && loudness_meter_finish(&acc->loudness, &out->loudness) == 0) {
+        out->loudness_db = out->loudness.integrated_lufs;
+    } else {
+        out->loudness_db = (rms>1e-12 ? 20.0*log10(rms) : -120.0); // more than 8 channels
+    }
+    // intersample overs count: the peak a DAC reconstructs, not the largest sample
+    if (acc->has_true_peak && true_peak_finish(&acc->true_peak, &out->true_peak) == 0) {
+        double tp = pow(10.0, out->true_peak.true_peak_dbtp / 20.0);
+        if (tp > peak) peak = tp;
     }
-    double rms = (total_samples? sqrt(sumsq/total_samples) : 0.0);
-    out->loudness_db = (rms>1e-12 ? 20.0*log10(rms) : -120.0);
     out->dynamic_range_db = (rms>1e-12 && peak>1e-12? 20.0*log10(peak/rms) : 0.0);
 
     // --- Stereo Width ---
     if (channels >= 2) {
-        double sumL=0,sumR=0,sumL2=0,sumR2=0,sumLR=0;
-        for (size_t i=0; i<frames; i++) {
-            double L=(double)stereo[i*channels+0];
-            double R=(double)stereo[i*channels+1];
-            sumL+=L; sumR+=R; sumL2+=L*L; sumR2+=R*R; sumLR+=L*R;
-        }
-        double meanL=sumL/frames, meanR=sumR/frames;
-        double cov=(sumLR/frames) - (meanL*meanR);
-        double varL=(sumL2/frames) - (meanL*meanL);
-        double varR=(sumR2/frames) - (meanR*meanR);
+        double meanL=acc->sumL/frames, meanR=acc->sumR/frames;
+        double cov=(acc->sumLR/frames) - (meanL*meanR);
+        double varL=(acc->sumL2/frames) - (meanL*meanL);
+        double varR=(acc->sumR2/frames) - (meanR*meanR);
         out->stereo_width=(varL>1e-12 && varR>1e-12? cov/(sqrt(varL)*sqrt(varR)):0.0);
     } else {
         out->stereo_width = 1.0; // mono
     }
+    if (acc->has_stereo) stereo_finish(&acc->stereo, frames, sample_rate, &out->stereo);
 
-    // --- Spectral Balance (FFT on first chunk, mono-mix of L+R) ---
-        // --- Spectral Balance + Masking Index (multi-window average) ---
-    int N = 4096; // FFT size
-    int numWindows = 10;
-    if ((size_t)N > frames) N = (int)frames; // fallback for very short files
+    // --- Spectral Balance + Masking Index (multi-window average) ---
+    int N = acc->fft_size;
+    int numWindows = acc->window_count;
+
+    const FftPlan* plan = dsp_fft_plan(N);
+    const double* hannw = dsp_window(DSP_HANN_SYMMETRIC, N);
+    DspComplex* bufc = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * N);
+    if (!plan || !hannw || !bufc) numWindows = 0;
 
     double balanceSum = 0.0;
     double flatnessSum = 0.0;
     int validWindows = 0;
+    const int fast = fast_math_enabled();
 
     for (int w = 0; w < numWindows; w++) {
-        size_t start = (size_t)((frames - N) * (w / (double)(numWindows - 1)));
-        if (start + N > frames) break;
-
-        Complex* bufc = (Complex*)malloc(sizeof(Complex) * N);
-        if (!bufc) break;
+        // windows past the end (stream shorter than announced) were never filled
+        if (acc->window_start[w] + N > frames) break;
 
-        // Build mono window with Hann
+        const double* mono = acc->windows + (size_t)w * N;
         for (int i = 0; i < N; i++) {
-            double sample = 0.0;
-            for (int c = 0; c < channels; c++) {
-                sample += stereo[(start + i) * channels + c];
-            }
-            sample /= channels;
-            double wHann = 0.5 * (1.0 - cos(2 * M_PI * i / (N - 1)));
-            bufc[i].r = sample * wHann;
+            bufc[i].r = mono[i] * hannw[i];
             bufc[i].i = 0.0;
         }
 
-        fft(bufc, N);
+        dsp_fft(plan, bufc);
 
         double lowE = 0.0, highE = 0.0;
         double sumLin = 0.0;
@@ -116,7 +429,7 @@ int compute_production_features(const float* stereo, size_t frames, int sample_r
             else if (freq > 2000.0) highE += psd;
 
             sumLin += psd;
-            sumLog += log(psd);
+            sumLog += (fast ? fm_log(psd) : log(psd));
             bins++;
         }
 
@@ -126,7 +439,7 @@ int compute_production_features(const float* stereo, size_t frames, int sample_r
             double bal = (denom > 1e-12 ? lowE / denom : 0.5);
 
             // flatness ratio
-            double geoMean = exp(sumLog / bins);
+            double geoMean = (fast ? fm_exp(sumLog / bins) : exp(sumLog / bins));
             double arithMean = sumLin / bins;
             double flatness = (arithMean > 1e-15 ? geoMean / arithMean : 0.0);
 
@@ -134,8 +447,6 @@ int compute_production_features(const float* stereo, size_t frames, int sample_r
             flatnessSum += flatness;
             validWindows++;
         }
-
-        free(bufc);
     }
 
     if (validWindows > 0) {
@@ -147,4 +458,17 @@ int compute_production_features(const float* stereo, size_t frames, int sample_r
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+void production_acc_free(ProductionAccumulator* acc) {
+    if (!acc) return;
+    if (acc->owns_windows) free(acc->windows);
+    acc->windows = NULL;
+    if (acc->has_loudness) loudness_meter_free(&acc->loudness);
+    acc->has_loudness = 0;
+    if (acc->has_true_peak) true_peak_free(&acc->true_peak);
+    acc->has_true_peak = 0;
+    if (acc->has_stereo) stereo_free(&acc->stereo);
+    acc->has_stereo = 0;
+    acc->window_count = 0;
+}
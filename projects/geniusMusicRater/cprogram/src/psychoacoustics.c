@@ -1,22 +1,16 @@
 #include "psychoacoustics.h"
+#include "order_stats.h"
+#include "dsp.h"
+#include "plan.h"
+#include "spectral_kernel.h"
+#include "fastmath.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
-
-static int cmp_double(const void* a, const void* b) {
-    double da = *(const double*)a;
-    double db = *(const double*)b;
-    return (da > db) - (da < db);
-}
-
-// --- Helper: percentile ---
-static double percentile(double* arr, size_t n, double perc) {
-    if (n == 0) return 0.0;
-    size_t idx = (size_t)floor(perc * (n-1));
-    if (idx >= n) idx = n-1;
-    return arr[idx];
-}
+#ifdef DSP_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 // --- Helper: simple A-weighting function (approximate response) ---
 static double a_weight(double f) {
@@ -26,92 +20,308 @@ static double a_weight(double f) {
     return den>0 ? num/den : 0.0;
 }
 
+// ---------- Sensory dissonance (Sethares / Plomp-Levelt) ----------
+
+#define PSY_MAX_SPECTRAL_FRAMES 1024   // long tracks: every k-th frame gets the peak analysis
+#define PSY_PEAK_FLOOR   0.003         // peaks below -50 dB of the frame maximum are ignored
+#define PSY_SIDELOBE_RATIO 20.0        // 26 dB
+#define PSY_PEAK_FMIN    20.0
+#define PSY_PEAK_FMAX    10000.0
+#define PSY_DISSONANCE_SCALE 0.25      // tanh mapping of the mean per-frame values to [0,1]
+#define PSY_ROUGHNESS_SCALE  0.15
+
+// Pair curve d(x) = exp(-b1 x) - exp(-b2 x) with x = s * (f2 - f1) and
+// s = D_STAR / (S1 * f1 + S2): peaks near a quarter critical band apart; by
+// x = 2.5 it is below 0.1% of its maximum, so farther pairs are skipped.
+#define SETHARES_B1 3.5
+#define SETHARES_B2 5.75
+#define SETHARES_D_STAR 0.24
+#define SETHARES_S1 0.0207
+#define SETHARES_S2 18.96
+#define SETHARES_X_MAX 2.5
+
+typedef struct {
+    double* freq;       // peak frequencies, ascending
+    double* amp;        // linear amplitudes relative to the frame maximum
+    double* x;          // per candidate pair: scaled frequency distance
+    double* amin;       //   min(a1, a2)  (dissonance weight)
+    double* aprod;      //   a1 * a2      (roughness weight)
+    size_t peak_cap, pair_cap;
+} PairScratch;
+
+static int reserve(double** p, size_t n) {
+    double* q = (double*)realloc(*p, sizeof(double) * n);
+    if (!q) return -1;
+    *p = q;
+    return 0;
+}
+
+#ifdef DSP_HAVE_SSE2
+// exp(y) for y in [-700, 0]: 2^n * 2^f, 2^f = exp(f ln2) by a degree-7
+// polynomial (relative error < 3e-6, far below the model's own accuracy)
+static inline __m128d exp_neg_pd(__m128d y) {
+    const __m128d log2e = _mm_set1_pd(1.4426950408889634);
+    __m128d t = _mm_mul_pd(y, log2e);
+    __m128i ni = _mm_cvttpd_epi32(t);                 // trunc toward zero
+    __m128d f = _mm_mul_pd(_mm_sub_pd(t, _mm_cvtepi32_pd(ni)), _mm_set1_pd(0.6931471805599453));
+    __m128d p = _mm_set1_pd(1.0 / 5040.0);
+    p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(1.0 / 720.0));
+    p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(1.0 / 120.0));
+    p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(1.0 / 24.0));
+    p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(1.0 / 6.0));
+    p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(0.5));
+    p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(1.0));
+    p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(1.0));
+    // 2^n from the exponent bits: [n0, n1] -> 64-bit lanes (n + 1023) << 52
+    __m128i n64 = _mm_shuffle_epi32(ni, _MM_SHUFFLE(1, 1, 0, 0));
+    n64 = _mm_slli_epi64(_mm_add_epi32(n64, _mm_set1_epi32(1023)), 52);
+    return _mm_mul_pd(p, _mm_castsi128_pd(n64));
+}
+#endif
+
+// Sum amin * d(x) and aprod * d(x) over a batch of candidate pairs.
+static void pair_curve_sums(const PairScratch* ps, size_t n, double* diss, double* rough) {
+    size_t i = 0;
+    double sd = 0.0, sr = 0.0;
+#ifdef DSP_HAVE_SSE2
+    const __m128d nb1 = _mm_set1_pd(-SETHARES_B1), nb2 = _mm_set1_pd(-SETHARES_B2);
+    __m128d vd = _mm_setzero_pd(), vr = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(ps->x + i);
+        __m128d d = _mm_sub_pd(exp_neg_pd(_mm_mul_pd(nb1, x)), exp_neg_pd(_mm_mul_pd(nb2, x)));
+        vd = _mm_add_pd(vd, _mm_mul_pd(d, _mm_loadu_pd(ps->amin + i)));
+        vr = _mm_add_pd(vr, _mm_mul_pd(d, _mm_loadu_pd(ps->aprod + i)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, vd); sd = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, vr); sr = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++) {
+        double d = exp(-SETHARES_B1 * ps->x[i]) - exp(-SETHARES_B2 * ps->x[i]);
+        sd += d * ps->amin[i];
+        sr += d * ps->aprod[i];
+    }
+    *diss = sd;
+    *rough = sr;
+}
+
+/**
+ * Dissonance and roughness of one magnitude spectrum. Peaks are found in
+ * ascending frequency, so for each peak a forward sweep stops at the first
+ * partner beyond SETHARES_X_MAX: the pair count grows with peak density, not
+ * with the square of the peak count. Dissonance weights pairs by the smaller
+ * amplitude (Sethares), roughness by the product (energy weighting); both
+ * are normalised so they do not depend on level or on the number of peaks.
+ */
+static int frame_dissonance(const double* mag, int n_fft, int sr, PairScratch* ps,
+                            double* diss, double* rough) {
+    int kmin = (int)ceil(PSY_PEAK_FMIN * n_fft / sr);
+    int kmax = (int)floor(PSY_PEAK_FMAX * n_fft / sr);
+    if (kmin < 3) kmin = 3;
+    if (kmax > n_fft / 2 - 3) kmax = n_fft / 2 - 3;
+
+    double peak_max = 0.0;
+    for (int k = kmin; k <= kmax; k++) if (mag[k] > peak_max) peak_max = mag[k];
+    if (peak_max <= 1e-9) return 0;   // silent frame
+    double floor_mag = PSY_PEAK_FLOOR * peak_max;
+
+    size_t np = 0;
+    for (int k = kmin; k <= kmax; k++) {
+        double m = mag[k];
+        if (m < floor_mag || m <= mag[k-1] || m < mag[k+1]) continue;
+        // Hann sidelobes (-31 dB) within three bins of a main lobe are not partials
+        int lobe = 0;
+        for (int j = k - 3; j <= k + 3; j++) {
+            if (mag[j] > PSY_SIDELOBE_RATIO * m) { lobe = 1; break; }
+        }
+        if (lobe) continue;
+        if (np == ps->peak_cap) {
+            size_t cap = ps->peak_cap ? ps->peak_cap * 2 : 256;
+            if (reserve(&ps->freq, cap) != 0 || reserve(&ps->amp, cap) != 0) return -1;
+            ps->peak_cap = cap;
+        }
+        // parabolic interpolation on log magnitude
+        double a, b, c;
+        if (fast_math_enabled()) {
+            a = fm_log(mag[k-1] + 1e-12); b = fm_log(m); c = fm_log(mag[k+1] + 1e-12);
+        } else {
+            a = log(mag[k-1] + 1e-12); b = log(m); c = log(mag[k+1] + 1e-12);
+        }
+        double den = a - 2.0 * b + c;
+        double off = (fabs(den) > 1e-12 ? 0.5 * (a - c) / den : 0.0);
+        ps->freq[np] = (k + off) * sr / (double)n_fft;
+        ps->amp[np] = m / peak_max;
+        np++;
+    }
+    if (np < 2) return 0;
+
+    double amp_sum = 0.0, energy = 0.0;
+    for (size_t i = 0; i < np; i++) {
+        amp_sum += ps->amp[i];
+        energy += ps->amp[i] * ps->amp[i];
+    }
+
+    size_t n_pairs = 0;
+    for (size_t i = 0; i + 1 < np; i++) {
+        double f1 = ps->freq[i], a1 = ps->amp[i];
+        double s = SETHARES_D_STAR / (SETHARES_S1 * f1 + SETHARES_S2);
+        for (size_t j = i + 1; j < np; j++) {
+            double x = s * (ps->freq[j] - f1);
+            if (x > SETHARES_X_MAX) break;
+            if (n_pairs == ps->pair_cap) {
+                size_t cap = ps->pair_cap ? ps->pair_cap * 2 : 1024;
+                if (reserve(&ps->x, cap) != 0 || reserve(&ps->amin, cap) != 0 ||
+                    reserve(&ps->aprod, cap) != 0) return -1;
+                ps->pair_cap = cap;
+            }
+            double a2 = ps->amp[j];
+            ps->x[n_pairs] = x;
+            ps->amin[n_pairs] = (a1 < a2 ? a1 : a2);
+            ps->aprod[n_pairs] = a1 * a2;
+            n_pairs++;
+        }
+    }
+
+    double d = 0.0, r = 0.0;
+    pair_curve_sums(ps, n_pairs, &d, &r);
+    *diss = d / amp_sum;
+    *rough = r / energy;
+    return 1;
+}
+
+// ---------- Frame levels ----------
+
+static size_t level_frame_count(size_t frames) {
+    if (frames <= (size_t)PSY_LEVEL_WIN) return 1;
+    return 1 + (frames - (size_t)PSY_LEVEL_WIN) / (size_t)PSY_LEVEL_HOP;
+}
+
+// RMS of level frame f (stored in *rms) and its level in dB.
+static double level_frame_db(const float* mono, size_t frames, size_t f, int fast, double* rms) {
+    size_t off = f * (size_t)PSY_LEVEL_HOP;
+    size_t wlen = PSY_LEVEL_WIN;
+    if (off + wlen > frames) wlen = (off < frames ? frames - off : 0);
+    if (wlen == 0) { *rms = 0.0; return -120.0; }
+
+    long double acc = 0.0L;
+    for (size_t i = 0; i < wlen; ++i) {
+        long double v = mono[off + i];
+        acc += v * v;
+    }
+    double r = sqrt((double)(acc / (long double)wlen));
+    *rms = r;
+    return 20.0 * (fast ? fm_log10(r + 1e-12) : log10(r + 1e-12));
+}
+
+int psy_frame_levels_db(const float* mono, size_t frames, double** out_db, size_t* out_n) {
+    if (!mono || frames == 0 || !out_db || !out_n) return -1;
+    size_t n = level_frame_count(frames);
+    double* db = (double*)malloc(sizeof(double) * n);
+    if (!db) return -2;
+    const int fast = fast_math_enabled();
+    double r;
+    for (size_t f = 0; f < n; ++f) db[f] = level_frame_db(mono, frames, f, fast, &r);
+    *out_db = db;
+    *out_n = n;
+    return 0;
+}
+
+double psy_dynamic_range(const double* db, size_t n) {
+    if (!db || n == 0) return 0.0;
+    double* copy = (double*)malloc(n * sizeof(double));
+    if (!copy) return 0.0;
+    memcpy(copy, db, n * sizeof(double));
+    double p05 = percentile_select(copy, n, 0.05);
+    double p95 = percentile_select(copy, n, 0.95);
+    free(copy);
+    return p95 - p05;
+}
+
 int compute_psychoacoustics(const float* mono, size_t frames, int sr, PsychoacousticFeatures* out) {
+    return compute_psychoacoustics_loudness(mono, frames, sr, NULL, out);
+}
+
+int compute_psychoacoustics_loudness(const float* mono, size_t frames, int sr,
+                                     const LoudnessResult* loudness, PsychoacousticFeatures* out) {
     if (!mono || !out || frames == 0 || sr <= 0) return -1;
 
     // Frame parameters (psychoacoustically reasonable and efficient)
-    const int win = 4096;
-    const int hop = 2048;
-
-    size_t n_frames;
-    if (frames <= (size_t)win) n_frames = 1;
-    else n_frames = 1 + (frames - (size_t)win) / (size_t)hop;
+    const int win = PSY_LEVEL_WIN;
+    const int hop = PSY_LEVEL_HOP;
+    size_t n_frames = level_frame_count(frames);
 
     double* rms = (double*)calloc(n_frames, sizeof(double));
     double* rms_db = (double*)calloc(n_frames, sizeof(double));
     if (!rms || !rms_db) { free(rms); free(rms_db); return -2; }
 
+    // The same frames feed the peak analysis; beyond PSY_MAX_SPECTRAL_FRAMES
+    // frames only every stride-th one is transformed; a budget plan widens
+    // the stride further.
+    StagePlan* budget = analysis_plan_stage(PLAN_DISSONANCE);
+    size_t stride = (n_frames + PSY_MAX_SPECTRAL_FRAMES - 1) / PSY_MAX_SPECTRAL_FRAMES;
+    if (budget) stride *= (size_t)budget->hop_scale;
+    const FftPlan* plan = dsp_fft_plan(win);
+    const double* hann = dsp_window(DSP_HANN_PERIODIC, win);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * win);
+    double* mag = (double*)dsp_scratch(DSP_SCRATCH_MAG, sizeof(double) * 2 * (win / 2 + 1));
+    SpectralKernel kernel;
+    int spectral_ok = (plan && hann && X && mag && spectral_kernel_init(&kernel, win, sr, NULL, 0) == 0);
+    PairScratch pairs = {0};
+    double diss_sum = 0.0, rough_sum = 0.0;
+    size_t diss_frames = 0, spectral_frames = 0;
+    const int fast = fast_math_enabled();
+
     // Compute frame RMS and dB
     for (size_t f = 0; f < n_frames; ++f) {
         size_t off = f * (size_t)hop;
-        size_t wlen = win;
-        if (off + (size_t)win > frames) wlen = (size_t) (frames - off);
-        if (wlen == 0) { rms[f] = 0.0; rms_db[f] = -120.0; continue; }
-
-        long double acc = 0.0L;
-        for (size_t i = 0; i < wlen; ++i) {
-            long double v = mono[off + i];
-            acc += v * v;
-        }
-        double r = sqrt((double)(acc / (long double)wlen));
-        rms[f] = r;
-        rms_db[f] = 20.0 * log10(r + 1e-12);
-    }
+        size_t wlen = (off + (size_t)win > frames ? frames - off : (size_t)win);
+        rms_db[f] = level_frame_db(mono, frames, f, fast, &rms[f]);
+        double r = rms[f];
+        if (wlen == 0) continue;
 
-    // Loudness (LUFS-like) with simple gating at -70 dBFS and K-weighting fudge
-    // We approximate integrated loudness as 10*log10(mean square of gated frames) - 0.691
-    long double sum_ms = 0.0L;
-    size_t count_ms = 0;
-    for (size_t f = 0; f < n_frames; ++f) {
-        if (rms_db[f] > -70.0) {
-            long double ms = (long double)rms[f] * (long double)rms[f];
-            sum_ms += ms;
-            count_ms++;
+        if (spectral_ok && f % stride == 0 && wlen == (size_t)win && r > 1e-4) {
+            for (int i = 0; i < win; ++i) {
+                X[i].r = (double)mono[off + i] * hann[i];
+                X[i].i = 0.0;
+            }
+            dsp_fft(plan, X);
+            spectral_frames++;
+            SpectralFrame sf;
+            spectral_kernel_run(&kernel, X, mag + win / 2 + 1, mag, NULL, NULL, &sf);
+            double d = 0.0, ro = 0.0;
+            int got = frame_dissonance(mag, win, sr, &pairs, &d, &ro);
+            if (got < 0) spectral_ok = 0;
+            else if (got > 0) { diss_sum += d; rough_sum += ro; diss_frames++; }
         }
     }
-    if (count_ms == 0) { // fallback to all frames
-        for (size_t f = 0; f < n_frames; ++f) {
-            long double ms = (long double)rms[f] * (long double)rms[f];
-            sum_ms += ms;
-        }
-        count_ms = n_frames ? n_frames : 1;
+    free(pairs.freq); free(pairs.amp);
+    free(pairs.x); free(pairs.amin); free(pairs.aprod);
+    if (budget) {
+        budget->ran = 1;
+        budget->hop_sec = (double)hop * (double)stride / (double)sr;
+        budget->coverage = (double)spectral_frames / (double)n_frames;
     }
-    double mean_ms = (double)(sum_ms / (long double)count_ms);
-    double loudness_lu = -0.691 + 10.0 * log10(mean_ms + 1e-12);
 
-    // Dynamic range in dB using percentiles of frame RMS in dB
-    double* sorted_db = (double*)malloc(n_frames * sizeof(double));
-    if (!sorted_db) { free(rms); free(rms_db); return -3; }
-    memcpy(sorted_db, rms_db, n_frames * sizeof(double));
-    qsort(sorted_db, n_frames, sizeof(double), cmp_double);
-    size_t idx05 = (size_t)floor(0.05 * (double)(n_frames - 1));
-    size_t idx95 = (size_t)floor(0.95 * (double)(n_frames - 1));
-    double p05 = sorted_db[idx05];
-    double p95 = sorted_db[idx95];
-    double dynamic_range_db = p95 - p05;
-    free(sorted_db);
-
-    // Roughness: mean absolute frame-to-frame change of RMS in dB, normalized
-    double mad = 0.0;
-    for (size_t f = 1; f < n_frames; ++f) {
-        mad += fabs(rms_db[f] - rms_db[f - 1]);
+    // Integrated loudness (K-weighted, gated)
+    double loudness_lu;
+    if (loudness) {
+        loudness_lu = loudness->integrated_lufs;
+    } else {
+        LoudnessResult lr;
+        if (compute_loudness(mono, frames, sr, 1, &lr) != 0) { free(rms); free(rms_db); return -3; }
+        loudness_lu = lr.integrated_lufs;
+        free_loudness_result(&lr);
     }
-    mad = (n_frames > 1) ? mad / (double)(n_frames - 1) : 0.0;
-    // Map to ~[0,1] with a soft saturation; typical pop tracks ~0.5–5 dB/frame
-    double roughness = tanh(mad / 6.0); // 6 dB scale; adjust if desired
-
-    // Dissonance proxy: variance of first difference (in dB) relative to energy
-    double sum_d = 0.0, sum_d2 = 0.0;
-    for (size_t f = 1; f < n_frames; ++f) {
-        double d = rms_db[f] - rms_db[f - 1];
-        sum_d += d;
-        sum_d2 += d * d;
+
+    // Dynamic range in dB using percentiles of frame RMS in dB
+    double dynamic_range_db = psy_dynamic_range(rms_db, n_frames);
+
+    // Roughness + dissonance: mean per-frame pair sums, mapped to [0,1]
+    double roughness = 0.0, dissonance = 0.0;
+    if (diss_frames > 0) {
+        roughness = tanh(rough_sum / diss_frames / PSY_ROUGHNESS_SCALE);
+        dissonance = tanh(diss_sum / diss_frames / PSY_DISSONANCE_SCALE);
     }
-    double mean_d = (n_frames > 1) ? sum_d / (double)(n_frames - 1) : 0.0;
-    double var_d = (n_frames > 1) ? (sum_d2 / (double)(n_frames - 1) - mean_d * mean_d) : 0.0;
-    if (var_d < 0.0) var_d = 0.0;
-    // Map to [0,1] with soft saturation; higher modulation variance -> higher perceived "busy-ness"/dissonance proxy
-    double dissonance = tanh(sqrt(var_d) / 8.0); // 8 dB/sqrt(frame) scale
 
     out->roughness = roughness;
     out->dissonance = dissonance;
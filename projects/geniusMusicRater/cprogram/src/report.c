@@ -0,0 +1,418 @@
+#include "genius_report.h"
+#include <string.h>
+#include <stddef.h>
+
+// ---------- Output schema ----------
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+// Sections are all written unless the report came from an explicit feature
+// selection, which writes only the nodes that were computed.
+#define WANT(r, node) (!(r)->features_only || ((r)->features & FEATURE_BIT(node)))
+
+static const FieldSpec BASIC_STATS_FIELDS[] = {
+    {"duration_seconds",          FIELD_DOUBLE, offsetof(GeniusBasicStats, duration_sec), 6},
+    {"rms",                       FIELD_DOUBLE, offsetof(GeniusBasicStats, rms), 6},
+    {"peak",                      FIELD_DOUBLE, offsetof(GeniusBasicStats, peak), 6},
+    {"dc_offset",                 FIELD_DOUBLE, offsetof(GeniusBasicStats, dc_offset), 6},
+    {"zero_crossings_per_second", FIELD_DOUBLE, offsetof(GeniusBasicStats, zcr), 6},
+};
+
+static const FieldSpec PSY_FIELDS[] = {
+    {"roughness",        FIELD_DOUBLE, offsetof(PsychoacousticFeatures, roughness), 6},
+    {"dissonance",       FIELD_DOUBLE, offsetof(PsychoacousticFeatures, dissonance), 6},
+    {"loudness_lu",      FIELD_DOUBLE, offsetof(PsychoacousticFeatures, loudness_lu), 2},
+    {"dynamic_range_db", FIELD_DOUBLE, offsetof(PsychoacousticFeatures, dynamic_range), 2},
+};
+
+static const FieldSpec RATINGS_FIELDS[] = {
+    {"harmonic_quality",    FIELD_INT, offsetof(Ratings, harmonic_quality), 0},
+    {"progression_quality", FIELD_INT, offsetof(Ratings, progression_quality), 0},
+    {"pleasantness",        FIELD_INT, offsetof(Ratings, pleasantness), 0},
+    {"creativity",          FIELD_INT, offsetof(Ratings, creativity), 0},
+    {"overall_grade",       FIELD_INT, offsetof(Ratings, overall_grade), 0},
+};
+
+static const FieldSpec RHYTHM_FIELDS[] = {
+    {"tempo_bpm",        FIELD_DOUBLE, offsetof(RhythmFeatures, tempo_bpm), 2},
+    {"tempo_confidence", FIELD_DOUBLE, offsetof(RhythmFeatures, tempo_confidence), 2},
+    {"beat_strength",    FIELD_DOUBLE, offsetof(RhythmFeatures, beat_strength), 4},
+    {"pulse_clarity",    FIELD_DOUBLE, offsetof(RhythmFeatures, pulse_clarity), 4},
+    {"syncopation",      FIELD_DOUBLE, offsetof(RhythmFeatures, syncopation), 4},
+    {"swing_ratio",      FIELD_DOUBLE, offsetof(RhythmFeatures, swing_ratio), 2},
+    {"beat_count",       FIELD_INT,    offsetof(RhythmFeatures, beat_count), 0},
+    {"tempo_stability",  FIELD_DOUBLE, offsetof(RhythmFeatures, tempo_stability), 3},
+};
+
+static const FieldSpec HARMONY_FIELDS[] = {
+    {"global_key",       FIELD_STRING, offsetof(HarmonyFeatures, global_key), 0},
+    {"key_stability",    FIELD_DOUBLE, offsetof(HarmonyFeatures, key_stability), 3},
+    {"modulation_count", FIELD_DOUBLE, offsetof(HarmonyFeatures, modulation_count), 1},
+    {"harmonic_motion",  FIELD_DOUBLE, offsetof(HarmonyFeatures, harmonic_motion), 3},
+    {"tension",          FIELD_DOUBLE, offsetof(HarmonyFeatures, tension), 3},
+};
+
+static const FieldSpec MELODY_FIELDS[] = {
+    {"median_f0",                  FIELD_DOUBLE, offsetof(MelodyFeatures, median_f0), 2},
+    {"mean_f0",                    FIELD_DOUBLE, offsetof(MelodyFeatures, mean_f0), 2},
+    {"f0_confidence",              FIELD_DOUBLE, offsetof(MelodyFeatures, f0_confidence), 3},
+    {"pitch_range_semitones",      FIELD_DOUBLE, offsetof(MelodyFeatures, pitch_range_semitones), 2},
+    {"contour_count",              FIELD_INT,    offsetof(MelodyFeatures, contour_count), 0},
+    {"avg_contour_length_sec",     FIELD_DOUBLE, offsetof(MelodyFeatures, avg_contour_length_sec), 3},
+    {"longest_contour_sec",        FIELD_DOUBLE, offsetof(MelodyFeatures, longest_contour_sec), 3},
+    {"avg_interval_semitones",     FIELD_DOUBLE, offsetof(MelodyFeatures, avg_interval_semitones), 3},
+    {"avg_abs_interval_semitones", FIELD_DOUBLE, offsetof(MelodyFeatures, avg_abs_interval_semitones), 3},
+    {"melodic_entropy",            FIELD_DOUBLE, offsetof(MelodyFeatures, melodic_entropy), 3},
+    {"motif_repetition_rate",      FIELD_DOUBLE, offsetof(MelodyFeatures, motif_repetition_rate), 3},
+    {"motif_count",                FIELD_INT,    offsetof(MelodyFeatures, motif_count), 0},
+    {"hook_strength",              FIELD_DOUBLE, offsetof(MelodyFeatures, hook_strength), 3},
+};
+
+static const FieldSpec PRODUCTION_FIELDS[] = {
+    {"loudness_db",      FIELD_DOUBLE, offsetof(ProductionFeatures, loudness_db), 2},
+    {"dynamic_range_db", FIELD_DOUBLE, offsetof(ProductionFeatures, dynamic_range_db), 2},
+    {"stereo_width",     FIELD_DOUBLE, offsetof(ProductionFeatures, stereo_width), 3},
+    {"spectral_balance", FIELD_DOUBLE, offsetof(ProductionFeatures, spectral_balance), 3},
+    {"masking_index",    FIELD_DOUBLE, offsetof(ProductionFeatures, masking_index), 3},
+};
+
+static const FieldSpec LOUDNESS_FIELDS[] = {
+    {"integrated_lufs",     FIELD_DOUBLE, offsetof(LoudnessResult, integrated_lufs), 2},
+    {"loudness_range_lu",   FIELD_DOUBLE, offsetof(LoudnessResult, loudness_range_lu), 2},
+    {"max_momentary_lufs",  FIELD_DOUBLE, offsetof(LoudnessResult, max_momentary_lufs), 2},
+    {"max_short_term_lufs", FIELD_DOUBLE, offsetof(LoudnessResult, max_short_term_lufs), 2},
+};
+
+static const FieldSpec TRUE_PEAK_FIELDS[] = {
+    {"true_peak_dbtp",   FIELD_DOUBLE, offsetof(TruePeakResult, true_peak_dbtp), 2},
+    {"sample_peak_dbfs", FIELD_DOUBLE, offsetof(TruePeakResult, sample_peak_dbfs), 2},
+};
+
+static const FieldSpec STEREO_BAND_FIELDS[] = {
+    {"low_hz",       FIELD_DOUBLE, offsetof(StereoBand, low_hz), 0},
+    {"high_hz",      FIELD_DOUBLE, offsetof(StereoBand, high_hz), 0},
+    {"energy_share", FIELD_DOUBLE, offsetof(StereoBand, energy_share), 3},
+    {"side_ratio",   FIELD_DOUBLE, offsetof(StereoBand, side_ratio), 3},
+    {"correlation",  FIELD_DOUBLE, offsetof(StereoBand, correlation), 3},
+};
+
+static const FieldSpec STAGE_PLAN_FIELDS[] = {
+    {"hop_sec",   FIELD_DOUBLE, offsetof(StagePlan, hop_sec), 4},
+    {"coverage",  FIELD_DOUBLE, offsetof(StagePlan, coverage), 3},
+    {"truncated", FIELD_BOOL,   offsetof(StagePlan, truncated), 0},
+};
+
+static const FieldSpec GENIUS_CATEGORY_FIELDS[] = {
+    {"harmony",              FIELD_INT, offsetof(GeniusResult, harmony_score), 0},
+    {"progression",          FIELD_INT, offsetof(GeniusResult, progression_score), 0},
+    {"melody",               FIELD_INT, offsetof(GeniusResult, melody_score), 0},
+    {"rhythm",               FIELD_INT, offsetof(GeniusResult, rhythm_score), 0},
+    {"structure",            FIELD_INT, offsetof(GeniusResult, structure_score), 0},
+    {"timbre",               FIELD_INT, offsetof(GeniusResult, timbre_score), 0},
+    {"creativity",           FIELD_INT, offsetof(GeniusResult, creativity_score), 0},
+    {"originality_score",    FIELD_INT, offsetof(GeniusResult, originality_score), 0},
+    {"complexity_score",     FIELD_INT, offsetof(GeniusResult, complexity_score), 0},
+    {"genre_distance_score", FIELD_INT, offsetof(GeniusResult, genre_distance_score), 0},
+    {"emotion_score",        FIELD_INT, offsetof(GeniusResult, emotion_score), 0},
+};
+
+static const FieldSpec GENIUS_SPAN_FIELDS[] = {
+    {"start_sec",   FIELD_DOUBLE, offsetof(GeniusSpan, start_sec), 2},
+    {"end_sec",     FIELD_DOUBLE, offsetof(GeniusSpan, end_sec), 2},
+    {"overall",     FIELD_INT,    offsetof(GeniusSpan, overall), 0},
+    {"harmony",     FIELD_INT,    offsetof(GeniusSpan, harmony), 0},
+    {"progression", FIELD_INT,    offsetof(GeniusSpan, progression), 0},
+    {"rhythm",      FIELD_INT,    offsetof(GeniusSpan, rhythm), 0},
+    {"timbre",      FIELD_INT,    offsetof(GeniusSpan, timbre), 0},
+    {"emotion",     FIELD_INT,    offsetof(GeniusSpan, emotion), 0},
+};
+
+int genius_report_write_object(const GeniusReport* r, const char* source,
+                               OutputWriter* w, const char* key) {
+    if (!r || !w) return -1;
+    if (!source) source = "";
+
+    writer_begin_object(w, key);
+    writer_string(w, "file", source);
+
+    writer_begin_object(w, "original");
+    writer_int(w, "sample_rate", r->sample_rate);
+    writer_int(w, "channels", r->channels);
+    writer_int(w, "frames", (long long)r->frames);
+    writer_end_object(w);
+
+    writer_begin_object(w, "analysis_basis");
+    writer_int(w, "resampled_sample_rate", r->analysis_sample_rate);
+    writer_int(w, "mono_frames", (long long)r->mono_frames);
+    writer_bool(w, "fast_math", r->fast_math);
+    if (r->melody_enabled) writer_string(w, "melody_backend", melody_backend_name(r->melody_backend));
+    // fields left out because the budget ran out before they were measured
+    if (WANT(r, FEATURE_STRUCTURE) && r->structure_enabled && r->rc_structure == 0 &&
+        r->structure.section_count > 0 && !r->structure.repetition_valid) {
+        writer_begin_array(w, "unavailable");
+        writer_string(w, NULL, "structure.repetition_ratio");
+        writer_end_array(w);
+    }
+    // resolution each stage actually ran at (coarser under a --budget)
+    writer_begin_object(w, "resolution");
+    writer_double(w, "budget_sec", r->resolution.budget_sec, 2);
+    writer_int(w, "decimation", r->resolution.decimation);
+    for (int s = 0; s < PLAN_STAGES; s++) {
+        const StagePlan* sp = &r->resolution.stage[s];
+        if (!sp->ran) continue;
+        writer_begin_object(w, analysis_plan_stage_name((PlanStage)s));
+        writer_fields(w, sp, STAGE_PLAN_FIELDS, COUNT_OF(STAGE_PLAN_FIELDS));
+        writer_end_object(w);
+    }
+    writer_end_object(w);
+    writer_end_object(w);
+
+    if (WANT(r, FEATURE_STATS)) {
+        writer_begin_object(w, "basic_stats");
+        writer_fields(w, &r->stats, BASIC_STATS_FIELDS, COUNT_OF(BASIC_STATS_FIELDS));
+        writer_end_object(w);
+    }
+
+    if (WANT(r, FEATURE_TEMPO) || WANT(r, FEATURE_KEY) || WANT(r, FEATURE_SPECTRAL)) {
+        writer_begin_object(w, "features");
+        if (WANT(r, FEATURE_TEMPO)) writer_double(w, "tempo_bpm", (r->rc_tempo==0 ? r->tempo_bpm : 0.0), 2);
+        if (WANT(r, FEATURE_KEY)) writer_string(w, "key", (r->rc_key==0 ? r->key : "unknown"));
+        if (WANT(r, FEATURE_SPECTRAL)) {
+            writer_begin_object(w, "spectral");
+            writer_double(w, "centroid", (r->rc_spectral==0 ? r->spectral.centroid : 0.0), 2);
+            writer_double(w, "rolloff", (r->rc_spectral==0 ? r->spectral.rolloff : 0.0), 2);
+            writer_double(w, "brightness", (r->rc_spectral==0 ? r->spectral.brightness : 0.0), 4);
+            writer_double(w, "bandwidth", (r->rc_spectral==0 ? r->spectral.bandwidth : 0.0), 2);
+            writer_double(w, "flatness", (r->rc_spectral==0 ? r->spectral.flatness : 0.0), 4);
+            writer_begin_array(w, "mfcc");
+            if (r->rc_spectral==0) {
+                for (int i=0; i<FEATURE_MFCC_COUNT; i++) writer_double(w, NULL, r->spectral.mfcc[i], 4);
+            }
+            writer_end_array(w);
+            writer_end_object(w);
+        }
+        writer_end_object(w);
+    }
+
+    if (WANT(r, FEATURE_PSY)) {
+        PsychoacousticFeatures psy_out = r->psy;
+        if (r->rc_psy != 0) memset(&psy_out, 0, sizeof(psy_out));
+        writer_begin_object(w, "psychoacoustics");
+        writer_fields(w, &psy_out, PSY_FIELDS, COUNT_OF(PSY_FIELDS));
+        writer_end_object(w);
+    }
+
+    if (WANT(r, FEATURE_RATINGS)) {
+        Ratings ratings_out = r->ratings;
+        if (r->rc_ratings != 0) memset(&ratings_out, 0, sizeof(ratings_out));
+        writer_begin_object(w, "ratings");
+        writer_fields(w, &ratings_out, RATINGS_FIELDS, COUNT_OF(RATINGS_FIELDS));
+        writer_string(w, "rating_profile", r->profile);
+        writer_end_object(w);
+    }
+
+    if (WANT(r, FEATURE_RHYTHM)) {
+        writer_begin_object(w, "rhythm");
+        writer_fields(w, &r->rhythm, RHYTHM_FIELDS, COUNT_OF(RHYTHM_FIELDS));
+        writer_begin_array(w, "beat_times");
+        if (r->rc_beats == 0) {
+            for (size_t i=0; i<r->beats.beat_count; i++) writer_double(w, NULL, r->beats.beat_times[i], 3);
+        }
+        writer_end_array(w);
+        writer_begin_array(w, "local_tempo_bpm");
+        for (size_t i=0; i<r->rhythm.local_tempo_len; i++) writer_double(w, NULL, r->rhythm.local_tempo[i], 1);
+        writer_end_array(w);
+        writer_end_object(w);
+    }
+
+    // --- Harmony Analysis (Step 2) ---
+    if (WANT(r, FEATURE_HARMONY)) {
+        writer_begin_object(w, "harmony");
+        writer_fields(w, &r->harmony, HARMONY_FIELDS, COUNT_OF(HARMONY_FIELDS));
+        writer_begin_array(w, "chords");
+        for (int i=0; i<r->harmony.chord_count; i++) {
+            writer_begin_object(w, NULL);
+            writer_double(w, "time_sec", r->harmony.chords[i].time_sec, 2);
+            writer_string(w, "name", r->harmony.chords[i].name);
+            writer_end_object(w);
+        }
+        writer_end_array(w);
+        writer_begin_array(w, "key_timeline");
+        for (int i=0; i<r->harmony.key_segment_count; i++) {
+            const KeySegment* k = &r->harmony.key_segments[i];
+            writer_begin_object(w, NULL);
+            writer_double(w, "start_sec", k->start_sec, 2);
+            writer_double(w, "end_sec", k->end_sec, 2);
+            writer_string(w, "key", k->key);
+            writer_double(w, "strength", k->strength, 3);
+            writer_end_object(w);
+        }
+        writer_end_array(w);
+        writer_end_object(w);
+    }
+
+    if (WANT(r, FEATURE_MELODY)) {
+        writer_begin_object(w, "melody");
+        if (r->rc_melody==0) {
+            writer_fields(w, &r->melody, MELODY_FIELDS, COUNT_OF(MELODY_FIELDS));
+        } else {
+            writer_string(w, "error", "melody extraction failed");
+        }
+        writer_end_object(w);
+    }
+
+    if (WANT(r, FEATURE_STRUCTURE)) {
+        writer_begin_object(w, "structure");
+        if (r->structure_enabled && r->rc_structure==0 && r->structure.section_count > 0) {
+            writer_int(w, "section_count", (long long)r->structure.section_count);
+            writer_double(w, "arc_complexity", r->structure.arc_complexity, 3);
+            if (r->structure.repetition_valid) {
+                writer_double(w, "repetition_ratio", r->structure.repetition_ratio, 3);
+            }
+
+            // --- section durations + duration ratio (longest/shortest) ---
+            double shortest = 1e9, longest = 0.0;
+            writer_begin_array(w, "section_durations");
+            for (size_t i = 0; i < r->structure.section_count; i++) {
+                double len = r->structure.sections[i].end_sec - r->structure.sections[i].start_sec;
+                writer_double(w, NULL, len, 2);
+                if (len < shortest) shortest = len;
+                if (len > longest) longest = len;
+            }
+            writer_end_array(w);
+            double duration_ratio = (shortest > 1e-6 ? longest / shortest : 0.0);
+            writer_double(w, "duration_ratio", duration_ratio, 2);
+
+            // --- label frequency counts ---
+            int count_intro=0, count_verse=0, count_chorus=0, count_bridge=0, count_outro=0;
+            for (size_t i=0; i<r->structure.section_count; i++) {
+                if (strcmp(r->structure.sections[i].label, "intro")==0) count_intro++;
+                else if (strcmp(r->structure.sections[i].label, "verse")==0) count_verse++;
+                else if (strcmp(r->structure.sections[i].label, "chorus")==0) count_chorus++;
+                else if (strcmp(r->structure.sections[i].label, "bridge")==0) count_bridge++;
+                else if (strcmp(r->structure.sections[i].label, "outro")==0) count_outro++;
+            }
+            writer_begin_object(w, "section_labels_summary");
+            writer_int(w, "intro", count_intro);
+            writer_int(w, "verse", count_verse);
+            writer_int(w, "chorus", count_chorus);
+            writer_int(w, "bridge", count_bridge);
+            writer_int(w, "outro", count_outro);
+            writer_end_object(w);
+            writer_bool(w, "has_chorus", count_chorus > 0);
+
+            // --- normalized arcs (boundary times / total duration) ---
+            double total_duration = r->structure.sections[r->structure.section_count-1].end_sec;
+            writer_begin_array(w, "structural_arcs");
+            for (size_t i=0; i<r->structure.section_count; i++) {
+                writer_double(w, NULL, r->structure.sections[i].start_sec / total_duration, 3);
+            }
+            writer_end_array(w);
+
+            // --- actual sections list ---
+            writer_begin_array(w, "sections");
+            for (size_t i = 0; i < r->structure.section_count; i++) {
+                writer_begin_object(w, NULL);
+                writer_double(w, "start_sec", r->structure.sections[i].start_sec, 2);
+                writer_double(w, "end_sec", r->structure.sections[i].end_sec, 2);
+                writer_string(w, "label", r->structure.sections[i].label);
+                writer_end_object(w);
+            }
+            writer_end_array(w);
+        } else {
+            writer_string(w, "error", r->structure_enabled ? "structure extraction failed"
+                                                     : "structure extraction disabled");
+        }
+        writer_end_object(w);
+    }
+
+    if (WANT(r, FEATURE_PRODUCTION)) {
+        writer_begin_object(w, "production");
+        if (r->rc_production == 0) {
+            writer_fields(w, &r->production, PRODUCTION_FIELDS, COUNT_OF(PRODUCTION_FIELDS));
+            const LoudnessResult* l = &r->production.loudness;
+            writer_begin_object(w, "loudness");
+            writer_fields(w, l, LOUDNESS_FIELDS, COUNT_OF(LOUDNESS_FIELDS));
+            writer_begin_array(w, "momentary_lufs");
+            for (size_t i=0; i<l->track_len; i++) writer_double(w, NULL, l->momentary[i], 1);
+            writer_end_array(w);
+            writer_begin_array(w, "short_term_lufs");
+            for (size_t i=0; i<l->track_len; i++) writer_double(w, NULL, l->short_term[i], 1);
+            writer_end_array(w);
+            writer_end_object(w);
+            const TruePeakResult* tp = &r->production.true_peak;
+            writer_begin_object(w, "true_peak");
+            writer_fields(w, tp, TRUE_PEAK_FIELDS, COUNT_OF(TRUE_PEAK_FIELDS));
+            writer_begin_array(w, "peak_dbtp");
+            for (size_t i=0; i<tp->track_len; i++) writer_double(w, NULL, tp->track[i], 1);
+            writer_end_array(w);
+            writer_end_object(w);
+            const StereoImage* st = &r->production.stereo;
+            if (st->valid) {
+                writer_begin_object(w, "stereo");
+                writer_double(w, "side_ratio", st->side_ratio, 3);
+                writer_double(w, "phase_coherence", st->phase_coherence, 3);
+                writer_begin_array(w, "bands");
+                for (int b = 0; b < PRODUCTION_STEREO_BANDS; b++) {
+                    writer_begin_object(w, NULL);
+                    writer_fields(w, &st->bands[b], STEREO_BAND_FIELDS, COUNT_OF(STEREO_BAND_FIELDS));
+                    writer_end_object(w);
+                }
+                writer_end_array(w);
+                writer_begin_array(w, "coherence");
+                for (size_t i=0; i<st->coherence_len; i++) writer_double(w, NULL, st->coherence[i], 2);
+                writer_end_array(w);
+                writer_end_object(w);
+            }
+        } else {
+            writer_string(w, "error", "production features failed");
+        }
+        writer_end_object(w);
+    }
+
+    if (r->genius_enabled) {
+        writer_begin_object(w, "genius");
+        writer_int(w, "overall_score", r->genius.overall_score);
+        writer_bool(w, "is_genius", r->genius.is_genius);
+        writer_double(w, "confidence", r->genius.confidence, 3);
+        // the web viewer reads the extras and explanation from inside "categories"
+        writer_begin_object(w, "categories");
+        writer_fields(w, &r->genius, GENIUS_CATEGORY_FIELDS, COUNT_OF(GENIUS_CATEGORY_FIELDS));
+        writer_begin_object(w, "explanation");
+        writer_begin_array(w, "positive_contributors");
+        for (int i=0; i<r->genius.pos_count; i++) writer_string(w, NULL, r->genius.positives[i]);
+        writer_end_array(w);
+        writer_begin_array(w, "negative_contributors");
+        for (int i=0; i<r->genius.neg_count; i++) writer_string(w, NULL, r->genius.negatives[i]);
+        writer_end_array(w);
+        writer_end_object(w);
+        writer_end_object(w);
+
+        // where the track peaks and sags: structure sections and a rolling window
+        const GeniusTimelineScores* tl = &r->genius_timeline;
+        writer_begin_array(w, "sections");
+        for (size_t i=0; i<tl->section_count; i++) {
+            writer_begin_object(w, NULL);
+            writer_fields(w, &tl->sections[i], GENIUS_SPAN_FIELDS, COUNT_OF(GENIUS_SPAN_FIELDS));
+            writer_string(w, "label", (i < r->structure.section_count ? r->structure.sections[i].label : ""));
+            writer_end_object(w);
+        }
+        writer_end_array(w);
+        writer_begin_object(w, "timeline");
+        writer_double(w, "window_sec", tl->window_sec, 1);
+        writer_double(w, "hop_sec", tl->hop_sec, 1);
+        writer_begin_array(w, "overall");
+        for (size_t i=0; i<tl->rolling_len; i++) writer_int(w, NULL, tl->rolling[i]);
+        writer_end_array(w);
+        writer_end_object(w);
+        writer_end_object(w);
+    }
+
+    writer_end_object(w);
+    return w->error ? -1 : 0;
+}
+
+int genius_report_write(const GeniusReport* r, const char* source, OutputWriter* w) {
+    if (genius_report_write_object(r, source, w, NULL) != 0) return -1;
+    return writer_end_record(w);
+}
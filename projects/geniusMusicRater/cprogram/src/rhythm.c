@@ -1,126 +1,72 @@
 #include "rhythm.h"
+#include "dsp.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 // ---------- Internal Helper Functions ----------
 
-/**
- * Simple Hann window generator
- */
-static void hann_window(float* w, size_t N) {
-    for (size_t i = 0; i < N; i++) {
-        w[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * (float)i / (float)(N - 1)));
+// Strongest onset within +-half_window frames of center.
+static float odf_local_max(const float* odf, size_t odf_len, size_t center, size_t half_window) {
+    size_t start = (center > half_window ? center - half_window : 0);
+    size_t end   = (center + half_window < odf_len ? center + half_window : odf_len - 1);
+    float local_max = 0.0f;
+    for (size_t i = start; i <= end; i++) {
+        if (odf[i] > local_max) local_max = odf[i];
     }
+    return local_max;
 }
 
-
-/**
- * Energy-based onset envelope.
- * Splits audio into hop-sized frames, computes RMS energy,
- * then returns the positive differences (onset strength).
- */
-static float* compute_onset_envelope_energy(const float* mono,
-                                            size_t frames,
-                                            int sample_rate,
-                                            size_t hop_size,
-                                            size_t* out_len) {
-    if (!mono || frames < hop_size) {
-        *out_len = 0;
-        return NULL;
-    }
-
-    size_t num_frames = frames / hop_size;
-    float* env = (float*)calloc(num_frames, sizeof(float));
-    if (!env) {
-        *out_len = 0;
-        return NULL;
+// Onset peak on beat b and halfway to the next beat (tolerance window: 10%
+// of the local beat period); *off is -1 when there is no next beat in range.
+static void beat_peaks(const BeatGrid* g, size_t b, double* on, double* off) {
+    size_t center = g->beat_frames[b];
+    // the last beat borrows the previous period
+    size_t period = (b + 1 < g->beat_count ? g->beat_frames[b+1] - center
+                                           : center - g->beat_frames[b-1]);
+    size_t half_window = (size_t)(0.1 * (double)period);
+    *on = odf_local_max(g->odf, g->odf_len, center, half_window);
+    *off = -1.0;
+    if (b + 1 < g->beat_count) {
+        size_t mid = center + period / 2;
+        if (mid < g->odf_len) *off = odf_local_max(g->odf, g->odf_len, mid, half_window);
     }
-
-    // 1. Compute RMS energy per frame
-    for (size_t f = 0; f < num_frames; f++) {
-        double sum = 0.0;
-        for (size_t i = 0; i < hop_size; i++) {
-            size_t idx = f * hop_size + i;
-            if (idx < frames) {
-                float x = mono[idx];
-                sum += (double)x * (double)x;
-            }
-        }
-        env[f] = (float)sqrt(sum / (double)hop_size);
-    }
-
-    // 2. Convert to onset detection function (positive first differences)
-    for (size_t f = num_frames-1; f > 0; f--) {
-        float diff = env[f] - env[f-1];
-        env[f] = (diff > 0 ? diff : 0.0f);
-    }
-    env[0] = 0.0f;
-
-    *out_len = num_frames;
-    return env;
 }
 
 /**
- * Estimate Tempo (BPM) using autocorrelation of onset envelope.
- * Confidence is defined as best_peak / second_best_peak ratio,
- * normalized into [0,1].
+ * Average onset peak on the tracked beats and halfway between consecutive
+ * beats.
  */
-static void estimate_tempo_from_odf(const float* odf,
-                                    size_t odf_len,
-                                    int sample_rate,
-                                    size_t hop_size,
-                                    double* tempo_bpm,
-                                    double* confidence) {
-    if (!odf || odf_len == 0) {
-        *tempo_bpm = 0.0;
-        *confidence = 0.0;
-        return;
-    }
+static int beat_offbeat_energy(const BeatGrid* g, double* avg_beat, double* avg_off) {
+    *avg_beat = 0.0;
+    *avg_off = 0.0;
+    if (!g || !g->odf || g->beat_count < 2) return 0;
 
-    // Simple autocorrelation
-    size_t max_lag = odf_len / 2;
-    double best_val = -1.0, second_val = -1.0;
-    size_t best_lag = 0;
-
-    for (size_t lag = 1; lag < max_lag; lag++) {
-        double sum = 0.0;
-        for (size_t i = 0; i + lag < odf_len; i++) {
-            sum += odf[i] * odf[i+lag];
-        }
-
-        // Only consider BPMs in reasonable range
-        double sec = (lag * hop_size) / (double)sample_rate;
-        double bpm = (sec > 0.0 ? 60.0 / sec : 0.0);
-        if (bpm < 40.0 || bpm > 200.0) continue;
-
-        // Track top 2 peaks
-        if (sum > best_val) {
-            second_val = best_val;
-            best_val = sum;
-            best_lag = lag;
-        } else if (sum > second_val) {
-            second_val = sum;
+    double beat_energy = 0.0, offbeat_energy = 0.0;
+    size_t offbeat_count = 0;
+    for (size_t b = 0; b < g->beat_count; b++) {
+        if (g->beat_frames[b] >= g->odf_len) break;
+        double on, off;
+        beat_peaks(g, b, &on, &off);
+        beat_energy += on;
+        if (off >= 0.0) {
+            offbeat_energy += off;
+            offbeat_count++;
         }
     }
 
-    if (best_lag > 0) {
-        double sec = (best_lag * hop_size) / (double)sample_rate;
-        *tempo_bpm = 60.0 / sec;
-
-        // ----- Confidence improvement -----
-        if (second_val > 0.0) {
-            double ratio = best_val / second_val;  // >1 = dominant
-            // map into [0,1] with a soft clamp
-            *confidence = (ratio > 2.0 ? 1.0 : (ratio - 1.0));
-            if (*confidence < 0.0) *confidence = 0.0;
-            if (*confidence > 1.0) *confidence = 1.0;
-        } else {
-            *confidence = 1.0; // only one strong peak
-        }
-    } else {
-        *tempo_bpm = 0.0;
-        *confidence = 0.0;
+    *avg_beat = beat_energy / (double)g->beat_count;
+    *avg_off = (offbeat_count > 0 ? offbeat_energy / (double)offbeat_count : 0.0);
+    return offbeat_count > 0;
+}
+
+void rhythm_beat_peaks(const BeatGrid* grid, double* on, double* off) {
+    if (!grid || !on || !off) return;
+    for (size_t b = 0; b < grid->beat_count; b++) {
+        on[b] = 0.0;
+        off[b] = -1.0;
+        if (grid->odf && grid->beat_count >= 2 && grid->beat_frames[b] < grid->odf_len)
+            beat_peaks(grid, b, &on[b], &off[b]);
     }
 }
 
@@ -129,66 +75,15 @@ static void estimate_tempo_from_odf(const float* odf,
  * Compare average onset energy at beat-aligned positions vs. offbeats.
  * Returns a normalized value [0,1].
  */
-static double compute_pulse_clarity(const float* odf,
-                                    size_t odf_len,
-                                    double tempo_bpm,
-                                    int sample_rate,
-                                    size_t hop_size) {
-    if (!odf || odf_len == 0 || tempo_bpm <= 0.0) return 0.0;
-
-    double hop_time = (double)hop_size / (double)sample_rate;
-    double beat_period_sec = 60.0 / tempo_bpm;
-    double beat_period_frames = beat_period_sec / hop_time;
-
-    if (beat_period_frames < 2.0) return 0.0;
-
-    double beat_energy = 0.0;
-    double offbeat_energy = 0.0;
-    int beat_count = 0;
-    int offbeat_count = 0;
-
-    // tolerance window (10% of beat period)
-    size_t half_window = (size_t)(0.1 * beat_period_frames);
-
-    for (size_t b = 0; b < odf_len; b += (size_t)beat_period_frames) {
-        size_t center = (size_t)b;
-        if (center >= odf_len) break;
-
-        // --- Beat energy ---
-        size_t start = (center > half_window ? center - half_window : 0);
-        size_t end   = (center + half_window < odf_len ? center + half_window : odf_len - 1);
-        float local_max = 0.0f;
-        for (size_t i = start; i <= end; i++) {
-            if (odf[i] > local_max) local_max = odf[i];
-        }
-        beat_energy += local_max;
-        beat_count++;
-
-        // --- Off-beat energy (halfway between beats) ---
-        size_t mid = center + (size_t)(beat_period_frames / 2.0);
-        if (mid < odf_len) {
-            start = (mid > half_window ? mid - half_window : 0);
-            end   = (mid + half_window < odf_len ? mid + half_window : odf_len - 1);
-            float off_local = 0.0f;
-            for (size_t i = start; i <= end; i++) {
-                if (odf[i] > off_local) off_local = odf[i];
-            }
-            offbeat_energy += off_local;
-            offbeat_count++;
-        }
-    }
-
-    if (beat_count == 0) return 0.0;
-
-    double avg_beat = beat_energy / (double)beat_count;
-    double avg_off  = (offbeat_count > 0 ? offbeat_energy / (double)offbeat_count : 0.0);
+static double compute_pulse_clarity(const BeatGrid* g) {
+    double avg_beat, avg_off;
+    beat_offbeat_energy(g, &avg_beat, &avg_off);
 
     // Normalize clarity measure
     double clarity = 0.0;
     if (avg_beat > 0.0) {
         clarity = avg_beat / (avg_beat + avg_off + 1e-9); // ratio in [0..1]
     }
-
     return clarity;
 }
 
@@ -196,51 +91,9 @@ static double compute_pulse_clarity(const float* odf,
  * Compute syncopation level (0..1).
  * High = more off-beat emphasis.
  */
-static double compute_syncopation(const float* odf,
-                                  size_t odf_len,
-                                  double tempo_bpm,
-                                  int sample_rate,
-                                  size_t hop_size) {
-    if (!odf || odf_len == 0 || tempo_bpm <= 0.0) return 0.0;
-
-    double hop_time = (double)hop_size / (double)sample_rate;
-    double beat_period_sec = 60.0 / tempo_bpm;
-    double beat_period_frames = beat_period_sec / hop_time;
-
-    if (beat_period_frames < 2.0) return 0.0;
-
-    double beat_energy = 0.0, offbeat_energy = 0.0;
-    int beat_count = 0, offbeat_count = 0;
-    size_t half_window = (size_t)(0.1 * beat_period_frames);
-
-    for (size_t b = 0; b < odf_len; b += (size_t)beat_period_frames) {
-        size_t center = (size_t)b;
-        if (center >= odf_len) break;
-
-        // beat
-        size_t start = (center > half_window ? center - half_window : 0);
-        size_t end   = (center + half_window < odf_len ? center + half_window : odf_len-1);
-        float local_max = 0.0f;
-        for (size_t i=start; i<=end; i++) if (odf[i] > local_max) local_max = odf[i];
-        beat_energy += local_max;
-        beat_count++;
-
-        // offbeat
-        size_t mid = center + (size_t)(beat_period_frames/2.0);
-        if (mid < odf_len) {
-            start = (mid > half_window ? mid - half_window : 0);
-            end   = (mid + half_window < odf_len ? mid + half_window : odf_len-1);
-            float off_local = 0.0f;
-            for (size_t i=start; i<=end; i++) if (odf[i] > off_local) off_local = odf[i];
-            offbeat_energy += off_local;
-            offbeat_count++;
-        }
-    }
-
-    if (beat_count == 0 || offbeat_count == 0) return 0.0;
-
-    double avg_beat = beat_energy / (double)beat_count;
-    double avg_off = offbeat_energy / (double)offbeat_count;
+static double compute_syncopation(const BeatGrid* g) {
+    double avg_beat, avg_off;
+    if (!beat_offbeat_energy(g, &avg_beat, &avg_off)) return 0.0;
 
     double sync = avg_off / (avg_beat + avg_off + 1e-9); // normalized [0..1]
     return sync;
@@ -248,40 +101,34 @@ static double compute_syncopation(const float* odf,
 
 /**
  * Estimate swing ratio. Approx by comparing onset strengths
- * in first vs second half of each beat.
+ * in first vs second half of each beat interval.
  *
  * Return around:
  *   ~1.0 => straight
  *   ~1.5-2.0 => swung feel
  */
-static double compute_swing_ratio(const float* odf,
-                                  size_t odf_len,
-                                  double tempo_bpm,
-                                  int sample_rate,
-                                  size_t hop_size) {
-    if (!odf || odf_len == 0 || tempo_bpm <= 0.0) return 1.0;
-
-    double hop_time = (double)hop_size / (double)sample_rate;
-    double beat_period_sec = 60.0 / tempo_bpm;
-    double beat_period_frames = beat_period_sec / hop_time;
-    if (beat_period_frames < 4.0) return 1.0;
+static double compute_swing_ratio(const BeatGrid* g) {
+    if (!g || !g->odf || g->beat_count < 2) return 1.0;
 
     double half1 = 0.0, half2 = 0.0;
     int count1 = 0, count2 = 0;
 
-    for (size_t b = 0; b < odf_len; b += (size_t)beat_period_frames) {
-        size_t half_point = (size_t)(b + beat_period_frames/2.0);
-        if (half_point >= odf_len) break;
+    for (size_t b = 0; b + 1 < g->beat_count; b++) {
+        size_t start = g->beat_frames[b];
+        size_t end = g->beat_frames[b+1];
+        if (end > g->odf_len) end = g->odf_len;
+        if (end < start + 4) continue; // too short to split
+        size_t half_point = start + (end - start) / 2;
 
         // average energy in first half
         double sum1 = 0.0;
-        for (size_t i=b; i<half_point && i<odf_len; i++) sum1 += odf[i];
-        if (half_point > b) { half1 += sum1/(half_point-b); count1++; }
+        for (size_t i=start; i<half_point; i++) sum1 += g->odf[i];
+        half1 += sum1/(half_point-start); count1++;
 
         // average in second half
         double sum2 = 0.0;
-        for (size_t i=half_point; i<b+beat_period_frames && i<odf_len; i++) sum2 += odf[i];
-        if (b+beat_period_frames > half_point) { half2 += sum2/((b+beat_period_frames)-half_point); count2++; }
+        for (size_t i=half_point; i<end; i++) sum2 += g->odf[i];
+        half2 += sum2/(end-half_point); count2++;
     }
 
     if (count1==0 || count2==0) return 1.0;
@@ -302,7 +149,112 @@ static double compute_swing_ratio(const float* odf,
     return ratio;
 }
 
-// ---------- Public Rhythm Stub (now with onset env) ----------
+// ---------- Tempogram ----------
+
+#define TEMPOGRAM_WINDOW_SEC  8.0   // onset envelope span per local estimate
+#define TEMPO_STABLE_TOLERANCE 0.04 // local tempo within 4% of the dominant tempo counts as steady
+#define TEMPO_PRIOR_BPM       120.0 // log-Gaussian preference (one octave wide) against
+                                    // picking half or double the local tempo
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Local tempo once per second from the autocorrelation of an 8 s onset
+ * envelope window centred on that second (clamped at the track edges).
+ * Each window's autocorrelation is the transform of its power spectrum,
+ * zero-padded to twice the window so it is linear, not circular: two FFTs
+ * per second of audio.
+ */
+static int compute_tempogram(const BeatGrid* g, RhythmFeatures* out) {
+    double fr = (double)g->sample_rate / (double)g->hop_size;   // envelope frames per second
+    int min_lag = (int)floor(fr * 60.0 / 200.0);
+    int max_lag = (int)ceil(fr * 60.0 / 40.0);
+    int win = (int)lround(TEMPOGRAM_WINDOW_SEC * fr);
+    if ((size_t)win > g->odf_len) win = (int)g->odf_len;
+    if (max_lag + 2 > win) return 0;  // too short for one 40 BPM period
+
+    int nfft = 1;
+    while (nfft < 2 * win) nfft <<= 1;
+    const FftPlan* plan = dsp_fft_plan(nfft);
+    const double* hann = dsp_window(DSP_HANN_SYMMETRIC, win);
+    DspComplex* X = (DspComplex*)dsp_scratch(DSP_SCRATCH_FFT, sizeof(DspComplex) * nfft);
+    size_t seconds = (size_t)ceil(g->odf_len / fr);
+    float* track = (float*)malloc(sizeof(float) * (seconds > 0 ? seconds : 1));
+    double* sorted = (double*)malloc(sizeof(double) * (seconds > 0 ? seconds : 1));
+    if (!plan || !hann || !X || !track || !sorted) {
+        free(track); free(sorted);
+        return -1;
+    }
+
+    size_t last_start = g->odf_len - (size_t)win;
+    size_t valid = 0;
+    for (size_t sec = 0; sec < seconds; sec++) {
+        double center = (sec + 0.5) * fr;
+        size_t start = (center > win / 2.0 ? (size_t)(center - win / 2.0) : 0);
+        if (start > last_start) start = last_start;
+        const float* x = g->odf + start;
+
+        double mean = 0.0;
+        for (int i = 0; i < win; i++) mean += x[i];
+        mean /= win;
+        for (int i = 0; i < win; i++) {
+            X[i].r = (x[i] - mean) * hann[i];
+            X[i].i = 0.0;
+        }
+        for (int i = win; i < nfft; i++) X[i].r = X[i].i = 0.0;
+
+        dsp_fft(plan, X);
+        for (int k = 0; k < nfft; k++) {
+            X[k].r = X[k].r * X[k].r + X[k].i * X[k].i;
+            X[k].i = 0.0;
+        }
+        dsp_fft(plan, X);   // power spectrum is real and even: forward == inverse up to 1/n
+
+        int best = 0;
+        double best_val = 0.0;
+        for (int lag = min_lag; lag <= max_lag; lag++) {
+            if (X[lag].r <= 0.0 || X[lag].r < X[lag-1].r || X[lag].r < X[lag+1].r) continue;
+            double octaves = log2(60.0 * fr / lag / TEMPO_PRIOR_BPM);
+            double v = X[lag].r * exp(-0.5 * octaves * octaves);
+            if (v > best_val) {
+                best_val = v;
+                best = lag;
+            }
+        }
+        if (best == 0 || X[0].r <= 0.0) {
+            track[sec] = 0.0f;
+            continue;
+        }
+
+        // parabolic interpolation of the peak
+        double a = X[best-1].r, b = X[best].r, c = X[best+1].r;
+        double denom = a - 2.0 * b + c;
+        double lag = best + (fabs(denom) > 1e-12 ? 0.5 * (a - c) / denom : 0.0);
+        double bpm = 60.0 * fr / lag;
+        track[sec] = (float)bpm;
+        sorted[valid++] = bpm;
+    }
+
+    out->local_tempo = track;
+    out->local_tempo_len = seconds;
+
+    // stability: most seconds whose tempi fit in one +-4% band
+    qsort(sorted, valid, sizeof(double), cmp_double);
+    size_t steady = 0, hi = 0;
+    for (size_t lo = 0; lo < valid; lo++) {
+        double top = sorted[lo] * (1.0 + TEMPO_STABLE_TOLERANCE) / (1.0 - TEMPO_STABLE_TOLERANCE);
+        while (hi < valid && sorted[hi] <= top) hi++;
+        if (hi - lo > steady) steady = hi - lo;
+    }
+    out->tempo_stability = (double)steady / (double)seconds;
+    free(sorted);
+    return 0;
+}
+
+// ---------- Public API ----------
 
 int compute_rhythm_features(const float* mono,
                             size_t frames,
@@ -311,51 +263,44 @@ int compute_rhythm_features(const float* mono,
     if (!mono || frames == 0 || sample_rate <= 0 || !out)
         return -1;
 
-    memset(out, 0, sizeof(*out));
-
-    // Parameters for STFT-based onset detection
-    size_t fft_size = 1024;   // ~23 ms at 44.1kHz
-    size_t hop_size = 512;    // 50% overlap
-
-    // Compute spectral flux onset envelope
-    size_t odf_len = 0;
-     float* onset_env = compute_onset_envelope_energy(mono, frames, sample_rate,
-                                                     hop_size, &odf_len);
+    BeatGrid grid;
+    int rc = compute_beat_grid(mono, frames, sample_rate, &grid);
+    if (rc != 0) {
+        memset(out, 0, sizeof(*out));
+        free_beat_grid(&grid);
+        return -2; // onset detection failed
+    }
+    rc = compute_rhythm_features_beats(&grid, out);
+    free_beat_grid(&grid);
+    return rc;
+}
 
-    if (!onset_env || odf_len == 0) {
+int compute_rhythm_features_beats(const BeatGrid* grid, RhythmFeatures* out) {
+    if (!grid || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!grid->odf || grid->odf_len == 0) {
         return -2; // onset detection failed
     }
 
-    // ---------- FUTURE STEPS ----------
-    // From now, we’ll:
-    // - Normalize onset_env
-    // - Autocorrelation/FFT for tempo
-    // - Beat tracking from peaks
-    //
-    // For now, just compute average onset strength as proxy:
+    // Average onset strength as a beat strength proxy
     double sum = 0.0;
-    for (size_t i=0; i<odf_len; i++) sum += onset_env[i];
-    double avg_flux = (odf_len>0? sum/odf_len : 0.0);
-
-     // --- Tempo Estimation (Fast FFT ACF) ---
-    double tempo_bpm = 0.0, tempo_conf = 0.0;
-    estimate_tempo_from_odf(onset_env, odf_len, sample_rate, hop_size,
-                            &tempo_bpm, &tempo_conf);
-    
-      // --- Pulse Clarity (Step 1.3) ---
-    double clarity = compute_pulse_clarity(onset_env, odf_len,
-                                           tempo_bpm, sample_rate, hop_size);
-
-    out->tempo_bpm = tempo_bpm;
-    out->tempo_confidence = tempo_conf;
-    out->beat_strength = avg_flux; // crude proxy until beat tracking
-    out->pulse_clarity = clarity;     // Step 1.3
-      // --- Syncopation & Swing (Step 1.4) ---
-    out->syncopation = compute_syncopation(onset_env, odf_len,
-                                           tempo_bpm, sample_rate, hop_size);
-    out->swing_ratio = compute_swing_ratio(onset_env, odf_len,
-                                           tempo_bpm, sample_rate, hop_size);
-
-    free(onset_env);
+    for (size_t i=0; i<grid->odf_len; i++) sum += grid->odf[i];
+    double avg_flux = sum / grid->odf_len;
+
+    out->tempo_bpm = grid->tempo_bpm;
+    out->tempo_confidence = grid->tempo_confidence;
+    out->beat_strength = avg_flux;
+    out->pulse_clarity = compute_pulse_clarity(grid);
+    out->syncopation = compute_syncopation(grid);
+    out->swing_ratio = compute_swing_ratio(grid);
+    out->beat_count = (int)grid->beat_count;
+    compute_tempogram(grid, out);   // optional: leaves an empty track on failure
     return 0;
-}
\ No newline at end of file
+}
+
+void free_rhythm_features(RhythmFeatures* rf) {
+    if (!rf) return;
+    free(rf->local_tempo);
+    rf->local_tempo = NULL;
+    rf->local_tempo_len = 0;
+}
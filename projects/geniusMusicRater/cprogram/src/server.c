@@ -0,0 +1,757 @@
+#include "server.h"
+#include "genius.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void server_options_init(ServerOptions* opts) {
+    if (!opts) return;
+    memset(opts, 0, sizeof(*opts));
+}
+
+#ifdef _WIN32
+
+int run_server(const char* socket_path, const ServerOptions* opts) {
+    (void)socket_path; (void)opts;
+    fprintf(stderr, "--serve is only available on POSIX systems\n");
+    return -1;
+}
+
+#else
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define SERVE_MAX_LINE     65536
+#define SERVE_PATH_MAX     4096
+#define SERVE_ID_MAX       64
+#define SERVE_DEFAULT_CONNS 64
+
+// ---------- Requests ----------
+
+typedef struct {
+    char id[SERVE_ID_MAX];      // string id, or the raw text of a numeric id
+    int id_kind;                // 0 = none, 1 = string, 2 = number
+    char path[SERVE_PATH_MAX];
+    char genre[32];
+    int melody, structure, genius;
+    double budget_sec;          // 0 = unlimited
+    unsigned features;          // "only" selection, 0 = default outputs
+    int fast_math;
+    int melody_backend;         // GENIUS_MELODY_*
+} ServeRequest;
+
+typedef struct {
+    const char* p;
+    const char* end;
+} JsonCursor;
+
+static void json_skip_ws(JsonCursor* c) {
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r' || *c->p == '\n')) c->p++;
+}
+
+static int json_expect(JsonCursor* c, char ch) {
+    json_skip_ws(c);
+    if (c->p >= c->end || *c->p != ch) return -1;
+    c->p++;
+    return 0;
+}
+
+static void put_utf8(char* out, size_t cap, size_t* n, unsigned cp) {
+    unsigned char b[4];
+    int len;
+    if (cp < 0x80)       { b[0] = (unsigned char)cp; len = 1; }
+    else if (cp < 0x800) { b[0] = (unsigned char)(0xC0 | (cp >> 6)); b[1] = (unsigned char)(0x80 | (cp & 0x3F)); len = 2; }
+    else                 { b[0] = (unsigned char)(0xE0 | (cp >> 12)); b[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+                           b[2] = (unsigned char)(0x80 | (cp & 0x3F)); len = 3; }
+    for (int i = 0; i < len; ++i) {
+        if (*n + 1 < cap) out[(*n)++] = (char)b[i];
+    }
+}
+
+// Parse a JSON string into out (truncated to cap-1 bytes). NULL out = skip.
+static int json_string(JsonCursor* c, char* out, size_t cap) {
+    if (json_expect(c, '"') != 0) return -1;
+    size_t n = 0;
+    while (c->p < c->end) {
+        char ch = *c->p++;
+        if (ch == '"') {
+            if (out && cap) out[n < cap ? n : cap - 1] = '\0';
+            return 0;
+        }
+        if (ch == '\\') {
+            if (c->p >= c->end) return -1;
+            char e = *c->p++;
+            switch (e) {
+                case 'n': ch = '\n'; break;
+                case 't': ch = '\t'; break;
+                case 'r': ch = '\r'; break;
+                case 'b': ch = '\b'; break;
+                case 'f': ch = '\f'; break;
+                case 'u': {
+                    if (c->end - c->p < 4) return -1;
+                    unsigned cp = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        char h = *c->p++;
+                        cp <<= 4;
+                        if (h >= '0' && h <= '9') cp |= (unsigned)(h - '0');
+                        else if (h >= 'a' && h <= 'f') cp |= (unsigned)(h - 'a' + 10);
+                        else if (h >= 'A' && h <= 'F') cp |= (unsigned)(h - 'A' + 10);
+                        else return -1;
+                    }
+                    if (out) put_utf8(out, cap, &n, cp);
+                    continue;
+                }
+                default: ch = e; break; // \" \\ \/
+            }
+        }
+        if (out && n + 1 < cap) out[n++] = ch;
+    }
+    return -1;
+}
+
+static int json_literal(JsonCursor* c, const char* word) {
+    size_t len = strlen(word);
+    if ((size_t)(c->end - c->p) < len || strncmp(c->p, word, len) != 0) return -1;
+    c->p += len;
+    return 0;
+}
+
+// Copy the text of a number token.
+static int json_number(JsonCursor* c, char* out, size_t cap) {
+    json_skip_ws(c);
+    const char* start = c->p;
+    while (c->p < c->end && *c->p && strchr("+-.0123456789eE", *c->p)) c->p++;
+    size_t len = (size_t)(c->p - start);
+    if (len == 0) return -1;
+    if (out && cap) {
+        if (len >= cap) len = cap - 1;
+        memcpy(out, start, len);
+        out[len] = '\0';
+    }
+    return 0;
+}
+
+// Parse true/false; numbers count as true when non-zero.
+static int json_bool(JsonCursor* c, int* out) {
+    json_skip_ws(c);
+    if (json_literal(c, "true") == 0)  { *out = 1; return 0; }
+    if (json_literal(c, "false") == 0) { *out = 0; return 0; }
+    if (json_literal(c, "null") == 0)  { *out = 0; return 0; }
+    char num[32];
+    if (json_number(c, num, sizeof(num)) != 0) return -1;
+    *out = atof(num) != 0.0;
+    return 0;
+}
+
+static int json_skip_value(JsonCursor* c, int depth) {
+    json_skip_ws(c);
+    if (c->p >= c->end || depth > 32) return -1;
+    char ch = *c->p;
+    if (ch == '"') return json_string(c, NULL, 0);
+    if (ch == '{' || ch == '[') {
+        char close = (ch == '{') ? '}' : ']';
+        c->p++;
+        json_skip_ws(c);
+        if (c->p < c->end && *c->p == close) { c->p++; return 0; }
+        for (;;) {
+            if (ch == '{') {
+                if (json_string(c, NULL, 0) != 0 || json_expect(c, ':') != 0) return -1;
+            }
+            if (json_skip_value(c, depth + 1) != 0) return -1;
+            json_skip_ws(c);
+            if (c->p < c->end && *c->p == ',') { c->p++; continue; }
+            return json_expect(c, close);
+        }
+    }
+    if (json_literal(c, "true") == 0 || json_literal(c, "false") == 0 || json_literal(c, "null") == 0) return 0;
+    return json_number(c, NULL, 0);
+}
+
+// "m", "--m", "melody", "--melody", ... as accepted on the command line
+static void apply_flag(ServeRequest* req, const char* flag) {
+    while (*flag == '-') flag++;
+    if (strcmp(flag, "m") == 0 || strcmp(flag, "melody") == 0) req->melody = 1;
+    else if (strcmp(flag, "s") == 0 || strcmp(flag, "structure") == 0) req->structure = 1;
+    else if (strcmp(flag, "g") == 0 || strcmp(flag, "genius") == 0) req->genius = 1;
+    else if (strcmp(flag, "fast-math") == 0) req->fast_math = 1;
+}
+
+// Returns 0 on success, otherwise fills err with a short reason.
+static int parse_request(const char* line, size_t len, ServeRequest* req, const char** err) {
+    memset(req, 0, sizeof(*req));
+    JsonCursor c = {line, line + len};
+    *err = "malformed JSON request";
+
+    if (json_expect(&c, '{') != 0) return -1;
+    json_skip_ws(&c);
+    if (c.p < c.end && *c.p == '}') {
+        c.p++;
+    } else {
+        for (;;) {
+            char key[32];
+            if (json_string(&c, key, sizeof(key)) != 0 || json_expect(&c, ':') != 0) return -1;
+            json_skip_ws(&c);
+            int rc = 0;
+            if (strcmp(key, "id") == 0) {
+                if (c.p < c.end && *c.p == '"') { rc = json_string(&c, req->id, sizeof(req->id)); req->id_kind = 1; }
+                else                            { rc = json_number(&c, req->id, sizeof(req->id)); req->id_kind = 2; }
+                if (rc != 0) req->id_kind = 0;
+            } else if (strcmp(key, "path") == 0 || strcmp(key, "file") == 0) {
+                rc = json_string(&c, req->path, sizeof(req->path));
+            } else if (strcmp(key, "genre") == 0) {
+                rc = json_string(&c, req->genre, sizeof(req->genre));
+            } else if (strcmp(key, "melody") == 0) {
+                rc = json_bool(&c, &req->melody);
+            } else if (strcmp(key, "structure") == 0) {
+                rc = json_bool(&c, &req->structure);
+            } else if (strcmp(key, "genius") == 0) {
+                rc = json_bool(&c, &req->genius);
+            } else if (strcmp(key, "fast_math") == 0) {
+                rc = json_bool(&c, &req->fast_math);
+            } else if (strcmp(key, "melody_backend") == 0) {
+                char name[32];
+                rc = json_string(&c, name, sizeof(name));
+                if (rc == 0 && genius_parse_melody_backend(name, &req->melody_backend) != 0) {
+                    *err = "unknown \"melody_backend\"";
+                    return -1;
+                }
+            } else if (strcmp(key, "only") == 0) {
+                char list[256];
+                rc = json_string(&c, list, sizeof(list));
+                if (rc == 0 && genius_parse_features(list, &req->features) != 0) {
+                    *err = "unknown feature in \"only\"";
+                    return -1;
+                }
+            } else if (strcmp(key, "budget") == 0) {
+                char num[32];
+                rc = json_number(&c, num, sizeof(num));
+                if (rc == 0) req->budget_sec = atof(num);
+            } else if (strcmp(key, "flags") == 0) {
+                if (json_expect(&c, '[') != 0) return -1;
+                json_skip_ws(&c);
+                if (c.p < c.end && *c.p == ']') {
+                    c.p++;
+                } else {
+                    for (;;) {
+                        char flag[32];
+                        if (json_string(&c, flag, sizeof(flag)) != 0) return -1;
+                        apply_flag(req, flag);
+                        json_skip_ws(&c);
+                        if (c.p < c.end && *c.p == ',') { c.p++; continue; }
+                        if (json_expect(&c, ']') != 0) return -1;
+                        break;
+                    }
+                }
+            } else {
+                rc = json_skip_value(&c, 0);
+            }
+            if (rc != 0) return -1;
+            json_skip_ws(&c);
+            if (c.p < c.end && *c.p == ',') { c.p++; continue; }
+            if (json_expect(&c, '}') != 0) return -1;
+            break;
+        }
+    }
+    json_skip_ws(&c);
+    if (c.p != c.end) return -1;
+
+    if (req->path[0] == '\0') {
+        *err = "missing \"path\"";
+        return -1;
+    }
+    if (strcmp(req->path, "-") == 0) {
+        *err = "stdin input is not available in server mode";
+        return -1;
+    }
+    return 0;
+}
+
+// ---------- Connections and the job queue ----------
+
+typedef struct Connection {
+    int fd;
+    int refs;                 // reader thread + queued/running jobs (server lock)
+    int dead;                 // peer gone: skip remaining work (write_lock)
+    pthread_mutex_t write_lock;
+    struct Server* server;
+    struct Connection* next;
+} Connection;
+
+typedef struct {
+    Connection* conn;
+    ServeRequest req;
+} Job;
+
+typedef struct Server {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t conns_done;
+
+    Job* jobs;                // ring buffer
+    int capacity, head, count;
+    int workers, running;
+    int stopping;
+    double avg_job_ms;        // moving average of analysis time
+
+    Connection* conns;
+    int conn_count, max_conns;
+
+    unsigned long long served, rejected, failed;
+} Server;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static void conn_send(Connection* conn, const unsigned char* data, size_t len) {
+    pthread_mutex_lock(&conn->write_lock);
+    while (!conn->dead && len > 0) {
+        ssize_t n = send(conn->fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            conn->dead = 1;
+            break;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    pthread_mutex_unlock(&conn->write_lock);
+}
+
+static int conn_dead(Connection* conn) {
+    pthread_mutex_lock(&conn->write_lock);
+    int dead = conn->dead;
+    pthread_mutex_unlock(&conn->write_lock);
+    return dead;
+}
+
+// Drop one reference; the last one closes the socket.
+static void conn_release(Connection* conn) {
+    Server* s = conn->server;
+    pthread_mutex_lock(&s->lock);
+    int last = (--conn->refs == 0);
+    if (last) {
+        Connection** pp = &s->conns;
+        while (*pp && *pp != conn) pp = &(*pp)->next;
+        if (*pp) *pp = conn->next;
+        s->conn_count--;
+        pthread_cond_broadcast(&s->conns_done);
+    }
+    pthread_mutex_unlock(&s->lock);
+    if (last) {
+        close(conn->fd);
+        pthread_mutex_destroy(&conn->write_lock);
+        free(conn);
+    }
+}
+
+// ---------- Responses (one JSONL record each) ----------
+
+static void write_id(OutputWriter* w, const ServeRequest* req) {
+    if (req && req->id_kind == 1) writer_string(w, "id", req->id);
+    else if (req && req->id_kind == 2) writer_double(w, "id", atof(req->id), -1);
+    else writer_null(w, "id");
+}
+
+static void respond_error(Connection* conn, OutputWriter* w, const ServeRequest* req,
+                          const char* message, int code) {
+    writer_reset(w);
+    writer_begin_object(w, NULL);
+    write_id(w, req);
+    writer_string(w, "status", "error");
+    writer_string(w, "error", message);
+    writer_int(w, "code", code);
+    writer_end_object(w);
+    if (writer_end_record(w) == 0) conn_send(conn, w->data, w->len);
+}
+
+static void respond_busy(Connection* conn, OutputWriter* w, const ServeRequest* req,
+                         int retry_after_ms, int queued) {
+    writer_reset(w);
+    writer_begin_object(w, NULL);
+    write_id(w, req);
+    writer_string(w, "status", "busy");
+    writer_int(w, "retry_after_ms", retry_after_ms);
+    writer_int(w, "queued", queued);
+    writer_end_object(w);
+    if (writer_end_record(w) == 0) conn_send(conn, w->data, w->len);
+}
+
+// Rough time until about half of the current backlog has drained, which is
+// when a retry is likely to find room in the queue (server lock held).
+static int retry_hint_ms(const Server* s) {
+    double per_job = s->avg_job_ms > 0.0 ? s->avg_job_ms : 1000.0;
+    double waves = (double)(s->count + s->running) / (double)s->workers;
+    double ms = per_job * waves / 2.0;
+    if (ms < 100.0) ms = 100.0;
+    if (ms > 60000.0) ms = 60000.0;
+    return (int)ms;
+}
+
+// ---------- Worker threads ----------
+
+typedef struct {
+    Server* server;
+    GeniusContext* ctx;
+    GeniusReport* report;       // reused for every request
+    pthread_t thread;
+} Worker;
+
+static void* worker_main(void* arg) {
+    Worker* wk = (Worker*)arg;
+    Server* s = wk->server;
+    OutputWriter w;
+    writer_init(&w, OUTPUT_JSONL);
+    trace_thread_name("worker");
+
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        while (s->count == 0 && !s->stopping) pthread_cond_wait(&s->not_empty, &s->lock);
+        if (s->count == 0) {                // stopping and drained
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        Job job = s->jobs[s->head];
+        s->head = (s->head + 1) % s->capacity;
+        s->count--;
+        s->running++;
+        trace_counter("queue_depth", s->count);
+        pthread_mutex_unlock(&s->lock);
+
+        double t0 = now_ms();
+        uint64_t t_trace = trace_now();
+        int rc = 0;
+        int skipped = conn_dead(job.conn);   // client went away while queued
+        if (!skipped) {
+            GeniusOptions opts;
+            genius_options_init(&opts);
+            opts.genre = job.req.genre[0] ? job.req.genre : NULL;
+            opts.melody = job.req.melody;
+            opts.structure = job.req.structure;
+            opts.genius = job.req.genius;
+            opts.budget_sec = job.req.budget_sec;
+            opts.features = job.req.features;
+            opts.fast_math = job.req.fast_math;
+            opts.melody_backend = job.req.melody_backend;
+            opts.input.decode_threads = 1;  // the pool already occupies every core
+
+            GeniusReport* report = wk->report;
+            rc = genius_analyze_file(wk->ctx, job.req.path, &opts, report);
+            double elapsed = now_ms() - t0;
+            if (rc == 0) {
+                writer_reset(&w);
+                writer_begin_object(&w, NULL);
+                write_id(&w, &job.req);
+                writer_string(&w, "status", "ok");
+                writer_double(&w, "elapsed_ms", elapsed, 1);
+                genius_report_write_object(report, job.req.path, &w, "result");
+                writer_end_object(&w);
+                if (writer_end_record(&w) == 0) conn_send(job.conn, w.data, w.len);
+                else respond_error(job.conn, &w, &job.req, "failed to serialize report", -1);
+            } else {
+                respond_error(job.conn, &w, &job.req, "failed to decode or analyze file", rc);
+            }
+        }
+        double elapsed = now_ms() - t0;
+        trace_span("serve", "request", t_trace, 0);
+
+        pthread_mutex_lock(&s->lock);
+        s->running--;
+        if (skipped) {
+            // nothing to account for
+        } else if (rc == 0) {
+            s->served++;
+            s->avg_job_ms = (s->avg_job_ms > 0.0) ? 0.8 * s->avg_job_ms + 0.2 * elapsed : elapsed;
+        } else {
+            s->failed++;
+        }
+        pthread_mutex_unlock(&s->lock);
+        conn_release(job.conn);
+    }
+
+    writer_free(&w);
+    return NULL;
+}
+
+// ---------- Connection reader threads ----------
+
+// Queue one request, or answer right away if it can't be accepted.
+static void submit(Connection* conn, OutputWriter* w, const char* line, size_t len) {
+    Server* s = conn->server;
+    ServeRequest req;
+    const char* err = NULL;
+    if (parse_request(line, len, &req, &err) != 0) {
+        respond_error(conn, w, req.id_kind ? &req : NULL, err, -1);
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (s->stopping) {
+        pthread_mutex_unlock(&s->lock);
+        respond_error(conn, w, &req, "server shutting down", -1);
+        return;
+    }
+    if (s->count == s->capacity) {
+        int retry = retry_hint_ms(s);
+        int queued = s->count;
+        s->rejected++;
+        pthread_mutex_unlock(&s->lock);
+        respond_busy(conn, w, &req, retry, queued);
+        return;
+    }
+    Job* job = &s->jobs[(s->head + s->count) % s->capacity];
+    job->conn = conn;
+    job->req = req;
+    s->count++;
+    conn->refs++;
+    trace_counter("queue_depth", s->count);
+    pthread_cond_signal(&s->not_empty);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void* reader_main(void* arg) {
+    Connection* conn = (Connection*)arg;
+    OutputWriter w;
+    writer_init(&w, OUTPUT_JSONL);
+    trace_thread_name("connection");
+
+    char* buf = (char*)malloc(SERVE_MAX_LINE);
+    size_t len = 0;
+    int overflow = 0;   // discarding the rest of an over-long line
+    while (buf) {
+        ssize_t n = recv(conn->fd, buf + len, SERVE_MAX_LINE - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += (size_t)n;
+
+        size_t start = 0;
+        for (size_t i = start; i < len; ++i) {
+            if (buf[i] != '\n') continue;
+            size_t line_len = i - start;
+            if (line_len > 0 && buf[start + line_len - 1] == '\r') line_len--;
+            if (!overflow && line_len > 0) submit(conn, &w, buf + start, line_len);
+            overflow = 0;
+            start = i + 1;
+        }
+        memmove(buf, buf + start, len - start);
+        len -= start;
+        if (len == SERVE_MAX_LINE) {
+            if (!overflow) respond_error(conn, &w, NULL, "request line too long", -1);
+            overflow = 1;
+            len = 0;
+        }
+    }
+
+    free(buf);
+    writer_free(&w);
+    conn_release(conn);
+    return NULL;
+}
+
+// ---------- Listener ----------
+
+static int open_listener(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // replace a stale socket from a previous run, but never a regular file
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Refusing to replace non-socket %s\n", path);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void reject_connection(int fd, int retry_after_ms) {
+    OutputWriter w;
+    writer_init(&w, OUTPUT_JSONL);
+    writer_begin_object(&w, NULL);
+    writer_null(&w, "id");
+    writer_string(&w, "status", "busy");
+    writer_int(&w, "retry_after_ms", retry_after_ms);
+    writer_string(&w, "error", "too many connections");
+    writer_end_object(&w);
+    if (writer_end_record(&w) == 0) {
+        ssize_t n = send(fd, w.data, w.len, MSG_NOSIGNAL);
+        (void)n;
+    }
+    writer_free(&w);
+    close(fd);
+}
+
+int run_server(const char* socket_path, const ServerOptions* opts) {
+    ServerOptions defaults;
+    if (!opts) {
+        server_options_init(&defaults);
+        opts = &defaults;
+    }
+    int workers = opts->workers;
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+
+    Server s;
+    memset(&s, 0, sizeof(s));
+    s.workers = workers;
+    s.capacity = opts->queue_capacity > 0 ? opts->queue_capacity : 4 * workers;
+    s.max_conns = opts->max_connections > 0 ? opts->max_connections : SERVE_DEFAULT_CONNS;
+    s.jobs = (Job*)malloc(sizeof(Job) * (size_t)s.capacity);
+    Worker* pool = (Worker*)calloc((size_t)workers, sizeof(Worker));
+    if (!s.jobs || !pool) {
+        free(s.jobs); free(pool);
+        return -1;
+    }
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.not_empty, NULL);
+    pthread_cond_init(&s.conns_done, NULL);
+
+    int listen_fd = open_listener(socket_path);
+    if (listen_fd < 0) {
+        free(s.jobs); free(pool);
+        return -2;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // contexts are created here, on one thread, before any worker starts
+    int started = 0;
+    for (; started < workers; ++started) {
+        pool[started].server = &s;
+        pool[started].ctx = genius_context_create();
+        pool[started].report = genius_report_create();
+        if (!pool[started].ctx || !pool[started].report ||
+            pthread_create(&pool[started].thread, NULL, worker_main, &pool[started]) != 0) {
+            genius_context_destroy(pool[started].ctx);
+            genius_report_destroy(pool[started].report);
+            break;
+        }
+    }
+    if (started == 0) {
+        fprintf(stderr, "Failed to start analysis workers\n");
+        close(listen_fd);
+        unlink(socket_path);
+        free(s.jobs); free(pool);
+        return -3;
+    }
+    s.workers = started;
+    fprintf(stderr, "Serving on %s (%d workers, queue %d, max %d connections)\n",
+            socket_path, s.workers, s.capacity, s.max_conns);
+
+    while (!g_stop) {
+        struct pollfd pfd = {listen_fd, POLLIN, 0};
+        int pr = poll(&pfd, 1, 500);
+        if (pr <= 0) continue;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        pthread_mutex_lock(&s.lock);
+        int full = s.conn_count >= s.max_conns;
+        int retry = retry_hint_ms(&s);
+        pthread_mutex_unlock(&s.lock);
+        if (full) {
+            reject_connection(fd, retry);
+            continue;
+        }
+
+        Connection* conn = (Connection*)calloc(1, sizeof(Connection));
+        if (!conn) { close(fd); continue; }
+        conn->fd = fd;
+        conn->refs = 1;
+        conn->server = &s;
+        pthread_mutex_init(&conn->write_lock, NULL);
+
+        pthread_mutex_lock(&s.lock);
+        conn->next = s.conns;
+        s.conns = conn;
+        s.conn_count++;
+        pthread_mutex_unlock(&s.lock);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_t tid;
+        if (pthread_create(&tid, &attr, reader_main, conn) != 0) conn_release(conn);
+        pthread_attr_destroy(&attr);
+    }
+
+    // Stop reading new requests, let the workers drain the queue, then wait
+    // for every connection to flush its last response and close.
+    close(listen_fd);
+    unlink(socket_path);
+    pthread_mutex_lock(&s.lock);
+    s.stopping = 1;
+    pthread_cond_broadcast(&s.not_empty);
+    for (Connection* c = s.conns; c; c = c->next) shutdown(c->fd, SHUT_RD);
+    pthread_mutex_unlock(&s.lock);
+
+    for (int i = 0; i < s.workers; ++i) {
+        pthread_join(pool[i].thread, NULL);
+        genius_context_destroy(pool[i].ctx);
+        genius_report_destroy(pool[i].report);
+    }
+
+    pthread_mutex_lock(&s.lock);
+    while (s.conn_count > 0) pthread_cond_wait(&s.conns_done, &s.lock);
+    pthread_mutex_unlock(&s.lock);
+
+    fprintf(stderr, "Server stopped: %llu served, %llu failed, %llu rejected\n",
+            s.served, s.failed, s.rejected);
+
+    pthread_cond_destroy(&s.conns_done);
+    pthread_cond_destroy(&s.not_empty);
+    pthread_mutex_destroy(&s.lock);
+    free(s.jobs);
+    free(pool);
+    return 0;
+}
+
+#endif // _WIN32
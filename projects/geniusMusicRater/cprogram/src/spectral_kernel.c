@@ -0,0 +1,341 @@
+#include "spectral_kernel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef DSP_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled per function (target attribute) and picked at run time,
+// so the library still runs on SSE2-only machines.
+#if defined(DSP_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define SK_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define SK_EPS        1e-12     // power floor inside the flatness log
+#define SK_BRIGHT_HZ  1500.0
+#define SK_ROLLOFF    0.85
+
+typedef struct {
+    double p, fp, ffp;          // sum of power, f*power, f^2*power
+    double logp;                // sum of log(power + eps)
+    double level, rise;         // sum of level, of rectified level rise
+} SegmentSums;
+
+typedef void (*SegmentFn)(const SpectralKernel* k, const DspComplex* X, int a, int b,
+                          double* power, double* level, const double* prev, SegmentSums* s);
+
+// ---------- Scalar reference ----------
+
+static void segment_scalar(const SpectralKernel* k, const DspComplex* X, int a, int b,
+                           double* power, double* level, const double* prev, SegmentSums* s) {
+    for (int i = a; i < b; i++) {
+        double p = X[i].r * X[i].r + X[i].i * X[i].i;
+        double f = (double)i * k->bin_hz;
+        power[i] = p;
+        s->p += p;
+        s->fp += f * p;
+        s->ffp += f * f * p;
+        if (k->flatness) s->logp += log(p + SK_EPS);
+        if (level) {
+            double v = sqrt(p) * k->level_scale;
+            if (k->compression > 0.0) v = log1p(k->compression * v);
+            level[i] = v;
+            s->level += v;
+            if (prev) {
+                double d = v - prev[i];
+                if (d > 0.0) s->rise += d;
+            }
+        }
+    }
+}
+
+// ---------- SSE2 ----------
+//
+// log(x) for positive normal x: x = 2^e * m with m folded into
+// [sqrt(1/2), sqrt(2)), log(m) = 2*atanh(t), t = (m-1)/(m+1), |t| < 0.172,
+// odd series through t^9. The first dropped term bounds the error: < 1e-9.
+
+#ifdef DSP_HAVE_SSE2
+static inline __m128d log_pd_sse2(__m128d x) {
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128i bits = _mm_castpd_si128(x);
+    __m128i e = _mm_srli_epi64(bits, 52);
+    // exponent to double: OR it into the mantissa of 2^52, subtract 2^52 + bias
+    __m128d ed = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(e, _mm_set1_epi64x(0x4330000000000000LL))),
+                            _mm_set1_pd(4503599627370496.0 + 1023.0));
+    __m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                              _mm_set1_epi64x(0x3FF0000000000000LL)));
+    __m128d big = _mm_cmpgt_pd(m, _mm_set1_pd(1.4142135623730951));
+    m = _mm_sub_pd(m, _mm_and_pd(big, _mm_mul_pd(m, _mm_set1_pd(0.5))));
+    ed = _mm_add_pd(ed, _mm_and_pd(big, one));
+    __m128d t = _mm_div_pd(_mm_sub_pd(m, one), _mm_add_pd(m, one));
+    __m128d t2 = _mm_mul_pd(t, t);
+    __m128d poly = _mm_set1_pd(2.0 / 9.0);
+    poly = _mm_add_pd(_mm_mul_pd(poly, t2), _mm_set1_pd(2.0 / 7.0));
+    poly = _mm_add_pd(_mm_mul_pd(poly, t2), _mm_set1_pd(2.0 / 5.0));
+    poly = _mm_add_pd(_mm_mul_pd(poly, t2), _mm_set1_pd(2.0 / 3.0));
+    poly = _mm_add_pd(_mm_mul_pd(poly, t2), _mm_set1_pd(2.0));
+    return _mm_add_pd(_mm_mul_pd(ed, _mm_set1_pd(0.69314718055994531)), _mm_mul_pd(poly, t));
+}
+
+static double hsum_pd(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static void segment_sse2(const SpectralKernel* k, const DspComplex* X, int a, int b,
+                         double* power, double* level, const double* prev, SegmentSums* s) {
+    const __m128d eps = _mm_set1_pd(SK_EPS);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d scale = _mm_set1_pd(k->level_scale);
+    const __m128d comp = _mm_set1_pd(k->compression * k->level_scale);
+    const __m128d df = _mm_set1_pd(k->bin_hz);
+    const __m128d two = _mm_set1_pd(2.0);
+    __m128d vk = _mm_set_pd((double)(a + 1), (double)a);
+    __m128d sp = zero, sfp = zero, sffp = zero, slog = zero, slev = zero, srise = zero;
+    int i = a;
+    for (; i + 2 <= b; i += 2) {
+        __m128d x0 = _mm_loadu_pd(&X[i].r);
+        __m128d x1 = _mm_loadu_pd(&X[i + 1].r);
+        x0 = _mm_mul_pd(x0, x0);
+        x1 = _mm_mul_pd(x1, x1);
+        __m128d p = _mm_add_pd(_mm_unpacklo_pd(x0, x1), _mm_unpackhi_pd(x0, x1));
+        _mm_storeu_pd(power + i, p);
+        __m128d f = _mm_mul_pd(vk, df);
+        vk = _mm_add_pd(vk, two);
+        __m128d fp = _mm_mul_pd(f, p);
+        sp = _mm_add_pd(sp, p);
+        sfp = _mm_add_pd(sfp, fp);
+        sffp = _mm_add_pd(sffp, _mm_mul_pd(f, fp));
+        if (k->flatness) slog = _mm_add_pd(slog, log_pd_sse2(_mm_add_pd(p, eps)));
+        if (level) {
+            __m128d m = _mm_sqrt_pd(p);
+            __m128d v = (k->compression > 0.0 ? log_pd_sse2(_mm_add_pd(one, _mm_mul_pd(m, comp)))
+                                              : _mm_mul_pd(m, scale));
+            _mm_storeu_pd(level + i, v);
+            slev = _mm_add_pd(slev, v);
+            if (prev) srise = _mm_add_pd(srise, _mm_max_pd(_mm_sub_pd(v, _mm_loadu_pd(prev + i)), zero));
+        }
+    }
+    s->p += hsum_pd(sp);
+    s->fp += hsum_pd(sfp);
+    s->ffp += hsum_pd(sffp);
+    s->logp += hsum_pd(slog);
+    s->level += hsum_pd(slev);
+    s->rise += hsum_pd(srise);
+    if (i < b) segment_scalar(k, X, i, b, power, level, prev, s);
+}
+#endif
+
+// ---------- AVX2 ----------
+
+#ifdef SK_HAVE_AVX2
+#define SK_AVX2 __attribute__((target("avx2")))
+
+static inline SK_AVX2 __m256d log_pd_avx2(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256i bits = _mm256_castpd_si256(x);
+    __m256i e = _mm256_srli_epi64(bits, 52);
+    __m256d ed = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(e, _mm256_set1_epi64x(0x4330000000000000LL))),
+                               _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                                    _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm256_sub_pd(m, _mm256_and_pd(big, _mm256_mul_pd(m, _mm256_set1_pd(0.5))));
+    ed = _mm256_add_pd(ed, _mm256_and_pd(big, one));
+    __m256d t = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    __m256d t2 = _mm256_mul_pd(t, t);
+    __m256d poly = _mm256_set1_pd(2.0 / 9.0);
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, t2), _mm256_set1_pd(2.0 / 7.0));
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, t2), _mm256_set1_pd(2.0 / 5.0));
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, t2), _mm256_set1_pd(2.0 / 3.0));
+    poly = _mm256_add_pd(_mm256_mul_pd(poly, t2), _mm256_set1_pd(2.0));
+    return _mm256_add_pd(_mm256_mul_pd(ed, _mm256_set1_pd(0.69314718055994531)), _mm256_mul_pd(poly, t));
+}
+
+static inline SK_AVX2 double hsum256_pd(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    return hsum_pd(_mm_add_pd(lo, hi));
+}
+
+static SK_AVX2 void segment_avx2(const SpectralKernel* k, const DspComplex* X, int a, int b,
+                                 double* power, double* level, const double* prev, SegmentSums* s) {
+    const __m256d eps = _mm256_set1_pd(SK_EPS);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d scale = _mm256_set1_pd(k->level_scale);
+    const __m256d comp = _mm256_set1_pd(k->compression * k->level_scale);
+    const __m256d df = _mm256_set1_pd(k->bin_hz);
+    const __m256d four = _mm256_set1_pd(4.0);
+    __m256d vk = _mm256_set_pd((double)(a + 3), (double)(a + 2), (double)(a + 1), (double)a);
+    __m256d sp = zero, sfp = zero, sffp = zero, slog = zero, slev = zero, srise = zero;
+    int i = a;
+    for (; i + 4 <= b; i += 4) {
+        __m256d x0 = _mm256_loadu_pd(&X[i].r);       // r0 i0 r1 i1
+        __m256d x1 = _mm256_loadu_pd(&X[i + 2].r);   // r2 i2 r3 i3
+        x0 = _mm256_mul_pd(x0, x0);
+        x1 = _mm256_mul_pd(x1, x1);
+        // hadd gives p0 p2 p1 p3; restore bin order
+        __m256d p = _mm256_permute4x64_pd(_mm256_hadd_pd(x0, x1), 0xD8);
+        _mm256_storeu_pd(power + i, p);
+        __m256d f = _mm256_mul_pd(vk, df);
+        vk = _mm256_add_pd(vk, four);
+        __m256d fp = _mm256_mul_pd(f, p);
+        sp = _mm256_add_pd(sp, p);
+        sfp = _mm256_add_pd(sfp, fp);
+        sffp = _mm256_add_pd(sffp, _mm256_mul_pd(f, fp));
+        if (k->flatness) slog = _mm256_add_pd(slog, log_pd_avx2(_mm256_add_pd(p, eps)));
+        if (level) {
+            __m256d m = _mm256_sqrt_pd(p);
+            __m256d v = (k->compression > 0.0 ? log_pd_avx2(_mm256_add_pd(one, _mm256_mul_pd(m, comp)))
+                                              : _mm256_mul_pd(m, scale));
+            _mm256_storeu_pd(level + i, v);
+            slev = _mm256_add_pd(slev, v);
+            if (prev) srise = _mm256_add_pd(srise, _mm256_max_pd(_mm256_sub_pd(v, _mm256_loadu_pd(prev + i)), zero));
+        }
+    }
+    s->p += hsum256_pd(sp);
+    s->fp += hsum256_pd(sfp);
+    s->ffp += hsum256_pd(sffp);
+    s->logp += hsum256_pd(slog);
+    s->level += hsum256_pd(slev);
+    s->rise += hsum256_pd(srise);
+    if (i < b) segment_scalar(k, X, i, b, power, level, prev, s);
+}
+#endif
+
+// ---------- Dispatch ----------
+
+static DSP_THREAD_LOCAL SegmentFn g_segment = NULL;
+static DSP_THREAD_LOCAL const char* g_isa = NULL;
+
+static void resolve_isa(void) {
+    const char* cap = getenv("GENIUS_SIMD");
+    g_segment = segment_scalar;
+    g_isa = "scalar";
+    if (cap && strcmp(cap, "scalar") == 0) return;
+#ifdef DSP_HAVE_SSE2
+    g_segment = segment_sse2;
+    g_isa = "sse2";
+    if (cap && strcmp(cap, "sse2") == 0) return;
+#endif
+#ifdef SK_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        g_segment = segment_avx2;
+        g_isa = "avx2";
+    }
+#endif
+}
+
+const char* spectral_kernel_isa(void) {
+    if (!g_segment) resolve_isa();
+    return g_isa;
+}
+
+// ---------- Public API ----------
+
+int spectral_kernel_init(SpectralKernel* k, int n_fft, int sample_rate,
+                         const int* band_first, int n_bands) {
+    if (!k || n_fft < 2 || sample_rate <= 0 || n_bands < 0 || n_bands > SPECTRAL_MAX_BANDS) return -1;
+    if (n_bands > 0 && !band_first) return -1;
+    memset(k, 0, sizeof(*k));
+    k->n_fft = n_fft;
+    k->n_bins = n_fft / 2 + 1;
+    k->bin_hz = (double)sample_rate / (double)n_fft;
+    k->bright_bin = (int)ceil(SK_BRIGHT_HZ * n_fft / (double)sample_rate);
+    if (k->bright_bin > k->n_bins) k->bright_bin = k->n_bins;
+    k->level_scale = 1.0;
+    k->n_bands = n_bands;
+    for (int b = 0; b <= n_bands && n_bands > 0; b++) {
+        int v = band_first[b];
+        if (v < 0 || v > k->n_bins || (b > 0 && v < k->band_first[b-1])) return -1;
+        k->band_first[b] = v;
+    }
+
+    // segment boundaries: 0, the bright bin, the band edges, n_bins
+    int cuts[SPECTRAL_MAX_BANDS + 4];
+    int n_cuts = 0;
+    cuts[n_cuts++] = 0;
+    cuts[n_cuts++] = k->bright_bin;
+    for (int b = 0; b <= n_bands && n_bands > 0; b++) cuts[n_cuts++] = k->band_first[b];
+    cuts[n_cuts++] = k->n_bins;
+    for (int i = 1; i < n_cuts; i++) {        // insertion sort, a handful of entries
+        int v = cuts[i], j = i;
+        while (j > 0 && cuts[j-1] > v) { cuts[j] = cuts[j-1]; j--; }
+        cuts[j] = v;
+    }
+    k->n_segments = 0;
+    for (int i = 0; i + 1 < n_cuts; i++) {
+        if (cuts[i+1] <= cuts[i]) continue;
+        int a = cuts[i];
+        int band = -1;
+        for (int b = 0; b < n_bands; b++) {
+            if (a >= k->band_first[b] && a < k->band_first[b+1]) { band = b; break; }
+        }
+        k->seg_start[k->n_segments] = a;
+        k->seg_band[k->n_segments] = band;
+        k->n_segments++;
+        k->seg_start[k->n_segments] = cuts[i+1];
+    }
+    return 0;
+}
+
+void spectral_kernel_run(const SpectralKernel* k, const DspComplex* X,
+                         double* power, double* level, const double* prev_level,
+                         double* band_level, SpectralFrame* out) {
+    if (!g_segment) resolve_isa();
+    if (!level) prev_level = NULL;
+
+    SegmentSums total = {0};
+    double bright = 0.0;
+    double band_rise[SPECTRAL_MAX_BANDS] = {0};
+    double band_sum[SPECTRAL_MAX_BANDS] = {0};
+    for (int s = 0; s < k->n_segments; s++) {
+        int a = k->seg_start[s], b = k->seg_start[s+1];
+        SegmentSums seg = {0};
+        g_segment(k, X, a, b, power, level, prev_level, &seg);
+        total.p += seg.p;
+        total.fp += seg.fp;
+        total.ffp += seg.ffp;
+        total.logp += seg.logp;
+        if (a >= k->bright_bin) bright += seg.p;
+        int band = k->seg_band[s];
+        if (band >= 0) {
+            band_rise[band] += seg.rise;
+            band_sum[band] += seg.level;
+        }
+    }
+
+    double e = total.p;
+    out->energy = e;
+    out->centroid = (e > 1e-12 ? total.fp / e : 0.0);
+    double spread = (e > 1e-12 ? total.ffp / e - out->centroid * out->centroid : 0.0);
+    out->bandwidth = (spread > 0.0 ? sqrt(spread) : 0.0);
+    out->brightness = (e > 1e-12 ? bright / e : 0.0);
+    out->flatness = 0.0;
+    if (k->flatness && e > 1e-12) {
+        double am = e / (double)k->n_bins;
+        out->flatness = exp(total.logp / (double)k->n_bins) / (am + SK_EPS);
+        if (out->flatness > 1.0) out->flatness = 1.0;
+    }
+
+    // rolloff needs the total first: one short scan over the stored power
+    double target = SK_ROLLOFF * e, acc = 0.0;
+    out->rolloff = 0.0;
+    for (int i = 0; i < k->n_bins; i++) {
+        acc += power[i];
+        if (acc >= target) { out->rolloff = (double)i * k->bin_hz; break; }
+    }
+
+    out->flux = 0.0;
+    for (int b = 0; b < k->n_bands; b++) {
+        int width = k->band_first[b+1] - k->band_first[b];
+        if (width <= 0) continue;
+        if (prev_level) out->flux += band_rise[b] / width;
+        if (band_level) band_level[b] = band_sum[b] / width;
+    }
+}
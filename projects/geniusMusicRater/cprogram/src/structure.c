@@ -4,52 +4,89 @@
 #include <string.h>
 #include <math.h>
 #include "feature_extractor.h"  // for FEATURE_MFCC_COUNT
+#include "plan.h"
+
+// novelty between consecutive blocks of onset frames [start[i], start[i+1]):
+// change of the mean band levels (timbre) plus change of the mean onset
+// strength (rhythmic density), each scaled to a maximum of 1
+static int compute_block_novelty(const OnsetFunction* onset, const size_t* start, size_t n_blocks,
+                                 double* novelty) {
+    double* spectral = (double*)calloc(n_blocks, sizeof(double));
+    double* density = (double*)calloc(n_blocks, sizeof(double));
+    if (!spectral || !density) {
+        free(spectral); free(density);
+        return 1;
+    }
+
+    double prev_bands[ONSET_BANDS] = {0};
+    double prev_odf = 0.0;
+    double max_spectral = 1e-9, max_density = 1e-9;
+    for (size_t i = 0; i < n_blocks; i++) {
+        size_t lo = start[i], hi = start[i+1];
+        double bands[ONSET_BANDS] = {0};
+        double odf = 0.0;
+        for (size_t f = lo; f < hi; f++) {
+            const float* e = onset->band_energy + f * ONSET_BANDS;
+            for (int b = 0; b < ONSET_BANDS; b++) bands[b] += e[b];
+            odf += onset->odf[f];
+        }
+        double len = (double)(hi > lo ? hi - lo : 1);
+        for (int b = 0; b < ONSET_BANDS; b++) bands[b] /= len;
+        odf /= len;
 
-// helper: magnitude spectrum (simple DFT)
-static void compute_magnitude_spectrum(const float* frame, int N, double* mag) {
-    for (int k = 0; k < N/2; k++) {
-        double real = 0.0, imag = 0.0;
-        for (int n = 0; n < N; n++) {
-            double angle = -2.0 * M_PI * k * n / N;
-            real += frame[n] * cos(angle);
-            imag += frame[n] * sin(angle);
+        if (i > 0) {
+            for (int b = 0; b < ONSET_BANDS; b++) spectral[i] += fabs(bands[b] - prev_bands[b]);
+            density[i] = fabs(odf - prev_odf);
         }
-        mag[k] = sqrt(real*real + imag*imag);
+        if (spectral[i] > max_spectral) max_spectral = spectral[i];
+        if (density[i] > max_density) max_density = density[i];
+        memcpy(prev_bands, bands, sizeof(bands));
+        prev_odf = odf;
+    }
+
+    for (size_t i = 0; i < n_blocks; i++) {
+        novelty[i] = 0.5 * (spectral[i] / max_spectral + density[i] / max_density);
     }
+    free(spectral);
+    free(density);
+    return 0;
 }
 
-// novelty function (spectral flux)
-static int compute_novelty_curve(const float* mono, size_t frames, int sr,
-                                 double hop_sec, double** out_curve, size_t* out_len) {
-    int win_size = 1024; // ~23ms at 44.1kHz
-    int hop_size = (int)(hop_sec * sr); // hop in samples
-    if (hop_size <= 0) hop_size = win_size / 2;
-
-    size_t n_frames = (frames - win_size) / hop_size;
-    double* novelty = (double*)calloc(n_frames, sizeof(double));
-    if (!novelty) return 1;
-
-    double* prev_mag = (double*)calloc(win_size/2, sizeof(double));
-    double* mag = (double*)calloc(win_size/2, sizeof(double));
-
-    for (size_t f = 0; f < n_frames; f++) {
-        const float* frame = mono + f * hop_size;
-        compute_magnitude_spectrum(frame, win_size, mag);
-
-        double flux = 0.0;
-        for (int k = 0; k < win_size/2; k++) {
-            double diff = mag[k] - prev_mag[k];
-            if (diff > 0) flux += diff; // rectified difference
-            prev_mag[k] = mag[k];
+// novelty per beat of `beats` (>= 3 beats), otherwise per `hop_sec` block
+static int compute_novelty_curve(const OnsetFunction* onset, const BeatGrid* beats, double hop_sec,
+                                 double** out_curve, double** out_times, size_t* out_len) {
+    size_t n_blocks = 0;
+    size_t* start = NULL;
+    if (beats && beats->beat_count >= 3) {
+        n_blocks = beats->beat_count;
+        start = (size_t*)malloc(sizeof(size_t) * (n_blocks + 1));
+        if (!start) return 1;
+        for (size_t b = 0; b < n_blocks; b++) {
+            size_t f = beats->beat_frames[b];
+            start[b] = (f < onset->odf_len ? f : onset->odf_len);
         }
-        novelty[f] = flux;
+        start[n_blocks] = onset->odf_len;
+    } else {
+        size_t hop = (size_t)lround(hop_sec * onset->frame_rate);
+        if (hop == 0) hop = 1;
+        n_blocks = onset->odf_len / hop;
+        start = (size_t*)malloc(sizeof(size_t) * (n_blocks + 1));
+        if (!start) return 1;
+        for (size_t b = 0; b <= n_blocks; b++) start[b] = b * hop;
     }
 
-    free(prev_mag);
-    free(mag);
+    double* novelty = (double*)calloc(n_blocks > 0 ? n_blocks : 1, sizeof(double));
+    double* times = (double*)calloc(n_blocks > 0 ? n_blocks : 1, sizeof(double));
+    if (!novelty || !times || compute_block_novelty(onset, start, n_blocks, novelty) != 0) {
+        free(start); free(novelty); free(times);
+        return 1;
+    }
+    for (size_t b = 0; b < n_blocks; b++) times[b] = start[b] / onset->frame_rate;
+    free(start);
 
     *out_curve = novelty;
-    *out_len = n_frames;
+    *out_times = times;
+    *out_len = n_blocks;
     return 0;
 }
 
@@ -95,19 +132,48 @@ int compute_structure_features(const float* mono,
                                size_t frames,
                                int sample_rate,
                                StructureFeatures* out)
+{
+    return compute_structure_features_beats(mono, frames, sample_rate, NULL, out);
+}
+
+int compute_structure_features_beats(const float* mono,
+                                     size_t frames,
+                                     int sample_rate,
+                                     const BeatGrid* beats,
+                                     StructureFeatures* out)
 {
     if (!mono || frames == 0 || sample_rate <= 0 || !out) return 1;
+    OnsetFunction onset;
+    if (compute_onset_function(mono, frames, sample_rate, &onset) != 0) {
+        memset(out, 0, sizeof(*out));
+        return 2;
+    }
+    int rc = compute_structure_features_onset(mono, frames, sample_rate, &onset, beats, out);
+    free_onset_function(&onset);
+    return rc;
+}
+
+int compute_structure_features_onset(const float* mono,
+                                     size_t frames,
+                                     int sample_rate,
+                                     const OnsetFunction* onset,
+                                     const BeatGrid* beats,
+                                     StructureFeatures* out)
+{
+    if (!mono || frames == 0 || sample_rate <= 0 || !onset || !out) return 1;
 
     // reset
     out->sections = NULL;
     out->section_count = 0;
     out->arc_complexity = 0.0;
     out->repetition_ratio = 0.0;
+    out->repetition_valid = 0;
 
-    // compute novelty curve
+    // compute novelty curve: per beat, or every 0.5 s without a beat grid
     double* novelty = NULL;
+    double* times = NULL;
     size_t n_frames = 0;
-    if (compute_novelty_curve(mono, frames, sample_rate, 0.5, &novelty, &n_frames) != 0)
+    if (compute_novelty_curve(onset, beats, 0.5, &novelty, &times, &n_frames) != 0)
         return 2;
 
     // normalize novelty
@@ -119,17 +185,17 @@ int compute_structure_features(const float* mono,
     double threshold = 0.5; // relative novelty, changed from 0.3
     size_t max_sections = 128;
     Section* sections = (Section*)calloc(max_sections, sizeof(Section));
-    if (!sections) { free(novelty); return 3; }
+    if (!sections) { free(novelty); free(times); return 3; }
     
     size_t sec_count = 0;
     double duration_sec = (double)frames / sample_rate;
     double last_boundary = 0.0;
 
-    for (size_t i=1; i<n_frames-1; i++) {
+    for (size_t i=1; i+1<n_frames; i++) {
         if (novelty[i] > threshold &&
             novelty[i] > novelty[i-1] &&
             novelty[i] > novelty[i+1]) {
-            double time_sec = (double)(i * 0.5); // hop_sec = 0.5s
+            double time_sec = times[i];
             if (time_sec - last_boundary > 20.0) {
                 if (sec_count < max_sections) {
                     sections[sec_count].start_sec = last_boundary;
@@ -153,6 +219,7 @@ int compute_structure_features(const float* mono,
     }
 
     free(novelty);
+    free(times);
 
     // --- Compute lengths ---
     double* lengths = (double*)calloc(sec_count, sizeof(double));
@@ -206,11 +273,22 @@ int compute_structure_features(const float* mono,
     out->arc_complexity = entropy / log(sec_count > 1 ? (double)sec_count : 2.0);
 
     // --- Inside compute_structure_features, after segmentation + arc complexity ---
+    // Under a budget plan, section timbre uses every hop_scale-th frame, and
+    // sections reached after the deadline stay unanalysed.
+    StagePlan* plan = analysis_plan_stage(PLAN_STRUCTURE);
+    int stride = plan ? plan->hop_scale : 1;
+    double covered_sec = 0.0;
+    double analysed_sec = 0.0;
     int mfcc_dim = FEATURE_MFCC_COUNT;
     double** mfcc_means = (double**)calloc(sec_count, sizeof(double*));
+    unsigned char* analysed = (unsigned char*)calloc(sec_count, 1);
 
     for (size_t i=0; i<sec_count; i++) {
         mfcc_means[i] = (double*)calloc(mfcc_dim, sizeof(double));
+        if (analysis_plan_expired(plan)) {
+            plan->truncated = 1;
+            continue;
+        }
 
         // extract average MFCC for section
         double start = out->sections[i].start_sec;
@@ -222,20 +300,30 @@ int compute_structure_features(const float* mono,
         if (end_idx > frames) end_idx = frames;
 
         SpectralFeatures feat;
-        if (compute_spectral_features(mono + start_idx, end_idx - start_idx,
-                                    sample_rate, &feat) == 0) {
+        if (compute_spectral_features_stride(mono + start_idx, end_idx - start_idx,
+                                             sample_rate, stride, &feat) == 0) {
             for (int k=0; k<mfcc_dim; k++) {
                 mfcc_means[i][k] = feat.mfcc[k];
             }
+            analysed[i] = 1;
+            analysed_sec += end - start;
         }
+        covered_sec += end - start;
+    }
+    if (plan) {
+        plan->ran = 1;
+        plan->hop_sec = 512.0 * stride / (double)sample_rate;   // compute_spectral_features hop
+        plan->coverage = (total > 1e-6 ? fmin(1.0, covered_sec / total) : 1.0) / (double)stride;
     }
 
     // --- Repetition ratio ---
-    // Compute descriptor per section
+    // Only sections with a descriptor take part, relative to their duration
     double repeated_time = 0.0;
     for (size_t i=0; i<sec_count; i++) {
+        if (!analysed[i]) continue;
         double len_i = out->sections[i].end_sec - out->sections[i].start_sec;
         for (size_t j=i+1; j<sec_count; j++) {
+            if (!analysed[j]) continue;
             double sim = cosine_similarity(mfcc_means[i], mfcc_means[j], mfcc_dim);
             if (sim > 0.85) { // threshold for repetition
                 repeated_time += fmin(len_i,
@@ -243,16 +331,14 @@ int compute_structure_features(const float* mono,
             }
         }
     }
-    if (total > 1e-6)
-        out->repetition_ratio = fmin(1.0, repeated_time / total);
-    else
-        out->repetition_ratio = 0.0;
-    
+    out->repetition_valid = (analysed_sec > 1e-6);
+    out->repetition_ratio = (out->repetition_valid ? fmin(1.0, repeated_time / analysed_sec) : 0.0);
 
     for (size_t i=0; i<sec_count; i++) {
         free(mfcc_means[i]);
     }
     free(mfcc_means);
+    free(analysed);
 
     return 0;
 }
@@ -0,0 +1,252 @@
+#include "timeline.h"
+#include "rhythm.h"
+#include "harmony.h"
+#include "psychoacoustics.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define TIMELINE_TEMPO_TOL   0.04     // local tempo agrees with the track tempo within +-4%
+#define TIMELINE_EPS         1e-9     // slack when converting seconds to frame indices
+
+// ---------- Build ----------
+
+void genius_timeline_free(GeniusTimeline* tl) {
+    if (!tl) return;
+    free(tl->odf); free(tl->beat_before); free(tl->chord_before);
+    free(tl->beat_on); free(tl->beat_off); free(tl->off_count);
+    free(tl->tension); free(tl->tension_count); free(tl->motion); free(tl->motion_count);
+    free(tl->tempo); free(tl->tempo_count); free(tl->tempo_agree);
+    free(tl->level_db);
+    memset(tl, 0, sizeof(*tl));
+}
+
+static int alloc_tables(GeniusTimeline* tl) {
+    size_t n = tl->n_frames + 1, b = tl->beat_count + 1, c = tl->chord_count + 1, s = tl->seconds + 1;
+    tl->odf = (double*)calloc(n, sizeof(double));
+    tl->beat_before = (size_t*)calloc(n, sizeof(size_t));
+    tl->chord_before = (size_t*)calloc(n, sizeof(size_t));
+    tl->beat_on = (double*)calloc(b, sizeof(double));
+    tl->beat_off = (double*)calloc(b, sizeof(double));
+    tl->off_count = (size_t*)calloc(b, sizeof(size_t));
+    tl->tension = (double*)calloc(c, sizeof(double));
+    tl->tension_count = (size_t*)calloc(c, sizeof(size_t));
+    tl->motion = (double*)calloc(c, sizeof(double));
+    tl->motion_count = (size_t*)calloc(c, sizeof(size_t));
+    tl->tempo = (double*)calloc(s, sizeof(double));
+    tl->tempo_count = (size_t*)calloc(s, sizeof(size_t));
+    tl->tempo_agree = (size_t*)calloc(s, sizeof(size_t));
+    return (tl->odf && tl->beat_before && tl->chord_before && tl->beat_on && tl->beat_off &&
+            tl->off_count && tl->tension && tl->tension_count && tl->motion && tl->motion_count &&
+            tl->tempo && tl->tempo_count && tl->tempo_agree) ? 0 : -1;
+}
+
+static void build_beats(GeniusTimeline* tl, const BeatGrid* beats) {
+    size_t j = 0;
+    for (size_t f = 0; f <= tl->n_frames; f++) {
+        while (j < tl->beat_count && beats->beat_frames[j] < f) j++;
+        tl->beat_before[f] = j;
+    }
+
+    double* on = (double*)malloc(sizeof(double) * (tl->beat_count ? tl->beat_count : 1));
+    double* off = (double*)malloc(sizeof(double) * (tl->beat_count ? tl->beat_count : 1));
+    if (on && off) {
+        rhythm_beat_peaks(beats, on, off);
+        for (size_t b = 0; b < tl->beat_count; b++) {
+            tl->beat_on[b+1] = tl->beat_on[b] + on[b];
+            tl->beat_off[b+1] = tl->beat_off[b] + (off[b] >= 0.0 ? off[b] : 0.0);
+            tl->off_count[b+1] = tl->off_count[b] + (off[b] >= 0.0);
+        }
+    } else {
+        tl->beat_count = 0;     // range pulse/syncopation fall back to the track values
+        memset(tl->beat_before, 0, sizeof(size_t) * (tl->n_frames + 1));
+    }
+    free(on);
+    free(off);
+}
+
+static void build_chords(GeniusTimeline* tl, const HarmonyFeatures* harmony) {
+    size_t j = 0;
+    for (size_t f = 0; f <= tl->n_frames; f++) {
+        while (j < tl->chord_count && harmony->chords[j].time_sec * tl->frame_rate < (double)f) j++;
+        tl->chord_before[f] = j;
+    }
+    for (size_t i = 0; i < tl->chord_count; i++) {
+        double t = harmony_chord_tension(harmony->chords[i].name, harmony->global_key);
+        double d = (i > 0 ? harmony_chord_distance(harmony->chords[i-1].name, harmony->chords[i].name) : -1.0);
+        tl->tension[i+1] = tl->tension[i] + (t >= 0.0 ? t : 0.0);
+        tl->tension_count[i+1] = tl->tension_count[i] + (t >= 0.0);
+        tl->motion[i+1] = tl->motion[i] + (d >= 0.0 ? d : 0.0);
+        tl->motion_count[i+1] = tl->motion_count[i] + (d >= 0.0);
+    }
+}
+
+static void build_seconds(GeniusTimeline* tl, const RhythmFeatures* rhythm) {
+    for (size_t s = 0; s < tl->seconds; s++) {
+        double lt = (rhythm && s < rhythm->local_tempo_len) ? rhythm->local_tempo[s] : 0.0;
+        int agree = (lt > 0.0 && rhythm->tempo_bpm > 0.0 &&
+                     fabs(lt - rhythm->tempo_bpm) <= TIMELINE_TEMPO_TOL * rhythm->tempo_bpm);
+        tl->tempo[s+1] = tl->tempo[s] + (lt > 0.0 ? lt : 0.0);
+        tl->tempo_count[s+1] = tl->tempo_count[s] + (lt > 0.0);
+        tl->tempo_agree[s+1] = tl->tempo_agree[s] + agree;
+    }
+}
+
+int genius_timeline_build(GeniusTimeline* tl, const BeatGrid* beats, const RhythmFeatures* rhythm,
+                          const HarmonyFeatures* harmony, const LoudnessResult* loudness,
+                          const float* mono, size_t frames, int sr) {
+    if (!tl) return -1;
+    memset(tl, 0, sizeof(*tl));
+    if (!beats || !beats->odf || beats->odf_len == 0 || beats->sample_rate <= 0 || beats->hop_size == 0)
+        return -1;
+
+    tl->frame_rate = (double)beats->sample_rate / (double)beats->hop_size;
+    tl->n_frames = beats->odf_len;
+    tl->beat_count = (beats->beat_frames ? beats->beat_count : 0);
+    tl->chord_count = (harmony && harmony->chords && harmony->chord_count > 0) ? (size_t)harmony->chord_count : 0;
+    tl->seconds = (size_t)ceil((double)tl->n_frames / tl->frame_rate);
+    if (alloc_tables(tl) != 0) {
+        genius_timeline_free(tl);
+        return -2;
+    }
+
+    for (size_t f = 0; f < tl->n_frames; f++) tl->odf[f+1] = tl->odf[f] + beats->odf[f];
+    build_beats(tl, beats);
+    if (tl->chord_count > 0) build_chords(tl, harmony);
+    build_seconds(tl, rhythm);
+
+    if (loudness && loudness->blocks && loudness->block_hop_sec > 0.0) {
+        tl->blocks = loudness->blocks;
+        tl->block_count = loudness->block_count;
+        tl->block_hop_sec = loudness->block_hop_sec;
+    }
+    // without level frames a range keeps the track's dynamic range
+    if (mono && frames > 0 && sr > 0 && psy_frame_levels_db(mono, frames, &tl->level_db, &tl->level_count) == 0) {
+        tl->level_hop_sec = (double)PSY_LEVEL_HOP / (double)sr;
+    }
+    return 0;
+}
+
+// ---------- Range queries ----------
+
+static size_t clamp_index(double x, size_t hi) {
+    if (!(x > 0.0)) return 0;
+    return (x >= (double)hi ? hi : (size_t)x);
+}
+
+void genius_timeline_inputs(const GeniusTimeline* tl, const GeniusInputs* track,
+                            double start_sec, double end_sec, GeniusInputs* out) {
+    *out = *track;
+    if (!tl || !tl->odf || end_sec <= start_sec) return;
+
+    // onset frames [fa, fb)
+    size_t fa = clamp_index(floor(start_sec * tl->frame_rate), tl->n_frames);
+    size_t fb = clamp_index(ceil(end_sec * tl->frame_rate), tl->n_frames);
+    if (fb > fa) out->rhythm.beat_strength = (tl->odf[fb] - tl->odf[fa]) / (double)(fb - fa);
+
+    size_t ba = tl->beat_before[fa], bb = tl->beat_before[fb];
+    size_t offs = tl->off_count[bb] - tl->off_count[ba];
+    if (bb - ba >= 2 && offs > 0) {
+        double avg_beat = (tl->beat_on[bb] - tl->beat_on[ba]) / (double)(bb - ba);
+        double avg_off = (tl->beat_off[bb] - tl->beat_off[ba]) / (double)offs;
+        out->rhythm.pulse_clarity = (avg_beat > 0.0 ? avg_beat / (avg_beat + avg_off + 1e-9) : 0.0);
+        out->rhythm.syncopation = avg_off / (avg_beat + avg_off + 1e-9);
+    }
+
+    // chords starting in the range; motion counts the steps between them
+    size_t ca = tl->chord_before[fa], cb = tl->chord_before[fb];
+    size_t tn = tl->tension_count[cb] - tl->tension_count[ca];
+    if (tn > 0) out->harmony.tension = (tl->tension[cb] - tl->tension[ca]) / (double)tn;
+    if (cb > ca + 1) {
+        size_t mn = tl->motion_count[cb] - tl->motion_count[ca+1];
+        if (mn > 0) out->harmony.harmonic_motion = (tl->motion[cb] - tl->motion[ca+1]) / (double)mn;
+    }
+
+    // whole seconds [sa, sb)
+    size_t sa = clamp_index(floor(start_sec), tl->seconds);
+    size_t sb = clamp_index(ceil(end_sec), tl->seconds);
+    size_t tc = tl->tempo_count[sb] - tl->tempo_count[sa];
+    if (tc > 0) {
+        out->rhythm.tempo_bpm = (tl->tempo[sb] - tl->tempo[sa]) / (double)tc;
+        out->rhythm.tempo_confidence = track->rhythm.tempo_confidence *
+                                       (double)(tl->tempo_agree[sb] - tl->tempo_agree[sa]) / (double)tc;
+    }
+
+    // 400 ms blocks that lie inside the range, gated like the integrated value
+    if (tl->blocks) {
+        size_t ka = clamp_index(ceil(start_sec / tl->block_hop_sec - TIMELINE_EPS), tl->block_count);
+        double last = floor(end_sec / tl->block_hop_sec + TIMELINE_EPS) - 3.0;   // 4 sub-blocks per block
+        size_t kb = clamp_index(last, tl->block_count);
+        if (kb > ka) out->psy.loudness_lu = loudness_gated(tl->blocks + ka, kb - ka);
+    }
+
+    // level frames starting in the range
+    if (tl->level_db) {
+        size_t la = clamp_index(ceil(start_sec / tl->level_hop_sec - TIMELINE_EPS), tl->level_count);
+        size_t lb = clamp_index(ceil(end_sec / tl->level_hop_sec - TIMELINE_EPS), tl->level_count);
+        if (lb > la + 1) out->psy.dynamic_range = psy_dynamic_range(tl->level_db + la, lb - la);
+    }
+}
+
+// ---------- Scores ----------
+
+static void score_span(const GeniusTimeline* tl, const GeniusInputs* track, GeniusGenre genre,
+                       double start_sec, double end_sec, GeniusSpan* span) {
+    GeniusInputs in;
+    GeniusResult r;
+    genius_timeline_inputs(tl, track, start_sec, end_sec, &in);
+    compute_genius_rating(&in, &r, genre);
+    span->start_sec = start_sec;
+    span->end_sec = end_sec;
+    span->overall = r.overall_score;
+    span->harmony = r.harmony_score;
+    span->progression = r.progression_score;
+    span->rhythm = r.rhythm_score;
+    span->timbre = r.timbre_score;
+    span->emotion = r.emotion_score;
+}
+
+void genius_timeline_scores_free(GeniusTimelineScores* s) {
+    if (!s) return;
+    free(s->sections);
+    free(s->rolling);
+    memset(s, 0, sizeof(*s));
+}
+
+int genius_timeline_score(const GeniusTimeline* tl, const GeniusInputs* track, GeniusGenre genre,
+                          const StructureFeatures* structure, double duration_sec,
+                          GeniusTimelineScores* out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!tl || !track) return -1;
+    out->window_sec = TIMELINE_WINDOW_SEC;
+    out->hop_sec = TIMELINE_HOP_SEC;
+
+    if (structure && structure->sections && structure->section_count > 0) {
+        out->sections = (GeniusSpan*)calloc(structure->section_count, sizeof(GeniusSpan));
+        if (!out->sections) return -2;
+        out->section_count = structure->section_count;
+        for (size_t i = 0; i < structure->section_count; i++) {
+            const Section* sec = &structure->sections[i];
+            score_span(tl, track, genre, sec->start_sec, sec->end_sec, &out->sections[i]);
+        }
+    }
+
+    if (duration_sec > 0.0) {
+        size_t n = (size_t)ceil(duration_sec / TIMELINE_HOP_SEC);
+        out->rolling = (int*)malloc(sizeof(int) * n);
+        if (!out->rolling) {
+            genius_timeline_scores_free(out);
+            return -2;
+        }
+        out->rolling_len = n;
+        for (size_t i = 0; i < n; i++) {
+            double centre = ((double)i + 0.5) * TIMELINE_HOP_SEC;
+            double a = centre - 0.5 * TIMELINE_WINDOW_SEC, b = centre + 0.5 * TIMELINE_WINDOW_SEC;
+            GeniusSpan span;
+            score_span(tl, track, genre, (a > 0.0 ? a : 0.0), (b < duration_sec ? b : duration_sec), &span);
+            out->rolling[i] = span.overall;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include "trace.h"
+#include "dsp.h"
+#include "output_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// ---------- Per-thread buffers ----------
+
+typedef struct {
+    const char* cat;            // NULL for counters
+    const char* name;
+    uint64_t ts;                // ns since trace_start()
+    uint64_t dur;               // spans: ns; counters: unused
+    double value;               // spans: bytes (0 = none); counters: the value
+} TraceEvent;
+
+typedef struct TraceChunk {
+    struct TraceChunk* next;
+    size_t fill;
+    TraceEvent ev[TRACE_CHUNK_EVENTS];
+} TraceChunk;
+
+typedef struct TraceBuffer {
+    struct TraceBuffer* next;   // registry list
+    int tid;                    // row in the trace, from 1
+    int active;                 // held by a running thread (registry lock)
+    char thread_name[32];
+    TraceChunk* head;
+    TraceChunk* tail;           // chunk being filled
+    size_t chunks;
+    size_t dropped;
+} TraceBuffer;
+
+static volatile int g_enabled = 0;
+static uint64_t g_origin = 0;   // raw clock at trace_start()
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer* g_buffers = NULL;
+static int g_buffer_count = 0;
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_key;
+static DSP_THREAD_LOCAL TraceBuffer* t_buf = NULL;
+
+static uint64_t raw_clock_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER c;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&c);
+    return (uint64_t)((double)c.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Thread exit: the buffer keeps its events and becomes free for a new thread.
+static void release_buffer(void* p) {
+    TraceBuffer* b = (TraceBuffer*)p;
+    pthread_mutex_lock(&g_lock);
+    b->active = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void make_key(void) {
+    pthread_key_create(&g_key, release_buffer);
+}
+
+// The calling thread's buffer, taken over or created on first use.
+static TraceBuffer* thread_buffer(void) {
+    if (t_buf) return t_buf;
+    pthread_once(&g_key_once, make_key);
+    pthread_mutex_lock(&g_lock);
+    TraceBuffer* b = g_buffers;
+    while (b && b->active) b = b->next;
+    if (!b && (b = (TraceBuffer*)calloc(1, sizeof(TraceBuffer))) != NULL) {
+        b->tid = ++g_buffer_count;
+        b->next = g_buffers;
+        g_buffers = b;
+    }
+    if (b) b->active = 1;
+    pthread_mutex_unlock(&g_lock);
+    if (!b) return NULL;
+    pthread_setspecific(g_key, b);
+    t_buf = b;
+    return b;
+}
+
+static TraceEvent* next_event(void) {
+    TraceBuffer* b = thread_buffer();
+    if (!b) return NULL;
+    TraceChunk* c = b->tail;
+    if (c && c->fill < TRACE_CHUNK_EVENTS) return &c->ev[c->fill++];
+
+    // chunks are kept across traces, so a restarted trace refills them first
+    if (c && c->next) {
+        c = c->next;
+    } else if (b->chunks < TRACE_MAX_CHUNKS && (c = (TraceChunk*)malloc(sizeof(TraceChunk))) != NULL) {
+        c->next = NULL;
+        if (b->tail) b->tail->next = c;
+        else b->head = c;
+        b->chunks++;
+    } else {
+        b->dropped++;
+        return NULL;
+    }
+    c->fill = 1;
+    b->tail = c;
+    return &c->ev[0];
+}
+
+// ---------- Recording ----------
+
+int trace_start(void) {
+    pthread_mutex_lock(&g_lock);
+    for (TraceBuffer* b = g_buffers; b; b = b->next) {
+        if (b->head) b->head->fill = 0;
+        b->tail = b->head;
+        b->dropped = 0;
+    }
+    g_origin = raw_clock_ns();
+    g_enabled = 1;
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+}
+
+void trace_stop(void) {
+    g_enabled = 0;
+}
+
+int trace_enabled(void) {
+    return g_enabled;
+}
+
+uint64_t trace_now(void) {
+    return g_enabled ? raw_clock_ns() - g_origin : 0;
+}
+
+void trace_span(const char* cat, const char* name, uint64_t t0, uint64_t bytes) {
+    if (!g_enabled) return;
+    uint64_t t1 = raw_clock_ns() - g_origin;
+    TraceEvent* e = next_event();
+    if (!e) return;
+    e->cat = cat;
+    e->name = name;
+    e->ts = t0;
+    e->dur = t1 > t0 ? t1 - t0 : 0;
+    e->value = (double)bytes;
+}
+
+void trace_counter(const char* name, double value) {
+    if (!g_enabled) return;
+    uint64_t t = raw_clock_ns() - g_origin;
+    TraceEvent* e = next_event();
+    if (!e) return;
+    e->cat = NULL;
+    e->name = name;
+    e->ts = t;
+    e->dur = 0;
+    e->value = value;
+}
+
+void trace_thread_name(const char* name) {
+    if (!g_enabled || !name) return;
+    TraceBuffer* b = thread_buffer();
+    if (b) snprintf(b->thread_name, sizeof(b->thread_name), "%s", name);
+}
+
+// ---------- Output ----------
+
+static void write_event(OutputWriter* w, const TraceEvent* e, int tid) {
+    writer_begin_object(w, NULL);
+    writer_string(w, "name", e->name);
+    writer_string(w, "ph", e->cat ? "X" : "C");
+    if (e->cat) writer_string(w, "cat", e->cat);
+    writer_double(w, "ts", (double)e->ts / 1000.0, 3);    // microseconds
+    if (e->cat) writer_double(w, "dur", (double)e->dur / 1000.0, 3);
+    writer_int(w, "pid", 1);
+    writer_int(w, "tid", tid);
+    if (!e->cat || e->value > 0.0) {
+        writer_begin_object(w, "args");
+        if (e->cat) writer_int(w, "bytes", (long long)e->value);
+        else writer_double(w, e->name, e->value, -1);
+        writer_end_object(w);
+    }
+    writer_end_object(w);
+}
+
+static void write_thread_name(OutputWriter* w, int tid, const char* name) {
+    writer_begin_object(w, NULL);
+    writer_string(w, "name", "thread_name");
+    writer_string(w, "ph", "M");
+    writer_int(w, "pid", 1);
+    writer_int(w, "tid", tid);
+    writer_begin_object(w, "args");
+    writer_string(w, "name", name);
+    writer_end_object(w);
+    writer_end_object(w);
+}
+
+int trace_write(const char* path) {
+    if (!path) return -1;
+    OutputWriter w;
+    writer_init(&w, OUTPUT_JSONL);
+    writer_begin_object(&w, NULL);
+    writer_begin_array(&w, "traceEvents");
+
+    long long dropped = 0;
+    pthread_mutex_lock(&g_lock);
+    for (TraceBuffer* b = g_buffers; b; b = b->next) {
+        char label[48];
+        if (b->thread_name[0]) snprintf(label, sizeof(label), "%s", b->thread_name);
+        else snprintf(label, sizeof(label), "thread %d", b->tid);
+        write_thread_name(&w, b->tid, label);
+        for (TraceChunk* c = b->head; c; c = c->next) {
+            for (size_t i = 0; i < c->fill; i++) write_event(&w, &c->ev[i], b->tid);
+            if (c == b->tail) break;
+        }
+        dropped += (long long)b->dropped;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    writer_end_array(&w);
+    writer_string(&w, "displayTimeUnit", "ms");
+    writer_begin_object(&w, "otherData");
+    writer_int(&w, "dropped_events", dropped);
+    writer_end_object(&w);
+    writer_end_object(&w);
+
+    int rc = writer_end_record(&w);
+    FILE* f = (rc == 0 ? fopen(path, "wb") : NULL);
+    if (rc == 0 && !f) rc = -2;
+    if (f) {
+        rc = writer_flush(&w, f);
+        if (fclose(f) != 0 && rc == 0) rc = -3;
+    }
+    writer_free(&w);
+    return rc;
+}
@@ -0,0 +1,265 @@
+#include "truepeak.h"
+#include "dsp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef DSP_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+// ---------- Interpolation filter ----------
+
+// BS.1770-4 Annex 2, one row per output phase, oldest input sample last.
+static const float TP_COEFFS[TRUEPEAK_PHASES][TRUEPEAK_TAPS] = {
+    { 0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+     -0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+      0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+    {-0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+     -0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+      0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+    {-0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f,
+     -0.2003173828125f,  0.7797851562500f,  0.4650878906250f, -0.1665039062500f,
+      0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+    {-0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f,
+     -0.1022949218750f,  0.9721679687500f,  0.1373291015625f, -0.0594482421875f,
+      0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f },
+};
+
+#define TP_HISTORY (TRUEPEAK_TAPS - 1)
+#define TP_BLOCK   1024            // frames per channel run, kept on the stack
+
+// Largest |y| over the four interpolated phases of x[TP_HISTORY .. TP_HISTORY+count).
+#ifdef DSP_HAVE_SSE2
+static float run_peak(const float* x, size_t count) {
+    __m128 h[TRUEPEAK_TAPS];
+    for (int k = 0; k < TRUEPEAK_TAPS; k++) {
+        // tap k of all four phases, applied to x[i + k]
+        int j = TRUEPEAK_TAPS - 1 - k;
+        h[k] = _mm_set_ps(TP_COEFFS[3][j], TP_COEFFS[2][j], TP_COEFFS[1][j], TP_COEFFS[0][j]);
+    }
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 best = _mm_setzero_ps();
+
+    for (size_t i = 0; i < count; i++) {
+        const float* w = x + i;
+        __m128 a0 = _mm_mul_ps(h[0], _mm_set1_ps(w[0]));
+        __m128 a1 = _mm_mul_ps(h[1], _mm_set1_ps(w[1]));
+        __m128 a2 = _mm_mul_ps(h[2], _mm_set1_ps(w[2]));
+        __m128 a3 = _mm_mul_ps(h[3], _mm_set1_ps(w[3]));
+        for (int k = 4; k < TRUEPEAK_TAPS; k += 4) {
+            a0 = _mm_add_ps(a0, _mm_mul_ps(h[k],   _mm_set1_ps(w[k])));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(h[k+1], _mm_set1_ps(w[k+1])));
+            a2 = _mm_add_ps(a2, _mm_mul_ps(h[k+2], _mm_set1_ps(w[k+2])));
+            a3 = _mm_add_ps(a3, _mm_mul_ps(h[k+3], _mm_set1_ps(w[k+3])));
+        }
+        __m128 y = _mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3));
+        best = _mm_max_ps(best, _mm_and_ps(y, abs_mask));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, best);
+    float m = lanes[0];
+    for (int p = 1; p < 4; p++) if (lanes[p] > m) m = lanes[p];
+    return m;
+}
+#else
+static float run_peak(const float* x, size_t count) {
+    float best = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const float* w = x + i;
+        for (int p = 0; p < TRUEPEAK_PHASES; p++) {
+            float y = 0.0f;
+            for (int k = 0; k < TRUEPEAK_TAPS; k++) y += TP_COEFFS[p][TRUEPEAK_TAPS - 1 - k] * w[k];
+            y = fabsf(y);
+            if (y > best) best = y;
+        }
+    }
+    return best;
+}
+#endif
+
+// ---------- Streaming meter ----------
+
+static int reserve_seconds(TruePeakMeter* m, size_t seconds) {
+    if (seconds <= m->peak_cap) return 0;
+    size_t cap = m->peak_cap ? m->peak_cap : 64;
+    while (cap < seconds) cap *= 2;
+    float* p = (float*)realloc(m->peak, sizeof(float) * cap);
+    if (!p) return -1;
+    memset(p + m->peak_cap, 0, sizeof(float) * (cap - m->peak_cap));
+    m->peak = p;
+    m->peak_cap = cap;
+    return 0;
+}
+
+int true_peak_init(TruePeakMeter* m, int sample_rate, int channels, size_t expected_frames) {
+    if (!m || sample_rate <= 0 || channels <= 0) return -1;
+    memset(m, 0, sizeof(*m));
+    m->sample_rate = sample_rate;
+    m->channels = channels;
+    m->history = (float*)calloc((size_t)channels * TP_HISTORY, sizeof(float));
+    if (!m->history) return -1;
+    if (reserve_seconds(m, expected_frames / sample_rate + 1) != 0) {
+        true_peak_free(m);
+        return -1;
+    }
+    return 0;
+}
+
+int true_peak_fork(const TruePeakMeter* parent, TruePeakMeter* child, size_t expected_frames) {
+    if (true_peak_init(child, parent->sample_rate, parent->channels, expected_frames) != 0) return -1;
+    child->head = (float*)malloc(sizeof(float) * TP_HISTORY * (size_t)parent->channels);
+    if (!child->head) {
+        true_peak_free(child);
+        return -1;
+    }
+    return 0;
+}
+
+int true_peak_push(TruePeakMeter* m, const float* interleaved, size_t count, size_t first_frame) {
+    if (!m || !interleaved) return -1;
+    if (count == 0) return 0;
+    int channels = m->channels;
+
+    // a fork's first frames become its filter history; they are measured at merge
+    if (m->head && m->head_len < TP_HISTORY) {
+        if (m->head_len == 0) m->first = first_frame;
+        size_t take = (count < TP_HISTORY - m->head_len ? count : TP_HISTORY - m->head_len);
+        memcpy(m->head + m->head_len * channels, interleaved, sizeof(float) * take * channels);
+        m->head_len += take;
+        if (m->head_len == TP_HISTORY) {
+            for (int c = 0; c < channels; c++) {
+                for (size_t i = 0; i < TP_HISTORY; i++) {
+                    m->history[(size_t)c * TP_HISTORY + i] = m->head[i * channels + c];
+                }
+            }
+        }
+        m->frames += take;
+        if (first_frame + take > m->end_frame) m->end_frame = first_frame + take;
+        interleaved += take * channels;
+        first_frame += take;
+        count -= take;
+        if (count == 0) return 0;
+    }
+
+    size_t end = first_frame + count;
+    size_t sr = (size_t)m->sample_rate;
+    if (reserve_seconds(m, (end - 1) / sr + 1) != 0) return -1;
+
+    // one channel of one block at a time, behind that channel's filter history
+    float run[TP_HISTORY + TP_BLOCK];
+    float sp = (float)m->sample_peak;
+
+    for (size_t b0 = first_frame; b0 < end; b0 += TP_BLOCK) {
+        size_t n = (end - b0 < TP_BLOCK ? end - b0 : TP_BLOCK);
+        const float* src = interleaved + (b0 - first_frame) * channels;
+        for (int c = 0; c < channels; c++) {
+            float* hist = m->history + (size_t)c * TP_HISTORY;
+            memcpy(run, hist, sizeof(float) * TP_HISTORY);
+            for (size_t i = 0; i < n; i++) {
+                float v = src[i * channels + c];
+                run[TP_HISTORY + i] = v;
+                if (fabsf(v) > sp) sp = fabsf(v);
+            }
+
+            // split at second boundaries for the per-second track
+            size_t f = b0;
+            while (f < b0 + n) {
+                size_t sec = f / sr;
+                size_t stop = (sec + 1) * sr;
+                if (stop > b0 + n) stop = b0 + n;
+                float p = run_peak(run + (f - b0), stop - f);
+                if (p > m->peak[sec]) m->peak[sec] = p;
+                f = stop;
+            }
+            memcpy(hist, run + n, sizeof(float) * TP_HISTORY);
+        }
+    }
+
+    m->sample_peak = sp;
+    m->frames += count;
+    if (end > m->end_frame) m->end_frame = end;
+    return 0;
+}
+
+int true_peak_merge(TruePeakMeter* dst, const TruePeakMeter* src) {
+    if (!dst || !src) return -1;
+
+    // Measure the fork's head behind dst's history (silence after a gap); once
+    // the head is full, the fork's own history takes over.
+    if (src->head_len > 0) {
+        if (dst->end_frame != src->first) {
+            memset(dst->history, 0, sizeof(float) * (size_t)dst->channels * TP_HISTORY);
+        }
+        if (true_peak_push(dst, src->head, src->head_len, src->first) != 0) return -1;
+    }
+
+    size_t n = (src->end_frame + src->sample_rate - 1) / src->sample_rate;
+    if (reserve_seconds(dst, n) != 0) return -1;
+    for (size_t i = 0; i < n && i < src->peak_cap; i++) {
+        if (src->peak[i] > dst->peak[i]) dst->peak[i] = src->peak[i];
+    }
+    if (src->sample_peak > dst->sample_peak) dst->sample_peak = src->sample_peak;
+    dst->frames += src->frames - src->head_len;
+    if (src->frames > src->head_len) {
+        memcpy(dst->history, src->history, sizeof(float) * (size_t)dst->channels * TP_HISTORY);
+    }
+    if (src->end_frame > dst->end_frame) dst->end_frame = src->end_frame;
+    return 0;
+}
+
+static double linear_to_db(double x) {
+    return (x > 1e-6 ? 20.0 * log10(x) : TRUEPEAK_SILENCE);
+}
+
+int true_peak_finish(const TruePeakMeter* m, TruePeakResult* out) {
+    if (!m || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    out->sample_peak_dbfs = linear_to_db(m->sample_peak);
+
+    size_t seconds = (m->end_frame + m->sample_rate - 1) / m->sample_rate;
+    double best = m->sample_peak;   // never report less than the sample peak
+    for (size_t s = 0; s < seconds; s++) {
+        if (m->peak[s] > best) best = m->peak[s];
+    }
+    out->true_peak_dbtp = linear_to_db(best);
+
+    if (seconds == 0) return 0;
+    out->track = (float*)malloc(sizeof(float) * seconds);
+    if (!out->track) return 0;
+    for (size_t s = 0; s < seconds; s++) out->track[s] = (float)linear_to_db(m->peak[s]);
+    out->track_len = seconds;
+    return 0;
+}
+
+void true_peak_free(TruePeakMeter* m) {
+    if (!m) return;
+    free(m->history);
+    free(m->peak);
+    free(m->head);
+    m->history = NULL;
+    m->peak = NULL;
+    m->head = NULL;
+    m->peak_cap = 0;
+    m->head_len = 0;
+}
+
+// ---------- One-shot ----------
+
+int compute_true_peak(const float* interleaved, size_t frames, int sample_rate, int channels,
+                      TruePeakResult* out) {
+    if (!interleaved || frames == 0 || !out) return -1;
+    TruePeakMeter m;
+    if (true_peak_init(&m, sample_rate, channels, frames) != 0) return -1;
+    int rc = true_peak_push(&m, interleaved, frames, 0);
+    if (rc == 0) rc = true_peak_finish(&m, out);
+    true_peak_free(&m);
+    return rc;
+}
+
+void free_true_peak_result(TruePeakResult* r) {
+    if (!r) return;
+    free(r->track);
+    r->track = NULL;
+    r->track_len = 0;
+}